@@ -1,9 +1,19 @@
 #pragma once
 
+#include "credit_tracker.h"
+#include "outbound_queue.h"
+
+#include <cstdint>
 #include <string>
 #include <map>
+#include <vector>
 #include <functional>
 #include <memory>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 // Forward declarations
 namespace boost {
@@ -23,19 +33,54 @@ public:
         std::string client_secret;
     };
 
+    // Where the WebSocket connects; defaults to Deribit's testnet over TLS
+    struct Endpoint {
+        std::string host = "test.deribit.com";
+        std::string port = "443";
+        std::string path = "/ws/api/v2";
+        bool tls = true;
+    };
+    
+    // Transport-agnostic WebSocket session (TLS or plain TCP); defined in api_client.cpp
+    class WebSocketImpl;
+    
+    // Client-side rate limiting against Deribit's credit pools. QUEUE delays a
+    // request until its credits are available; REJECT fails it at once with a
+    // too_many_requests error, as the exchange would.
+    enum class RateLimitMode { OFF, QUEUE, REJECT };
+    
+    // Order entry (buy/sell/edit/cancel*) draws on the matching-engine pool,
+    // everything else on the non-matching pool
+    enum class CreditPool { MATCHING_ENGINE, NON_MATCHING };
+    
+    // Credits charged per request
+    static constexpr int64_t kRequestCost = 500;
+
     // Constructor
     ApiClient(const Auth& auth);
     ~ApiClient();
 
-    // REST API methods
+    // Order entry. With a WebSocket session these are JSON-RPC requests that
+    // block until the response with their id arrives (or kResponseTimeoutMs
+    // passes), so they must not be called from the message handler. Without a
+    // session they take the stubbed REST path.
+    static constexpr int64_t kResponseTimeoutMs = 10000;
+    
     std::string placeOrder(const std::string& instrument, 
                           bool is_buy, 
                           double price, 
                           double amount, 
-                          const std::string& order_type = "limit");
+                          const std::string& order_type = "limit",
+                          const std::string& label = "");
     
     bool cancelOrder(const std::string& order_id);
     
+    // Cancel by client label, for orders whose exchange id is not known yet
+    bool cancelOrderByLabel(const std::string& label);
+    
+    // Cancel every open order on an instrument in one request
+    bool cancelAllByInstrument(const std::string& instrument);
+    
     bool modifyOrder(const std::string& order_id, 
                     double new_price,
                     double new_amount);
@@ -43,21 +88,93 @@ public:
     std::string getOrderbook(const std::string& instrument, int depth = 10);
     
     std::string getCurrentPositions();
+    
+    // Point the client at another server, e.g. a local MockExchange without TLS.
+    // Takes effect on the next connectWebSocket.
+    void setEndpoint(const Endpoint& endpoint) { endpoint_ = endpoint; }
+    const Endpoint& endpoint() const { return endpoint_; }
+    
+    // Book subscriptions use book.<instrument>.none.<depth>.<interval>;
+    // interval is "raw", "100ms" or "agg2". Set before subscribing.
+    void setBookChannel(int depth, const std::string& interval) { book_depth_ = depth; book_interval_ = interval; }
+    std::string bookChannel(const std::string& instrument) const;
+    
+    // Pin the WebSocket I/O thread to a CPU on the next connectWebSocket; -1 leaves it unpinned
+    void setCpuAffinity(int cpu) { cpu_ = cpu; }
+    
+    // Rate limiting; off by default
+    void setRateLimitMode(RateLimitMode mode);
+    RateLimitMode rateLimitMode() const;
+    void setCreditLimits(CreditPool pool, const CreditTracker::Limits& limits);
+    CreditTracker& credits(CreditPool pool);
+    
+    // Block until a request on the pool could be sent without waiting
+    void awaitCredits(CreditPool pool) const;
+    
+    static CreditPool poolFor(const std::string& endpoint);
+
+    // Round trip added to each stubbed REST request, to model exchange latency offline
+    void setMockLatency(int64_t microseconds) { mock_latency_us_ = microseconds; }
 
-    // WebSocket API methods
+    // WebSocket API methods. Responses to order entry requests are consumed by
+    // the client; every other frame goes to message_handler.
     void connectWebSocket(std::function<void(const std::string&)> message_handler);
     void subscribeToOrderbook(const std::string& instrument);
     void unsubscribeFromOrderbook(const std::string& instrument);
+    
+    // Subscribe to arbitrary channels; private channels (user.*) need an authenticated session
+    void subscribeToChannels(const std::vector<std::string>& channels, bool is_private = false);
+    
+    // Send a JSON-RPC request over the WebSocket. Outbound frames are scheduled
+    // by lane (cancel, modify, new order, subscription, query) from the method;
+    // frames with the same order_key (an order id or label) keep their order.
+    // The request is charged to its credit pool before it is queued; returns
+    // false when there is no session or the rate limiter rejected it.
+    bool sendWebSocketRequest(const std::string& method,
+                              const std::string& params,
+                              const std::string& order_key = "");
     void closeWebSocket();
 
 private:
     Auth auth_;
+    int64_t mock_latency_us_ = 0;
+    std::atomic<uint64_t> ws_request_id_{10000};  // above the fixed auth and subscription ids
+    std::atomic<RateLimitMode> rate_limit_mode_{RateLimitMode::OFF};
+    CreditTracker matching_credits_;
+    CreditTracker non_matching_credits_;
+    
+    // Charge a request to its pool; false when it must not be sent. Takes a REST
+    // endpoint or a JSON-RPC method.
+    bool chargeCredits(const std::string& endpoint);
     std::string generateSignature(const std::string& timestamp, const std::string& nonce, const std::string& data);
     std::string makeRequest(const std::string& method, const std::string& endpoint, const std::map<std::string, std::string>& params = {});
     
+    // Send a JSON-RPC request and wait for its response frame; falls back to
+    // makeRequest when there is no session
+    std::string call(const std::string& method, const std::string& params, const std::string& order_key);
+    
+    // Hand a response frame to the call waiting on its id; false for any other frame
+    bool completeCall(const std::string& frame);
+    
+    // Fail every waiting call, e.g. when the session closes
+    void failCalls(const std::string& response);
+    
+    // Frame one request and queue it on the session's outbound lanes
+    void queueRequest(WebSocketImpl& impl, uint64_t id, const std::string& method,
+                      const std::string& params, const std::string& order_key);
+    
+    std::mutex calls_mutex_;
+    std::unordered_map<uint64_t, std::shared_ptr<std::promise<std::string>>> calls_;
+    std::atomic<size_t> calls_waiting_{0};
+    bool session_failed_ = false;  // set on a session read/write error; guarded by calls_mutex_
+    
     // WebSocket implementation details
     std::unique_ptr<boost::asio::io_context> io_context_;
     std::unique_ptr<boost::asio::ssl::context> ssl_context_;
-    class WebSocketImpl;
-    std::shared_ptr<WebSocketImpl> ws_impl_;
+    Endpoint endpoint_;
+    int book_depth_ = 10;
+    std::string book_interval_ = "100ms";
+    int cpu_ = -1;
+    std::shared_ptr<WebSocketImpl> ws_impl_;  // accessed only through std::atomic_load/store
+    std::thread io_thread_;
 };
\ No newline at end of file
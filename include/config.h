@@ -0,0 +1,68 @@
+#pragma once
+
+#include "api_client.h"
+#include "risk_engine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Startup settings for every component.
+//
+// Built-in defaults are overridden by a JSON file, then by DERIBIT_* environment
+// variables, so a host can keep its tuning in a file and its credentials in the
+// environment. See USAGE.md for the file layout and variable names.
+struct Config {
+    // Exchange connection
+    ApiClient::Endpoint endpoint;
+    ApiClient::Auth auth;                  // empty unless configured
+    ApiClient::RateLimitMode rate_limit = ApiClient::RateLimitMode::QUEUE;
+    int client_cpu = -1;                   // ApiClient I/O thread; -1 leaves it unpinned
+    
+    // Market data
+    std::vector<std::string> instruments = {"BTC-PERPETUAL", "ETH-PERPETUAL"};
+    int book_depth = 10;
+    std::string book_interval = "100ms";
+    std::string journal_dir;               // empty disables recording
+    size_t journal_file_size = 256ull << 20;
+    std::string tick_dir;                  // empty disables the tick store
+    
+    // Orders
+    size_t order_history = 10000;          // terminal orders kept queryable
+    size_t request_threads = 8;
+    
+    // Pre-trade risk, the default limits for every instrument. Perpetual
+    // amounts are USD contracts, so order size and position are in USD; the
+    // price * amount notional suits linear instruments and is off by default.
+    RiskLimits risk_limits = defaultRiskLimits();
+    uint32_t risk_max_messages = 20;       // placements and edits per window; 0 disables
+    int64_t risk_window_ms = 1000;
+    
+    static RiskLimits defaultRiskLimits();
+    
+    // WebSocket server
+    int server_port = 8080;
+    size_t server_threads = 1;
+    size_t max_connections = 16384;
+    size_t max_queued_messages = 4096;
+    std::vector<int> server_cpus;          // I/O thread CPUs, reused round-robin; empty leaves them unpinned
+    
+    // Environment lookup; std::getenv outside tests
+    using Environment = std::function<const char*(const char*)>;
+    
+    // Defaults, then the file at path (skipped when empty), then the environment.
+    // Returns false and describes the first problem in error.
+    static bool load(const std::string& path, Config& config, std::string& error,
+                     const Environment& environment = std::getenv);
+    
+    // Layers, in the order load() applies them. Unknown keys and malformed
+    // values are errors rather than silently ignored.
+    bool applyJson(const std::string& text, std::string& error);
+    bool applyEnvironment(const Environment& environment, std::string& error);
+    
+    // Set one setting by its file key ("server.threads") from its string form
+    bool set(const std::string& key, const std::string& value, std::string& error);
+};
\ No newline at end of file
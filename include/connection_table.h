@@ -0,0 +1,57 @@
+#pragma once
+
+#include "websocket_server.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Dense, recyclable connection slots.
+//
+// Slots are partitioned by I/O thread: worker w owns the contiguous range
+// [w * slots_per_worker, (w + 1) * slots_per_worker), and slots are reused LIFO
+// so the live set stays dense. A ConnectionId packs the slot with a generation
+// that is bumped on release, so a stale id never resolves to a newer connection
+// that reused the slot.
+class ConnectionTable {
+public:
+    static constexpr ConnectionId kInvalidId = 0;
+    
+    static uint32_t slotOf(ConnectionId id) { return static_cast<uint32_t>(id); }
+    static uint32_t generationOf(ConnectionId id) { return static_cast<uint32_t>(id >> 32); }
+    
+    ConnectionTable(size_t worker_count, size_t slots_per_worker);
+    
+    // Assign a slot on the worker's range and stamp the connection's id; kInvalidId when full
+    ConnectionId acquire(size_t worker, const WebSocketConnection::Pointer& connection);
+    void release(ConnectionId id);
+    
+    // Connection for an id, or null if it was released (array index + generation check)
+    WebSocketConnection::Pointer get(ConnectionId id) const;
+    
+    // Current occupant of a slot, or null (array index only)
+    WebSocketConnection::Pointer at(uint32_t slot) const;
+    std::vector<WebSocketConnection::Pointer> all() const;
+    
+    size_t size() const { return size_; }
+    size_t capacity() const { return worker_count_ * slots_per_worker_; }
+    size_t workerOf(uint32_t slot) const { return slot / slots_per_worker_; }
+    
+private:
+    struct Slot {
+        std::shared_ptr<WebSocketConnection> connection;  // accessed through std::atomic_load/store
+        uint32_t generation = 1;                          // guarded by the owning worker's free list
+    };
+    
+    struct FreeList {
+        std::mutex mutex;
+        std::vector<uint32_t> slots;
+    };
+    
+    size_t worker_count_;
+    size_t slots_per_worker_;
+    std::unique_ptr<Slot[]> slots_;
+    std::vector<std::unique_ptr<FreeList>> free_lists_;
+    std::atomic<size_t> size_{0};
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <thread>
+
+// Pin a running thread to one CPU. Returns false when the CPU does not exist,
+// the platform has no affinity support or the kernel refuses; the thread then
+// keeps running unpinned. A negative cpu is a no-op that succeeds.
+bool pinThreadToCpu(std::thread& thread, int cpu);
+
+// Pin the calling thread, with the same rules
+bool pinCurrentThreadToCpu(int cpu);
\ No newline at end of file
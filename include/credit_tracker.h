@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+// Client-side model of one of Deribit's rate-limit credit pools.
+//
+// Each request costs a number of credits; the pool refills continuously up to
+// its maximum, so a full pool allows a burst of max_credits / cost requests and
+// then refill_per_second / cost requests per second. Tracking the pool locally
+// lets requests go out at exactly the sustainable rate instead of being
+// rejected by the exchange or spaced by a fixed sleep.
+//
+// reserve() lets the balance go negative: each caller is told how long to wait
+// before sending, so queued requests leave in order at the refill rate.
+class CreditTracker {
+public:
+    struct Limits {
+        int64_t max_credits = 50000;
+        int64_t refill_per_second = 10000;
+        int64_t max_queue_ns = 5000000000;  // reserve() fails beyond this wait
+    };
+    
+    CreditTracker();
+    explicit CreditTracker(const Limits& limits);
+    
+    void setLimits(const Limits& limits);
+    Limits limits() const;
+    
+    // Take the credits if they are available now
+    bool tryAcquire(int64_t cost, int64_t now_ns);
+    
+    // Take the credits now or in the future; returns the wait in nanoseconds
+    // before the request may be sent, or -1 when the queue is too long
+    int64_t reserve(int64_t cost, int64_t now_ns);
+    
+    // Wait until the credits would be available, without taking them
+    int64_t waitTime(int64_t cost, int64_t now_ns) const;
+    
+    // Current balance (negative while requests are queued)
+    int64_t available(int64_t now_ns) const;
+    
+    // Sleep-based helpers on the steady clock
+    bool tryAcquire(int64_t cost);
+    bool acquire(int64_t cost);
+    void waitFor(int64_t cost) const;
+    
+    static int64_t nowNs();
+    
+private:
+    // Credits at now_ns; mutex_ must be held
+    double balanceAt(int64_t now_ns) const;
+    void refill(int64_t now_ns);
+    
+    mutable std::mutex mutex_;
+    Limits limits_;
+    double credits_;
+    int64_t last_refill_ns_ = 0;
+};
\ No newline at end of file
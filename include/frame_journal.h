@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// One recorded frame, pointing into the mapped journal
+struct JournalRecord {
+    int64_t realtime_ns = 0;  // CLOCK_REALTIME at receipt
+    uint64_t tsc = 0;         // time-stamp counter at receipt
+    std::string_view frame;
+};
+
+// Append-only, memory-mapped journal of raw inbound frames.
+//
+// Files are named <prefix>-<sequence>.journal and preallocated to a fixed size.
+// Each record is a small header (length, CLOCK_REALTIME and TSC stamps) plus
+// the frame bytes, 8-byte aligned; the length is stored last with release
+// semantics, so a reader never sees a partial record. When a file is full the
+// writer switches to the next one, which a background thread has already
+// created, preallocated and mapped. Unmapping and trimming the finished file
+// happen there too, so append() never makes a system call beyond reading the
+// clock. If the next file isn't ready in time the frame is dropped and counted.
+//
+// append() must be called from a single thread (the I/O thread).
+class FrameJournal {
+public:
+    static constexpr size_t kDefaultFileSize = 256u << 20;
+    
+    FrameJournal(const std::string& directory,
+                 const std::string& prefix = "marketdata",
+                 size_t file_size = kDefaultFileSize);
+    ~FrameJournal();
+    
+    bool isOpen() const { return current_.base != nullptr; }
+    
+    bool append(const std::string& frame) { return append(frame.data(), frame.size()); }
+    bool append(const char* data, size_t size) { return append(data, size, realtimeNs(), readTsc()); }
+    bool append(const char* data, size_t size, int64_t realtime_ns, uint64_t tsc);
+    
+    // Finish the current file and stop the background thread
+    void close();
+    
+    std::string currentPath() const { return current_.path; }
+    uint64_t framesWritten() const { return frames_written_.load(std::memory_order_relaxed); }
+    uint64_t framesDropped() const { return frames_dropped_.load(std::memory_order_relaxed); }
+    uint64_t rotations() const { return rotations_.load(std::memory_order_relaxed); }
+    
+    static int64_t realtimeNs();
+    static uint64_t readTsc();
+    
+    // Whether a frame must stay off disk because it carries credentials: a
+    // public/auth request, or an auth or token refresh reply with an access or
+    // refresh token. Every other frame is recorded.
+    static bool carriesToken(std::string_view frame);
+    
+    // Journal files for a prefix in sequence order
+    static std::vector<std::string> listFiles(const std::string& directory, const std::string& prefix = "marketdata");
+    
+private:
+    struct Mapping {
+        int fd = -1;
+        char* base = nullptr;
+        size_t size = 0;
+        std::string path;
+    };
+    
+    bool mapFile(Mapping& mapping, const std::string& path);
+    
+    // Unmap and trim to the bytes written
+    static void finish(Mapping& mapping, size_t used);
+    
+    std::string pathFor(uint64_t sequence) const;
+    
+    // Swap in the prepared file; false if it isn't ready
+    bool rotate();
+    void backgroundLoop();
+    
+    std::string directory_;
+    std::string prefix_;
+    size_t file_size_;
+    
+    // Writer state, owned by the appending thread
+    Mapping current_;
+    size_t offset_ = 0;
+    
+    // Handoff with the background thread
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    Mapping next_;
+    bool next_ready_ = false;
+    std::vector<std::pair<Mapping, size_t>> retired_;
+    uint64_t next_sequence_ = 0;
+    bool stopping_ = false;
+    std::thread worker_;
+    
+    std::atomic<uint64_t> frames_written_{0};
+    std::atomic<uint64_t> frames_dropped_{0};
+    std::atomic<uint64_t> rotations_{0};
+};
+
+// Sequential reader over one journal file
+class JournalReader {
+public:
+    explicit JournalReader(const std::string& path);
+    ~JournalReader();
+    
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+    
+    bool isOpen() const { return base_ != nullptr; }
+    
+    // Next complete record; false at the end of the data written so far
+    bool next(JournalRecord& record);
+    void rewind();
+    
+private:
+    int fd_ = -1;
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    size_t offset_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// HDR-style latency histogram with nanosecond resolution.
+//
+// Values are counted in log-linear buckets: each power of two is split into
+// 2^(precision_bits-1) linear sub-buckets, so any recorded value is reported
+// to within 1 part in 2^(precision_bits-1) (0.1% at the default 11 bits)
+// while memory stays fixed whatever the sample count. Recording is a few
+// shifts and an increment. A histogram is not safe for concurrent writers:
+// give each thread its own and merge() them afterwards.
+class LatencyHistogram {
+public:
+    // Values above max_value_ns are counted as max_value_ns
+    explicit LatencyHistogram(int64_t max_value_ns = 60000000000LL, int precision_bits = 11);
+    
+    void record(int64_t value_ns, uint64_t count = 1);
+    
+    // Coordinated-omission correction for loads paced at expected_interval_ns:
+    // a sample that stalled the sender past its next send also accounts for
+    // the sends that should have happened meanwhile, which would each have
+    // waited one interval less.
+    void recordCorrected(int64_t value_ns, int64_t expected_interval_ns);
+    
+    // Adds other's samples; both must share max value and precision.
+    // Returns false, leaving this unchanged, when they do not.
+    bool merge(const LatencyHistogram& other);
+    void reset();
+    
+    uint64_t count() const { return total_; }
+    int64_t min() const { return total_ ? min_ : 0; }
+    int64_t max() const { return max_; }
+    double mean() const;
+    
+    // Smallest recorded value v such that percentile% of samples are <= v,
+    // reported as the upper end of v's bucket (never above max())
+    int64_t valueAtPercentile(double percentile) const;
+    
+    // "p50 120 / p90 ... / max 9840 ns", or in us/ms when divisor is 1000/1000000
+    std::string summary(const std::string& unit = "ns", int64_t divisor = 1) const;
+    
+    // Percentile distribution as "percentile,value_ns,count" lines, for plotting
+    std::string toCsv() const;
+    
+private:
+    size_t indexOf(int64_t value) const;
+    int64_t lowestValueAt(size_t index) const;
+    int64_t highestValueAt(size_t index) const;
+    
+    int64_t max_value_;
+    int precision_bits_;
+    int64_t sub_bucket_count_;
+    int64_t sub_bucket_half_count_;
+    int64_t sub_bucket_mask_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    int64_t min_ = INT64_MAX;
+    int64_t max_ = 0;
+    double sum_ = 0.0;
+};
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "api_client.h"
+#include "message_router.h"
+#include "frame_journal.h"
 
 #include <string>
 #include <vector>
@@ -10,6 +12,8 @@
 #include <memory>
 #include <atomic>
 
+#include <nlohmann/json_fwd.hpp>
+
 // Structure to represent an orderbook
 struct Orderbook {
     struct Level {
@@ -20,9 +24,13 @@ struct Orderbook {
     std::string instrument;
     std::vector<Level> bids;
     std::vector<Level> asks;
-    int64_t timestamp;
+    int64_t timestamp;  // ns since the epoch: the exchange time when the update carries one
 };
 
+// Serialize a book for WebSocketServer clients:
+// {"type": "orderbook", "instrument", "timestamp", "bids": [[price, size], ...], "asks": [...]}
+std::string orderbookToJson(const Orderbook& orderbook);
+
 // Market data client to handle orderbook updates
 class MarketDataClient {
 public:
@@ -49,6 +57,19 @@ public:
     // Process incoming market data
     void processMessage(const std::string& message);
     
+    // Apply an already parsed book.* notification
+    void onBookUpdate(const std::string& channel, const nlohmann::json& data);
+    
+    // Route inbound frames through a shared router instead of parsing them here;
+    // registers the book.* route. Call before start().
+    void setRouter(std::shared_ptr<MessageRouter> router);
+    void registerRoutes(MessageRouter& router);
+    
+    // Record every raw inbound frame except those carrying tokens (see
+    // FrameJournal::carriesToken), stamped on receipt, before they are
+    // processed. Call before start().
+    void setJournal(std::shared_ptr<FrameJournal> journal);
+    
 private:
     std::shared_ptr<ApiClient> api_client_;
     std::atomic<bool> running_;
@@ -64,6 +85,9 @@ private:
     // Callbacks
     OrderbookUpdateCallback orderbook_callback_;
     
+    std::shared_ptr<MessageRouter> router_;
+    std::shared_ptr<FrameJournal> journal_;
+    
     // Initial fetch for new subscriptions
     void fetchInitialOrderbook(const std::string& instrument);
 };
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json_fwd.hpp>
+
+// Inbound dispatch for the exchange WebSocket.
+//
+// Each frame is parsed once. Subscription notifications are handed to the
+// handler registered for the longest matching channel prefix ("book.",
+// "user.orders.", ...) together with the already parsed "data" member;
+// JSON-RPC responses go to the response handler.
+class MessageRouter {
+public:
+    using ChannelHandler = std::function<void(const std::string& channel, const nlohmann::json& data)>;
+    using ResponseHandler = std::function<void(const nlohmann::json& message)>;
+    
+    // Register before frames start arriving; routes are not guarded against concurrent changes
+    void addRoute(const std::string& prefix, ChannelHandler handler);
+    void setResponseHandler(ResponseHandler handler);
+    
+    void route(const std::string& message);
+    
+    uint64_t routedCount() const { return routed_; }
+    uint64_t unroutedCount() const { return unrouted_; }
+    
+private:
+    struct Route {
+        std::string prefix;
+        ChannelHandler handler;
+    };
+    
+    std::vector<Route> routes_;  // longest prefix first
+    ResponseHandler response_handler_;
+    std::atomic<uint64_t> routed_{0};
+    std::atomic<uint64_t> unrouted_{0};
+};
\ No newline at end of file
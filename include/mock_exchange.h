@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Settings for MockExchange
+struct MockExchangeConfig {
+    std::string address = "127.0.0.1";
+    unsigned short port = 0;              // 0 picks a free port; see MockExchange::port()
+    std::vector<std::string> instruments = {"BTC-PERPETUAL"};
+
+    // Synthetic books: a random walk of the mid, book_depth levels a side
+    double book_updates_per_second = 100; // per instrument
+    size_t book_depth = 10;
+    double initial_price = 50000.0;
+    double tick_size = 0.5;
+    double level_size = 10.0;             // largest random size of a level
+
+    // Share of a marketable order filled on arrival; the rest rests on the book.
+    // Resting orders fill once the walk crosses their price.
+    double fill_ratio = 1.0;
+    bool fill_resting = true;
+
+    uint64_t seed = 42;
+};
+
+// A local stand-in for Deribit's WebSocket JSON-RPC API.
+//
+// Speaks plain ws:// on one I/O thread and answers public/auth,
+// public|private/subscribe and unsubscribe, public/get_order_book,
+// private/buy, sell, edit, cancel, cancel_by_label and
+// cancel_all_by_instrument. Books move on a timer at the configured rate and
+// are pushed on book.<instrument>.* channels; orders are matched against them
+// and fills are pushed on user.orders.*, user.trades.* and trades.<instrument>.*.
+// Point ApiClient at it with setEndpoint({"127.0.0.1", port, "/ws/api/v2", false}).
+class MockExchange {
+public:
+    struct Stats {
+        uint64_t connections = 0;
+        uint64_t requests = 0;
+        uint64_t messages_sent = 0;
+        uint64_t messages_dropped = 0;    // book frames skipped for clients that fell behind
+        uint64_t book_updates = 0;
+        uint64_t orders = 0;
+        uint64_t fills = 0;
+    };
+
+    explicit MockExchange(MockExchangeConfig config = MockExchangeConfig());
+    ~MockExchange();
+
+    MockExchange(const MockExchange&) = delete;
+    MockExchange& operator=(const MockExchange&) = delete;
+
+    // Binds and starts the I/O thread; false if the address cannot be bound
+    bool start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    // The bound port, valid after start()
+    unsigned short port() const { return port_; }
+
+    Stats stats() const;
+
+private:
+    struct Impl;
+
+    MockExchangeConfig config_;
+    std::shared_ptr<Impl> impl_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    unsigned short port_ = 0;
+};
\ No newline at end of file
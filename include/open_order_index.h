@@ -0,0 +1,83 @@
+#pragma once
+
+#include "order.h"
+#include "order_table.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Live open orders grouped by instrument and side.
+//
+// Each (instrument, side) pair keeps an intrusive doubly linked list of order
+// handles, with the links stored in an array indexed by OrderTable slot, so
+// adding or removing an order is O(1) and a query visits only its result.
+// Lists are kept in insertion order; visitors see the newest order first.
+//
+// Not thread-safe: the owner serializes access.
+class OpenOrderIndex {
+public:
+    void add(OrderHandle handle, const std::string& instrument, Order::Side side);
+    bool remove(OrderHandle handle);
+    bool contains(OrderHandle handle) const;
+    
+    size_t size() const { return size_; }
+    size_t count(const std::string& instrument) const;
+    size_t count(const std::string& instrument, Order::Side side) const;
+    
+    template<typename Visitor>
+    void forEach(const std::string& instrument, Order::Side side, Visitor&& visitor) const {
+        auto it = lists_.find(instrument);
+        if (it != lists_.end()) {
+            visitList(it->second[sideIndex(side)], visitor);
+        }
+    }
+    
+    template<typename Visitor>
+    void forEach(const std::string& instrument, Visitor&& visitor) const {
+        auto it = lists_.find(instrument);
+        if (it != lists_.end()) {
+            visitList(it->second[0], visitor);
+            visitList(it->second[1], visitor);
+        }
+    }
+    
+    template<typename Visitor>
+    void forEach(Visitor&& visitor) const {
+        for (const auto& pair : lists_) {
+            visitList(pair.second[0], visitor);
+            visitList(pair.second[1], visitor);
+        }
+    }
+    
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+    
+    struct List {
+        uint32_t head = kNone;  // oldest
+        uint32_t tail = kNone;  // newest
+        size_t size = 0;
+    };
+    
+    struct Link {
+        OrderHandle handle = OrderTable::kInvalidHandle;
+        uint32_t prev = kNone;
+        uint32_t next = kNone;
+        List* list = nullptr;  // unordered_map values never move
+    };
+    
+    static size_t sideIndex(Order::Side side) { return side == Order::Side::BUY ? 0 : 1; }
+    
+    template<typename Visitor>
+    void visitList(const List& list, Visitor& visitor) const {
+        for (uint32_t slot = list.tail; slot != kNone; slot = links_[slot].prev) {
+            visitor(links_[slot].handle);
+        }
+    }
+    
+    std::vector<Link> links_;  // indexed by OrderTable slot
+    std::unordered_map<std::string, std::array<List, 2>> lists_;
+    size_t size_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Dense per-instrument id assigned by the PositionEngine
+using InstrumentId = uint32_t;
+
+// Structure to represent an order
+struct Order {
+    enum class Side { BUY, SELL };
+    enum class Type { LIMIT, MARKET };
+    enum class Status { PENDING, OPEN, FILLED, PARTIALLY_FILLED, CANCELLED, REJECTED };
+    
+    std::string order_id;
+    std::string label;       // client-assigned label, empty if none
+    std::string instrument;
+    Side side;
+    Type type;
+    double price;
+    double amount;
+    double filled_amount = 0.0;
+    Status status = Status::PENDING;
+    std::string error_message;
+    int64_t creation_timestamp;
+    int64_t last_update_timestamp;
+};
+
+// A fill reported on user.trades
+struct Trade {
+    std::string trade_id;
+    std::string order_id;
+    std::string label;
+    std::string instrument;
+    Order::Side side;
+    double price;
+    double amount;
+    double fee = 0.0;
+    int64_t timestamp;
+};
+
+// Account summary reported on user.portfolio
+struct Portfolio {
+    std::string currency;
+    double equity = 0.0;
+    double balance = 0.0;
+    double available_funds = 0.0;
+    double margin_balance = 0.0;
+    double initial_margin = 0.0;
+    double maintenance_margin = 0.0;
+    double total_pl = 0.0;
+};
\ No newline at end of file
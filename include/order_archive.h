@@ -0,0 +1,68 @@
+#pragma once
+
+#include "order.h"
+
+#include <bitset>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Append-only on-disk log of terminal orders.
+//
+// Each record is a length-prefixed binary encoding of one Order. The file is
+// never rewritten; the in-memory index is sparse, one entry per block of
+// records holding the block's file offset, the running maximum update
+// timestamp (for time range seeks) and a small hash filter of the block's
+// order ids and labels (so a lookup reads only candidate blocks). The index is
+// rebuilt by scanning the file on open, and a torn trailing record left by a
+// crash is truncated away.
+class OrderArchive {
+public:
+    explicit OrderArchive(const std::string& path, size_t block_size = 64);
+    
+    bool isOpen() const;
+    const std::string& path() const { return path_; }
+    
+    void append(const Order& order);
+    
+    // Number of archived orders
+    size_t size() const;
+    
+    // Up to `limit` orders starting at record `first` (0 = oldest archived)
+    std::vector<Order> read(size_t first, size_t limit) const;
+    
+    // Up to `limit` orders, newest first, after skipping the `skip` newest
+    std::vector<Order> readNewest(size_t skip, size_t limit) const;
+    
+    // Up to `limit` orders last updated at or after `since`, oldest first
+    std::vector<Order> readSince(int64_t since, size_t limit) const;
+    
+    // Most recently archived record whose order id or label is `order_ref`
+    bool find(const std::string& order_ref, Order& order) const;
+    
+private:
+    static constexpr size_t kFilterBits = 1024;
+    
+    struct Block {
+        uint64_t offset;
+        int64_t max_timestamp;
+        std::bitset<kFilterBits> keys;  // order ids and labels
+    };
+    
+    void rebuildIndex();
+    void indexRecord(uint64_t offset, const Order& order);
+    
+    // Read `count` records starting at `first`; mutex_ must be held
+    std::vector<Order> readLocked(size_t first, size_t count) const;
+    
+    std::string path_;
+    size_t block_size_;
+    mutable std::mutex mutex_;
+    mutable std::ofstream out_;
+    uint64_t end_offset_ = 0;
+    size_t count_ = 0;
+    int64_t max_timestamp_ = INT64_MIN;
+    std::vector<Block> blocks_;
+};
\ No newline at end of file
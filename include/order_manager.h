@@ -1,37 +1,85 @@
 #pragma once
 
 #include "api_client.h"
+#include "order.h"
+#include "order_table.h"
+#include "open_order_index.h"
+#include "order_archive.h"
+#include "order_state.h"
+#include "message_router.h"
+#include "position_engine.h"
+#include "risk_engine.h"
 
 #include <string>
 #include <vector>
+#include <deque>
 #include <map>
+#include <functional>
 #include <mutex>
+#include <atomic>
+#include <future>
 #include <memory>
 
-// Structure to represent an order
-struct Order {
-    enum class Side { BUY, SELL };
-    enum class Type { LIMIT, MARKET };
-    enum class Status { PENDING, OPEN, FILLED, PARTIALLY_FILLED, CANCELLED, REJECTED };
-    
-    std::string order_id;
-    std::string instrument;
-    Side side;
-    Type type;
+#include <nlohmann/json_fwd.hpp>
+
+namespace boost {
+    namespace asio {
+        class thread_pool;
+    }
+}
+
+// Outcome of an order request once the exchange has answered
+struct OrderAck {
+    std::string order_ref;  // label for placements, otherwise the reference passed in
+    bool success = false;
+    Order order;            // local order state after the ack
+};
+
+// A placement in flight: the label is usable at once, the ack arrives later
+struct OrderTicket {
+    std::string label;
+    OrderHandle handle = OrderTable::kInvalidHandle;
+    std::future<OrderAck> ack;
+};
+
+// One level of a desired quote ladder
+struct QuoteLevel {
+    Order::Side side;
     double price;
     double amount;
-    double filled_amount = 0.0;
-    Status status = Status::PENDING;
-    std::string error_message;
-    int64_t creation_timestamp;
-    int64_t last_update_timestamp;
+};
+
+// What a mass replace did to reach the desired ladder
+struct MassQuoteResult {
+    size_t kept = 0;
+    size_t modified = 0;
+    size_t cancelled = 0;
+    size_t placed = 0;
+    size_t failed = 0;
 };
 
 class OrderManager {
 public:
-    OrderManager(std::shared_ptr<ApiClient> api_client);
+    // Called with each terminal order as it is evicted from the history ring,
+    // without orders_mutex_ held
+    using ArchiveHandler = std::function<void(const Order&)>;
+    
+    // Called on a request thread when an async request is acked or rejected
+    using AckCallback = std::function<void(const OrderAck&)>;
     
-    // Order management functions
+    // Called for each fill received on user.trades
+    using TradeCallback = std::function<void(const Trade&)>;
+    
+    OrderManager(std::shared_ptr<ApiClient> api_client,
+                 size_t history_capacity = 10000,
+                 size_t request_threads = 8);
+    ~OrderManager();
+    
+    // Order management functions. placeOrder returns the client label assigned
+    // before the order is sent; every call below accepts it or the exchange id.
+    // With a risk engine attached, placements and edits that fail a pre-trade
+    // check are never sent: a placement is recorded as REJECTED with the failed
+    // rule in error_message, and an edit fails.
     std::string placeOrder(const std::string& instrument, 
                          Order::Side side, 
                          double price, 
@@ -44,20 +92,142 @@ public:
                    double new_price,
                    double new_amount);
     
+    // Asynchronous variants: the request is sent from a pool of request threads
+    // so many can be in flight at once. The order is tracked (PENDING) before
+    // placeOrderAsync returns.
+    OrderTicket placeOrderAsync(const std::string& instrument,
+                                Order::Side side,
+                                double price,
+                                double amount,
+                                Order::Type type = Order::Type::LIMIT,
+                                AckCallback on_ack = nullptr);
+    
+    std::future<OrderAck> cancelOrderAsync(const std::string& order_id,
+                                           AckCallback on_ack = nullptr);
+    
+    std::future<OrderAck> modifyOrderAsync(const std::string& order_id,
+                                           double new_price,
+                                           double new_amount,
+                                           AckCallback on_ack = nullptr);
+    
+    // Bulk operations. cancelAll(instrument) is a single cancel_all_by_instrument
+    // request; the per-side form cancels that side's orders as one pipelined batch.
+    // Returns the number of orders cancelled.
+    size_t cancelAll(const std::string& instrument);
+    
+    // Waits on the request threads, so it must not be called from one (an
+    // AckCallback); use cancelAllAsync there
+    size_t cancelAll(const std::string& instrument, Order::Side side);
+    
+    // Resolves with the number cancelled once the last cancel is acked; never blocks
+    std::future<size_t> cancelAllAsync(const std::string& instrument, Order::Side side);
+    
+    // Diff a desired ladder against the instrument's live orders and send only
+    // the edits, cancels and new orders needed, as one pipelined batch. Waits on
+    // the request threads, so it must not be called from one.
+    MassQuoteResult replaceQuotes(const std::string& instrument, const std::vector<QuoteLevel>& ladder);
+    
     // Query functions
+    // Orders held in memory (open, pending and the history ring), newest first
     std::vector<Order> getAllOrders() const;
+    
+    // One page of all orders: memory first, then the archive newest first,
+    // reading from disk only the records the page needs
+    std::vector<Order> getAllOrders(size_t offset, size_t limit) const;
     std::vector<Order> getOpenOrders() const;
+    std::vector<Order> getOpenOrders(const std::string& instrument) const;
+    std::vector<Order> getOpenOrders(const std::string& instrument, Order::Side side) const;
+    size_t openOrderCount(const std::string& instrument) const;
     Order getOrder(const std::string& order_id) const;
+    
+    // Lock-free state reads. Each change to an order is published through a
+    // per-order seqlock, so hot readers holding a handle never wait on the
+    // thread applying fills and never delay it.
+    OrderHandle findHandle(const std::string& order_ref) const;
+    bool getOrderState(OrderHandle handle, OrderState& state) const;
     std::map<std::string, double> getCurrentPositions() const;
+    
+    // Fill-driven positions and PnL; shared so readers can hold it directly
+    std::shared_ptr<PositionEngine> positionEngine() const { return positions_; }
+
+    Portfolio getPortfolio(const std::string& currency) const;
 
     // Event callbacks - called when receiving WebSocket updates
     void onOrderUpdate(const std::string& order_data);
     void onPositionUpdate(const std::string& position_data);
     
+    // Parsed user.orders / user.trades / user.portfolio notification data
+    // (a single object or an array of them)
+    void onOrderUpdate(const nlohmann::json& data);
+    void onTradeUpdate(const nlohmann::json& data);
+    void onPortfolioUpdate(const nlohmann::json& data);
+    
+    // Register the user.orders., user.trades. and user.portfolio. routes
+    void registerRoutes(MessageRouter& router);
+    
+    // Subscribe the exchange session to the private order, trade and portfolio channels
+    void subscribePrivateChannels();
+    
+    void setTradeCallback(TradeCallback callback);
+    
+    void setArchiveHandler(ArchiveHandler handler);
+    
+    // Append evicted orders to an on-disk archive and serve lookups and paging from it
+    void setArchive(std::shared_ptr<OrderArchive> archive);
+    
+    // Run placements and edits through pre-trade risk checks; nullptr disables them
+    void setRiskEngine(std::shared_ptr<RiskEngine> risk);
+    
 private:
+    std::string nextLabel();
+    
+    // Assign a fresh label and insert the order as PENDING, or as REJECTED when
+    // it fails the risk checks
+    OrderHandle trackNewOrder(Order& order);
+    
+    // Blocking request bodies shared by the sync and async APIs
+    OrderAck sendPlace(OrderHandle handle, const Order& order);
+    OrderAck sendCancel(const std::string& order_ref);
+    OrderAck sendModify(const std::string& order_ref, double new_price, double new_amount);
+    
+    // Run a request on the request pool, then invoke the callback and fulfil the future
+    std::future<OrderAck> submit(std::function<OrderAck()> request, AckCallback on_ack);
+    OrderAck makeAck(const std::string& order_ref, OrderHandle handle, bool success) const;
+    
+    // Handle for an exchange order id or client label; orders_mutex_ must be held
+    OrderHandle findOrder(const std::string& order_ref) const;
+    
+    // Bind the exchange id and initial state from a placement response
+    void onOrderAck(OrderHandle handle, const std::string& response);
+    
+    // Apply a status change and keep the open index and history ring in step;
+    // orders_mutex_ must be held. Terminal statuses are final, so changes out of
+    // them are ignored. Evicted orders are queued on evicted_.
+    void updateStatus(OrderHandle handle, Order& order, Order::Status status);
+    
+    // Hand queued evicted orders to the archive and handler; called after
+    // orders_mutex_ is released so disk writes never stall the order path
+    void writeEvicted();
+    void collectOpen(std::vector<Order>& result, OrderHandle handle) const;
+    
     std::shared_ptr<ApiClient> api_client_;
     mutable std::mutex orders_mutex_;
-    std::map<std::string, Order> orders_;
-    mutable std::mutex positions_mutex_;
-    std::map<std::string, double> positions_;
+    OrderTable orders_;
+    OpenOrderIndex open_orders_;
+    OrderStateTable order_states_;  // written under orders_mutex_, read without it
+    std::deque<OrderHandle> history_;  // terminal orders, oldest first
+    size_t history_capacity_;
+    ArchiveHandler archive_handler_;
+    std::shared_ptr<OrderArchive> archive_;
+    std::deque<Order> evicted_;  // out of the table, not yet archived; still served by lookups
+    std::atomic<size_t> evicted_pending_{0};
+    std::mutex archive_write_mutex_;  // one writeEvicted drains at a time, keeping archive order
+    std::string label_prefix_;
+    std::atomic<uint64_t> label_counter_{0};
+    std::shared_ptr<PositionEngine> positions_;
+    std::shared_ptr<RiskEngine> risk_;
+    mutable std::mutex portfolio_mutex_;
+    std::map<std::string, Portfolio> portfolios_;
+    TradeCallback trade_callback_;
+    std::unique_ptr<boost::asio::thread_pool> request_pool_;
 };
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "order.h"
+#include "order_table.h"
+#include "seqlock.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Mutable part of an order, published for lock-free reads
+struct OrderState {
+    OrderHandle handle = OrderTable::kInvalidHandle;
+    Order::Status status = Order::Status::PENDING;
+    double price = 0.0;
+    double amount = 0.0;
+    double filled_amount = 0.0;
+    int64_t last_update_timestamp = 0;
+};
+
+// Per-order seqlocks indexed by OrderTable slot.
+//
+// The order writer publishes each change here after applying it to the
+// OrderTable; any thread can then read a consistent OrderState for a handle
+// without taking the writer's lock. Chunks are allocated on first use and
+// never freed or moved, so readers only need the chunk pointer.
+class OrderStateTable {
+public:
+    OrderStateTable();
+    ~OrderStateTable();
+    
+    // Writer side; calls must be serialized
+    void publish(OrderHandle handle, const Order& order);
+    
+    // False if the slot was never published or now holds a different order
+    bool read(OrderHandle handle, OrderState& state) const;
+    
+private:
+    static constexpr size_t kChunkShift = 10;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkShift;
+    static constexpr size_t kMaxChunks = 16384;  // 16M order slots
+    
+    using Slot = SeqLock<OrderState>;
+    
+    std::unique_ptr<std::atomic<Slot*>[]> chunks_;  // kMaxChunks entries, each kChunkSize slots
+};
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "order.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using OrderHandle = uint64_t;
+
+// Pooled order storage with stable integer handles.
+//
+// Orders live in fixed-size chunks that never move, so a handle (and an
+// Order* obtained from it) stays valid until the order is erased. Two flat
+// open-addressing indexes map the exchange order id and the client label to
+// a handle. Like ConnectionId, a handle packs the slot with a generation that
+// is bumped on erase, so stale handles resolve to nothing.
+//
+// Not thread-safe: the owner serializes access.
+class OrderTable {
+public:
+    static constexpr OrderHandle kInvalidHandle = 0;
+    static constexpr InstrumentId kNoInstrument = UINT32_MAX;
+    
+    static uint32_t slotOf(OrderHandle handle) { return static_cast<uint32_t>(handle); }
+    static uint32_t generationOf(OrderHandle handle) { return static_cast<uint32_t>(handle >> 32); }
+    
+    OrderTable();
+    
+    // Store an order, indexing its order_id and label when non-empty. The
+    // instrument id is kept alongside so later checks skip the name lookup.
+    OrderHandle insert(Order order, InstrumentId instrument_id = kNoInstrument);
+    bool erase(OrderHandle handle);
+    
+    Order* get(OrderHandle handle);
+    const Order* get(OrderHandle handle) const;
+    
+    // Instrument id given at insert; kNoInstrument if none or the handle is stale
+    InstrumentId instrumentIdOf(OrderHandle handle) const;
+    
+    OrderHandle findById(const std::string& order_id) const;
+    OrderHandle findByLabel(const std::string& label) const;
+    
+    // Bind (or rebind) the exchange order id of a stored order
+    bool bindId(OrderHandle handle, const std::string& order_id);
+    
+    // Visit live orders in slot order
+    template<typename Visitor>
+    void forEach(Visitor&& visitor) const {
+        for (uint32_t slot = 0; slot < slot_count_; ++slot) {
+            const Entry& entry = entryAt(slot);
+            if (entry.live) {
+                visitor(handleOf(slot), entry.order);
+            }
+        }
+    }
+    
+    size_t size() const { return size_; }
+    
+private:
+    static constexpr size_t kChunkShift = 8;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkShift;
+    
+    struct Entry {
+        Order order;
+        InstrumentId instrument_id = kNoInstrument;
+        uint32_t generation = 1;
+        bool live = false;
+    };
+    
+    // Linear-probing hash index from a string key to a slot. Keys are not
+    // stored; a probe compares the cached hash, then the key in the order.
+    class Index {
+    public:
+        Index(std::string Order::*key) : key_(key), buckets_(16) {}
+        
+        uint32_t find(const OrderTable& table, const std::string& key) const;
+        void insert(const OrderTable& table, const std::string& key, uint32_t slot);
+        void erase(const std::string& key, uint32_t slot);
+        
+    private:
+        static constexpr uint32_t kEmpty = UINT32_MAX;
+        static constexpr uint32_t kTombstone = UINT32_MAX - 1;
+        
+        struct Bucket {
+            size_t hash = 0;
+            uint32_t slot = kEmpty;
+        };
+        
+        void grow();
+        
+        std::string Order::*key_;
+        std::vector<Bucket> buckets_;  // power-of-two size
+        size_t used_ = 0;              // live entries plus tombstones
+    };
+    
+    Entry& entryAt(uint32_t slot) { return chunks_[slot >> kChunkShift][slot & (kChunkSize - 1)]; }
+    const Entry& entryAt(uint32_t slot) const { return chunks_[slot >> kChunkShift][slot & (kChunkSize - 1)]; }
+    OrderHandle handleOf(uint32_t slot) const {
+        return (static_cast<OrderHandle>(entryAt(slot).generation) << 32) | slot;
+    }
+    const Entry* resolve(OrderHandle handle) const;
+    
+    std::vector<std::unique_ptr<Entry[]>> chunks_;
+    std::vector<uint32_t> free_slots_;
+    uint32_t slot_count_ = 0;
+    size_t size_ = 0;
+    Index by_id_;
+    Index by_label_;
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+// Outbound lanes, highest priority first
+enum class OutboundPriority : uint8_t {
+    CANCEL,
+    MODIFY,
+    NEW_ORDER,
+    SUBSCRIPTION,
+    QUERY,
+};
+
+// Priority scheduler for outbound frames.
+//
+// Frames wait in one FIFO lane per priority and pop() always drains the highest
+// non-empty lane, so a cancel queued behind a burst of orders or subscriptions
+// goes out next. Frames tagged with the same order key keep their submission
+// order: a frame that would overtake an earlier one for the same order pulls
+// that frame up into its own lane, just ahead of it.
+//
+// Not thread-safe; the WebSocket client drives it from its strand.
+class OutboundQueue {
+public:
+    static constexpr size_t kLanes = static_cast<size_t>(OutboundPriority::QUERY) + 1;
+    
+    void push(std::string frame, OutboundPriority priority, const std::string& order_key = "");
+    
+    // Next frame to send; false when every lane is empty
+    bool pop(std::string& frame);
+    
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+    size_t size(OutboundPriority priority) const { return lanes_[static_cast<size_t>(priority)].size(); }
+    
+    // Lane for a JSON-RPC method
+    static OutboundPriority priorityFor(const std::string& method);
+    
+private:
+    struct Entry {
+        std::string frame;
+        std::string order_key;
+        uint64_t sequence;
+    };
+    
+    // Queued frames per lane for one order key
+    using KeyCounts = std::array<uint32_t, kLanes>;
+    
+    // Move the key's frames in lower lanes up into the given lane, oldest first
+    void promote(const std::string& order_key, size_t lane);
+    
+    std::array<std::deque<Entry>, kLanes> lanes_;
+    std::unordered_map<std::string, KeyCounts> pending_;
+    size_t size_ = 0;
+    uint64_t next_sequence_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "order.h"
+#include "seqlock.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// How an instrument's size and PnL are denominated.
+//  LINEAR:  size in the base asset, PnL in the quote currency:
+//           size * (price - average_price).
+//  INVERSE: size in quote-currency contracts (USD for Deribit's BTC and ETH
+//           perpetuals and futures), PnL in the coin: size * (1/average_price - 1/price).
+//           The average entry is the harmonic mean of the fill prices.
+enum class ContractKind : uint8_t { LINEAR, INVERSE };
+
+// Position and PnL for one instrument
+struct PositionState {
+    double size = 0.0;            // signed: long > 0, short < 0
+    double average_price = 0.0;   // entry price of the open size
+    double realized_pnl = 0.0;    // in the PnL currency of the contract kind
+    double unrealized_pnl = 0.0;  // at mark_price
+    double mark_price = 0.0;
+    double fees = 0.0;
+    int64_t last_update_timestamp = 0;
+    ContractKind contract = ContractKind::INVERSE;
+};
+
+// Incremental position keeping driven by fills.
+//
+// Each instrument gets a dense InstrumentId on first use and a slot in a flat
+// array. Fills and marks update the slot in place; readers see a consistent
+// PositionState through a per-slot seqlock and the net size through a plain
+// atomic, so exposure checks by id are a single wait-free load. Looking up a
+// known instrument's id is lock-free too; only registration takes the writer
+// lock. PnL follows each instrument's ContractKind, so totals across
+// instruments only add up when they share a PnL currency.
+//
+// Writers (applyFill, updateMark, setPosition) are serialized internally.
+class PositionEngine {
+public:
+    static constexpr InstrumentId kInvalidInstrument = UINT32_MAX;
+    static constexpr size_t kMaxInstruments = 4096;
+    
+    PositionEngine();
+    
+    // Id for an instrument, registering it if needed; kInvalidInstrument when full
+    InstrumentId instrumentId(const std::string& instrument);
+    
+    // Id for a known instrument without registering it; lock-free
+    InstrumentId findInstrument(const std::string& instrument) const;
+    
+    // Contract kind used from the next fill or mark. New instruments default
+    // to defaultContractKind(name).
+    void setContractKind(const std::string& instrument, ContractKind kind);
+    
+    // Deribit naming: USDC/USDT-margined instruments ("BTC_USDC-PERPETUAL")
+    // are linear, coin-margined ones ("BTC-PERPETUAL", "ETH-27DEC24") inverse
+    static ContractKind defaultContractKind(const std::string& instrument);
+    
+    void applyFill(const Trade& trade);
+    void updateMark(const std::string& instrument, double mark_price);
+    
+    // Overwrite from an exchange snapshot (reconciliation)
+    void setPosition(const std::string& instrument, double size, double average_price);
+    
+    // Wait-free net size; 0 for unknown ids
+    double netPosition(InstrumentId id) const {
+        return id < kMaxInstruments ? slots_[id].net.load(std::memory_order_acquire) : 0.0;
+    }
+    
+    PositionState position(InstrumentId id) const;
+    PositionState position(const std::string& instrument) const;
+    
+    // Non-zero positions by instrument (a copy; prefer netPosition on hot paths)
+    std::map<std::string, double> netPositions() const;
+    
+    double totalRealizedPnl() const;
+    double totalUnrealizedPnl() const;
+    
+private:
+    struct Slot {
+        SeqLock<PositionState> state;
+        std::atomic<double> net{0.0};
+    };
+    
+    void publish(InstrumentId id, const PositionState& state);
+    
+    // Name -> id as linear probing over ids, at most half full. Entries are
+    // only ever added: a name is written before its id is published with
+    // release, so readers probe without a lock.
+    static constexpr size_t kLookupSize = kMaxInstruments * 2;
+    
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint32_t> count_{0};
+    std::unique_ptr<std::string[]> names_;                // by id, fixed capacity
+    std::unique_ptr<std::atomic<InstrumentId>[]> lookup_;
+    
+    mutable std::mutex write_mutex_;  // serializes writers and instrument registration
+    std::vector<PositionState> working_;  // writer-side copy of each slot
+};
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "frame_journal.h"
+#include "market_data.h"
+#include "message_router.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How a replay is paced
+struct ReplayOptions {
+    // 0 replays as fast as possible; 1 keeps the recorded gaps between frames,
+    // 2 halves them, 0.5 doubles them
+    double speed = 0.0;
+    
+    // Stop after this many frames; 0 replays everything
+    size_t max_frames = 0;
+};
+
+struct ReplayStats {
+    size_t frames = 0;
+    size_t bytes = 0;
+    int64_t elapsed_ns = 0;    // wall time of the replay
+    int64_t recorded_ns = 0;   // span between the first and last frame replayed
+    int64_t max_lag_ns = 0;    // worst delivery behind schedule when paced
+};
+
+// Replays recorded journals through the same inbound path as the live
+// WebSocket, with no network. Frames are delivered in recorded order on the
+// calling thread, one at a time, so a replay of the same journal into the same
+// handlers is repeatable.
+class ReplayEngine {
+public:
+    using FrameHandler = std::function<void(const std::string& frame, int64_t realtime_ns)>;
+    
+    // Journal files in replay order, e.g. from FrameJournal::listFiles
+    explicit ReplayEngine(std::vector<std::string> files);
+    
+    // Deliver frames to MarketDataClient::processMessage
+    void setTarget(MarketDataClient& market_data);
+    
+    // Deliver frames to a router, reaching both market data and OrderManager routes
+    void setTarget(std::shared_ptr<MessageRouter> router);
+    
+    void setHandler(FrameHandler handler);
+    
+    // Replay every file; returns when done or stopped
+    ReplayStats run(const ReplayOptions& options = ReplayOptions());
+    
+    // Stop a replay running on another thread
+    void stop() { stopping_ = true; }
+    
+private:
+    // Wait until the frame's scheduled time; returns how late it is
+    int64_t pace(int64_t start_ns, int64_t offset_ns) const;
+    
+    std::vector<std::string> files_;
+    FrameHandler handler_;
+    std::atomic<bool> stopping_{false};
+};
\ No newline at end of file
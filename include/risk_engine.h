@@ -0,0 +1,114 @@
+#pragma once
+
+#include "order.h"
+#include "position_engine.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Per-instrument pre-trade limits. Defaults leave every rule disabled.
+struct RiskLimits {
+    double max_order_size = std::numeric_limits<double>::infinity();
+    double max_notional = std::numeric_limits<double>::infinity();    // price * amount
+    double price_band = 0.0;                                          // max distance from mid as a fraction; 0 disables
+    uint32_t max_open_orders = std::numeric_limits<uint32_t>::max();
+    double max_position = std::numeric_limits<double>::infinity();    // absolute net size after the fill
+};
+
+// Outcome of a pre-trade check; anything but ACCEPTED names the rule that failed
+enum class RiskResult : uint8_t {
+    ACCEPTED,
+    ORDER_SIZE,
+    NOTIONAL,
+    PRICE_BAND,
+    OPEN_ORDERS,
+    POSITION,
+    THROTTLED,
+    NO_MID,              // a market order under a notional limit before any mid is known
+    UNKNOWN_INSTRUMENT,
+};
+
+// An order as the risk gate sees it
+struct RiskOrder {
+    InstrumentId instrument = PositionEngine::kInvalidInstrument;
+    Order::Side side = Order::Side::BUY;
+    Order::Type type = Order::Type::LIMIT;
+    double price = 0.0;
+    double amount = 0.0;
+    size_t open_orders = 0;  // the instrument's working orders, not counting this one
+};
+
+// Inline pre-trade risk checks.
+//
+// Limits live in a flat table indexed by the PositionEngine's InstrumentId, one
+// cache line per instrument, and the price band is precomputed into absolute
+// bounds whenever the mid moves. A check is a handful of relaxed loads and
+// compares, ordered cheapest first, plus one CAS for the message-rate throttle,
+// so the whole gate costs tens of nanoseconds. Configuration and mid updates may
+// run concurrently with checks; a check sees each field's latest value.
+class RiskEngine {
+public:
+    explicit RiskEngine(std::shared_ptr<PositionEngine> positions);
+    
+    // Limits for instruments without their own
+    void setDefaultLimits(const RiskLimits& limits);
+    void setLimits(const std::string& instrument, const RiskLimits& limits);
+    RiskLimits limits(const std::string& instrument) const;
+    
+    // Allow at most max_messages placements and edits per window across all
+    // instruments, with bursts up to max_messages; 0 disables
+    void setThrottle(uint32_t max_messages, int64_t window_ns);
+    
+    // Latest mid for the price band, fed from the market data top of book
+    void updateMid(const std::string& instrument, double mid);
+    
+    // Id shared with the position engine; registers the instrument if needed.
+    // Lock-free for instruments already registered.
+    InstrumentId instrumentId(const std::string& instrument) { return positions_->instrumentId(instrument); }
+    
+    // Run every rule; a passing check consumes one throttle credit
+    RiskResult check(const RiskOrder& order, int64_t now_ns);
+    RiskResult check(const RiskOrder& order);
+    
+    uint64_t rejectedCount(RiskResult reason) const;
+    
+    static const char* describe(RiskResult result);
+    
+private:
+    struct alignas(64) Row {
+        std::atomic<double> max_order_size{std::numeric_limits<double>::infinity()};
+        std::atomic<double> max_notional{std::numeric_limits<double>::infinity()};
+        std::atomic<double> max_position{std::numeric_limits<double>::infinity()};
+        std::atomic<double> band_low{0.0};
+        std::atomic<double> band_high{std::numeric_limits<double>::infinity()};
+        std::atomic<double> mid{0.0};
+        std::atomic<uint32_t> max_open_orders{std::numeric_limits<uint32_t>::max()};
+    };
+    
+    void storeLimits(InstrumentId id, const RiskLimits& limits);
+    
+    // Recompute the absolute band from the mid; config_mutex_ must be held
+    void refreshBand(InstrumentId id);
+    
+    RiskResult reject(RiskResult reason);
+    
+    std::shared_ptr<PositionEngine> positions_;
+    std::unique_ptr<Row[]> rows_;
+    
+    // Throttle as a generic cell rate algorithm: one theoretical arrival time
+    std::atomic<int64_t> throttle_tat_{0};
+    std::atomic<int64_t> throttle_interval_{0};   // window / max_messages; 0 disables
+    std::atomic<int64_t> throttle_tolerance_{0};  // window - interval
+    
+    std::atomic<uint64_t> rejected_[static_cast<size_t>(RiskResult::UNKNOWN_INSTRUMENT) + 1] = {};
+    
+    mutable std::mutex config_mutex_;
+    RiskLimits default_limits_;
+    std::vector<RiskLimits> limits_;    // configured limits by id
+    std::vector<bool> explicit_;        // ids with their own limits
+};
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer sequence lock for a small trivially copyable value.
+//
+// The writer bumps the sequence to odd, stores the value, then bumps it to
+// even; a reader retries until it sees the same even sequence on both sides
+// of its copy. Readers never block the writer. The value is held in relaxed
+// atomic words so concurrent reads are well-defined. Concurrent writers must
+// be serialized by the caller.
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+    
+public:
+    SeqLock() { store(T{}); }
+    
+    void store(const T& value) {
+        uint64_t words[kWords] = {};
+        std::memcpy(words, &value, sizeof(T));
+        
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+    
+    T load() const {
+        uint64_t words[kWords];
+        uint32_t before, after;
+        do {
+            before = seq_.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kWords; ++i) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq_.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+    
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<uint64_t> words_[kWords];
+};
\ No newline at end of file
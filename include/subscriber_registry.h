@@ -0,0 +1,120 @@
+#pragma once
+
+#include "websocket_server.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Dense bitset over connection slots.
+//
+// Subscribe/unsubscribe are a single atomic fetch_or/fetch_and. Slots are laid out
+// per I/O thread (see ConnectionTable), so each worker's subscribers occupy a
+// contiguous run of 64-bit words and can be walked without touching the others.
+class SubscriberBitset {
+public:
+    // slots_per_worker must be a multiple of 64
+    SubscriberBitset(size_t worker_count, size_t slots_per_worker);
+    
+    bool set(uint32_t slot);    // true if the slot was newly added
+    bool reset(uint32_t slot);  // true if the slot was present
+    bool test(uint32_t slot) const;
+    
+    size_t count() const { return count_.load(std::memory_order_relaxed); }
+    size_t count(size_t worker) const { return worker_counts_[worker].load(std::memory_order_relaxed); }
+    bool empty() const { return count() == 0; }
+    size_t workerCount() const { return worker_count_; }
+    
+    // Visit every set slot of one worker in ascending order
+    template <typename Visitor>
+    void forEach(size_t worker, Visitor&& visit) const {
+        size_t first = worker * words_per_worker_;
+        visitWords(first, first + words_per_worker_, visit);
+    }
+    
+    // Visit every set slot
+    template <typename Visitor>
+    void forEach(Visitor&& visit) const {
+        visitWords(0, worker_count_ * words_per_worker_, visit);
+    }
+    
+private:
+    size_t worker_count_;
+    size_t words_per_worker_;
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    std::unique_ptr<std::atomic<uint32_t>[]> worker_counts_;
+    std::atomic<size_t> count_{0};
+    
+    uint64_t word(size_t index) const {
+        return words_[index].load(std::memory_order_relaxed);
+    }
+    
+    template <typename Visitor>
+    static void visitWord(size_t index, uint64_t bits, Visitor& visit) {
+        while (bits != 0) {
+            visit(static_cast<uint32_t>(index * 64 + __builtin_ctzll(bits)));
+            bits &= bits - 1;
+        }
+    }
+    
+    template <typename Visitor>
+    void visitWords(size_t first, size_t last, Visitor& visit) const {
+        size_t i = first;
+        
+        // Test 256 bits per branch so sparse sets skip empty blocks quickly
+        for (; i + 4 <= last; i += 4) {
+            uint64_t w0 = word(i), w1 = word(i + 1), w2 = word(i + 2), w3 = word(i + 3);
+            if ((w0 | w1 | w2 | w3) == 0) continue;
+            visitWord(i, w0, visit);
+            visitWord(i + 1, w1, visit);
+            visitWord(i + 2, w2, visit);
+            visitWord(i + 3, w3, visit);
+        }
+        for (; i < last; ++i) {
+            visitWord(i, word(i), visit);
+        }
+    }
+};
+
+// Instrument -> subscriber bitset, optimized for broadcast.
+//
+// Each shard publishes an immutable instrument map through an atomically swapped
+// shared_ptr, so looking up an instrument is a single atomic load. The map is only
+// copied when an instrument gets its first subscriber or loses its last one, so
+// entries never outlive their subscribers; otherwise subscribe and unsubscribe
+// flip a bit in place.
+class SubscriberRegistry {
+public:
+    using SubscriberSetPtr = std::shared_ptr<const SubscriberBitset>;
+    
+    SubscriberRegistry(size_t worker_count, size_t slots_per_worker, size_t shard_count = 16);
+    
+    void add(uint32_t slot, const std::vector<std::string>& instruments);
+    void remove(uint32_t slot, const std::vector<std::string>& instruments);
+    
+    // Subscribers of an instrument, or null if it has none
+    SubscriberSetPtr subscribers(const std::string& instrument) const;
+    
+    // Number of instruments with at least one subscriber
+    size_t instrumentCount() const;
+    
+private:
+    using Map = std::unordered_map<std::string, std::shared_ptr<SubscriberBitset>>;
+    
+    struct Shard {
+        std::mutex write_mutex;          // serializes add/remove and map copies; readers never lock
+        std::shared_ptr<const Map> map;  // accessed only through std::atomic_load/store
+    };
+    
+    size_t worker_count_;
+    size_t slots_per_worker_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    
+    size_t shardIndex(const std::string& instrument) const;
+    std::shared_ptr<SubscriberBitset> find(const std::string& instrument) const;
+    std::shared_ptr<SubscriberBitset> findOrCreate(Shard& shard, const std::string& instrument);  // shard.write_mutex held
+};
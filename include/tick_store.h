@@ -0,0 +1,137 @@
+#pragma once
+
+#include "market_data.h"
+#include "message_router.h"
+#include "order.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json_fwd.hpp>
+
+// Best bid and offer at one instant
+struct QuoteTick {
+    int64_t timestamp_ns = 0;
+    double bid_price = 0.0;
+    double bid_size = 0.0;
+    double ask_price = 0.0;
+    double ask_size = 0.0;
+};
+
+// N-level book snapshot; missing levels are stored as zero
+struct BookTick {
+    int64_t timestamp_ns = 0;
+    std::vector<Orderbook::Level> bids;
+    std::vector<Orderbook::Level> asks;
+};
+
+// One public trade
+struct TradeTick {
+    int64_t timestamp_ns = 0;
+    double price = 0.0;
+    double amount = 0.0;
+    Order::Side side = Order::Side::BUY;
+};
+
+enum class TickKind : uint8_t { QUOTES, BOOKS, TRADES };
+
+struct TickStoreOptions {
+    double price_scale = 1e4;   // prices are stored as integers of 1/price_scale
+    double size_scale = 1e4;
+    size_t chunk_rows = 4096;   // rows buffered per series before a chunk is written
+    size_t book_levels = 10;
+};
+
+// Columnar tick store writer.
+//
+// Ticks are grouped into one file per instrument, kind and UTC hour:
+// <root>/<instrument>/<YYYYMMDD-HH>.<quotes|books|trades>. Each file is a
+// sequence of self-contained chunks; a chunk holds up to chunk_rows rows as one
+// array per column (timestamp, prices, sizes, ...), each delta-encoded,
+// zigzagged and written as varints. Prices and sizes are fixed point. Chunk
+// headers carry the chunk's time range so readers skip chunks they don't need.
+class TickStoreWriter {
+public:
+    explicit TickStoreWriter(const std::string& root, const TickStoreOptions& options = TickStoreOptions());
+    ~TickStoreWriter();
+    
+    void addQuote(const std::string& instrument, const QuoteTick& quote);
+    void addBook(const std::string& instrument, const BookTick& book);
+    void addTrade(const std::string& instrument, const TradeTick& trade);
+    
+    // Store the top of book and a snapshot from a MarketDataClient update
+    void onOrderbook(const Orderbook& orderbook);
+    
+    // Parsed trades.* notification data (an array of trades)
+    void onTrades(const nlohmann::json& data);
+    
+    // Register the trades. route
+    void registerRoutes(MessageRouter& router);
+    
+    // Write every buffered row
+    void flush();
+    
+    size_t rowsWritten() const;
+    
+private:
+    struct Series {
+        std::string instrument;
+        TickKind kind;
+        int64_t hour = -1;
+        int64_t first_ts = 0;
+        int64_t last_ts = 0;
+        size_t rows = 0;
+        std::vector<std::vector<int64_t>> columns;
+    };
+    
+    Series& series(const std::string& instrument, TickKind kind, int64_t timestamp_ns, size_t columns);
+    void endRow(Series& series, int64_t timestamp_ns);
+    
+    // Encode and append the buffered rows as one chunk; mutex_ must be held
+    void writeChunk(Series& series);
+    
+    int64_t price(double value) const;
+    int64_t size(double value) const;
+    
+    std::string root_;
+    TickStoreOptions options_;
+    mutable std::mutex mutex_;
+    std::map<std::pair<std::string, TickKind>, Series> series_;
+    size_t rows_written_ = 0;
+};
+
+// Reads ticks back for an instrument and time range
+class TickStoreReader {
+public:
+    explicit TickStoreReader(const std::string& root);
+    
+    std::vector<std::string> instruments() const;
+    
+    // Ticks with from_ns <= timestamp < to_ns, in time order
+    std::vector<QuoteTick> quotes(const std::string& instrument, int64_t from_ns, int64_t to_ns) const;
+    std::vector<BookTick> books(const std::string& instrument, int64_t from_ns, int64_t to_ns) const;
+    std::vector<TradeTick> trades(const std::string& instrument, int64_t from_ns, int64_t to_ns) const;
+    
+    // The quote in force at every interval from from_ns, e.g. mid and spread at 100 ms;
+    // intervals before the first quote are skipped
+    std::vector<QuoteTick> sampleQuotes(const std::string& instrument, int64_t from_ns, int64_t to_ns,
+                                        int64_t interval_ns) const;
+    
+private:
+    struct Chunk {
+        size_t rows = 0;
+        size_t levels = 0;
+        double price_scale = 1.0;
+        double size_scale = 1.0;
+        std::vector<std::vector<int64_t>> columns;
+    };
+    
+    // Decoded chunks overlapping the range, oldest first
+    std::vector<Chunk> readChunks(const std::string& instrument, TickKind kind, int64_t from_ns, int64_t to_ns) const;
+    
+    std::string root_;
+};
\ No newline at end of file
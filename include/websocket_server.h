@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <functional>
 #include <memory>
@@ -8,16 +9,15 @@
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <vector>
 
-// Forward declarations
-namespace boost {
-    namespace asio {
-        class io_context;
-        namespace ip {
-            class tcp;
-        }
-    }
-}
+#include <nlohmann/json_fwd.hpp>
+
+class SubscriberRegistry;
+class ConnectionTable;
+
+// Connection handle: generation in the high 32 bits, connection-table slot in the low 32
+using ConnectionId = uint64_t;
 
 // WebSocket client connection
 class WebSocketConnection {
@@ -25,52 +25,95 @@ public:
     using Pointer = std::shared_ptr<WebSocketConnection>;
     using MessageHandler = std::function<void(Pointer, const std::string&)>;
     using CloseHandler = std::function<void(Pointer)>;
+    using SharedMessage = std::shared_ptr<const std::string>;
     
     virtual ~WebSocketConnection() = default;
     
     virtual void send(const std::string& message) = 0;
     virtual void close() = 0;
-    virtual std::string getId() const = 0;
+    
+    // Assigned by the server's ConnectionTable when the connection is registered
+    ConnectionId getId() const { return id_; }
+    
+    // Send a buffer shared with other recipients; runs inline when called
+    // from the connection's own I/O thread
+    virtual void sendShared(const SharedMessage& message) { send(*message); }
+    
+    // Index of the I/O thread this connection is pinned to
+    virtual size_t getWorker() const { return 0; }
+    
+private:
+    friend class ConnectionTable;
+    ConnectionId id_ = 0;
 };
 
 // WebSocket server
 class WebSocketServer {
 public:
-    WebSocketServer(int port = 8080);
+    WebSocketServer(int port = 8080, size_t io_threads = 1, size_t max_connections = 16384);
     ~WebSocketServer();
     
     // Server control
     void start();
     void stop();
     bool isRunning() const;
+    size_t ioThreadCount() const;
+    
+    // Tuning, applied on the next start(): outbound frames a slow client may
+    // have queued before it is disconnected (default 4096), and the CPUs the
+    // I/O threads are pinned to, reused round-robin (default unpinned)
+    void setMaxQueuedMessages(size_t max_queued);
+    void setCpuAffinity(const std::vector<int>& cpus);
     
     // Broadcasting
     void broadcastOrderbook(const std::string& instrument, const std::string& orderbook_json);
     void broadcastToSubscribers(const std::string& instrument, const std::string& message);
     void broadcastToAll(const std::string& message);
     
+    // Connection registration (done automatically for accepted sockets)
+    bool addConnection(const WebSocketConnection::Pointer& connection);
+    void removeConnection(const WebSocketConnection::Pointer& connection);
+    size_t connectionCount() const;
+    
     // Subscription management
     void addSubscription(const WebSocketConnection::Pointer& client, const std::string& instrument);
     void removeSubscription(const WebSocketConnection::Pointer& client, const std::string& instrument);
     void removeAllSubscriptions(const WebSocketConnection::Pointer& client);
     std::set<std::string> getSubscriptions(const WebSocketConnection::Pointer& client) const;
     
+    // Wildcard matching used for pattern subscriptions (e.g. "BTC-*")
+    static bool matchesPattern(const std::string& pattern, const std::string& instrument);
+    
 private:
+    // Client command handler, looked up by the command "type" field
+    using CommandHandler = void (WebSocketServer::*)(const WebSocketConnection::Pointer&, const nlohmann::json&);
+    
     // Implementation details
     int port_;
     std::atomic<bool> running_;
-    std::unique_ptr<boost::asio::io_context> io_context_;
-    std::unique_ptr<boost::asio::ip::tcp> acceptor_;
-    std::thread server_thread_;
+    size_t max_queued_messages_ = 4096;
+    std::vector<int> cpus_;
+    
+    // One io_context and thread per worker; connections stay on the worker that accepted them
+    struct IoWorker;
+    std::vector<std::unique_ptr<IoWorker>> workers_;
     
-    // Client tracking
-    mutable std::mutex clients_mutex_;
-    std::map<std::string, WebSocketConnection::Pointer> clients_;
+    // Client tracking: dense slots, partitioned by worker
+    std::unique_ptr<ConnectionTable> connections_;
     
-    // Subscription tracking
+    // Subscription tracking; the registry is the broadcast-side view and is
+    // only written while holding subscriptions_mutex_
     mutable std::mutex subscriptions_mutex_;
-    std::map<std::string, std::set<std::string>> client_subscriptions_;  // client_id -> set of instruments
-    std::map<std::string, std::set<std::string>> instrument_subscribers_; // instrument -> set of client_ids
+    std::vector<std::set<std::string>> slot_subscriptions_;         // slot -> set of instruments
+    std::map<ConnectionId, std::set<std::string>> client_patterns_; // connection -> set of wildcard patterns (sparse)
+    std::unique_ptr<SubscriberRegistry> subscribers_;               // instrument -> slot bitset
+    
+    // Latest orderbook per instrument, served to snapshot requests
+    mutable std::mutex snapshots_mutex_;
+    std::map<std::string, WebSocketConnection::SharedMessage> snapshots_;
+    
+    // Command dispatch table
+    std::map<std::string, CommandHandler> command_handlers_;
     
     // Connection handlers
     void onAccept(WebSocketConnection::Pointer connection);
@@ -79,5 +122,26 @@ private:
     
     // Connection setup
     void startAccept();
+    
+    // Fan out one shared buffer per I/O thread
+    void broadcastShared(const std::string& instrument, const WebSocketConnection::SharedMessage& message);
     void handleMessage(WebSocketConnection::Pointer connection, const std::string& message);
+    
+    // Command handlers
+    void handleSubscribe(const WebSocketConnection::Pointer& connection, const nlohmann::json& request);
+    void handleUnsubscribe(const WebSocketConnection::Pointer& connection, const nlohmann::json& request);
+    void handleSnapshot(const WebSocketConnection::Pointer& connection, const nlohmann::json& request);
+    void handlePing(const WebSocketConnection::Pointer& connection, const nlohmann::json& request);
+    void handleList(const WebSocketConnection::Pointer& connection, const nlohmann::json& request);
+    
+    // Subscription helpers shared by the single, batch and wildcard paths
+    std::vector<std::string> subscribeInstruments(const WebSocketConnection::Pointer& client, const std::vector<std::string>& instruments);
+    std::vector<std::string> unsubscribeInstruments(const WebSocketConnection::Pointer& client, const std::vector<std::string>& instruments);
+    std::vector<std::string> knownInstruments() const;
+    void onNewInstrument(const std::string& instrument);
+    bool isRegistered(const WebSocketConnection::Pointer& client) const;
+    
+    // Replies
+    void sendError(const WebSocketConnection::Pointer& connection, const nlohmann::json& request,
+                   const std::string& code, const std::string& message);
 };
\ No newline at end of file
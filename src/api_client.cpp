@@ -1,4 +1,5 @@
 #include "api_client.h"
+#include "cpu_affinity.h"
 
 #include <boost/beast/core.hpp>
 #include <boost/beast/ssl.hpp>
@@ -19,10 +20,19 @@
 #include <random>
 #include <sstream>
 #include <iomanip>
+#include <type_traits>
 
 #include <openssl/hmac.h>
 #include <openssl/sha.h>
 
+// Include JSON library
+#define NLOHMANN_JSON_VERSION_MAJOR 3
+#define NLOHMANN_JSON_VERSION_MINOR 11
+#define NLOHMANN_JSON_VERSION_PATCH 2
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
 namespace beast = boost::beast;
 namespace http = beast::http;
 namespace websocket = beast::websocket;
@@ -30,32 +40,59 @@ namespace net = boost::asio;
 namespace ssl = boost::asio::ssl;
 using tcp = boost::asio::ip::tcp;
 
-// WebSocket implementation class
-class ApiClient::WebSocketImpl : public std::enable_shared_from_this<ApiClient::WebSocketImpl> {
+// WebSocket implementation class: the session interface ApiClient holds,
+// independent of whether the stream runs over TLS
+class ApiClient::WebSocketImpl {
 public:
-    WebSocketImpl(boost::asio::io_context& ioc, ssl::context& ctx, const ApiClient::Auth& auth) 
+    virtual ~WebSocketImpl() = default;
+    virtual void connect(const Endpoint& endpoint,
+                         std::function<void(const std::string&)> message_handler,
+                         std::function<void()> error_handler) = 0;
+    virtual void write(std::string msg, OutboundPriority priority, std::string order_key = "") = 0;
+    virtual void close() = 0;
+};
+
+namespace {
+
+using TlsStream = websocket::stream<beast::ssl_stream<beast::tcp_stream>>;
+using PlainStream = websocket::stream<beast::tcp_stream>;
+
+template<typename Stream>
+class WebSocketSession : public ApiClient::WebSocketImpl,
+                         public std::enable_shared_from_this<WebSocketSession<Stream>> {
+public:
+    static constexpr bool kTls = std::is_same<Stream, TlsStream>::value;
+    
+    WebSocketSession(boost::asio::io_context& ioc, ssl::context& ctx, const ApiClient::Auth& auth) 
         : resolver_(net::make_strand(ioc)), 
-          ws_(net::make_strand(ioc), ctx),
+          ws_(makeStream(ioc, ctx)),
           auth_(auth) {
     }
 
-    void connect(const std::string& host, const std::string& port, 
-                std::function<void(const std::string&)> message_handler) {
-        host_ = host;
+    void connect(const ApiClient::Endpoint& endpoint,
+                 std::function<void(const std::string&)> message_handler,
+                 std::function<void()> error_handler) override {
+        host_ = endpoint.host;
+        path_ = endpoint.path;
         message_handler_ = message_handler;
+        error_handler_ = error_handler;
+        
+        // Queued ahead of anything written during the handshake
+        authenticate();
         
         // Set up the TCP resolver
         resolver_.async_resolve(
-            host,
-            port,
+            endpoint.host,
+            endpoint.port,
             beast::bind_front_handler(
-                &WebSocketImpl::on_resolve,
-                shared_from_this()));
+                &WebSocketSession::on_resolve,
+                this->shared_from_this()));
     }
 
     void on_resolve(beast::error_code ec, tcp::resolver::results_type results) {
         if(ec) {
             std::cerr << "Error resolving: " << ec.message() << std::endl;
+            on_error();
             return;
         }
 
@@ -63,27 +100,33 @@ public:
         beast::get_lowest_layer(ws_).async_connect(
             results,
             beast::bind_front_handler(
-                &WebSocketImpl::on_connect,
-                shared_from_this()));
+                &WebSocketSession::on_connect,
+                this->shared_from_this()));
     }
 
     void on_connect(beast::error_code ec, tcp::resolver::results_type::endpoint_type) {
         if(ec) {
             std::cerr << "Error connecting: " << ec.message() << std::endl;
+            on_error();
             return;
         }
 
-        // Perform the SSL handshake
-        ws_.next_layer().async_handshake(
-            ssl::stream_base::client,
-            beast::bind_front_handler(
-                &WebSocketImpl::on_ssl_handshake,
-                shared_from_this()));
+        if constexpr (kTls) {
+            // Perform the SSL handshake
+            ws_.next_layer().async_handshake(
+                ssl::stream_base::client,
+                beast::bind_front_handler(
+                    &WebSocketSession::on_ssl_handshake,
+                    this->shared_from_this()));
+        } else {
+            on_ssl_handshake(beast::error_code());
+        }
     }
 
     void on_ssl_handshake(beast::error_code ec) {
         if(ec) {
             std::cerr << "Error SSL handshake: " << ec.message() << std::endl;
+            on_error();
             return;
         }
 
@@ -99,20 +142,22 @@ public:
             }));
 
         // Perform the WebSocket handshake
-        ws_.async_handshake(host_, "/ws/api/v2",
+        ws_.async_handshake(host_, path_,
             beast::bind_front_handler(
-                &WebSocketImpl::on_handshake,
-                shared_from_this()));
+                &WebSocketSession::on_handshake,
+                this->shared_from_this()));
     }
 
     void on_handshake(beast::error_code ec) {
         if(ec) {
             std::cerr << "Error handshake: " << ec.message() << std::endl;
+            on_error();
             return;
         }
 
-        // Authentication
-        authenticate();
+        // Flush what was queued during the handshake, auth first
+        open_ = true;
+        write_next();
 
         // Start reading
         read();
@@ -132,8 +177,8 @@ public:
            << "  }\n"
            << "}";
 
-        // Send the message
-        write(ss.str());
+        // Top lane: nothing may reach the server before auth
+        write(ss.str(), OutboundPriority::CANCEL);
     }
 
     void read() {
@@ -141,8 +186,8 @@ public:
         ws_.async_read(
             buffer_,
             beast::bind_front_handler(
-                &WebSocketImpl::on_read,
-                shared_from_this()));
+                &WebSocketSession::on_read,
+                this->shared_from_this()));
     }
 
     void on_read(beast::error_code ec, std::size_t bytes_transferred) {
@@ -150,6 +195,7 @@ public:
 
         if(ec) {
             std::cerr << "Error reading: " << ec.message() << std::endl;
+            on_error();
             return;
         }
 
@@ -166,23 +212,32 @@ public:
         read();
     }
 
-    void write(const std::string& msg) {
-        // Post our work to the strand
+    void write(std::string msg, OutboundPriority priority, std::string order_key = "") override {
+        // Queue on the strand; frames for one order keep their order
         net::post(
             ws_.get_executor(),
-            beast::bind_front_handler(
-                &WebSocketImpl::on_write,
-                shared_from_this(),
-                msg));
+            [self = this->shared_from_this(), msg = std::move(msg), priority, order_key = std::move(order_key)]() mutable {
+                self->outbound_.push(std::move(msg), priority, order_key);
+                if (self->open_ && !self->writing_) {
+                    self->write_next();
+                }
+            });
     }
 
-    void on_write(std::string msg) {
+    // One write in flight at a time; the next frame is picked when it completes
+    void write_next() {
+        if (!outbound_.pop(current_write_)) {
+            writing_ = false;
+            return;
+        }
+        writing_ = true;
+        
         // Send the message
         ws_.async_write(
-            net::buffer(msg),
+            net::buffer(current_write_),
             beast::bind_front_handler(
-                &WebSocketImpl::on_write_complete,
-                shared_from_this()));
+                &WebSocketSession::on_write_complete,
+                this->shared_from_this()));
     }
 
     void on_write_complete(beast::error_code ec, std::size_t bytes_transferred) {
@@ -190,25 +245,29 @@ public:
 
         if(ec) {
             std::cerr << "Error writing: " << ec.message() << std::endl;
+            writing_ = false;
+            on_error();
             return;
         }
+        
+        write_next();
     }
 
-    void close() {
+    void close() override {
         // Close the WebSocket connection
         net::post(
             ws_.get_executor(),
             beast::bind_front_handler(
-                &WebSocketImpl::on_close,
-                shared_from_this()));
+                &WebSocketSession::on_close,
+                this->shared_from_this()));
     }
 
     void on_close() {
         // Send close frame
         ws_.async_close(websocket::close_code::normal,
             beast::bind_front_handler(
-                &WebSocketImpl::on_close_complete,
-                shared_from_this()));
+                &WebSocketSession::on_close_complete,
+                this->shared_from_this()));
     }
 
     void on_close_complete(beast::error_code ec) {
@@ -219,14 +278,38 @@ public:
     }
 
 private:
+    // The session is dead; nothing more will be read from it
+    void on_error() {
+        if (error_handler_) {
+            error_handler_();
+        }
+    }
+
+    static Stream makeStream(boost::asio::io_context& ioc, ssl::context& ctx) {
+        if constexpr (kTls) {
+            return Stream(net::make_strand(ioc), ctx);
+        } else {
+            boost::ignore_unused(ctx);
+            return Stream(net::make_strand(ioc));
+        }
+    }
+
     tcp::resolver resolver_;
-    websocket::stream<beast::ssl_stream<beast::tcp_stream>> ws_;
+    Stream ws_;
     beast::flat_buffer buffer_;
     std::string host_;
+    std::string path_;
     ApiClient::Auth auth_;
     std::function<void(const std::string&)> message_handler_;
+    std::function<void()> error_handler_;
+    OutboundQueue outbound_;
+    std::string current_write_;
+    bool writing_ = false;
+    bool open_ = false;
 };
 
+} // namespace
+
 // Generate random nonce
 std::string generateNonce() {
     static std::random_device rd;
@@ -251,7 +334,58 @@ std::string bytesToHex(const unsigned char* data, size_t len) {
 }
 
 // API Client implementation
-ApiClient::ApiClient(const Auth& auth) : auth_(auth) {
+namespace {
+
+// Deribit's default matching-engine tier: bursts of 20, 5 requests per second
+CreditTracker::Limits matchingEngineLimits() {
+    CreditTracker::Limits limits;
+    limits.max_credits = 20 * ApiClient::kRequestCost;
+    limits.refill_per_second = 5 * ApiClient::kRequestCost;
+    return limits;
+}
+
+// Non-matching requests: bursts of 100, 20 requests per second
+CreditTracker::Limits nonMatchingLimits() {
+    CreditTracker::Limits limits;
+    limits.max_credits = 100 * ApiClient::kRequestCost;
+    limits.refill_per_second = 20 * ApiClient::kRequestCost;
+    return limits;
+}
+
+const char* const kTooManyRequests =
+    "{\"error\": {\"code\": 10028, \"message\": \"too_many_requests\"}}";
+const char* const kRequestTimedOut =
+    "{\"error\": {\"code\": -32000, \"message\": \"request_timeout\"}}";
+const char* const kConnectionClosed =
+    "{\"error\": {\"code\": -32000, \"message\": \"connection_closed\"}}";
+
+bool isError(const std::string& response) {
+    return response.find("\"error\"") != std::string::npos;
+}
+
+// Top-level JSON-RPC id of a frame, 0 if none. Subscription notifications have
+// no id, and nested keys such as "order_id" don't match the quoted "id".
+uint64_t responseId(const std::string& frame) {
+    size_t pos = frame.find("\"id\"");
+    if (pos == std::string::npos) return 0;
+    pos += 4;
+    while (pos < frame.size() && (frame[pos] == ' ' || frame[pos] == ':' || frame[pos] == '\n' ||
+                                  frame[pos] == '\r' || frame[pos] == '\t')) {
+        ++pos;
+    }
+    uint64_t id = 0;
+    for (; pos < frame.size() && frame[pos] >= '0' && frame[pos] <= '9'; ++pos) {
+        id = id * 10 + static_cast<uint64_t>(frame[pos] - '0');
+    }
+    return id;
+}
+
+} // namespace
+
+ApiClient::ApiClient(const Auth& auth)
+    : auth_(auth),
+      matching_credits_(matchingEngineLimits()),
+      non_matching_credits_(nonMatchingLimits()) {
     // Initialize IO context
     io_context_ = std::make_unique<boost::asio::io_context>();
     
@@ -279,52 +413,159 @@ std::string ApiClient::generateSignature(const std::string& timestamp, const std
     return bytesToHex(digest, digest_len);
 }
 
+ApiClient::CreditPool ApiClient::poolFor(const std::string& endpoint) {
+    // Matches REST paths (/api/v2/private/buy) and JSON-RPC methods (private/buy)
+    static const char* const matching[] = {
+        "private/buy", "private/sell", "private/edit", "private/cancel"
+    };
+    for (const char* path : matching) {
+        if (endpoint.find(path) != std::string::npos) {
+            return CreditPool::MATCHING_ENGINE;
+        }
+    }
+    return CreditPool::NON_MATCHING;
+}
+
+void ApiClient::setRateLimitMode(RateLimitMode mode) {
+    rate_limit_mode_ = mode;
+}
+
+ApiClient::RateLimitMode ApiClient::rateLimitMode() const {
+    return rate_limit_mode_;
+}
+
+void ApiClient::setCreditLimits(CreditPool pool, const CreditTracker::Limits& limits) {
+    credits(pool).setLimits(limits);
+}
+
+CreditTracker& ApiClient::credits(CreditPool pool) {
+    return pool == CreditPool::MATCHING_ENGINE ? matching_credits_ : non_matching_credits_;
+}
+
+void ApiClient::awaitCredits(CreditPool pool) const {
+    if (rate_limit_mode_ == RateLimitMode::OFF) return;
+    (pool == CreditPool::MATCHING_ENGINE ? matching_credits_ : non_matching_credits_).waitFor(kRequestCost);
+}
+
+bool ApiClient::chargeCredits(const std::string& endpoint) {
+    RateLimitMode mode = rate_limit_mode_;
+    if (mode == RateLimitMode::OFF) return true;
+    
+    CreditTracker& pool = credits(poolFor(endpoint));
+    return mode == RateLimitMode::QUEUE ? pool.acquire(kRequestCost) : pool.tryAcquire(kRequestCost);
+}
+
 std::string ApiClient::makeRequest(const std::string& method, const std::string& endpoint, const std::map<std::string, std::string>& params) {
     // Create HTTP client and request
     // This is a placeholder - in a real implementation, you would use boost::beast::http
     // to make the actual HTTP request to the Deribit API
     
+    // Rejected locally rather than spending a round trip on an exchange reject
+    if (!chargeCredits(endpoint)) {
+        return kTooManyRequests;
+    }
+    
     // For now, return a mock response
+    if (mock_latency_us_ > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(mock_latency_us_));
+    }
     return "{\"result\": \"success\"}";
 }
 
-std::string ApiClient::placeOrder(const std::string& instrument, bool is_buy, double price, double amount, const std::string& order_type) {
-    // Prepare parameters
-    std::map<std::string, std::string> params;
-    params["instrument_name"] = instrument;
-    params["type"] = order_type;
-    params["side"] = is_buy ? "buy" : "sell";
-    params["price"] = std::to_string(price);
-    params["amount"] = std::to_string(amount);
+std::string ApiClient::call(const std::string& method, const std::string& params, const std::string& order_key) {
+    auto impl = std::atomic_load(&ws_impl_);
+    if (!impl) {
+        // No session: the stubbed REST path stands in for the exchange
+        return makeRequest("POST", "/api/v2/" + method);
+    }
     
-    // Make API request
-    return makeRequest("POST", "/api/v2/private/buy", params);
+    // Rejected locally rather than spending a round trip on an exchange reject
+    if (!chargeCredits(method)) {
+        return kTooManyRequests;
+    }
+    
+    // Registered before the frame is queued, so the response can't arrive first
+    auto response = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> ready = response->get_future();
+    uint64_t id = ++ws_request_id_;
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        if (session_failed_) {
+            return kConnectionClosed;
+        }
+        calls_[id] = response;
+        calls_waiting_ = calls_.size();
+    }
+    queueRequest(*impl, id, method, params, order_key);
+    
+    if (ready.wait_for(std::chrono::milliseconds(kResponseTimeoutMs)) != std::future_status::ready) {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        calls_.erase(id);
+        calls_waiting_ = calls_.size();
+        return kRequestTimedOut;
+    }
+    return ready.get();
 }
 
-bool ApiClient::cancelOrder(const std::string& order_id) {
-    // Prepare parameters
-    std::map<std::string, std::string> params;
-    params["order_id"] = order_id;
-    
-    // Make API request
-    std::string response = makeRequest("POST", "/api/v2/private/cancel", params);
+bool ApiClient::completeCall(const std::string& frame) {
+    if (calls_waiting_ == 0) return false;
+    uint64_t id = responseId(frame);
+    if (id == 0) return false;
     
-    // In real implementation, parse the response to determine success
+    std::shared_ptr<std::promise<std::string>> response;
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        auto it = calls_.find(id);
+        if (it == calls_.end()) return false;
+        response = std::move(it->second);
+        calls_.erase(it);
+        calls_waiting_ = calls_.size();
+    }
+    response->set_value(frame);
     return true;
 }
 
+void ApiClient::failCalls(const std::string& response) {
+    std::unordered_map<uint64_t, std::shared_ptr<std::promise<std::string>>> calls;
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        calls.swap(calls_);
+        calls_waiting_ = 0;
+    }
+    for (auto& call : calls) {
+        call.second->set_value(response);
+    }
+}
+
+std::string ApiClient::placeOrder(const std::string& instrument, bool is_buy, double price, double amount, const std::string& order_type, const std::string& label) {
+    json params = {{"instrument_name", instrument}, {"amount", amount}, {"type", order_type}};
+    if (order_type != "market") {
+        params["price"] = price;
+    }
+    if (!label.empty()) {
+        params["label"] = label;
+    }
+    return call(is_buy ? "private/buy" : "private/sell", params.dump(), label);
+}
+
+bool ApiClient::cancelOrder(const std::string& order_id) {
+    json params = {{"order_id", order_id}};
+    return !isError(call("private/cancel", params.dump(), order_id));
+}
+
+bool ApiClient::cancelOrderByLabel(const std::string& label) {
+    json params = {{"label", label}};
+    return !isError(call("private/cancel_by_label", params.dump(), label));
+}
+
+bool ApiClient::cancelAllByInstrument(const std::string& instrument) {
+    json params = {{"instrument_name", instrument}, {"type", "all"}};
+    return !isError(call("private/cancel_all_by_instrument", params.dump(), ""));
+}
+
 bool ApiClient::modifyOrder(const std::string& order_id, double new_price, double new_amount) {
-    // Prepare parameters
-    std::map<std::string, std::string> params;
-    params["order_id"] = order_id;
-    params["price"] = std::to_string(new_price);
-    params["amount"] = std::to_string(new_amount);
-    
-    // Make API request
-    std::string response = makeRequest("POST", "/api/v2/private/edit", params);
-    
-    // In real implementation, parse the response to determine success
-    return true;
+    json params = {{"order_id", order_id}, {"price", new_price}, {"amount", new_amount}};
+    return !isError(call("private/edit", params.dump(), order_id));
 }
 
 std::string ApiClient::getOrderbook(const std::string& instrument, int depth) {
@@ -343,26 +584,57 @@ std::string ApiClient::getCurrentPositions() {
 }
 
 void ApiClient::connectWebSocket(std::function<void(const std::string&)> message_handler) {
-    // Initialize the WebSocket implementation using make_shared instead of make_unique
-    auto impl = std::make_shared<WebSocketImpl>(*io_context_, *ssl_context_, auth_);
-    ws_impl_ = impl;
+    // Reconnecting replaces the previous session
+    closeWebSocket();
+    
+    // TLS for the exchange; plain TCP for a local mock
+    std::shared_ptr<WebSocketImpl> impl;
+    if (endpoint_.tls) {
+        impl = std::make_shared<WebSocketSession<TlsStream>>(*io_context_, *ssl_context_, auth_);
+    } else {
+        impl = std::make_shared<WebSocketSession<PlainStream>>(*io_context_, *ssl_context_, auth_);
+    }
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        session_failed_ = false;
+    }
+    std::atomic_store(&ws_impl_, impl);
     
-    // Connect to the WebSocket server
-    impl->connect("test.deribit.com", "443", message_handler);
+    // Connect to the WebSocket server; responses to blocking calls are taken out first
+    io_context_->restart();
+    // A read or write error ends the session, so waiting and later calls fail
+    // now instead of running out their timeout
+    impl->connect(endpoint_, [this, message_handler](const std::string& message) {
+        if (completeCall(message)) return;
+        if (message_handler) {
+            message_handler(message);
+        }
+    }, [this]() {
+        {
+            std::lock_guard<std::mutex> lock(calls_mutex_);
+            session_failed_ = true;
+        }
+        failCalls(kConnectionClosed);
+    });
     
-    // Start the IO context in a separate thread
-    std::thread t([this]() {
+    // Start the IO context in a separate thread; joined by closeWebSocket
+    io_thread_ = std::thread([this]() {
         try {
             io_context_->run();
         } catch (const std::exception& e) {
             std::cerr << "WebSocket error: " << e.what() << std::endl;
         }
     });
-    t.detach();
+    pinThreadToCpu(io_thread_, cpu_);
+}
+
+std::string ApiClient::bookChannel(const std::string& instrument) const {
+    return "book." + instrument + ".none." + std::to_string(book_depth_) + "." + book_interval_;
 }
 
 void ApiClient::subscribeToOrderbook(const std::string& instrument) {
-    if (!ws_impl_) return;
+    auto impl = std::atomic_load(&ws_impl_);
+    if (!impl) return;
     
     // Create subscription message
     std::stringstream ss;
@@ -371,19 +643,17 @@ void ApiClient::subscribeToOrderbook(const std::string& instrument) {
        << "  \"id\": 3600,\n"
        << "  \"method\": \"public/subscribe\",\n"
        << "  \"params\": {\n"
-       << "    \"channels\": [\"book." << instrument << ".none.10.100ms\"]\n"
+       << "    \"channels\": [\"" << bookChannel(instrument) << "\"]\n"
        << "  }\n"
        << "}";
     
     // Send the subscription message
-    auto impl = ws_impl_;
-    if (impl) {
-        impl->write(ss.str());
-    }
+    impl->write(ss.str(), OutboundPriority::SUBSCRIPTION);
 }
 
 void ApiClient::unsubscribeFromOrderbook(const std::string& instrument) {
-    if (!ws_impl_) return;
+    auto impl = std::atomic_load(&ws_impl_);
+    if (!impl) return;
     
     // Create unsubscription message
     std::stringstream ss;
@@ -392,25 +662,74 @@ void ApiClient::unsubscribeFromOrderbook(const std::string& instrument) {
        << "  \"id\": 8691,\n"
        << "  \"method\": \"public/unsubscribe\",\n"
        << "  \"params\": {\n"
-       << "    \"channels\": [\"book." << instrument << ".none.10.100ms\"]\n"
+       << "    \"channels\": [\"" << bookChannel(instrument) << "\"]\n"
        << "  }\n"
        << "}";
     
     // Send the unsubscription message
-    auto impl = ws_impl_;
-    if (impl) {
-        impl->write(ss.str());
+    impl->write(ss.str(), OutboundPriority::SUBSCRIPTION);
+}
+
+void ApiClient::subscribeToChannels(const std::vector<std::string>& channels, bool is_private) {
+    auto impl = std::atomic_load(&ws_impl_);
+    if (!impl || channels.empty()) return;
+    
+    // Create subscription message
+    std::stringstream ss;
+    ss << "{\n"
+       << "  \"jsonrpc\": \"2.0\",\n"
+       << "  \"id\": 4235,\n"
+       << "  \"method\": \"" << (is_private ? "private/subscribe" : "public/subscribe") << "\",\n"
+       << "  \"params\": {\n"
+       << "    \"channels\": [";
+    for (size_t i = 0; i < channels.size(); ++i) {
+        ss << (i ? ", " : "") << "\"" << channels[i] << "\"";
     }
+    ss << "]\n"
+       << "  }\n"
+       << "}";
+    
+    // Send the subscription message
+    impl->write(ss.str(), OutboundPriority::SUBSCRIPTION);
+}
+
+bool ApiClient::sendWebSocketRequest(const std::string& method,
+                                     const std::string& params,
+                                     const std::string& order_key) {
+    auto impl = std::atomic_load(&ws_impl_);
+    if (!impl) return false;
+    
+    // Charged before queueing, so a burst can't overrun the pool in the outbound queue
+    if (!chargeCredits(method)) {
+        return false;
+    }
+    
+    queueRequest(*impl, ++ws_request_id_, method, params, order_key);
+    return true;
+}
+
+void ApiClient::queueRequest(WebSocketImpl& impl, uint64_t id, const std::string& method,
+                             const std::string& params, const std::string& order_key) {
+    std::stringstream ss;
+    ss << "{\"jsonrpc\": \"2.0\", \"id\": " << id
+       << ", \"method\": \"" << method << "\", \"params\": " << (params.empty() ? "{}" : params) << "}";
+    
+    impl.write(ss.str(), OutboundQueue::priorityFor(method), order_key);
 }
 
 void ApiClient::closeWebSocket() {
-    auto impl = ws_impl_;
+    auto impl = std::atomic_exchange(&ws_impl_, std::shared_ptr<WebSocketImpl>());
     if (impl) {
         impl->close();
-        ws_impl_.reset();
     }
     
     if (io_context_) {
         io_context_->stop();
     }
+    if (io_thread_.joinable()) {
+        io_thread_.join();
+    }
+    
+    // No response can arrive now
+    failCalls(kConnectionClosed);
 }
\ No newline at end of file
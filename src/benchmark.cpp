@@ -2,6 +2,13 @@
 #include "order_manager.h"
 #include "market_data.h"
 #include "websocket_server.h"
+#include "subscriber_registry.h"
+#include "risk_engine.h"
+#include "frame_journal.h"
+#include "replay_engine.h"
+#include "mock_exchange.h"
+#include "config.h"
+#include "latency_histogram.h"
 
 #include <iostream>
 #include <iomanip>
@@ -12,6 +19,12 @@
 #include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <map>
+#include <set>
+#include <random>
+#include <cstring>
+#include <cmath>
+#include <filesystem>
 
 // Include JSON library
 #define NLOHMANN_JSON_VERSION_MAJOR 3
@@ -22,94 +35,91 @@
 using json = nlohmann::json;
 
 // A simple benchmarking class
+//
+// Samples go into an HDR histogram, so a run of any length keeps nanosecond
+// resolution in fixed memory. For a paced load (one operation every interval),
+// setExpectedInterval() turns on coordinated-omission correction.
 class Benchmark {
 public:
     Benchmark(const std::string& name) : name_(name) {}
     
     void start() {
-        start_time_ = std::chrono::high_resolution_clock::now();
+        start_time_ = std::chrono::steady_clock::now();
     }
     
+    // Records the time since start(); returns it in milliseconds
     double stop() {
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time_).count();
-        durations_.push_back(duration);
-        return duration / 1000.0; // Convert to milliseconds
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_time_).count();
+        record(ns);
+        return ns / 1e6;
     }
     
-    void reset() {
-        durations_.clear();
-    }
-    
-    double getAverageMs() const {
-        if (durations_.empty()) return 0.0;
-        double sum = std::accumulate(durations_.begin(), durations_.end(), 0.0);
-        return (sum / durations_.size()) / 1000.0; // Convert to milliseconds
+    void record(int64_t ns) {
+        histogram_.recordCorrected(ns, expected_interval_ns_);
     }
     
-    double getMinMs() const {
-        if (durations_.empty()) return 0.0;
-        return (*std::min_element(durations_.begin(), durations_.end())) / 1000.0; // Convert to milliseconds
+    void setExpectedInterval(int64_t interval_ns) {
+        expected_interval_ns_ = interval_ns;
     }
     
-    double getMaxMs() const {
-        if (durations_.empty()) return 0.0;
-        return (*std::max_element(durations_.begin(), durations_.end())) / 1000.0; // Convert to milliseconds
+    // Fold in samples from another thread's Benchmark
+    void merge(const Benchmark& other) {
+        histogram_.merge(other.histogram_);
     }
     
-    double getMedianMs() const {
-        if (durations_.empty()) return 0.0;
-        std::vector<double> sorted = durations_;
-        std::sort(sorted.begin(), sorted.end());
-        size_t mid = sorted.size() / 2;
-        return (sorted.size() % 2 == 0 ? (sorted[mid-1] + sorted[mid]) / 2.0 : sorted[mid]) / 1000.0; // Convert to milliseconds
+    void reset() {
+        histogram_.reset();
     }
     
-    double getP95Ms() const {
-        if (durations_.empty()) return 0.0;
-        std::vector<double> sorted = durations_;
-        std::sort(sorted.begin(), sorted.end());
-        size_t p95_idx = static_cast<size_t>(sorted.size() * 0.95);
-        return sorted[p95_idx] / 1000.0; // Convert to milliseconds
+    const LatencyHistogram& histogram() const {
+        return histogram_;
     }
     
     size_t getSampleCount() const {
-        return durations_.size();
+        return histogram_.count();
     }
     
     void printStatistics(std::ostream& out = std::cout) const {
         out << "Benchmark: " << name_ << "\n";
-        out << "  Samples: " << getSampleCount() << "\n";
-        out << "  Min:     " << std::fixed << std::setprecision(3) << getMinMs() << " ms\n";
-        out << "  Max:     " << std::fixed << std::setprecision(3) << getMaxMs() << " ms\n";
-        out << "  Average: " << std::fixed << std::setprecision(3) << getAverageMs() << " ms\n";
-        out << "  Median:  " << std::fixed << std::setprecision(3) << getMedianMs() << " ms\n";
-        out << "  P95:     " << std::fixed << std::setprecision(3) << getP95Ms() << " ms\n";
+        out << "  Samples: " << getSampleCount();
+        if (expected_interval_ns_ > 0) {
+            out << " (corrected for a " << expected_interval_ns_ / 1000 << " us interval)";
+        }
+        out << "\n";
+        out << "  Min:     " << histogram_.min() << " ns\n";
+        out << "  Mean:    " << std::fixed << std::setprecision(1) << histogram_.mean() << " ns\n";
+        out << "  " << histogram_.summary() << "\n";
     }
     
     void saveToCSV(const std::string& filename) const {
         std::ofstream file(filename);
-        file << "sample,duration_us,duration_ms\n";
-        for (size_t i = 0; i < durations_.size(); ++i) {
-            file << i << "," << durations_[i] << "," << (durations_[i] / 1000.0) << "\n";
-        }
+        file << histogram_.toCsv();
     }
     
 private:
     std::string name_;
-    std::chrono::high_resolution_clock::time_point start_time_;
-    std::vector<double> durations_;
+    std::chrono::steady_clock::time_point start_time_;
+    int64_t expected_interval_ns_ = 0;
+    LatencyHistogram histogram_;
 };
 
 // Main benchmarking function
 void runBenchmarks(int iterations = 100) {
     std::cout << "Starting benchmarks with " << iterations << " iterations each...\n";
     
-    // Create API client
-    ApiClient::Auth auth;
-    auth.client_id = "m_B5zE25";
-    auth.client_secret = "qwHcammuk8D-MEK4idg8urGt_ZAkfk4r_MuIzT9v1LE";
-    auto api_client = std::make_shared<ApiClient>(auth);
+    // Create API client; endpoint and credentials come from DERIBIT_* variables
+    Config config;
+    std::string config_error;
+    if (!Config::load("", config, config_error)) {
+        std::cerr << "Configuration error: " << config_error << std::endl;
+        return;
+    }
+    auto api_client = std::make_shared<ApiClient>(config.auth);
+    api_client->setEndpoint(config.endpoint);
+    
+    // Pace requests by the exchange's credit pools instead of fixed sleeps
+    api_client->setRateLimitMode(ApiClient::RateLimitMode::QUEUE);
     
     // Create order manager
     auto order_manager = std::make_shared<OrderManager>(api_client);
@@ -126,32 +136,8 @@ void runBenchmarks(int iterations = 100) {
         // Start measuring when we receive market data
         end_to_end_benchmark.start();
         
-        // Convert orderbook to JSON (this would be part of the latency we're measuring)
-        json j;
-        j["type"] = "orderbook";
-        j["instrument"] = orderbook.instrument;
-        j["timestamp"] = orderbook.timestamp;
-        
-        // Add bids
-        j["bids"] = json::array();
-        for (const auto& bid : orderbook.bids) {
-            json level;
-            level.push_back(bid.price);
-            level.push_back(bid.size);
-            j["bids"].push_back(level);
-        }
-        
-        // Add asks
-        j["asks"] = json::array();
-        for (const auto& ask : orderbook.asks) {
-            json level;
-            level.push_back(ask.price);
-            level.push_back(ask.size);
-            j["asks"].push_back(level);
-        }
-        
-        // Broadcast to subscribers (actual WebSocket send would happen here)
-        ws_server->broadcastOrderbook(orderbook.instrument, j.dump());
+        // Convert orderbook to JSON and broadcast to subscribers (part of the measured latency)
+        ws_server->broadcastOrderbook(orderbook.instrument, orderbookToJson(orderbook));
         
         // Stop measuring after the broadcast is queued
         end_to_end_benchmark.stop();
@@ -167,6 +153,8 @@ void runBenchmarks(int iterations = 100) {
     // Benchmark 1: Order placement latency
     Benchmark order_placement_benchmark("Order Placement");
     for (int i = 0; i < iterations; ++i) {
+        // Wait for credits outside the timed section
+        api_client->awaitCredits(ApiClient::CreditPool::MATCHING_ENGINE);
         order_placement_benchmark.start();
         std::string order_id = order_manager->placeOrder(
             "BTC-PERPETUAL", 
@@ -176,36 +164,30 @@ void runBenchmarks(int iterations = 100) {
             Order::Type::LIMIT
         );
         order_placement_benchmark.stop();
-        
-        // Small delay between iterations to avoid rate limiting
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     
     // Benchmark 2: Order cancellation latency
     Benchmark order_cancel_benchmark("Order Cancellation");
     auto open_orders = order_manager->getOpenOrders();
     for (size_t i = 0; i < std::min(static_cast<size_t>(iterations), open_orders.size()); ++i) {
+        api_client->awaitCredits(ApiClient::CreditPool::MATCHING_ENGINE);
         order_cancel_benchmark.start();
         order_manager->cancelOrder(open_orders[i].order_id);
         order_cancel_benchmark.stop();
-        
-        // Small delay between iterations to avoid rate limiting
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     
     // Benchmark 3: Orderbook retrieval latency
     Benchmark orderbook_retrieval_benchmark("Orderbook Retrieval");
     for (int i = 0; i < iterations; ++i) {
+        api_client->awaitCredits(ApiClient::CreditPool::NON_MATCHING);
         orderbook_retrieval_benchmark.start();
         api_client->getOrderbook("BTC-PERPETUAL", 10);
         orderbook_retrieval_benchmark.stop();
-        
-        // Small delay between iterations to avoid rate limiting
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     
     // Benchmark 4: WebSocket message propagation
     Benchmark ws_message_benchmark("WebSocket Message Propagation");
+    ws_message_benchmark.setExpectedInterval(10000000);
     for (int i = 0; i < iterations; ++i) {
         ws_message_benchmark.start();
         ws_server->broadcastToAll("{\"type\":\"test\",\"sequence\":" + std::to_string(i) + "}");
@@ -248,11 +230,628 @@ void runBenchmarks(int iterations = 100) {
     std::cout << "Benchmark data saved to CSV files.\n";
 }
 
+// Subscriber index benchmark: subscribe churn and broadcast iteration over
+// slot bitsets, compared with the previous map<instrument, set<client_id>> layout
+void runSubscriberIndexBenchmark(size_t connections = 10000, size_t instruments = 500) {
+    const size_t workers = 4;
+    const size_t subscriptions_per_connection = 20;
+    const size_t churn_ops = 1000000;
+    const int broadcast_rounds = 20;
+    
+    std::cout << "Subscriber index: " << connections << " connections x " << instruments
+              << " instruments, " << workers << " workers\n";
+    
+    size_t slots_per_worker = ((connections + workers - 1) / workers + 63) / 64 * 64;
+    SubscriberRegistry registry(workers, slots_per_worker);
+    std::map<std::string, std::set<std::string>> baseline;
+    
+    std::vector<std::string> names;
+    for (size_t i = 0; i < instruments; ++i) {
+        names.push_back("INST-" + std::to_string(i));
+    }
+    std::vector<std::string> client_ids;
+    for (size_t i = 0; i < connections; ++i) {
+        char id[17];
+        std::snprintf(id, sizeof(id), "%016zx", i * 2654435761u);
+        client_ids.push_back(id);
+    }
+    
+    // Every connection takes the popular instrument plus a random spread of others
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> pick_instrument(1, instruments - 1);
+    std::uniform_int_distribution<size_t> pick_connection(0, connections - 1);
+    for (size_t c = 0; c < connections; ++c) {
+        uint32_t slot = static_cast<uint32_t>((c % workers) * slots_per_worker + c / workers);
+        std::vector<std::string> subscribed{names[0]};
+        for (size_t k = 0; k < subscriptions_per_connection; ++k) {
+            subscribed.push_back(names[pick_instrument(gen)]);
+        }
+        registry.add(slot, subscribed);
+        for (const auto& name : subscribed) {
+            baseline[name].insert(client_ids[c]);
+        }
+    }
+    
+    // Subscribe churn: toggle random (connection, instrument) pairs
+    std::vector<std::pair<size_t, size_t>> ops(churn_ops);
+    for (auto& op : ops) {
+        op = {pick_connection(gen), pick_instrument(gen)};
+    }
+    
+    auto churn_start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < ops.size(); ++i) {
+        size_t c = ops[i].first;
+        uint32_t slot = static_cast<uint32_t>((c % workers) * slots_per_worker + c / workers);
+        if (i % 2 == 0) {
+            registry.add(slot, {names[ops[i].second]});
+        } else {
+            registry.remove(slot, {names[ops[i].second]});
+        }
+    }
+    auto churn_bitset = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - churn_start).count();
+    
+    churn_start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < ops.size(); ++i) {
+        const std::string& client_id = client_ids[ops[i].first];
+        const std::string& name = names[ops[i].second];
+        if (i % 2 == 0) {
+            baseline[name].insert(client_id);
+        } else {
+            baseline[name].erase(client_id);
+        }
+    }
+    auto churn_map = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - churn_start).count();
+    
+    // Broadcast iteration: walk every worker's subscribers of every instrument
+    size_t visited = 0;
+    Benchmark popular_bitset("Bitset iteration, popular instrument");
+    auto iterate_start = std::chrono::high_resolution_clock::now();
+    for (int round = 0; round < broadcast_rounds; ++round) {
+        for (size_t i = 0; i < instruments; ++i) {
+            if (i == 0) popular_bitset.start();
+            auto subscribers = registry.subscribers(names[i]);
+            if (!subscribers) continue;
+            for (size_t w = 0; w < workers; ++w) {
+                subscribers->forEach(w, [&visited](uint32_t slot) { visited += slot != UINT32_MAX; });
+            }
+            if (i == 0) popular_bitset.stop();
+        }
+    }
+    auto iterate_bitset = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - iterate_start).count();
+    
+    // Previous broadcast path copied the id set into a vector before looking each id up
+    size_t visited_map = 0;
+    Benchmark popular_map("std::map/std::set copy, popular instrument");
+    iterate_start = std::chrono::high_resolution_clock::now();
+    for (int round = 0; round < broadcast_rounds; ++round) {
+        for (size_t i = 0; i < instruments; ++i) {
+            if (i == 0) popular_map.start();
+            auto it = baseline.find(names[i]);
+            if (it != baseline.end()) {
+                std::vector<std::string> ids(it->second.begin(), it->second.end());
+                visited_map += ids.size();
+            }
+            if (i == 0) popular_map.stop();
+        }
+    }
+    auto iterate_map = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - iterate_start).count();
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  Subscribe churn (bitset):    " << churn_bitset / churn_ops << " ns/op\n";
+    std::cout << "  Subscribe churn (map/set):   " << churn_map / churn_ops << " ns/op\n";
+    std::cout << "  Broadcast walk (bitset):     " << iterate_bitset / (broadcast_rounds * instruments) << " ns/broadcast, "
+              << std::setprecision(2) << iterate_bitset / std::max<size_t>(visited, 1) << " ns/subscriber\n";
+    std::cout << std::setprecision(1);
+    std::cout << "  Broadcast walk (map/set):    " << iterate_map / (broadcast_rounds * instruments) << " ns/broadcast, "
+              << std::setprecision(2) << iterate_map / std::max<size_t>(visited_map, 1) << " ns/subscriber\n";
+    std::cout << "-------------------------------------\n";
+    popular_bitset.printStatistics();
+    std::cout << "-------------------------------------\n";
+    popular_map.printStatistics();
+}
+
+// Order pipelining benchmark: the same mix of place/modify/cancel operations
+// issued one at a time versus all in flight through the async API, against
+// the stubbed REST path with a simulated exchange round trip
+void runOrderPipelineBenchmark(size_t operations = 1000, int64_t latency_us = 500, size_t request_threads = 32) {
+    std::cout << "Order pipelining: " << operations << " operations, " << latency_us
+              << " us simulated round trip, " << request_threads << " request threads\n";
+    
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    api_client->setMockLatency(latency_us);
+    
+    // Half placements, then a modify or cancel for each placed order
+    size_t placements = operations / 2;
+    
+    auto sequential = [&]() {
+        OrderManager order_manager(api_client, 10000, request_threads);
+        std::vector<std::string> labels;
+        for (size_t i = 0; i < placements; ++i) {
+            labels.push_back(order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0 - i, 0.1));
+        }
+        for (size_t i = 0; i < operations - placements; ++i) {
+            if (i % 2 == 0) {
+                order_manager.modifyOrder(labels[i], 49000.0 - i, 0.2);
+            } else {
+                order_manager.cancelOrder(labels[i]);
+            }
+        }
+    };
+    
+    auto pipelined = [&]() {
+        OrderManager order_manager(api_client, 10000, request_threads);
+        std::vector<OrderTicket> tickets;
+        for (size_t i = 0; i < placements; ++i) {
+            tickets.push_back(order_manager.placeOrderAsync("BTC-PERPETUAL", Order::Side::BUY, 50000.0 - i, 0.1));
+        }
+        std::vector<std::future<OrderAck>> acks;
+        for (size_t i = 0; i < operations - placements; ++i) {
+            // An edit needs the exchange id, so wait for that order's own ack first
+            tickets[i].ack.wait();
+            if (i % 2 == 0) {
+                acks.push_back(order_manager.modifyOrderAsync(tickets[i].label, 49000.0 - i, 0.2));
+            } else {
+                acks.push_back(order_manager.cancelOrderAsync(tickets[i].label));
+            }
+        }
+        for (auto& ack : acks) {
+            ack.wait();
+        }
+    };
+    
+    Benchmark sequential_benchmark("Sequential order operations (total)");
+    sequential_benchmark.start();
+    sequential();
+    double sequential_ms = sequential_benchmark.stop();
+    
+    Benchmark pipelined_benchmark("Pipelined order operations (total)");
+    pipelined_benchmark.start();
+    pipelined();
+    double pipelined_ms = pipelined_benchmark.stop();
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  Sequential: " << sequential_ms << " ms, "
+              << operations / (sequential_ms / 1000.0) << " ops/s\n";
+    std::cout << "  Pipelined:  " << pipelined_ms << " ms, "
+              << operations / (pipelined_ms / 1000.0) << " ops/s\n";
+    std::cout << "  Speedup:    " << sequential_ms / pipelined_ms << "x\n";
+}
+
+// Order state contention benchmark: one thread applies user.orders updates
+// while reader threads poll order state, either through the mutex-guarded
+// getOrder or the lock-free seqlock snapshot
+void runOrderStateBenchmark(size_t orders = 1000, size_t readers = 3, size_t updates = 200000) {
+    std::cout << "Order state contention: " << orders << " orders, " << readers
+              << " reader threads, " << updates << " updates\n";
+    
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    
+    for (bool lock_free : {false, true}) {
+        OrderManager order_manager(api_client);
+        std::vector<std::string> labels;
+        std::vector<OrderHandle> handles;
+        for (size_t i = 0; i < orders; ++i) {
+            labels.push_back(order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0 - i, 1.0));
+            handles.push_back(order_manager.findHandle(labels.back()));
+        }
+        
+        // Partial fills that keep every order open
+        std::vector<std::string> messages;
+        for (size_t i = 0; i < orders; ++i) {
+            messages.push_back(R"({"order_id": ")" + labels[i] +
+                               R"(", "order_state": "open", "filled_amount": 0.5})");
+        }
+        
+        std::atomic<bool> done{false};
+        // One histogram per reader thread, merged once they finish
+        std::vector<LatencyHistogram> read_latency(readers);
+        std::vector<std::thread> reader_threads;
+        for (size_t r = 0; r < readers; ++r) {
+            reader_threads.emplace_back([&, r]() {
+                LatencyHistogram& latency = read_latency[r];
+                size_t i = r;
+                OrderState state;
+                while (!done.load(std::memory_order_relaxed)) {
+                    size_t index = i++ % orders;
+                    auto start = std::chrono::steady_clock::now();
+                    if (lock_free) {
+                        order_manager.getOrderState(handles[index], state);
+                    } else {
+                        Order order = order_manager.getOrder(labels[index]);
+                    }
+                    latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count());
+                }
+            });
+        }
+        
+        LatencyHistogram update_latency;
+        for (size_t i = 0; i < updates; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            order_manager.onOrderUpdate(messages[i % orders]);
+            update_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+        done = true;
+        for (auto& thread : reader_threads) {
+            thread.join();
+        }
+        
+        LatencyHistogram reads;
+        for (const auto& latency : read_latency) {
+            reads.merge(latency);
+        }
+        
+        std::cout << (lock_free ? "  Seqlock getOrderState readers\n" : "  Mutex getOrder readers\n");
+        std::cout << "    Update " << update_latency.summary() << "\n";
+        std::cout << "    Read   " << reads.summary() << " (" << reads.count() << " reads)\n";
+    }
+}
+
+// Cost of the pre-trade risk gate with every rule enabled, on the accepting path
+void runRiskCheckBenchmark(size_t checks = 1000000, size_t instruments = 100) {
+    std::cout << "Pre-trade risk checks: " << checks << " checks over " << instruments << " instruments\n";
+    
+    auto positions = std::make_shared<PositionEngine>();
+    RiskEngine risk(positions);
+    RiskLimits limits;
+    limits.max_order_size = 100.0;
+    limits.max_notional = 1e9;
+    limits.price_band = 0.05;
+    limits.max_open_orders = 1000;
+    limits.max_position = 1e6;
+    risk.setDefaultLimits(limits);
+    risk.setThrottle(1000000000, 1000000000);
+    
+    std::vector<RiskOrder> orders;
+    std::vector<std::string> names;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> offset(-0.01, 0.01);
+    for (size_t i = 0; i < instruments; ++i) {
+        names.push_back("INSTR-" + std::to_string(i));
+        double mid = 100.0 + i;
+        risk.updateMid(names.back(), mid);
+        positions->setPosition(names.back(), 10.0, mid);
+        
+        for (size_t j = 0; j < 16; ++j) {
+            RiskOrder order;
+            order.instrument = risk.instrumentId(names.back());
+            order.side = j % 2 ? Order::Side::SELL : Order::Side::BUY;
+            order.price = mid * (1.0 + offset(rng));
+            order.amount = 1.0 + j;
+            order.open_orders = j;
+            orders.push_back(order);
+        }
+    }
+    std::shuffle(orders.begin(), orders.end(), rng);
+    
+    // Throughput: one timestamp per batch so the clock doesn't dominate
+    size_t accepted = 0;
+    auto start = std::chrono::steady_clock::now();
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+    for (size_t i = 0; i < checks; ++i) {
+        accepted += risk.check(orders[i % orders.size()], now + static_cast<int64_t>(i)) == RiskResult::ACCEPTED;
+    }
+    double total_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "  check(RiskOrder):        " << std::fixed << std::setprecision(1)
+              << total_ns / checks << " ns/check (" << accepted << " accepted)\n";
+    
+    // Per-call latency, including the clock read and the name lookup an order entry path does
+    LatencyHistogram latency;
+    for (size_t i = 0; i < checks; ++i) {
+        RiskOrder order = orders[i % orders.size()];
+        auto call_start = std::chrono::steady_clock::now();
+        order.instrument = risk.instrumentId(names[order.instrument]);
+        risk.check(order);
+        latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - call_start).count());
+    }
+    std::cout << "  lookup + check " << latency.summary() << "\n";
+}
+
+// Cost of recording a frame to the mapped journal, rotations included
+void runJournalBenchmark(size_t frames = 1000000, size_t frame_size = 400) {
+    std::cout << "Market data journal: " << frames << " frames of " << frame_size << " bytes\n";
+    
+    std::string directory = "benchmark_journal";
+    std::filesystem::remove_all(directory);
+    
+    std::string frame = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.none.10.100ms","data":)";
+    frame.resize(frame_size, ' ');
+    
+    LatencyHistogram latency;
+    size_t dropped = 0;
+    uint64_t rotations = 0;
+    double total_ns = 0;
+    {
+        FrameJournal journal(directory, "benchmark", 64u << 20);
+        for (size_t i = 0; i < frames; ++i) {
+            auto call_start = std::chrono::steady_clock::now();
+            bool written = journal.append(frame);
+            int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - call_start).count();
+            
+            // A flat-out writer can outrun the preparation of the next file;
+            // wait for it untimed and count the frame as written once it fits
+            if (!written) {
+                --i;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            latency.record(ns);
+            total_ns += ns;
+        }
+        dropped = journal.framesDropped();
+        rotations = journal.rotations();
+    }
+    
+    std::cout << "  append: " << std::fixed << std::setprecision(1) << total_ns / frames << " ns/frame, "
+              << (frames * frame_size / 1e6) / (total_ns / 1e9) << " MB/s, "
+              << rotations << " rotations, " << dropped << " waits for the next file\n";
+    std::cout << "  " << latency.summary() << "\n";
+    
+    std::filesystem::remove_all(directory);
+}
+
+// Synthetic BTC-PERPETUAL book frames at 100 ms, a random walk around 50000
+void writeSyntheticJournal(const std::string& directory, size_t frames) {
+    FrameJournal journal(directory, "marketdata");
+    std::mt19937 rng(7);
+    std::normal_distribution<double> step(0.0, 2.5);
+    double mid = 50000.0;
+    int64_t realtime_ns = FrameJournal::realtimeNs();
+    
+    for (size_t i = 0; i < frames; ++i) {
+        mid += step(rng);
+        json data;
+        data["timestamp"] = realtime_ns / 1000000;
+        data["change_id"] = i;
+        data["bids"] = json::array();
+        data["asks"] = json::array();
+        for (int level = 0; level < 10; ++level) {
+            data["bids"].push_back({std::round(mid * 2 - 1 - level) / 2, 1000.0 + level * 10});
+            data["asks"].push_back({std::round(mid * 2 + 1 + level) / 2, 1000.0 + level * 10});
+        }
+        json frame;
+        frame["jsonrpc"] = "2.0";
+        frame["method"] = "subscription";
+        frame["params"]["channel"] = "book.BTC-PERPETUAL.none.10.100ms";
+        frame["params"]["data"] = data;
+        
+        std::string text = frame.dump();
+        journal.append(text.data(), text.size(), realtime_ns, i);
+        realtime_ns += 100000000;
+    }
+}
+
+// Full inbound pipeline from a recorded journal: parse, book, callback, serialize, broadcast
+void runReplayBenchmark(const std::string& directory, double speed = 0.0, size_t frames = 100000) {
+    std::vector<std::string> files = FrameJournal::listFiles(directory, "marketdata");
+    if (files.empty()) {
+        std::cout << "No journal in " << directory << ", recording " << frames << " synthetic frames\n";
+        writeSyntheticJournal(directory, frames);
+        files = FrameJournal::listFiles(directory, "marketdata");
+    }
+    std::cout << "Replaying " << files.size() << " journal file(s) from " << directory;
+    if (speed > 0.0) {
+        std::cout << " at " << speed << "x\n";
+    } else {
+        std::cout << " as fast as possible\n";
+    }
+    
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    auto market_data = std::make_shared<MarketDataClient>(api_client);
+    auto order_manager = std::make_shared<OrderManager>(api_client);
+    auto ws_server = std::make_shared<WebSocketServer>(8082);
+    
+    auto router = std::make_shared<MessageRouter>();
+    market_data->setRouter(router);
+    order_manager->registerRoutes(*router);
+    
+    size_t broadcasts = 0;
+    market_data->setOrderbookCallback([&ws_server, &broadcasts](const Orderbook& orderbook) {
+        ws_server->broadcastOrderbook(orderbook.instrument, orderbookToJson(orderbook));
+        ++broadcasts;
+    });
+    
+    LatencyHistogram latency;
+    ReplayEngine replay(files);
+    replay.setHandler([&router, &latency](const std::string& frame, int64_t) {
+        auto start = std::chrono::steady_clock::now();
+        router->route(frame);
+        latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    });
+    
+    ReplayOptions options;
+    options.speed = speed;
+    ReplayStats stats = replay.run(options);
+    
+    double seconds = stats.elapsed_ns / 1e9;
+    std::cout << "  " << stats.frames << " frames (" << stats.bytes / 1024 << " KB), "
+              << broadcasts << " broadcasts in " << std::fixed << std::setprecision(3) << seconds << " s\n";
+    std::cout << "  " << std::setprecision(0) << stats.frames / seconds << " frames/s, "
+              << std::setprecision(1) << (stats.bytes / 1e6) / seconds << " MB/s, recorded span "
+              << std::setprecision(1) << stats.recorded_ns / 1e9 << " s";
+    if (speed > 0.0) {
+        std::cout << ", max lag " << stats.max_lag_ns / 1000 << " us";
+    }
+    std::cout << "\n";
+    if (latency.count()) {
+        std::cout << "  Per frame " << latency.summary() << "\n";
+    }
+}
+
+// Real client code paths (WebSocket session, router, MarketDataClient) against a
+// local MockExchange: book throughput at the requested rate, then order round
+// trips through OrderManager, so the risk gate, credit tracker and outbound
+// priority lanes are all on the measured path
+void runExchangeBenchmark(double rate = 100000, double seconds = 5.0, size_t instruments = 4, size_t orders = 1000) {
+    MockExchangeConfig config;
+    config.instruments.clear();
+    for (size_t i = 0; i < instruments; ++i) {
+        config.instruments.push_back("MOCK-" + std::to_string(i) + "-PERPETUAL");
+    }
+    config.book_updates_per_second = rate / std::max<size_t>(instruments, 1);
+    MockExchange exchange(config);
+    if (!exchange.start()) return;
+    std::cout << "Mock exchange on 127.0.0.1:" << exchange.port() << ", " << instruments << " instruments, "
+              << rate << " book updates/s requested\n";
+    
+    ApiClient::Auth auth;
+    auth.client_id = "benchmark";
+    auth.client_secret = "benchmark";
+    auto api_client = std::make_shared<ApiClient>(auth);
+    ApiClient::Endpoint endpoint;
+    endpoint.host = "127.0.0.1";
+    endpoint.port = std::to_string(exchange.port());
+    endpoint.tls = false;
+    api_client->setEndpoint(endpoint);
+    
+    auto router = std::make_shared<MessageRouter>();
+    
+    MarketDataClient market_data(api_client);
+    market_data.setRouter(router);
+    std::atomic<uint64_t> books{0};
+    market_data.setOrderbookCallback([&books](const Orderbook&) { ++books; });
+    for (const auto& instrument : config.instruments) {
+        market_data.subscribe(instrument);
+    }
+    market_data.start();
+    
+    // Let the connection settle before measuring
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    MockExchange::Stats before = exchange.stats();
+    uint64_t books_before = books;
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    MockExchange::Stats after = exchange.stats();
+    uint64_t received = books - books_before;
+    
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << "  Generated: " << (after.book_updates - before.book_updates) / elapsed << " updates/s, sent "
+              << (after.messages_sent - before.messages_sent) / elapsed << " msgs/s, dropped "
+              << after.messages_dropped - before.messages_dropped << "\n";
+    std::cout << "  Applied by MarketDataClient: " << received / elapsed << " books/s\n";
+    
+    // Sequential round trips with the book stream quiet
+    const std::string& instrument = config.instruments.front();
+    Orderbook book = market_data.getOrderbook(instrument);
+    for (const auto& subscribed : config.instruments) {
+        market_data.unsubscribe(subscribed);
+    }
+    
+    // Risk limits and credit pools sized so they are checked but never bind
+    OrderManager order_manager(api_client, 10000, 4);
+    auto risk = std::make_shared<RiskEngine>(order_manager.positionEngine());
+    risk->setDefaultLimits(Config::defaultRiskLimits());
+    risk->setThrottle(1000000, 1000000000);
+    order_manager.setRiskEngine(risk);
+    
+    CreditTracker::Limits credits;
+    credits.max_credits = 1000000 * ApiClient::kRequestCost;
+    credits.refill_per_second = 1000000 * ApiClient::kRequestCost;
+    api_client->setCreditLimits(ApiClient::CreditPool::MATCHING_ENGINE, credits);
+    api_client->setRateLimitMode(ApiClient::RateLimitMode::QUEUE);
+    
+    double mid = !book.bids.empty() && !book.asks.empty()
+        ? (book.bids[0].price + book.asks[0].price) / 2.0 : config.initial_price;
+    risk->updateMid(instrument, mid);
+    
+    // Passive quotes 1% either side of the mid, clear of the walk and inside the
+    // price band: each is placed, then cancelled
+    LatencyHistogram places;
+    LatencyHistogram cancels;
+    size_t not_open = 0;
+    for (size_t i = 0; i < orders; ++i) {
+        bool buy = i % 2 == 0;
+        double price = std::round((buy ? mid * 0.99 : mid * 1.01) / config.tick_size) * config.tick_size;
+        
+        auto sent = std::chrono::steady_clock::now();
+        std::string label = order_manager.placeOrder(instrument, buy ? Order::Side::BUY : Order::Side::SELL, price, 10.0);
+        places.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - sent).count());
+        if (order_manager.getOrder(label).status != Order::Status::OPEN) {
+            ++not_open;
+            continue;
+        }
+        
+        sent = std::chrono::steady_clock::now();
+        order_manager.cancelOrder(label);
+        cancels.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - sent).count());
+    }
+    if (places.count()) {
+        std::cout << "  Place round trip  " << places.summary("us", 1000) << "\n";
+    }
+    if (cancels.count()) {
+        std::cout << "  Cancel round trip " << cancels.summary("us", 1000) << "\n";
+    }
+    std::cout << "  " << exchange.stats().orders << " orders reached the exchange, " << not_open << " not open after placement\n";
+    
+    market_data.stop();
+    exchange.stop();
+}
+
 // Entry point for the benchmark tool
 int main(int argc, char* argv[]) {
     std::cout << "Deribit Trader Benchmark Tool\n";
     std::cout << "-----------------------------\n\n";
     
+    // Offline suites, selected by name
+    if (argc > 1 && std::strcmp(argv[1], "subscribers") == 0) {
+        size_t connections = argc > 2 ? std::stoul(argv[2]) : 10000;
+        size_t instruments = argc > 3 ? std::stoul(argv[3]) : 500;
+        runSubscriberIndexBenchmark(connections, instruments);
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "orders") == 0) {
+        size_t operations = argc > 2 ? std::stoul(argv[2]) : 1000;
+        int64_t latency_us = argc > 3 ? std::stoll(argv[3]) : 500;
+        size_t request_threads = argc > 4 ? std::stoul(argv[4]) : 32;
+        runOrderPipelineBenchmark(operations, latency_us, request_threads);
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "orderstate") == 0) {
+        size_t orders = argc > 2 ? std::stoul(argv[2]) : 1000;
+        size_t readers = argc > 3 ? std::stoul(argv[3]) : 3;
+        size_t updates = argc > 4 ? std::stoul(argv[4]) : 200000;
+        runOrderStateBenchmark(orders, readers, updates);
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "journal") == 0) {
+        size_t frames = argc > 2 ? std::stoul(argv[2]) : 1000000;
+        size_t frame_size = argc > 3 ? std::stoul(argv[3]) : 400;
+        runJournalBenchmark(frames, frame_size);
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "replay") == 0) {
+        std::string directory = argc > 2 ? argv[2] : "replay_journal";
+        double speed = argc > 3 ? std::stod(argv[3]) : 0.0;
+        size_t frames = argc > 4 ? std::stoul(argv[4]) : 100000;
+        runReplayBenchmark(directory, speed, frames);
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "exchange") == 0) {
+        double rate = argc > 2 ? std::stod(argv[2]) : 100000;
+        double seconds = argc > 3 ? std::stod(argv[3]) : 5.0;
+        size_t instruments = argc > 4 ? std::stoul(argv[4]) : 4;
+        size_t orders = argc > 5 ? std::stoul(argv[5]) : 1000;
+        runExchangeBenchmark(rate, seconds, instruments, orders);
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "risk") == 0) {
+        size_t checks = argc > 2 ? std::stoul(argv[2]) : 1000000;
+        size_t instruments = argc > 3 ? std::stoul(argv[3]) : 100;
+        runRiskCheckBenchmark(checks, instruments);
+        return 0;
+    }
+    
     int iterations = 100;
     if (argc > 1) {
         iterations = std::stoi(argv[1]);
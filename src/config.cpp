@@ -0,0 +1,356 @@
+#include "config.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <fstream>
+#include <sstream>
+
+// Include JSON library
+#define NLOHMANN_JSON_VERSION_MAJOR 3
+#define NLOHMANN_JSON_VERSION_MINOR 11
+#define NLOHMANN_JSON_VERSION_PATCH 2
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        item = trim(item);
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool parseBool(const std::string& text, bool& value) {
+    std::string lower;
+    for (char c : trim(text)) lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (lower == "true" || lower == "1" || lower == "yes" || lower == "on") {
+        value = true;
+        return true;
+    }
+    if (lower == "false" || lower == "0" || lower == "no" || lower == "off") {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+bool parseInt(const std::string& text, long long& value) {
+    std::string digits = trim(text);
+    if (digits.empty()) return false;
+    char* end = nullptr;
+    value = std::strtoll(digits.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+bool parseDouble(const std::string& text, double& value) {
+    std::string digits = trim(text);
+    if (digits.empty()) return false;
+    char* end = nullptr;
+    value = std::strtod(digits.c_str(), &end);
+    return *end == '\0' && std::isfinite(value);
+}
+
+// A positive risk limit, or "off" for none
+bool parseLimit(const std::string& text, double& value) {
+    if (trim(text) == "off") {
+        value = std::numeric_limits<double>::infinity();
+        return true;
+    }
+    return parseDouble(text, value) && value > 0.0;
+}
+
+// Byte counts and other sizes; accepts a K, M or G suffix (powers of 1024)
+bool parseSize(const std::string& text, size_t& value) {
+    std::string digits = trim(text);
+    unsigned shift = 0;
+    if (!digits.empty()) {
+        switch (std::toupper(static_cast<unsigned char>(digits.back()))) {
+            case 'K': shift = 10; break;
+            case 'M': shift = 20; break;
+            case 'G': shift = 30; break;
+            default: break;
+        }
+        if (shift) digits.pop_back();
+    }
+    long long number = 0;
+    if (!parseInt(digits, number) || number < 0) return false;
+    value = static_cast<size_t>(number) << shift;
+    return true;
+}
+
+// "0,2,4-7"
+bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    std::vector<int> parsed;
+    for (const auto& item : splitList(text)) {
+        size_t dash = item.find('-');
+        long long first = 0;
+        long long last = 0;
+        if (dash == std::string::npos) {
+            if (!parseInt(item, first)) return false;
+            last = first;
+        } else if (!parseInt(item.substr(0, dash), first) || !parseInt(item.substr(dash + 1), last)) {
+            return false;
+        }
+        if (first < 0 || last < first) return false;
+        for (long long cpu = first; cpu <= last; ++cpu) {
+            parsed.push_back(static_cast<int>(cpu));
+        }
+    }
+    cpus = std::move(parsed);
+    return true;
+}
+
+using Setter = bool (*)(Config&, const std::string&);
+
+struct Setting {
+    const char* key;   // "section.name" in the file
+    const char* env;   // environment variable
+    Setter set;
+};
+
+// Every configurable value, once; the file and the environment share this table
+const Setting kSettings[] = {
+    {"exchange.host", "DERIBIT_HOST", [](Config& c, const std::string& v) {
+        c.endpoint.host = trim(v);
+        return !c.endpoint.host.empty();
+    }},
+    {"exchange.port", "DERIBIT_PORT", [](Config& c, const std::string& v) {
+        long long port = 0;
+        if (!parseInt(v, port) || port <= 0 || port > 65535) return false;
+        c.endpoint.port = std::to_string(port);
+        return true;
+    }},
+    {"exchange.path", "DERIBIT_PATH", [](Config& c, const std::string& v) {
+        c.endpoint.path = trim(v);
+        return !c.endpoint.path.empty() && c.endpoint.path[0] == '/';
+    }},
+    {"exchange.tls", "DERIBIT_TLS", [](Config& c, const std::string& v) {
+        return parseBool(v, c.endpoint.tls);
+    }},
+    {"exchange.client_id", "DERIBIT_CLIENT_ID", [](Config& c, const std::string& v) {
+        c.auth.client_id = v;
+        return true;
+    }},
+    {"exchange.client_secret", "DERIBIT_CLIENT_SECRET", [](Config& c, const std::string& v) {
+        c.auth.client_secret = v;
+        return true;
+    }},
+    {"exchange.rate_limit", "DERIBIT_RATE_LIMIT", [](Config& c, const std::string& v) {
+        std::string mode = trim(v);
+        if (mode == "off") c.rate_limit = ApiClient::RateLimitMode::OFF;
+        else if (mode == "queue") c.rate_limit = ApiClient::RateLimitMode::QUEUE;
+        else if (mode == "reject") c.rate_limit = ApiClient::RateLimitMode::REJECT;
+        else return false;
+        return true;
+    }},
+    {"exchange.cpu", "DERIBIT_CLIENT_CPU", [](Config& c, const std::string& v) {
+        long long cpu = 0;
+        if (!parseInt(v, cpu) || cpu < -1) return false;
+        c.client_cpu = static_cast<int>(cpu);
+        return true;
+    }},
+    {"market_data.instruments", "DERIBIT_INSTRUMENTS", [](Config& c, const std::string& v) {
+        c.instruments = splitList(v);
+        return true;
+    }},
+    {"market_data.book_depth", "DERIBIT_BOOK_DEPTH", [](Config& c, const std::string& v) {
+        long long depth = 0;
+        if (!parseInt(v, depth) || depth <= 0) return false;
+        c.book_depth = static_cast<int>(depth);
+        return true;
+    }},
+    {"market_data.book_interval", "DERIBIT_BOOK_INTERVAL", [](Config& c, const std::string& v) {
+        c.book_interval = trim(v);
+        return c.book_interval == "raw" || c.book_interval == "100ms" || c.book_interval == "agg2";
+    }},
+    {"market_data.journal_dir", "DERIBIT_JOURNAL_DIR", [](Config& c, const std::string& v) {
+        c.journal_dir = trim(v);
+        return true;
+    }},
+    {"market_data.journal_file_size", "DERIBIT_JOURNAL_FILE_SIZE", [](Config& c, const std::string& v) {
+        return parseSize(v, c.journal_file_size) && c.journal_file_size > 0;
+    }},
+    {"market_data.tick_dir", "DERIBIT_TICK_DIR", [](Config& c, const std::string& v) {
+        c.tick_dir = trim(v);
+        return true;
+    }},
+    {"orders.history", "DERIBIT_ORDER_HISTORY", [](Config& c, const std::string& v) {
+        return parseSize(v, c.order_history) && c.order_history > 0;
+    }},
+    {"orders.request_threads", "DERIBIT_REQUEST_THREADS", [](Config& c, const std::string& v) {
+        return parseSize(v, c.request_threads) && c.request_threads > 0;
+    }},
+    {"risk.max_order_size", "DERIBIT_RISK_MAX_ORDER_SIZE", [](Config& c, const std::string& v) {
+        return parseLimit(v, c.risk_limits.max_order_size);
+    }},
+    {"risk.max_notional", "DERIBIT_RISK_MAX_NOTIONAL", [](Config& c, const std::string& v) {
+        return parseLimit(v, c.risk_limits.max_notional);
+    }},
+    {"risk.price_band", "DERIBIT_RISK_PRICE_BAND", [](Config& c, const std::string& v) {
+        if (trim(v) == "off") {
+            c.risk_limits.price_band = 0.0;
+            return true;
+        }
+        return parseDouble(v, c.risk_limits.price_band) && c.risk_limits.price_band >= 0.0;
+    }},
+    {"risk.max_open_orders", "DERIBIT_RISK_MAX_OPEN_ORDERS", [](Config& c, const std::string& v) {
+        if (trim(v) == "off") {
+            c.risk_limits.max_open_orders = std::numeric_limits<uint32_t>::max();
+            return true;
+        }
+        long long count = 0;
+        if (!parseInt(v, count) || count <= 0 || count > std::numeric_limits<uint32_t>::max()) return false;
+        c.risk_limits.max_open_orders = static_cast<uint32_t>(count);
+        return true;
+    }},
+    {"risk.max_position", "DERIBIT_RISK_MAX_POSITION", [](Config& c, const std::string& v) {
+        return parseLimit(v, c.risk_limits.max_position);
+    }},
+    {"risk.max_messages", "DERIBIT_RISK_MAX_MESSAGES", [](Config& c, const std::string& v) {
+        long long count = 0;
+        if (!parseInt(v, count) || count < 0 || count > std::numeric_limits<uint32_t>::max()) return false;
+        c.risk_max_messages = static_cast<uint32_t>(count);
+        return true;
+    }},
+    {"risk.window_ms", "DERIBIT_RISK_WINDOW_MS", [](Config& c, const std::string& v) {
+        long long ms = 0;
+        if (!parseInt(v, ms) || ms <= 0) return false;
+        c.risk_window_ms = ms;
+        return true;
+    }},
+    {"server.port", "DERIBIT_SERVER_PORT", [](Config& c, const std::string& v) {
+        long long port = 0;
+        if (!parseInt(v, port) || port <= 0 || port > 65535) return false;
+        c.server_port = static_cast<int>(port);
+        return true;
+    }},
+    {"server.threads", "DERIBIT_SERVER_THREADS", [](Config& c, const std::string& v) {
+        return parseSize(v, c.server_threads) && c.server_threads > 0;
+    }},
+    {"server.max_connections", "DERIBIT_MAX_CONNECTIONS", [](Config& c, const std::string& v) {
+        return parseSize(v, c.max_connections) && c.max_connections > 0;
+    }},
+    {"server.max_queued_messages", "DERIBIT_MAX_QUEUED_MESSAGES", [](Config& c, const std::string& v) {
+        return parseSize(v, c.max_queued_messages) && c.max_queued_messages > 0;
+    }},
+    {"server.cpus", "DERIBIT_SERVER_CPUS", [](Config& c, const std::string& v) {
+        return parseCpuList(v, c.server_cpus);
+    }},
+};
+
+// File values in the string form the environment would carry
+bool toSettingString(const json& value, std::string& text) {
+    if (value.is_string()) {
+        text = value.get<std::string>();
+    } else if (value.is_boolean()) {
+        text = value.get<bool>() ? "true" : "false";
+    } else if (value.is_number()) {
+        text = value.dump();
+    } else if (value.is_array()) {
+        text.clear();
+        for (const auto& item : value) {
+            std::string element;
+            if (item.is_array() || item.is_object() || !toSettingString(item, element)) return false;
+            text += (text.empty() ? "" : ",") + element;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+RiskLimits Config::defaultRiskLimits() {
+    RiskLimits limits;
+    limits.max_order_size = 100000.0;    // USD contracts per order
+    limits.price_band = 0.05;            // within 5% of the mid
+    limits.max_open_orders = 50;         // working orders per instrument
+    limits.max_position = 1000000.0;     // absolute net USD contracts
+    return limits;
+}
+
+bool Config::set(const std::string& key, const std::string& value, std::string& error) {
+    for (const Setting& setting : kSettings) {
+        if (key != setting.key) continue;
+        if (!setting.set(*this, value)) {
+            error = "invalid value for " + key + ": \"" + value + "\"";
+            return false;
+        }
+        return true;
+    }
+    error = "unknown setting " + key;
+    return false;
+}
+
+bool Config::applyJson(const std::string& text, std::string& error) {
+    json document = json::parse(text, nullptr, false);
+    if (document.is_discarded() || !document.is_object()) {
+        error = "config is not a JSON object";
+        return false;
+    }
+    
+    for (const auto& section : document.items()) {
+        if (!section.value().is_object()) {
+            error = "config section " + section.key() + " is not an object";
+            return false;
+        }
+        for (const auto& item : section.value().items()) {
+            std::string key = section.key() + "." + item.key();
+            std::string value;
+            if (!toSettingString(item.value(), value)) {
+                error = "invalid value for " + key;
+                return false;
+            }
+            if (!set(key, value, error)) return false;
+        }
+    }
+    return true;
+}
+
+bool Config::applyEnvironment(const Environment& environment, std::string& error) {
+    for (const Setting& setting : kSettings) {
+        const char* value = environment(setting.env);
+        if (!value) continue;
+        if (!set(setting.key, value, error)) {
+            error += std::string(" (from ") + setting.env + ")";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Config::load(const std::string& path, Config& config, std::string& error, const Environment& environment) {
+    config = Config();
+    
+    if (!path.empty()) {
+        std::ifstream file(path);
+        if (!file) {
+            error = "cannot read config file " + path;
+            return false;
+        }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        if (!config.applyJson(contents.str(), error)) {
+            error = path + ": " + error;
+            return false;
+        }
+    }
+    
+    return config.applyEnvironment(environment, error);
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "connection_table.h"
+
+#include <algorithm>
+#include <atomic>
+
+ConnectionTable::ConnectionTable(size_t worker_count, size_t slots_per_worker)
+    : worker_count_(std::max<size_t>(worker_count, 1)),
+      slots_per_worker_(std::max<size_t>(slots_per_worker, 1)),
+      slots_(new Slot[worker_count_ * slots_per_worker_]) {
+    for (size_t worker = 0; worker < worker_count_; ++worker) {
+        auto free_list = std::make_unique<FreeList>();
+        free_list->slots.reserve(slots_per_worker_);
+        
+        // Push in reverse so the lowest slots are handed out first
+        uint32_t first = static_cast<uint32_t>(worker * slots_per_worker_);
+        for (size_t i = slots_per_worker_; i > 0; --i) {
+            free_list->slots.push_back(first + static_cast<uint32_t>(i - 1));
+        }
+        free_lists_.push_back(std::move(free_list));
+    }
+}
+
+ConnectionId ConnectionTable::acquire(size_t worker, const WebSocketConnection::Pointer& connection) {
+    FreeList& free_list = *free_lists_[worker % worker_count_];
+    std::lock_guard<std::mutex> lock(free_list.mutex);
+    if (free_list.slots.empty()) {
+        return kInvalidId;
+    }
+    
+    uint32_t slot = free_list.slots.back();
+    free_list.slots.pop_back();
+    
+    ConnectionId id = (static_cast<ConnectionId>(slots_[slot].generation) << 32) | slot;
+    connection->id_ = id;
+    std::atomic_store(&slots_[slot].connection, connection);
+    ++size_;
+    
+    return id;
+}
+
+void ConnectionTable::release(ConnectionId id) {
+    uint32_t slot = slotOf(id);
+    if (id == kInvalidId || slot >= capacity()) return;
+    
+    FreeList& free_list = *free_lists_[workerOf(slot)];
+    std::lock_guard<std::mutex> lock(free_list.mutex);
+    
+    // Ignore double releases and stale ids
+    if (slots_[slot].generation != generationOf(id)) return;
+    
+    std::atomic_store(&slots_[slot].connection, WebSocketConnection::Pointer());
+    
+    // Bump the generation, skipping 0 so no live id equals kInvalidId
+    if (++slots_[slot].generation == 0) {
+        slots_[slot].generation = 1;
+    }
+    
+    free_list.slots.push_back(slot);
+    --size_;
+}
+
+WebSocketConnection::Pointer ConnectionTable::get(ConnectionId id) const {
+    uint32_t slot = slotOf(id);
+    if (slot >= capacity()) return nullptr;
+    
+    WebSocketConnection::Pointer connection = std::atomic_load(&slots_[slot].connection);
+    if (connection && connection->getId() == id) {
+        return connection;
+    }
+    return nullptr;
+}
+
+WebSocketConnection::Pointer ConnectionTable::at(uint32_t slot) const {
+    if (slot >= capacity()) return nullptr;
+    return std::atomic_load(&slots_[slot].connection);
+}
+
+std::vector<WebSocketConnection::Pointer> ConnectionTable::all() const {
+    std::vector<WebSocketConnection::Pointer> connections;
+    connections.reserve(size_);
+    for (size_t slot = 0; slot < capacity(); ++slot) {
+        WebSocketConnection::Pointer connection = std::atomic_load(&slots_[slot].connection);
+        if (connection) {
+            connections.push_back(std::move(connection));
+        }
+    }
+    return connections;
+}
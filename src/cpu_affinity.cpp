@@ -0,0 +1,54 @@
+#include "cpu_affinity.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+bool pinNativeThread(pthread_t thread, int cpu) {
+    if (cpu >= CPU_SETSIZE) {
+        std::cerr << "Cannot pin thread to CPU " << cpu << ": out of range" << std::endl;
+        return false;
+    }
+    
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(thread, sizeof(set), &set);
+    if (rc != 0) {
+        std::cerr << "Cannot pin thread to CPU " << cpu << ": error " << rc << std::endl;
+        return false;
+    }
+    return true;
+}
+#endif
+
+}
+
+bool pinThreadToCpu(std::thread& thread, int cpu) {
+    if (cpu < 0) return true;
+    
+#ifdef __linux__
+    return pinNativeThread(thread.native_handle(), cpu);
+#else
+    (void)thread;
+    std::cerr << "CPU affinity is not supported on this platform" << std::endl;
+    return false;
+#endif
+}
+
+bool pinCurrentThreadToCpu(int cpu) {
+    if (cpu < 0) return true;
+    
+#ifdef __linux__
+    return pinNativeThread(pthread_self(), cpu);
+#else
+    std::cerr << "CPU affinity is not supported on this platform" << std::endl;
+    return false;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "credit_tracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+CreditTracker::CreditTracker() : CreditTracker(Limits()) {
+}
+
+CreditTracker::CreditTracker(const Limits& limits)
+    : limits_(limits),
+      credits_(static_cast<double>(limits.max_credits)) {
+}
+
+void CreditTracker::setLimits(const Limits& limits) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    limits_ = limits;
+    credits_ = std::min(credits_, static_cast<double>(limits.max_credits));
+}
+
+CreditTracker::Limits CreditTracker::limits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limits_;
+}
+
+double CreditTracker::balanceAt(int64_t now_ns) const {
+    // The first request starts the clock with a full pool
+    if (last_refill_ns_ == 0 || now_ns <= last_refill_ns_) {
+        return credits_;
+    }
+    double refilled = (now_ns - last_refill_ns_) * 1e-9 * limits_.refill_per_second;
+    return std::min(credits_ + refilled, static_cast<double>(limits_.max_credits));
+}
+
+void CreditTracker::refill(int64_t now_ns) {
+    credits_ = balanceAt(now_ns);
+    last_refill_ns_ = std::max(last_refill_ns_, now_ns);
+}
+
+bool CreditTracker::tryAcquire(int64_t cost, int64_t now_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refill(now_ns);
+    if (credits_ < cost) {
+        return false;
+    }
+    credits_ -= cost;
+    return true;
+}
+
+int64_t CreditTracker::reserve(int64_t cost, int64_t now_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refill(now_ns);
+    
+    double shortfall = cost - credits_;
+    int64_t wait = 0;
+    if (shortfall > 0.0) {
+        if (limits_.refill_per_second <= 0) return -1;
+        wait = static_cast<int64_t>(std::ceil(shortfall * 1e9 / limits_.refill_per_second));
+        if (wait > limits_.max_queue_ns) return -1;
+    }
+    credits_ -= cost;
+    return wait;
+}
+
+int64_t CreditTracker::waitTime(int64_t cost, int64_t now_ns) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double shortfall = cost - balanceAt(now_ns);
+    if (shortfall <= 0.0) return 0;
+    if (limits_.refill_per_second <= 0) return -1;
+    return static_cast<int64_t>(std::ceil(shortfall * 1e9 / limits_.refill_per_second));
+}
+
+int64_t CreditTracker::available(int64_t now_ns) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int64_t>(std::floor(balanceAt(now_ns)));
+}
+
+int64_t CreditTracker::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CreditTracker::tryAcquire(int64_t cost) {
+    return tryAcquire(cost, nowNs());
+}
+
+bool CreditTracker::acquire(int64_t cost) {
+    int64_t wait = reserve(cost, nowNs());
+    if (wait < 0) return false;
+    if (wait > 0) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+    }
+    return true;
+}
+
+void CreditTracker::waitFor(int64_t cost) const {
+    int64_t wait = waitTime(cost, nowNs());
+    if (wait > 0) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,362 @@
+#include "frame_journal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'R', 'B', 'J', 'R', 'N', 'L', '1'};
+constexpr size_t kFileHeaderSize = 64;
+constexpr size_t kRecordHeaderSize = 24;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    int64_t created_ns;
+};
+
+// Record layout: uint32 length, uint32 reserved, int64 realtime_ns, uint64 tsc, bytes
+size_t recordSize(size_t frame_size) {
+    return (kRecordHeaderSize + frame_size + 7) & ~static_cast<size_t>(7);
+}
+
+// Offset just past the first quoted key "name", matched in place; npos if absent
+size_t findKey(std::string_view frame, std::string_view name) {
+    for (size_t at = frame.find(name); at != std::string_view::npos; at = frame.find(name, at + 1)) {
+        size_t end = at + name.size();
+        if (at > 0 && frame[at - 1] == '"' && end < frame.size() && frame[end] == '"') {
+            return end + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Value of the first string field with the given name, without parsing the frame;
+// empty when the field is missing or not a string
+std::string_view stringField(std::string_view frame, std::string_view name) {
+    size_t i = findKey(frame, name);
+    if (i == std::string_view::npos) return {};
+    
+    while (i < frame.size() && (frame[i] == ' ' || frame[i] == '\t' || frame[i] == '\n' || frame[i] == '\r')) ++i;
+    if (i >= frame.size() || frame[i] != ':') return {};
+    ++i;
+    while (i < frame.size() && (frame[i] == ' ' || frame[i] == '\t' || frame[i] == '\n' || frame[i] == '\r')) ++i;
+    if (i >= frame.size() || frame[i] != '"') return {};
+    
+    size_t end = frame.find('"', i + 1);
+    if (end == std::string_view::npos) return {};
+    return frame.substr(i + 1, end - i - 1);
+}
+
+} // namespace
+
+bool FrameJournal::carriesToken(std::string_view frame) {
+    return findKey(frame, "access_token") != std::string_view::npos ||
+           findKey(frame, "refresh_token") != std::string_view::npos ||
+           stringField(frame, "method") == "public/auth";
+}
+
+FrameJournal::FrameJournal(const std::string& directory, const std::string& prefix, size_t file_size)
+    : directory_(directory),
+      prefix_(prefix),
+      file_size_(std::max<size_t>(file_size, 4096)) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    
+    // Continue numbering after any files already in the directory
+    std::vector<std::string> existing = listFiles(directory_, prefix_);
+    if (!existing.empty()) {
+        std::string stem = std::filesystem::path(existing.back()).stem().string();
+        next_sequence_ = std::strtoull(stem.c_str() + prefix_.size() + 1, nullptr, 10) + 1;
+    }
+    
+    if (!mapFile(current_, pathFor(next_sequence_++))) {
+        return;
+    }
+    offset_ = kFileHeaderSize;
+    worker_ = std::thread(&FrameJournal::backgroundLoop, this);
+}
+
+FrameJournal::~FrameJournal() {
+    close();
+}
+
+std::string FrameJournal::pathFor(uint64_t sequence) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "-%06llu.journal", static_cast<unsigned long long>(sequence));
+    return (std::filesystem::path(directory_) / (prefix_ + name)).string();
+}
+
+bool FrameJournal::mapFile(Mapping& mapping, const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error creating journal " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    
+    // Reserve the blocks up front so appends never extend the file
+    if (::posix_fallocate(fd, 0, static_cast<off_t>(file_size_)) != 0 &&
+        ::ftruncate(fd, static_cast<off_t>(file_size_)) != 0) {
+        std::cerr << "Error preallocating journal " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    
+    // MAP_POPULATE maps the pages in here rather than on the I/O thread
+    void* base = ::mmap(nullptr, file_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "Error mapping journal " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    
+    // Shared file pages still fault on their first write; take those faults now too
+    long page = ::sysconf(_SC_PAGESIZE);
+    for (size_t offset = 0; offset < file_size_; offset += static_cast<size_t>(page)) {
+        static_cast<volatile char*>(base)[offset] = 0;
+    }
+    
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = 1;
+    header.header_size = kFileHeaderSize;
+    header.file_size = file_size_;
+    header.created_ns = realtimeNs();
+    std::memcpy(base, &header, sizeof(header));
+    
+    mapping.fd = fd;
+    mapping.base = static_cast<char*>(base);
+    mapping.size = file_size_;
+    mapping.path = path;
+    return true;
+}
+
+void FrameJournal::finish(Mapping& mapping, size_t used) {
+    if (!mapping.base) return;
+    ::munmap(mapping.base, mapping.size);
+    if (::ftruncate(mapping.fd, static_cast<off_t>(used)) != 0) {
+        std::cerr << "Error trimming journal " << mapping.path << std::endl;
+    }
+    ::close(mapping.fd);
+    mapping = Mapping();
+}
+
+bool FrameJournal::rotate() {
+    // Never wait on the background thread from the I/O thread
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || !next_ready_) {
+        return false;
+    }
+    
+    retired_.emplace_back(current_, offset_);
+    current_ = next_;
+    next_ = Mapping();
+    next_ready_ = false;
+    offset_ = kFileHeaderSize;
+    rotations_.fetch_add(1, std::memory_order_relaxed);
+    
+    lock.unlock();
+    cv_.notify_one();
+    return true;
+}
+
+bool FrameJournal::append(const char* data, size_t size, int64_t realtime_ns, uint64_t tsc) {
+    if (size == 0) return true;
+    
+    size_t record = recordSize(size);
+    if (!current_.base || size > UINT32_MAX || kFileHeaderSize + record > current_.size) {
+        frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (offset_ + record > current_.size && !rotate()) {
+        frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    char* out = current_.base + offset_;
+    uint32_t reserved = 0;
+    std::memcpy(out + 4, &reserved, sizeof(reserved));
+    std::memcpy(out + 8, &realtime_ns, sizeof(realtime_ns));
+    std::memcpy(out + 16, &tsc, sizeof(tsc));
+    std::memcpy(out + kRecordHeaderSize, data, size);
+    
+    // Publish the record by its length
+    __atomic_store_n(reinterpret_cast<uint32_t*>(out), static_cast<uint32_t>(size), __ATOMIC_RELEASE);
+    
+    offset_ += record;
+    frames_written_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void FrameJournal::backgroundLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // Finish retired files outside the lock
+        std::vector<std::pair<Mapping, size_t>> retired;
+        retired.swap(retired_);
+        bool prepare = !next_ready_ && !stopping_;
+        uint64_t sequence = next_sequence_;
+        
+        if (!retired.empty() || prepare) {
+            lock.unlock();
+            for (auto& file : retired) {
+                finish(file.first, file.second);
+            }
+            Mapping mapping;
+            bool mapped = prepare && mapFile(mapping, pathFor(sequence));
+            lock.lock();
+            
+            if (mapped) {
+                next_ = mapping;
+                next_ready_ = true;
+                ++next_sequence_;
+            }
+            if (prepare && !mapped) {
+                // Retry after a pause rather than spinning on a full disk
+                cv_.wait_for(lock, std::chrono::seconds(1));
+            }
+            continue;
+        }
+        
+        if (stopping_) break;
+        cv_.wait(lock);
+    }
+}
+
+void FrameJournal::close() {
+    if (worker_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        worker_.join();
+    }
+    
+    finish(current_, offset_);
+    
+    // The prepared file was never written; remove it
+    if (next_.base) {
+        std::string path = next_.path;
+        finish(next_, 0);
+        std::remove(path.c_str());
+        next_ready_ = false;
+    }
+}
+
+int64_t FrameJournal::realtimeNs() {
+    timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t FrameJournal::readTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+std::vector<std::string> FrameJournal::listFiles(const std::string& directory, const std::string& prefix) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if (entry.path().extension() != ".journal") continue;
+        
+        // <prefix>-<digits>.journal; anything else (e.g. marketdata-old.journal) is not ours
+        std::string stem = entry.path().stem().string();
+        if (stem.size() <= prefix.size() + 1 || stem.size() > prefix.size() + 1 + 19 ||
+            stem.compare(0, prefix.size() + 1, prefix + "-") != 0) {
+            continue;
+        }
+        bool digits = std::all_of(stem.begin() + prefix.size() + 1, stem.end(),
+                                  [](char c) { return c >= '0' && c <= '9'; });
+        if (digits) {
+            files.push_back(entry.path().string());
+        }
+    }
+    
+    // Sequence order; numbers are zero-padded to six digits, so compare lengths first
+    std::sort(files.begin(), files.end(), [](const std::string& a, const std::string& b) {
+        return a.size() != b.size() ? a.size() < b.size() : a < b;
+    });
+    return files;
+}
+
+JournalReader::JournalReader(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        std::cerr << "Error opening journal " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    
+    off_t size = ::lseek(fd_, 0, SEEK_END);
+    if (size < static_cast<off_t>(kFileHeaderSize)) {
+        std::cerr << "Journal too short: " << path << std::endl;
+        return;
+    }
+    
+    void* base = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "Error mapping journal " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    if (std::memcmp(base, kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << "Not a frame journal: " << path << std::endl;
+        ::munmap(base, static_cast<size_t>(size));
+        return;
+    }
+    
+    base_ = static_cast<const char*>(base);
+    size_ = static_cast<size_t>(size);
+    offset_ = kFileHeaderSize;
+}
+
+JournalReader::~JournalReader() {
+    if (base_) {
+        ::munmap(const_cast<char*>(base_), size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool JournalReader::next(JournalRecord& record) {
+    if (!base_ || offset_ + kRecordHeaderSize > size_) {
+        return false;
+    }
+    
+    // A zero length is unwritten space
+    const char* in = base_ + offset_;
+    uint32_t length = __atomic_load_n(reinterpret_cast<const uint32_t*>(in), __ATOMIC_ACQUIRE);
+    if (length == 0 || offset_ + recordSize(length) > size_) {
+        return false;
+    }
+    
+    std::memcpy(&record.realtime_ns, in + 8, sizeof(record.realtime_ns));
+    std::memcpy(&record.tsc, in + 16, sizeof(record.tsc));
+    record.frame = std::string_view(in + kRecordHeaderSize, length);
+    offset_ += recordSize(length);
+    return true;
+}
+
+void JournalReader::rewind() {
+    offset_ = kFileHeaderSize;
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+const double kReportedPercentiles[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+
+}
+
+LatencyHistogram::LatencyHistogram(int64_t max_value_ns, int precision_bits)
+    : max_value_(std::max<int64_t>(max_value_ns, 2)),
+      precision_bits_(std::min(std::max(precision_bits, 2), 20)) {
+    sub_bucket_count_ = int64_t(1) << precision_bits_;
+    sub_bucket_half_count_ = sub_bucket_count_ / 2;
+    sub_bucket_mask_ = sub_bucket_count_ - 1;
+    
+    // Enough power-of-two buckets that the last one reaches max_value_
+    size_t buckets = 1;
+    for (int64_t reach = sub_bucket_count_; reach <= max_value_ && reach < (INT64_MAX >> 1); reach <<= 1) {
+        ++buckets;
+    }
+    counts_.assign((buckets + 1) * static_cast<size_t>(sub_bucket_half_count_), 0);
+}
+
+size_t LatencyHistogram::indexOf(int64_t value) const {
+    // Bucket: how far the value's top bit sits above the linear range;
+    // sub-bucket: the value's leading precision_bits bits
+    int pow2_ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | sub_bucket_mask_));
+    int bucket = pow2_ceiling - precision_bits_;
+    int64_t sub_bucket = value >> bucket;
+    return static_cast<size_t>((int64_t(bucket + 1) << (precision_bits_ - 1)) + (sub_bucket - sub_bucket_half_count_));
+}
+
+int64_t LatencyHistogram::lowestValueAt(size_t index) const {
+    int64_t bucket = static_cast<int64_t>(index >> (precision_bits_ - 1)) - 1;
+    int64_t sub_bucket = static_cast<int64_t>(index & static_cast<size_t>(sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+    if (bucket < 0) {
+        sub_bucket -= sub_bucket_half_count_;
+        bucket = 0;
+    }
+    return sub_bucket << bucket;
+}
+
+int64_t LatencyHistogram::highestValueAt(size_t index) const {
+    int64_t bucket = std::max<int64_t>(static_cast<int64_t>(index >> (precision_bits_ - 1)) - 1, 0);
+    return lowestValueAt(index) + (int64_t(1) << bucket) - 1;
+}
+
+void LatencyHistogram::record(int64_t value_ns, uint64_t count) {
+    if (count == 0) return;
+    int64_t value = std::min(std::max<int64_t>(value_ns, 0), max_value_);
+    counts_[indexOf(value)] += count;
+    total_ += count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += static_cast<double>(value) * static_cast<double>(count);
+}
+
+void LatencyHistogram::recordCorrected(int64_t value_ns, int64_t expected_interval_ns) {
+    record(value_ns);
+    if (expected_interval_ns <= 0) return;
+    
+    for (int64_t missing = value_ns - expected_interval_ns; missing >= expected_interval_ns;
+         missing -= expected_interval_ns) {
+        record(missing);
+    }
+}
+
+bool LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.max_value_ != max_value_ || other.precision_bits_ != precision_bits_) return false;
+    
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+    return true;
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+    min_ = INT64_MAX;
+    max_ = 0;
+    sum_ = 0.0;
+}
+
+double LatencyHistogram::mean() const {
+    return total_ ? sum_ / static_cast<double>(total_) : 0.0;
+}
+
+int64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+    if (total_ == 0) return 0;
+    
+    double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100.0;
+    // Rounded rather than ceil'd so 99.9% of 1000 is the 999th sample despite float error
+    uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(fraction * static_cast<double>(total_) + 0.5), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= target) {
+            return std::min(highestValueAt(i), max_);
+        }
+    }
+    return max_;
+}
+
+std::string LatencyHistogram::summary(const std::string& unit, int64_t divisor) const {
+    divisor = std::max<int64_t>(divisor, 1);
+    std::ostringstream out;
+    out << "p50/p90/p99/p99.9/p99.99/max: ";
+    if (divisor > 1) out << std::fixed << std::setprecision(1);
+    for (double percentile : kReportedPercentiles) {
+        int64_t value = valueAtPercentile(percentile);
+        if (divisor > 1) out << static_cast<double>(value) / static_cast<double>(divisor);
+        else out << value;
+        out << " / ";
+    }
+    if (divisor > 1) out << static_cast<double>(max_) / static_cast<double>(divisor);
+    else out << max_;
+    out << " " << unit;
+    return out.str();
+}
+
+std::string LatencyHistogram::toCsv() const {
+    std::ostringstream out;
+    out << "percentile,value_ns,count\n";
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        if (counts_[i] == 0) continue;
+        seen += counts_[i];
+        out << std::fixed << std::setprecision(6) << 100.0 * static_cast<double>(seen) / static_cast<double>(total_)
+            << "," << std::min(highestValueAt(i), max_) << "," << counts_[i] << "\n";
+    }
+    return out.str();
+}
\ No newline at end of file
@@ -0,0 +1,823 @@
+#include "websocket_server.h"
+#include "market_data.h"
+#include "latency_histogram.h"
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Include JSON library
+#define NLOHMANN_JSON_VERSION_MAJOR 3
+#define NLOHMANN_JSON_VERSION_MINOR 11
+#define NLOHMANN_JSON_VERSION_PATCH 2
+#include <nlohmann/json.hpp>
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+using json = nlohmann::json;
+
+// Throughput and saturation load generator for the WebSocketServer fan-out.
+//
+// The process forks: the parent runs a WebSocketServer and a paced
+// broadcaster, the child opens the client connections, subscribes them and
+// measures delivery. Keeping clients in their own process means the parent's
+// CPU and memory are the server's (plus the broadcaster thread). The broadcast
+// rate steps up until the server saturates: deliveries fall behind what the
+// subscriptions call for, the broadcaster cannot keep pace, clients are
+// dropped for falling behind, or delivery p99 passes the latency limit.
+//
+// Each book frame carries its send time (steady clock, shared by both
+// processes) in "timestamp"; a client records now - timestamp on receipt.
+// The two processes talk over a socketpair with one-line commands.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    unsigned short port = 18080;
+    size_t connections = 1000;
+    std::vector<std::string> instruments;
+    size_t instrument_count = 10;
+    size_t per_client = 2;
+    size_t server_threads = 1;
+    std::vector<int> server_cpus;
+    size_t max_queued = 4096;
+    size_t client_threads = 1;
+    size_t book_depth = 10;
+    double start_rate = 100;
+    double max_rate = 1000000;
+    double rate_factor = 2.0;
+    double step_seconds = 5.0;
+    double latency_limit_ms = 100.0;
+    std::string json_path;
+};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// Instruments client k subscribes to: per_client consecutive names from k * per_client,
+// wrapping, so every instrument gets the same share of clients
+std::vector<size_t> clientInstruments(size_t client, const Options& options) {
+    std::vector<size_t> picks;
+    size_t count = std::min(options.per_client, options.instruments.size());
+    for (size_t j = 0; j < count; ++j) {
+        picks.push_back((client * count + j) % options.instruments.size());
+    }
+    return picks;
+}
+
+// CPU time and resident memory of this process
+struct ProcessUsage {
+    double cpu_seconds = 0;
+    uint64_t rss_bytes = 0;
+};
+
+ProcessUsage readProcessUsage() {
+    ProcessUsage usage;
+
+    // Fields after the command name: state is field 3, utime and stime are 14 and 15
+    std::ifstream stat("/proc/self/stat");
+    std::string line;
+    if (std::getline(stat, line)) {
+        size_t end = line.rfind(')');
+        if (end != std::string::npos) {
+            std::istringstream fields(line.substr(end + 2));
+            std::string skip;
+            for (int i = 0; i < 11; ++i) fields >> skip;
+            uint64_t utime = 0, stime = 0;
+            fields >> utime >> stime;
+            usage.cpu_seconds = static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+        }
+    }
+
+    std::ifstream status("/proc/self/status");
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            usage.rss_bytes = std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+            break;
+        }
+    }
+    return usage;
+}
+
+// Control channel between the two processes, one command or reply per line
+bool writeLine(int fd, const std::string& line) {
+    std::string data = line + "\n";
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n <= 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readLine(int fd, std::string& line) {
+    line.clear();
+    char c;
+    while (true) {
+        ssize_t n = ::read(fd, &c, 1);
+        if (n <= 0) return false;
+        if (c == '\n') return true;
+        line.push_back(c);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Client side
+
+// One I/O thread and the counters of the sessions on it; only that thread
+// touches them, snapshots are posted to it
+struct ClientWorker {
+    net::io_context ioc{1};
+    std::thread thread;
+    LatencyHistogram latency;
+    uint64_t received = 0;
+    uint64_t closed = 0;
+};
+
+class ClientSession : public std::enable_shared_from_this<ClientSession> {
+public:
+    using ReadyHandler = std::function<void(bool)>;
+
+    ClientSession(ClientWorker& worker, std::string subscribe)
+        : worker_(worker), ws_(worker.ioc), subscribe_(std::move(subscribe)) {}
+
+    void start(const tcp::endpoint& endpoint, ReadyHandler on_ready) {
+        on_ready_ = std::move(on_ready);
+        beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(10));
+        beast::get_lowest_layer(ws_).async_connect(endpoint,
+            [self = shared_from_this()](beast::error_code ec) { self->onConnect(ec); });
+    }
+
+    // Messages and worst delivery latency since the last call, then reset
+    void takeStats(uint64_t& received, int64_t& worst_ns) {
+        received = received_;
+        worst_ns = worst_ns_;
+        received_ = 0;
+        worst_ns_ = 0;
+    }
+
+    bool isOpen() const { return ready_ && !failed_; }
+
+private:
+    void onConnect(beast::error_code ec) {
+        if (ec) return fail();
+        beast::get_lowest_layer(ws_).socket().set_option(tcp::no_delay(true));
+        ws_.async_handshake("127.0.0.1", "/",
+            [self = shared_from_this()](beast::error_code ec) { self->onHandshake(ec); });
+    }
+
+    void onHandshake(beast::error_code ec) {
+        if (ec) return fail();
+        beast::get_lowest_layer(ws_).expires_never();
+        ws_.async_write(net::buffer(subscribe_),
+            [self = shared_from_this()](beast::error_code ec, size_t) {
+                if (ec) return self->fail();
+                self->read();
+            });
+    }
+
+    void read() {
+        ws_.async_read(buffer_, [self = shared_from_this()](beast::error_code ec, size_t) { self->onRead(ec); });
+    }
+
+    void onRead(beast::error_code ec) {
+        if (ec) return fail();
+
+        std::string_view text(static_cast<const char*>(buffer_.cdata().data()), buffer_.size());
+        if (text.find("\"type\":\"orderbook\"") != std::string_view::npos) {
+            size_t at = text.rfind("\"timestamp\":");
+            if (at != std::string_view::npos) {
+                int64_t sent = std::strtoll(text.data() + at + 12, nullptr, 10);
+                int64_t latency = std::max<int64_t>(nowNs() - sent, 0);
+                worker_.latency.record(latency);
+                worst_ns_ = std::max(worst_ns_, latency);
+            }
+            ++received_;
+            ++worker_.received;
+        } else if (!ready_ && text.find("\"type\":\"subscription\"") != std::string_view::npos) {
+            ready_ = true;
+            notifyReady(true);
+        }
+
+        buffer_.consume(buffer_.size());
+        read();
+    }
+
+    void fail() {
+        if (failed_) return;
+        failed_ = true;
+        if (ready_) {
+            ++worker_.closed;
+        } else {
+            notifyReady(false);
+        }
+    }
+
+    void notifyReady(bool ok) {
+        if (!on_ready_) return;
+        auto handler = std::move(on_ready_);
+        on_ready_ = nullptr;
+        handler(ok);
+    }
+
+    ClientWorker& worker_;
+    websocket::stream<beast::tcp_stream> ws_;
+    beast::flat_buffer buffer_;
+    std::string subscribe_;
+    ReadyHandler on_ready_;
+    bool ready_ = false;
+    bool failed_ = false;
+    uint64_t received_ = 0;
+    int64_t worst_ns_ = 0;
+};
+
+// Counters of every worker since the last snapshot, then reset
+json takeSnapshot(std::vector<std::unique_ptr<ClientWorker>>& workers,
+                  std::vector<std::vector<std::shared_ptr<ClientSession>>>& sessions) {
+    LatencyHistogram latency;
+    LatencyHistogram worst_per_client;
+    uint64_t received = 0;
+    uint64_t closed = 0;
+    uint64_t open = 0;
+    uint64_t min_client = UINT64_MAX;
+    uint64_t max_client = 0;
+
+    for (size_t w = 0; w < workers.size(); ++w) {
+        ClientWorker& worker = *workers[w];
+        std::promise<void> done;
+        net::post(worker.ioc, [&]() {
+            latency.merge(worker.latency);
+            worker.latency.reset();
+            received += worker.received;
+            closed += worker.closed;
+            worker.received = 0;
+            worker.closed = 0;
+            for (const auto& session : sessions[w]) {
+                uint64_t count = 0;
+                int64_t worst = 0;
+                session->takeStats(count, worst);
+                if (!session->isOpen()) continue;
+                ++open;
+                min_client = std::min(min_client, count);
+                max_client = std::max(max_client, count);
+                if (count > 0) worst_per_client.record(worst);
+            }
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+
+    ProcessUsage usage = readProcessUsage();
+    return {
+        {"received", received},
+        {"closed", closed},
+        {"open", open},
+        {"min_client", open ? min_client : 0},
+        {"max_client", max_client},
+        {"latency", {{"count", latency.count()}, {"p50", latency.valueAtPercentile(50)},
+                     {"p90", latency.valueAtPercentile(90)}, {"p99", latency.valueAtPercentile(99)},
+                     {"p99_9", latency.valueAtPercentile(99.9)}, {"max", latency.max()}}},
+        {"worst_per_client", {{"p50", worst_per_client.valueAtPercentile(50)},
+                              {"p99", worst_per_client.valueAtPercentile(99)},
+                              {"max", worst_per_client.max()}}},
+        {"cpu_seconds", usage.cpu_seconds},
+        {"rss_bytes", usage.rss_bytes}
+    };
+}
+
+// The child process: connect, subscribe, report ready, then answer snapshots until told to quit
+int runClients(const Options& options, int control) {
+    std::string command;
+    if (!readLine(control, command) || command != "start") return 1;
+
+    std::vector<std::unique_ptr<ClientWorker>> workers;
+    for (size_t i = 0; i < std::max<size_t>(options.client_threads, 1); ++i) {
+        workers.push_back(std::make_unique<ClientWorker>());
+    }
+    std::vector<net::executor_work_guard<net::io_context::executor_type>> guards;
+    for (auto& worker : workers) {
+        guards.push_back(net::make_work_guard(worker->ioc));
+        worker->thread = std::thread([&ioc = worker->ioc]() { ioc.run(); });
+    }
+
+    // Connect in waves so the listen backlog is never overrun
+    constexpr size_t kWave = 256;
+    tcp::endpoint endpoint(net::ip::make_address("127.0.0.1"), options.port);
+    std::vector<std::vector<std::shared_ptr<ClientSession>>> sessions(workers.size());
+    std::atomic<size_t> done{0};
+    std::atomic<size_t> connected{0};
+
+    for (size_t first = 0; first < options.connections; first += kWave) {
+        size_t last = std::min(first + kWave, options.connections);
+        for (size_t k = first; k < last; ++k) {
+            json subscribe;
+            subscribe["type"] = "subscribe";
+            subscribe["instruments"] = json::array();
+            for (size_t index : clientInstruments(k, options)) {
+                subscribe["instruments"].push_back(options.instruments[index]);
+            }
+
+            size_t w = k % workers.size();
+            auto session = std::make_shared<ClientSession>(*workers[w], subscribe.dump());
+            net::post(workers[w]->ioc, [&, w, session, endpoint]() {
+                sessions[w].push_back(session);
+                session->start(endpoint, [&done, &connected](bool ok) {
+                    if (ok) ++connected;
+                    ++done;
+                });
+            });
+        }
+
+        auto deadline = Clock::now() + std::chrono::seconds(15);
+        while (done < last && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    writeLine(control, "ready " + std::to_string(connected.load()));
+
+    while (readLine(control, command) && command == "snapshot") {
+        writeLine(control, takeSnapshot(workers, sessions).dump());
+    }
+
+    // Leave without a closing handshake; the server sees the sockets drop
+    for (auto& worker : workers) worker->ioc.stop();
+    for (auto& worker : workers) worker->thread.join();
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Server side
+
+// Book frames per instrument, split around the timestamp so each send only
+// writes the clock into the middle
+struct FrameTemplate {
+    std::string instrument;
+    std::string prefix;
+    std::string suffix;
+    size_t subscribers = 0;
+};
+
+std::vector<FrameTemplate> makeTemplates(const Options& options) {
+    std::vector<FrameTemplate> templates;
+    for (const auto& name : options.instruments) {
+        Orderbook book;
+        book.instrument = name;
+        book.timestamp = 0;
+        for (size_t i = 0; i < options.book_depth; ++i) {
+            book.bids.push_back({50000.0 - 0.5 * (i + 1), 1.0 + i * 0.25});
+            book.asks.push_back({50000.0 + 0.5 * (i + 1), 1.0 + i * 0.25});
+        }
+
+        std::string text = orderbookToJson(book);
+        size_t at = text.find("\"timestamp\":0");
+        if (at == std::string::npos) {
+            std::cerr << "Unexpected orderbook format: " << text << std::endl;
+            return {};
+        }
+        templates.push_back({name, text.substr(0, at + 12), text.substr(at + 13), 0});
+    }
+
+    for (size_t k = 0; k < options.connections; ++k) {
+        for (size_t index : clientInstruments(k, options)) {
+            ++templates[index].subscribers;
+        }
+    }
+    return templates;
+}
+
+// Sends book frames at the target rate, round-robin over the instruments.
+// The schedule restarts on a rate change; a backlog of more than 100 ms is
+// dropped rather than burst, and shows up as a shortfall in the sent rate.
+class Broadcaster {
+public:
+    Broadcaster(WebSocketServer& server, std::vector<FrameTemplate> templates)
+        : server_(server), templates_(std::move(templates)) {}
+
+    ~Broadcaster() { stop(); }
+
+    void start() {
+        running_ = true;
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    void stop() {
+        running_ = false;
+        if (thread_.joinable()) thread_.join();
+    }
+
+    void setRate(double rate) { rate_ = rate; }
+    uint64_t sent() const { return sent_; }
+    uint64_t expectedDeliveries() const { return expected_; }
+
+private:
+    void run() {
+        double rate = 0;
+        Clock::time_point base = Clock::now();
+        uint64_t sent_since_base = 0;
+        size_t next = 0;
+        std::string frame;
+
+        while (running_) {
+            double target = rate_;
+            auto now = Clock::now();
+            if (target != rate) {
+                rate = target;
+                base = now;
+                sent_since_base = 0;
+            }
+
+            double elapsed = std::chrono::duration<double>(now - base).count();
+            double due = rate * elapsed - static_cast<double>(sent_since_base);
+            if (due > rate * 0.1 + 1) {
+                sent_since_base += static_cast<uint64_t>(due) - 1;
+                due = 1;
+            }
+            if (due < 1) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+
+            for (uint64_t i = 0; i < static_cast<uint64_t>(due); ++i) {
+                const FrameTemplate& item = templates_[next];
+                next = (next + 1) % templates_.size();
+                frame.assign(item.prefix);
+                frame += std::to_string(nowNs());
+                frame += item.suffix;
+                server_.broadcastOrderbook(item.instrument, frame);
+                expected_.fetch_add(item.subscribers, std::memory_order_relaxed);
+                sent_.fetch_add(1, std::memory_order_relaxed);
+                ++sent_since_base;
+            }
+        }
+    }
+
+    WebSocketServer& server_;
+    std::vector<FrameTemplate> templates_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<double> rate_{0};
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> expected_{0};
+};
+
+struct StepResult {
+    double rate = 0;
+    json values;
+    std::string saturated;  // why the step saturated, empty if it kept up
+};
+
+bool snapshot(int control, json& result) {
+    std::string line;
+    if (!writeLine(control, "snapshot") || !readLine(control, line)) return false;
+    result = json::parse(line, nullptr, false);
+    return !result.is_discarded();
+}
+
+void printHeader() {
+    std::cout << std::right
+              << std::setw(10) << "rate/s" << std::setw(10) << "sent/s"
+              << std::setw(12) << "expected/s" << std::setw(12) << "delivered/s"
+              << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(11) << "p99.9 us"
+              << std::setw(10) << "max us" << std::setw(14) << "client p99 us"
+              << std::setw(9) << "srv cpu" << std::setw(9) << "srv MB" << std::setw(9) << "cli cpu"
+              << std::setw(8) << "closed" << "\n";
+}
+
+void printStep(const StepResult& step) {
+    const json& v = step.values;
+    std::cout << std::right << std::fixed << std::setprecision(0)
+              << std::setw(10) << step.rate
+              << std::setw(10) << v["sent_per_sec"].get<double>()
+              << std::setw(12) << v["expected_per_sec"].get<double>()
+              << std::setw(12) << v["delivered_per_sec"].get<double>()
+              << std::setprecision(1)
+              << std::setw(10) << v["latency_us"]["p50"].get<double>()
+              << std::setw(10) << v["latency_us"]["p99"].get<double>()
+              << std::setw(11) << v["latency_us"]["p99_9"].get<double>()
+              << std::setw(10) << v["latency_us"]["max"].get<double>()
+              << std::setw(14) << v["worst_per_client_us"]["p99"].get<double>()
+              << std::setw(8) << v["server_cpu_percent"].get<double>() << "%"
+              << std::setw(9) << v["server_rss_mb"].get<double>()
+              << std::setw(8) << v["client_cpu_percent"].get<double>() << "%"
+              << std::setw(8) << v["closed"].get<uint64_t>();
+    if (!step.saturated.empty()) std::cout << "  saturated: " << step.saturated;
+    std::cout << "\n";
+}
+
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --connections <n>       client connections (default 1000)\n"
+              << "  --instruments <n>       generated instruments SIM-0..n-1 (default 10)\n"
+              << "  --instrument-list <a,b> explicit instrument names instead\n"
+              << "  --per-client <n>        instruments each client subscribes to (default 2)\n"
+              << "  --server-threads <n>    WebSocketServer I/O threads (default 1)\n"
+              << "  --server-cpus <list>    CPUs for the server I/O threads, e.g. 0,2-3\n"
+              << "  --max-queued <n>        frames a client may have queued (default 4096)\n"
+              << "  --client-threads <n>    client I/O threads (default 1)\n"
+              << "  --depth <n>             book levels a side (default 10)\n"
+              << "  --start-rate <n>        first step, broadcasts/s (default 100)\n"
+              << "  --max-rate <n>          stop after this rate (default 1000000)\n"
+              << "  --rate-factor <x>       rate multiplier per step (default 2)\n"
+              << "  --step-seconds <s>      measured time per step (default 5)\n"
+              << "  --latency-limit-ms <n>  saturated once delivery p99 exceeds this (default 100)\n"
+              << "  --port <n>              server port (default 18080)\n"
+              << "  --json <file>           write per-step results as JSON\n";
+}
+
+bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    for (const auto& item : splitList(text)) {
+        size_t dash = item.find('-');
+        int first = std::stoi(item.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+        if (first < 0 || last < first) return false;
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--connections") options.connections = std::stoul(value);
+            else if (arg == "--instruments") options.instrument_count = std::stoul(value);
+            else if (arg == "--instrument-list") options.instruments = splitList(value);
+            else if (arg == "--per-client") options.per_client = std::stoul(value);
+            else if (arg == "--server-threads") options.server_threads = std::stoul(value);
+            else if (arg == "--server-cpus") {
+                if (!parseCpuList(value, options.server_cpus)) throw std::invalid_argument(value);
+            }
+            else if (arg == "--max-queued") options.max_queued = std::stoul(value);
+            else if (arg == "--client-threads") options.client_threads = std::stoul(value);
+            else if (arg == "--depth") options.book_depth = std::stoul(value);
+            else if (arg == "--start-rate") options.start_rate = std::stod(value);
+            else if (arg == "--max-rate") options.max_rate = std::stod(value);
+            else if (arg == "--rate-factor") options.rate_factor = std::stod(value);
+            else if (arg == "--step-seconds") options.step_seconds = std::stod(value);
+            else if (arg == "--latency-limit-ms") options.latency_limit_ms = std::stod(value);
+            else if (arg == "--port") options.port = static_cast<unsigned short>(std::stoul(value));
+            else if (arg == "--json") options.json_path = value;
+            else {
+                std::cerr << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    if (options.instruments.empty()) {
+        for (size_t i = 0; i < options.instrument_count; ++i) {
+            options.instruments.push_back("SIM-" + std::to_string(i));
+        }
+    }
+    if (options.instruments.empty() || options.connections == 0 || options.per_client == 0 ||
+        options.start_rate <= 0 || options.rate_factor <= 1.0 || options.step_seconds <= 0) {
+        std::cerr << "Need instruments, connections, a positive start rate and a rate factor above 1" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Both processes hold one descriptor per connection
+void raiseDescriptorLimit(size_t needed) {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < needed) {
+        std::cerr << "Open file limit " << limit.rlim_cur << " is below the " << needed
+                  << " descriptors needed; raise it with ulimit -n" << std::endl;
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    raiseDescriptorLimit(options.connections + 64);
+
+    // Fork before any thread exists
+    int channel[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) != 0) {
+        std::cerr << "Cannot create control channel: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        std::cerr << "Cannot fork the client process: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    if (child == 0) {
+        close(channel[0]);
+        int rc = runClients(options, channel[1]);
+        std::cout.flush();
+        _exit(rc);
+    }
+    close(channel[1]);
+    int control = channel[0];
+
+    auto finish = [&](int rc) {
+        writeLine(control, "quit");
+        close(control);
+        waitpid(child, nullptr, 0);
+        return rc;
+    };
+
+    std::vector<FrameTemplate> templates = makeTemplates(options);
+    if (templates.empty()) return finish(1);
+
+    WebSocketServer server(options.port, options.server_threads, options.connections + 64);
+    server.setMaxQueuedMessages(options.max_queued);
+    server.setCpuAffinity(options.server_cpus);
+    server.start();
+    if (!server.isRunning()) {
+        std::cerr << "WebSocketServer did not start on port " << options.port << std::endl;
+        return finish(1);
+    }
+
+    std::cout << "Load generator: " << options.connections << " clients, " << options.instruments.size()
+              << " instruments, " << std::min(options.per_client, options.instruments.size())
+              << " per client, " << options.server_threads << " server thread(s), port " << options.port << "\n";
+
+    std::string reply;
+    writeLine(control, "start");
+    if (!readLine(control, reply) || reply.compare(0, 6, "ready ") != 0) {
+        std::cerr << "Client process failed" << std::endl;
+        server.stop();
+        return finish(1);
+    }
+    size_t connected = std::stoul(reply.substr(6));
+    std::cout << "Connected and subscribed: " << connected << " / " << options.connections << "\n";
+    if (connected == 0) {
+        server.stop();
+        return finish(1);
+    }
+
+    Broadcaster broadcaster(server, templates);
+    broadcaster.start();
+
+    printHeader();
+    std::vector<StepResult> steps;
+    json before;
+    for (double rate = options.start_rate; rate <= options.max_rate; rate *= options.rate_factor) {
+        broadcaster.setRate(rate);
+
+        // Let queues settle at the new rate before measuring
+        std::this_thread::sleep_for(std::chrono::duration<double>(std::min(1.0, options.step_seconds / 5)));
+        if (!snapshot(control, before)) break;
+        ProcessUsage server_before = readProcessUsage();
+        uint64_t sent_before = broadcaster.sent();
+        uint64_t expected_before = broadcaster.expectedDeliveries();
+        auto start = Clock::now();
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.step_seconds));
+
+        json after;
+        if (!snapshot(control, after)) break;
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        ProcessUsage server_after = readProcessUsage();
+        double sent = (broadcaster.sent() - sent_before) / seconds;
+        double expected = (broadcaster.expectedDeliveries() - expected_before) / seconds;
+        double delivered = after["received"].get<uint64_t>() / seconds;
+
+        StepResult step;
+        step.rate = rate;
+        const json& latency = after["latency"];
+        const json& worst = after["worst_per_client"];
+        step.values = {
+            {"rate", rate},
+            {"sent_per_sec", sent},
+            {"expected_per_sec", expected},
+            {"delivered_per_sec", delivered},
+            {"latency_us", {{"count", latency["count"]},
+                            {"p50", latency["p50"].get<double>() / 1000}, {"p90", latency["p90"].get<double>() / 1000},
+                            {"p99", latency["p99"].get<double>() / 1000}, {"p99_9", latency["p99_9"].get<double>() / 1000},
+                            {"max", latency["max"].get<double>() / 1000}}},
+            {"worst_per_client_us", {{"p50", worst["p50"].get<double>() / 1000},
+                                     {"p99", worst["p99"].get<double>() / 1000},
+                                     {"max", worst["max"].get<double>() / 1000}}},
+            {"messages_per_client", {{"min", after["min_client"]}, {"max", after["max_client"]}}},
+            {"open_clients", after["open"]},
+            {"closed", after["closed"]},
+            {"server_cpu_percent", 100.0 * (server_after.cpu_seconds - server_before.cpu_seconds) / seconds},
+            {"server_rss_mb", server_after.rss_bytes / 1048576.0},
+            {"client_cpu_percent", 100.0 * (after["cpu_seconds"].get<double>() - before["cpu_seconds"].get<double>()) / seconds},
+            {"client_rss_mb", after["rss_bytes"].get<double>() / 1048576.0}
+        };
+
+        if (after["closed"].get<uint64_t>() > 0) {
+            step.saturated = "clients dropped for falling behind";
+        } else if (sent < 0.95 * rate) {
+            step.saturated = "broadcaster could not keep pace";
+        } else if (delivered < 0.95 * expected) {
+            step.saturated = "deliveries fell behind";
+        } else if (latency["p99"].get<double>() > options.latency_limit_ms * 1e6) {
+            step.saturated = "p99 over the latency limit";
+        }
+        step.values["saturated"] = step.saturated;
+
+        printStep(step);
+        steps.push_back(step);
+        if (!step.saturated.empty()) break;
+    }
+
+    broadcaster.stop();
+    server.stop();
+
+    // The highest step that kept up is the capacity at these settings
+    const StepResult* capacity = nullptr;
+    for (const auto& step : steps) {
+        if (step.saturated.empty()) capacity = &step;
+    }
+    if (capacity) {
+        std::cout << "Sustained: " << std::fixed << std::setprecision(0) << capacity->rate << " broadcasts/s, "
+                  << capacity->values["delivered_per_sec"].get<double>() << " msgs/s delivered to "
+                  << connected << " clients\n";
+    } else {
+        std::cout << "Saturated at the first step; lower --start-rate\n";
+    }
+
+    if (!options.json_path.empty()) {
+        json report;
+        report["settings"] = {
+            {"connections", options.connections},
+            {"connected", connected},
+            {"instruments", options.instruments},
+            {"per_client", options.per_client},
+            {"server_threads", options.server_threads},
+            {"max_queued", options.max_queued},
+            {"client_threads", options.client_threads},
+            {"book_depth", options.book_depth},
+            {"step_seconds", options.step_seconds},
+            {"latency_limit_ms", options.latency_limit_ms}
+        };
+        report["steps"] = json::array();
+        for (const auto& step : steps) report["steps"].push_back(step.values);
+        report["sustained_rate"] = capacity ? capacity->rate : 0.0;
+
+        std::ofstream file(options.json_path);
+        if (!file) {
+            std::cerr << "Cannot write " << options.json_path << std::endl;
+        } else {
+            file << report.dump(2) << std::endl;
+            std::cout << "Results written to " << options.json_path << "\n";
+        }
+    }
+
+    return finish(0);
+}
\ No newline at end of file
@@ -2,22 +2,19 @@
 #include "order_manager.h"
 #include "market_data.h"
 #include "websocket_server.h"
+#include "message_router.h"
+#include "risk_engine.h"
+#include "tick_store.h"
+#include "config.h"
 
 #include <iostream>
 #include <memory>
 #include <thread>
 #include <chrono>
 #include <csignal>
+#include <cstdlib>
 #include <atomic>
 
-// Include JSON library
-#define NLOHMANN_JSON_VERSION_MAJOR 3
-#define NLOHMANN_JSON_VERSION_MINOR 11
-#define NLOHMANN_JSON_VERSION_PATCH 2
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::json;
-
 // Signal handler flag
 std::atomic<bool> running(true);
 
@@ -27,34 +24,6 @@ void signalHandler(int signal) {
     running = false;
 }
 
-// Function to serialize an orderbook to JSON
-std::string orderbookToJson(const Orderbook& orderbook) {
-    json j;
-    j["type"] = "orderbook";
-    j["instrument"] = orderbook.instrument;
-    j["timestamp"] = orderbook.timestamp;
-    
-    // Add bids
-    j["bids"] = json::array();
-    for (const auto& bid : orderbook.bids) {
-        json level;
-        level.push_back(bid.price);
-        level.push_back(bid.size);
-        j["bids"].push_back(level);
-    }
-    
-    // Add asks
-    j["asks"] = json::array();
-    for (const auto& ask : orderbook.asks) {
-        json level;
-        level.push_back(ask.price);
-        level.push_back(ask.size);
-        j["asks"].push_back(level);
-    }
-    
-    return j.dump();
-}
-
 int main(int argc, char* argv[]) {
     // Print welcome message
     std::cout << "Deribit Trader - High-Performance Trading System" << std::endl;
@@ -64,30 +33,90 @@ int main(int argc, char* argv[]) {
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
     
-    // Create API client with Deribit Test credentials
-    ApiClient::Auth auth;
-    auth.client_id = "m_B5zE25";
-    auth.client_secret = "qwHcammuk8D-MEK4idg8urGt_ZAkfk4r_MuIzT9v1LE";
-    auto api_client = std::make_shared<ApiClient>(auth);
+    // Settings: the file named on the command line or in DERIBIT_CONFIG, then the environment
+    std::string config_path = argc > 1 ? argv[1] : "";
+    if (config_path.empty()) {
+        if (const char* path = std::getenv("DERIBIT_CONFIG")) config_path = path;
+    }
+    Config config;
+    std::string config_error;
+    if (!Config::load(config_path, config, config_error)) {
+        std::cerr << "Configuration error: " << config_error << std::endl;
+        return 1;
+    }
+    if (config.auth.client_id.empty() || config.auth.client_secret.empty()) {
+        std::cerr << "No credentials configured (DERIBIT_CLIENT_ID / DERIBIT_CLIENT_SECRET); "
+                  << "private requests will be refused" << std::endl;
+    }
+    
+    // Create API client
+    auto api_client = std::make_shared<ApiClient>(config.auth);
+    api_client->setEndpoint(config.endpoint);
+    api_client->setBookChannel(config.book_depth, config.book_interval);
+    api_client->setCpuAffinity(config.client_cpu);
+    std::cout << "Exchange endpoint: " << (config.endpoint.tls ? "wss://" : "ws://") << config.endpoint.host
+              << ":" << config.endpoint.port << config.endpoint.path << std::endl;
+    
+    // Hold requests locally until Deribit's credit pools allow them (by default)
+    api_client->setRateLimitMode(config.rate_limit);
     
     // Create order manager
-    auto order_manager = std::make_shared<OrderManager>(api_client);
+    auto order_manager = std::make_shared<OrderManager>(api_client, config.order_history, config.request_threads);
     
     // Create market data client
     auto market_data = std::make_shared<MarketDataClient>(api_client);
     
+    // Route inbound exchange frames by channel: book.* to market data, user.* to orders
+    auto router = std::make_shared<MessageRouter>();
+    market_data->setRouter(router);
+    
+    // Record raw market data frames for replay when a journal directory is given
+    if (!config.journal_dir.empty()) {
+        market_data->setJournal(std::make_shared<FrameJournal>(config.journal_dir, "marketdata", config.journal_file_size));
+        std::cout << "Recording market data to " << config.journal_dir << std::endl;
+    }
+    order_manager->registerRoutes(*router);
+    
     // Create WebSocket server
-    auto ws_server = std::make_shared<WebSocketServer>(8080);
+    auto ws_server = std::make_shared<WebSocketServer>(config.server_port, config.server_threads, config.max_connections);
+    ws_server->setMaxQueuedMessages(config.max_queued_messages);
+    ws_server->setCpuAffinity(config.server_cpus);
+    
+    // Pre-trade risk limits, checked before any order leaves the process
+    auto positions = order_manager->positionEngine();
+    auto risk = std::make_shared<RiskEngine>(positions);
+    risk->setDefaultLimits(config.risk_limits);
+    risk->setThrottle(config.risk_max_messages, config.risk_window_ms * 1000000);
+    order_manager->setRiskEngine(risk);
+    
+    // Persist books and public trades into the columnar tick store when a directory is given
+    std::shared_ptr<TickStoreWriter> ticks;
+    if (!config.tick_dir.empty()) {
+        ticks = std::make_shared<TickStoreWriter>(config.tick_dir);
+        ticks->registerRoutes(*router);
+        std::cout << "Storing ticks in " << config.tick_dir << std::endl;
+    }
     
     // Set up market data callback
-    market_data->setOrderbookCallback([&ws_server](const Orderbook& orderbook) {
+    market_data->setOrderbookCallback([&ws_server, positions, risk, ticks](const Orderbook& orderbook) {
+        // Mark positions and the risk price band to the mid
+        if (!orderbook.bids.empty() && !orderbook.asks.empty()) {
+            double mid = (orderbook.bids[0].price + orderbook.asks[0].price) / 2.0;
+            positions->updateMark(orderbook.instrument, mid);
+            risk->updateMid(orderbook.instrument, mid);
+        }
+        
+        if (ticks) {
+            ticks->onOrderbook(orderbook);
+        }
+        
         // Convert orderbook to JSON and broadcast to subscribers
         std::string json = orderbookToJson(orderbook);
         ws_server->broadcastOrderbook(orderbook.instrument, json);
     });
     
     // Start the WebSocket server
-    std::cout << "Starting WebSocket server on port 8080..." << std::endl;
+    std::cout << "Starting WebSocket server on port " << config.server_port << "..." << std::endl;
     ws_server->start();
     std::cout << "WebSocket server running." << std::endl;
     
@@ -96,10 +125,19 @@ int main(int argc, char* argv[]) {
     market_data->start();
     std::cout << "Market data client running." << std::endl;
     
+    // Keep order state current from the private channels instead of polling
+    order_manager->subscribePrivateChannels();
+    
     // Subscribe to some initial instruments
     std::cout << "Subscribing to initial instruments..." << std::endl;
-    market_data->subscribe("BTC-PERPETUAL");
-    market_data->subscribe("ETH-PERPETUAL");
+    std::vector<std::string> trade_channels;
+    for (const auto& instrument : config.instruments) {
+        market_data->subscribe(instrument);
+        trade_channels.push_back("trades." + instrument + ".100ms");
+    }
+    if (ticks) {
+        api_client->subscribeToChannels(trade_channels);
+    }
     std::cout << "Subscribed to initial instruments." << std::endl;
     
     // Main event loop
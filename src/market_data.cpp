@@ -26,9 +26,19 @@ void MarketDataClient::start() {
     running_ = true;
     
     // Connect to the WebSocket
-    api_client_->connectWebSocket([this](const std::string& message) {
-        this->processMessage(message);
-    });
+    std::shared_ptr<FrameJournal> journal = journal_;
+    if (router_) {
+        std::shared_ptr<MessageRouter> router = router_;
+        api_client_->connectWebSocket([router, journal](const std::string& message) {
+            if (journal && !FrameJournal::carriesToken(message)) journal->append(message);
+            router->route(message);
+        });
+    } else {
+        api_client_->connectWebSocket([this, journal](const std::string& message) {
+            if (journal && !FrameJournal::carriesToken(message)) journal->append(message);
+            this->processMessage(message);
+        });
+    }
     
     // Subscribe to all currently subscribed instruments
     std::vector<std::string> instruments;
@@ -125,6 +135,23 @@ void MarketDataClient::setOrderbookCallback(OrderbookUpdateCallback callback) {
     orderbook_callback_ = callback;
 }
 
+void MarketDataClient::setJournal(std::shared_ptr<FrameJournal> journal) {
+    journal_ = journal;
+}
+
+void MarketDataClient::setRouter(std::shared_ptr<MessageRouter> router) {
+    router_ = router;
+    if (router_) {
+        registerRoutes(*router_);
+    }
+}
+
+void MarketDataClient::registerRoutes(MessageRouter& router) {
+    router.addRoute("book.", [this](const std::string& channel, const json& data) {
+        onBookUpdate(channel, data);
+    });
+}
+
 void MarketDataClient::processMessage(const std::string& message) {
     try {
         // Parse the JSON message
@@ -138,54 +165,7 @@ void MarketDataClient::processMessage(const std::string& message) {
             
             // Check if this is an orderbook update
             if (channel.find("book.") == 0) {
-                std::string instrument = channel.substr(5);
-                size_t first_dot = instrument.find(".");
-                if (first_dot != std::string::npos) {
-                    instrument = instrument.substr(0, first_dot);
-                }
-                
-                // Extract orderbook data
-                json orderbook_data = data["params"]["data"];
-                
-                // Create an orderbook object
-                Orderbook orderbook;
-                orderbook.instrument = instrument;
-                orderbook.timestamp = std::chrono::system_clock::now().time_since_epoch().count();
-                
-                // Process bids
-                if (orderbook_data.contains("bids")) {
-                    for (const auto& bid : orderbook_data["bids"]) {
-                        if (bid.is_array() && bid.size() >= 2) {
-                            Orderbook::Level level;
-                            level.price = bid[0];
-                            level.size = bid[1];
-                            orderbook.bids.push_back(level);
-                        }
-                    }
-                }
-                
-                // Process asks
-                if (orderbook_data.contains("asks")) {
-                    for (const auto& ask : orderbook_data["asks"]) {
-                        if (ask.is_array() && ask.size() >= 2) {
-                            Orderbook::Level level;
-                            level.price = ask[0];
-                            level.size = ask[1];
-                            orderbook.asks.push_back(level);
-                        }
-                    }
-                }
-                
-                // Store the orderbook
-                {
-                    std::lock_guard<std::mutex> lock(orderbooks_mutex_);
-                    orderbooks_[instrument] = orderbook;
-                }
-                
-                // Notify callback
-                if (orderbook_callback_) {
-                    orderbook_callback_(orderbook);
-                }
+                onBookUpdate(channel, data["params"]["data"]);
             }
         }
     } catch (const std::exception& e) {
@@ -193,6 +173,60 @@ void MarketDataClient::processMessage(const std::string& message) {
     }
 }
 
+void MarketDataClient::onBookUpdate(const std::string& channel, const json& orderbook_data) {
+    std::string instrument = channel.substr(5);
+    size_t first_dot = instrument.find(".");
+    if (first_dot != std::string::npos) {
+        instrument = instrument.substr(0, first_dot);
+    }
+    
+    // Create an orderbook object
+    Orderbook orderbook;
+    orderbook.instrument = instrument;
+    
+    // Prefer the exchange timestamp (ms) so replayed books carry their recorded time
+    if (orderbook_data.contains("timestamp") && orderbook_data["timestamp"].is_number()) {
+        orderbook.timestamp = orderbook_data["timestamp"].get<int64_t>() * 1000000;
+    } else {
+        orderbook.timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+    }
+    
+    // Process bids
+    if (orderbook_data.contains("bids")) {
+        for (const auto& bid : orderbook_data["bids"]) {
+            if (bid.is_array() && bid.size() >= 2) {
+                Orderbook::Level level;
+                level.price = bid[0];
+                level.size = bid[1];
+                orderbook.bids.push_back(level);
+            }
+        }
+    }
+    
+    // Process asks
+    if (orderbook_data.contains("asks")) {
+        for (const auto& ask : orderbook_data["asks"]) {
+            if (ask.is_array() && ask.size() >= 2) {
+                Orderbook::Level level;
+                level.price = ask[0];
+                level.size = ask[1];
+                orderbook.asks.push_back(level);
+            }
+        }
+    }
+    
+    // Store the orderbook
+    {
+        std::lock_guard<std::mutex> lock(orderbooks_mutex_);
+        orderbooks_[instrument] = orderbook;
+    }
+    
+    // Notify callback
+    if (orderbook_callback_) {
+        orderbook_callback_(orderbook);
+    }
+}
+
 void MarketDataClient::fetchInitialOrderbook(const std::string& instrument) {
     try {
         // Fetch the initial orderbook from the REST API
@@ -247,4 +281,32 @@ void MarketDataClient::fetchInitialOrderbook(const std::string& instrument) {
     } catch (const std::exception& e) {
         std::cerr << "Error fetching initial orderbook: " << e.what() << std::endl;
     }
+}
+
+// Function to serialize an orderbook to JSON
+std::string orderbookToJson(const Orderbook& orderbook) {
+    json j;
+    j["type"] = "orderbook";
+    j["instrument"] = orderbook.instrument;
+    j["timestamp"] = orderbook.timestamp;
+    
+    // Add bids
+    j["bids"] = json::array();
+    for (const auto& bid : orderbook.bids) {
+        json level;
+        level.push_back(bid.price);
+        level.push_back(bid.size);
+        j["bids"].push_back(level);
+    }
+    
+    // Add asks
+    j["asks"] = json::array();
+    for (const auto& ask : orderbook.asks) {
+        json level;
+        level.push_back(ask.price);
+        level.push_back(ask.size);
+        j["asks"].push_back(level);
+    }
+    
+    return j.dump();
 }
\ No newline at end of file
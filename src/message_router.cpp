@@ -0,0 +1,67 @@
+#include "message_router.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Include JSON library
+#define NLOHMANN_JSON_VERSION_MAJOR 3
+#define NLOHMANN_JSON_VERSION_MINOR 11
+#define NLOHMANN_JSON_VERSION_PATCH 2
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+void MessageRouter::addRoute(const std::string& prefix, ChannelHandler handler) {
+    routes_.push_back(Route{prefix, std::move(handler)});
+    std::stable_sort(routes_.begin(), routes_.end(), [](const Route& a, const Route& b) {
+        return a.prefix.size() > b.prefix.size();
+    });
+}
+
+void MessageRouter::setResponseHandler(ResponseHandler handler) {
+    response_handler_ = std::move(handler);
+}
+
+void MessageRouter::route(const std::string& message) {
+    json data = json::parse(message, nullptr, false);
+    if (data.is_discarded() || !data.is_object()) {
+        std::cerr << "Error routing message: invalid JSON" << std::endl;
+        ++unrouted_;
+        return;
+    }
+    
+    auto method = data.find("method");
+    if (method != data.end() && *method == "subscription") {
+        auto params = data.find("params");
+        if (params == data.end() || !params->is_object() || !params->contains("channel") ||
+            !(*params)["channel"].is_string()) {
+            ++unrouted_;
+            return;
+        }
+        
+        const std::string& channel = (*params)["channel"].get_ref<const std::string&>();
+        for (const Route& route : routes_) {
+            if (channel.compare(0, route.prefix.size(), route.prefix) == 0) {
+                static const json kNull;
+                auto payload = params->find("data");
+                try {
+                    route.handler(channel, payload != params->end() ? *payload : kNull);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error handling " << channel << ": " << e.what() << std::endl;
+                }
+                ++routed_;
+                return;
+            }
+        }
+        ++unrouted_;
+        return;
+    }
+    
+    // JSON-RPC responses (auth, subscribe acks, errors)
+    if (response_handler_ && (data.contains("result") || data.contains("error"))) {
+        response_handler_(data);
+        ++routed_;
+        return;
+    }
+    ++unrouted_;
+}
\ No newline at end of file
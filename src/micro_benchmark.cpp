@@ -0,0 +1,366 @@
+#include "api_client.h"
+#include "order_manager.h"
+#include "market_data.h"
+#include "websocket_server.h"
+#include "cpu_affinity.h"
+#include "latency_histogram.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstring>
+
+// Include JSON library
+#define NLOHMANN_JSON_VERSION_MAJOR 3
+#define NLOHMANN_JSON_VERSION_MINOR 11
+#define NLOHMANN_JSON_VERSION_PATCH 2
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Micro-benchmarks of the hot paths, one function at a time.
+//
+// Each case runs on one pinned thread: a warmup sizes the batch so a batch
+// takes about 10 us (one clock read pair per batch, not per call), then
+// batches are timed until the minimum time has passed. Per-call cost is the
+// batch time over the batch size, recorded into an HDR histogram so the tail
+// across batches is kept. Results are printed as a table and, with --json,
+// written as JSON for regression tracking.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keep a value alive so the compiler cannot drop the work that produced it
+template<typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct Options {
+    std::string filter;
+    std::string json_path;
+    int cpu = 0;
+    int64_t warmup_ms = 100;
+    int64_t min_time_ms = 500;
+    size_t connections = 1000;
+    size_t orders = 1000;
+    size_t book_depth = 10;
+};
+
+struct Case {
+    std::string name;
+    json params;
+    std::function<void(size_t batch)> prepare;  // untimed, before each batch; optional
+    std::function<void()> op;                   // one call of the code under test
+};
+
+struct Result {
+    std::string name;
+    json params;
+    uint64_t iterations = 0;
+    size_t batch = 0;
+    LatencyHistogram latency;
+};
+
+int64_t elapsedNs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+int64_t timeBatch(const Case& bench, size_t batch) {
+    if (bench.prepare) bench.prepare(batch);
+    auto start = Clock::now();
+    for (size_t i = 0; i < batch; ++i) {
+        bench.op();
+    }
+    return elapsedNs(start);
+}
+
+Result measure(const Case& bench, const Options& options) {
+    constexpr int64_t kTargetBatchNs = 10000;
+    constexpr size_t kMaxBatch = 1 << 20;
+
+    // Warmup, growing the batch until it reaches the target length
+    size_t batch = 1;
+    auto warmup_start = Clock::now();
+    do {
+        int64_t ns = timeBatch(bench, batch);
+        if (ns < kTargetBatchNs && batch < kMaxBatch) batch *= 2;
+    } while (elapsedNs(warmup_start) < options.warmup_ms * 1000000);
+
+    Result result;
+    result.name = bench.name;
+    result.params = bench.params;
+    result.batch = batch;
+
+    auto start = Clock::now();
+    while (elapsedNs(start) < options.min_time_ms * 1000000 || result.latency.count() < 100) {
+        int64_t ns = timeBatch(bench, batch);
+        result.latency.record((ns + static_cast<int64_t>(batch) / 2) / static_cast<int64_t>(batch), batch);
+        result.iterations += batch;
+    }
+    return result;
+}
+
+// Connection that only counts deliveries, so a broadcast costs fan-out and nothing else
+class CountingConnection : public WebSocketConnection {
+public:
+    void send(const std::string& message) override { doNotOptimize(message); ++delivered; }
+    void sendShared(const SharedMessage& message) override { doNotOptimize(message); ++delivered; }
+    void close() override {}
+
+    uint64_t delivered = 0;
+};
+
+Orderbook syntheticBook(const std::string& instrument, size_t depth) {
+    Orderbook book;
+    book.instrument = instrument;
+    book.timestamp = 1700000000000000000;
+    for (size_t i = 0; i < depth; ++i) {
+        book.bids.push_back({50000.0 - 0.5 * (i + 1), 1.0 + i * 0.25});
+        book.asks.push_back({50000.0 + 0.5 * (i + 1), 1.0 + i * 0.25});
+    }
+    return book;
+}
+
+std::string bookFrame(const Orderbook& book) {
+    json data;
+    data["timestamp"] = book.timestamp / 1000000;
+    data["instrument_name"] = book.instrument;
+    data["bids"] = json::array();
+    data["asks"] = json::array();
+    for (const auto& bid : book.bids) data["bids"].push_back({bid.price, bid.size});
+    for (const auto& ask : book.asks) data["asks"].push_back({ask.price, ask.size});
+
+    json frame;
+    frame["jsonrpc"] = "2.0";
+    frame["method"] = "subscription";
+    frame["params"]["channel"] = "book." + book.instrument + ".none." + std::to_string(book.bids.size()) + ".100ms";
+    frame["params"]["data"] = data;
+    return frame.dump();
+}
+
+std::string isoTimestamp() {
+    std::time_t now = std::time(nullptr);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return buffer;
+}
+
+json toJson(const Result& result) {
+    const LatencyHistogram& h = result.latency;
+    double mean = h.mean();
+    return {
+        {"name", result.name},
+        {"params", result.params},
+        {"iterations", result.iterations},
+        {"batch", result.batch},
+        {"mean_ns", mean},
+        {"p50_ns", h.valueAtPercentile(50)},
+        {"p90_ns", h.valueAtPercentile(90)},
+        {"p99_ns", h.valueAtPercentile(99)},
+        {"p99_9_ns", h.valueAtPercentile(99.9)},
+        {"p99_99_ns", h.valueAtPercentile(99.99)},
+        {"max_ns", h.max()},
+        {"ops_per_sec", mean > 0 ? 1e9 / mean : 0.0}
+    };
+}
+
+void printResult(std::ostream& out, const Result& result) {
+    std::string label = result.name;
+    for (auto it = result.params.begin(); it != result.params.end(); ++it) {
+        label += " " + it.key() + "=" + it.value().dump();
+    }
+    out << std::left << std::setw(56) << label << std::right
+        << std::fixed << std::setprecision(1) << std::setw(12) << result.latency.mean() << " ns/op  "
+        << result.latency.summary() << "\n";
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --filter <text>       run only cases whose name contains text\n"
+              << "  --json <file|->       write results as JSON (- for stdout)\n"
+              << "  --cpu <n>             CPU to pin to, -1 to leave unpinned (default 0)\n"
+              << "  --warmup-ms <n>       warmup per case (default 100)\n"
+              << "  --min-time-ms <n>     measured time per case (default 500)\n"
+              << "  --connections <n>     subscribers for broadcast cases (default 1000)\n"
+              << "  --orders <n>          live orders for order cases (default 1000)\n"
+              << "  --depth <n>           book levels a side (default 10)\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--filter") options.filter = value;
+            else if (arg == "--json") options.json_path = value;
+            else if (arg == "--cpu") options.cpu = std::stoi(value);
+            else if (arg == "--warmup-ms") options.warmup_ms = std::stoll(value);
+            else if (arg == "--min-time-ms") options.min_time_ms = std::stoll(value);
+            else if (arg == "--connections") options.connections = std::stoul(value);
+            else if (arg == "--orders") options.orders = std::stoul(value);
+            else if (arg == "--depth") options.book_depth = std::stoul(value);
+            else {
+                std::cerr << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    bool pinned = options.cpu >= 0 && pinCurrentThreadToCpu(options.cpu);
+
+    // The ApiClient is never connected: requests take its local mock path,
+    // so order cases measure the manager and request building, not the network
+    auto api_client = std::make_shared<ApiClient>(ApiClient::Auth{});
+    const std::string instrument = "BTC-PERPETUAL";
+    const Orderbook book = syntheticBook(instrument, options.book_depth);
+    const std::string frame = bookFrame(book);
+    const json depth_param = {{"depth", options.book_depth}};
+
+    MarketDataClient market_data(api_client);
+    market_data.processMessage(frame);
+
+    WebSocketServer server(0, 1, options.connections + 1);
+    std::vector<std::shared_ptr<CountingConnection>> connections;
+    for (size_t i = 0; i < options.connections; ++i) {
+        auto connection = std::make_shared<CountingConnection>();
+        server.addConnection(connection);
+        server.addSubscription(connection, instrument);
+        connections.push_back(connection);
+    }
+    const std::string book_json = orderbookToJson(book);
+
+    OrderManager order_manager(api_client, options.orders * 2, 1);
+    std::vector<std::string> live;
+    std::vector<std::string> updates;
+    for (size_t i = 0; i < options.orders; ++i) {
+        std::string ref = order_manager.placeOrder(instrument, i % 2 ? Order::Side::SELL : Order::Side::BUY,
+                                                   i % 2 ? 50100.0 + i : 49900.0 - i, 0.1);
+        live.push_back(ref);
+        updates.push_back(R"({"order_id": ")" + ref + R"(", "order_state": "open", "filled_amount": 0.0})");
+        updates.push_back(R"({"order_id": ")" + ref + R"(", "order_state": "open", "filled_amount": 0.05})");
+    }
+
+    // Orders the place case adds and the cancel case removes, kept off the live set
+    std::vector<std::string> scratch;
+    size_t next = 0;
+    auto cancelScratch = [&]() {
+        for (const auto& ref : scratch) order_manager.cancelOrder(ref);
+        scratch.clear();
+    };
+
+    std::vector<Case> cases;
+    cases.push_back({"market_data/processMessage", depth_param, nullptr, [&]() {
+        market_data.processMessage(frame);
+    }});
+    cases.push_back({"market_data/getOrderbook", depth_param, nullptr, [&]() {
+        Orderbook snapshot = market_data.getOrderbook(instrument);
+        doNotOptimize(snapshot);
+    }});
+    cases.push_back({"market_data/orderbookToJson", depth_param, nullptr, [&]() {
+        std::string serialized = orderbookToJson(book);
+        doNotOptimize(serialized);
+    }});
+    cases.push_back({"websocket_server/broadcastToSubscribers", {{"connections", options.connections}}, nullptr, [&]() {
+        server.broadcastToSubscribers(instrument, book_json);
+    }});
+    cases.push_back({"order_manager/placeOrder", {{"live_orders", options.orders}},
+        [&](size_t) { cancelScratch(); },
+        [&]() {
+            scratch.push_back(order_manager.placeOrder(instrument, Order::Side::BUY, 40000.0, 0.1));
+        }});
+    cases.push_back({"order_manager/cancelOrder", {{"live_orders", options.orders}},
+        [&](size_t batch) {
+            scratch.clear();  // the previous batch cancelled them
+            for (size_t i = 0; i < batch; ++i) {
+                scratch.push_back(order_manager.placeOrder(instrument, Order::Side::BUY, 40000.0, 0.1));
+            }
+            next = 0;
+        },
+        [&]() {
+            order_manager.cancelOrder(scratch[next++]);
+        }});
+    cases.push_back({"order_manager/onOrderUpdate", {{"live_orders", options.orders}}, nullptr, [&]() {
+        order_manager.onOrderUpdate(updates[next++ % updates.size()]);
+    }});
+
+    std::ostream& table = options.json_path == "-" ? std::cerr : std::cout;
+    table << "Micro-benchmarks" << (pinned ? " pinned to CPU " + std::to_string(options.cpu) : std::string(" unpinned"))
+          << ", " << options.min_time_ms << " ms per case\n";
+
+    std::vector<Result> results;
+    for (const auto& bench : cases) {
+        if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos) continue;
+        results.push_back(measure(bench, options));
+        cancelScratch();
+        printResult(table, results.back());
+    }
+
+    if (!options.json_path.empty()) {
+        json report;
+        report["context"] = {
+            {"date", isoTimestamp()},
+            {"cpu", pinned ? options.cpu : -1},
+            {"hardware_threads", std::thread::hardware_concurrency()},
+            {"warmup_ms", options.warmup_ms},
+            {"min_time_ms", options.min_time_ms},
+#ifdef __VERSION__
+            {"compiler", __VERSION__},
+#endif
+#ifdef NDEBUG
+            {"build", "release"}
+#else
+            {"build", "debug"}
+#endif
+        };
+        report["benchmarks"] = json::array();
+        for (const auto& result : results) {
+            report["benchmarks"].push_back(toJson(result));
+        }
+
+        if (options.json_path == "-") {
+            std::cout << report.dump(2) << std::endl;
+        } else {
+            std::ofstream file(options.json_path);
+            if (!file) {
+                std::cerr << "Cannot write " << options.json_path << std::endl;
+                return 1;
+            }
+            file << report.dump(2) << std::endl;
+            std::cout << "Results written to " << options.json_path << "\n";
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
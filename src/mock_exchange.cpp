@@ -0,0 +1,844 @@
+#include "mock_exchange.h"
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <random>
+#include <unordered_map>
+
+// Include JSON library
+#define NLOHMANN_JSON_VERSION_MAJOR 3
+#define NLOHMANN_JSON_VERSION_MINOR 11
+#define NLOHMANN_JSON_VERSION_PATCH 2
+#include <nlohmann/json.hpp>
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+using json = nlohmann::json;
+
+namespace {
+
+// JSON-RPC and Deribit error codes used by the mock
+constexpr int kParseError = -32700;
+constexpr int kMethodNotFound = -32601;
+constexpr int kInvalidParams = -32602;
+constexpr int kOrderNotFound = 10004;
+constexpr int kUnauthorized = 13009;
+
+// Largest number of book updates one timer tick may catch up on
+constexpr double kMaxUpdatesPerTick = 1000.0;
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void appendNumber(std::string& out, double value) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.10g", value);
+    out.append(buffer, static_cast<size_t>(length));
+}
+
+} // namespace
+
+struct MockExchange::Impl {
+    class Session;
+    using SessionPtr = std::shared_ptr<Session>;
+    using SharedFrame = std::shared_ptr<const std::string>;
+
+    struct Level {
+        double price;
+        double size;
+    };
+
+    struct Book {
+        std::string instrument;
+        int64_t bid_ticks = 0;        // best bid in ticks; the ask is one tick above
+        std::vector<Level> bids;
+        std::vector<Level> asks;
+        uint64_t change_id = 0;
+        double due = 0.0;             // updates owed to the configured rate
+    };
+
+    struct MockOrder {
+        std::string order_id;
+        std::string label;
+        std::string instrument;
+        std::string type;
+        std::string state = "open";
+        bool is_buy = true;
+        double price = 0.0;
+        double amount = 0.0;
+        double filled = 0.0;
+        int64_t created_ms = 0;
+        int64_t updated_ms = 0;
+        std::weak_ptr<Session> owner;
+    };
+
+    // Declared first so it is destroyed last, after everything bound to it
+    net::io_context ioc{1};
+    tcp::acceptor acceptor{ioc};
+    net::steady_timer timer{ioc};
+
+    MockExchangeConfig config;
+    std::mt19937_64 rng;
+    std::vector<Book> books;
+    std::unordered_map<std::string, size_t> book_index;
+    std::vector<SessionPtr> sessions;
+    std::map<std::string, MockOrder> orders;   // open orders only
+    uint64_t next_order_id = 0;
+    uint64_t next_trade_id = 0;
+    std::chrono::steady_clock::time_point last_tick;
+
+    std::atomic<uint64_t> connections{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> messages_sent{0};
+    std::atomic<uint64_t> messages_dropped{0};
+    std::atomic<uint64_t> book_updates{0};
+    std::atomic<uint64_t> order_count{0};
+    std::atomic<uint64_t> fills{0};
+
+    explicit Impl(const MockExchangeConfig& cfg);
+
+    bool listen(const MockExchangeConfig& cfg, std::string& error);
+    void accept();
+    void scheduleTick();
+    void onTick();
+    void shutdown();
+
+    void onMessage(const SessionPtr& session, const std::string& message);
+    void onClose(const SessionPtr& session);
+
+    // Market
+    void step(Book& book, bool walk = true);
+    void publishBook(const Book& book);
+    void matchResting(Book& book);
+    Book* findBook(const std::string& instrument);
+    std::string bookData(const Book& book, size_t depth) const;
+
+    // Requests
+    json handleAuth(Session& session, const json& params);
+    json handleSubscribe(Session& session, const json& params, bool is_private);
+    json handleUnsubscribe(Session& session, const json& params);
+    json handleOrderBook(const json& params);
+    json handlePlace(const SessionPtr& session, const json& params, bool is_buy);
+    json handleEdit(const SessionPtr& session, const json& params);
+    json handleCancel(const SessionPtr& session, const json& params);
+    json handleCancelWhere(const SessionPtr& session, const std::string& key, const std::string& value);
+
+    // Orders and fills
+    json fill(MockOrder& order, double amount, double price);
+    json orderJson(const MockOrder& order) const;
+    void notifyOrder(const MockOrder& order, const json& trades);
+    bool owns(const MockOrder& order, const SessionPtr& session) const;
+    bool covers(const std::string& channel, const std::string& prefix, const std::string& instrument) const;
+
+    void send(Session& session, const std::string& frame);
+    void sendNotification(Session& session, const std::string& channel, const json& data);
+};
+
+// One client connection; every handler runs on the exchange's single I/O thread
+class MockExchange::Impl::Session : public std::enable_shared_from_this<Session> {
+public:
+    // Book frames a slow client may have queued before further ones are dropped
+    static constexpr size_t kMaxQueuedMessages = 4096;
+
+    Session(tcp::socket&& socket, Impl& exchange)
+        : ws_(std::move(socket)), exchange_(exchange) {
+    }
+
+    void start() {
+        // Small frames at high rates: never hold them back for coalescing
+        beast::error_code ec;
+        beast::get_lowest_layer(ws_).socket().set_option(tcp::no_delay(true), ec);
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.async_accept(
+            beast::bind_front_handler(
+                &Session::on_accept,
+                shared_from_this()));
+    }
+
+    // Responses and order events are always queued; book frames may be dropped
+    void send(SharedFrame frame, bool droppable) {
+        if (closing_) return;
+        if (droppable && write_queue_.size() >= kMaxQueuedMessages) {
+            ++exchange_.messages_dropped;
+            return;
+        }
+
+        write_queue_.push_back(std::move(frame));
+        ++exchange_.messages_sent;
+        if (write_queue_.size() > 1 || !accepted_) return;
+        write();
+    }
+
+    // Book frames would be dropped; lets the publisher skip building them
+    bool congested() const {
+        return write_queue_.size() >= kMaxQueuedMessages;
+    }
+
+    void close() {
+        if (closing_) return;
+        closing_ = true;
+        beast::error_code ec;
+        beast::get_lowest_layer(ws_).socket().close(ec);
+    }
+
+    bool authenticated = false;
+    std::vector<std::string> channels;
+
+private:
+    websocket::stream<beast::tcp_stream> ws_;
+    beast::flat_buffer buffer_;
+    Impl& exchange_;
+    std::deque<SharedFrame> write_queue_;
+    bool accepted_ = false;
+    bool closing_ = false;
+
+    void on_accept(beast::error_code ec) {
+        if (ec) {
+            exchange_.onClose(shared_from_this());
+            return;
+        }
+
+        accepted_ = true;
+        if (!write_queue_.empty()) {
+            write();
+        }
+        read();
+    }
+
+    void read() {
+        ws_.async_read(
+            buffer_,
+            beast::bind_front_handler(
+                &Session::on_read,
+                shared_from_this()));
+    }
+
+    void on_read(beast::error_code ec, std::size_t) {
+        if (ec) {
+            exchange_.onClose(shared_from_this());
+            return;
+        }
+
+        std::string message = beast::buffers_to_string(buffer_.data());
+        buffer_.consume(buffer_.size());
+        exchange_.onMessage(shared_from_this(), message);
+        read();
+    }
+
+    void write() {
+        ws_.async_write(
+            net::buffer(*write_queue_.front()),
+            beast::bind_front_handler(
+                &Session::on_write,
+                shared_from_this()));
+    }
+
+    void on_write(beast::error_code ec, std::size_t) {
+        if (ec) {
+            write_queue_.clear();
+            return;
+        }
+
+        write_queue_.pop_front();
+        if (!write_queue_.empty() && !closing_) {
+            write();
+        }
+    }
+};
+
+MockExchange::Impl::Impl(const MockExchangeConfig& cfg)
+    : config(cfg), rng(cfg.seed) {
+    int64_t bid_ticks = static_cast<int64_t>(std::llround(cfg.initial_price / cfg.tick_size));
+    for (const auto& instrument : cfg.instruments) {
+        Book book;
+        book.instrument = instrument;
+        book.bid_ticks = bid_ticks;
+        book_index[instrument] = books.size();
+        books.push_back(std::move(book));
+    }
+    for (auto& book : books) {
+        step(book, false);
+    }
+}
+
+bool MockExchange::Impl::listen(const MockExchangeConfig& cfg, std::string& error) {
+    beast::error_code ec;
+    tcp::endpoint endpoint(net::ip::make_address(cfg.address, ec), cfg.port);
+    if (ec) {
+        error = "invalid address " + cfg.address;
+        return false;
+    }
+
+    acceptor.open(endpoint.protocol(), ec);
+    if (!ec) acceptor.set_option(net::socket_base::reuse_address(true), ec);
+    if (!ec) acceptor.bind(endpoint, ec);
+    if (!ec) acceptor.listen(net::socket_base::max_listen_connections, ec);
+    if (ec) {
+        error = ec.message();
+        return false;
+    }
+    return true;
+}
+
+void MockExchange::Impl::accept() {
+    acceptor.async_accept(ioc, [this](beast::error_code ec, tcp::socket socket) {
+        if (ec == net::error::operation_aborted) return;
+        if (!ec) {
+            auto session = std::make_shared<Session>(std::move(socket), *this);
+            sessions.push_back(session);
+            ++connections;
+            session->start();
+        }
+        accept();
+    });
+}
+
+void MockExchange::Impl::scheduleTick() {
+    timer.expires_after(std::chrono::milliseconds(1));
+    timer.async_wait([this](beast::error_code ec) {
+        if (ec) return;
+        onTick();
+        scheduleTick();
+    });
+}
+
+void MockExchange::Impl::onTick() {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - last_tick).count();
+    last_tick = now;
+
+    // Owed updates accumulate so rates above the 1 ms timer resolution are met in batches
+    for (auto& book : books) {
+        book.due = std::min(book.due + config.book_updates_per_second * elapsed, kMaxUpdatesPerTick);
+        while (book.due >= 1.0) {
+            book.due -= 1.0;
+            step(book);
+            if (config.fill_resting) {
+                matchResting(book);
+            }
+            publishBook(book);
+        }
+    }
+}
+
+void MockExchange::Impl::shutdown() {
+    beast::error_code ec;
+    acceptor.close(ec);
+    timer.cancel();
+    for (auto& session : sessions) {
+        session->close();
+    }
+    sessions.clear();
+    orders.clear();
+}
+
+void MockExchange::Impl::onClose(const SessionPtr& session) {
+    auto it = std::find(sessions.begin(), sessions.end(), session);
+    if (it == sessions.end()) return;
+    sessions.erase(it);
+
+    // Cancel on disconnect
+    for (auto order = orders.begin(); order != orders.end();) {
+        if (owns(order->second, session)) {
+            order = orders.erase(order);
+        } else {
+            ++order;
+        }
+    }
+}
+
+void MockExchange::Impl::step(Book& book, bool walk) {
+    // Mid walks a tick at a time; every level gets a fresh size
+    std::uniform_int_distribution<int> move(-1, 1);
+    std::uniform_real_distribution<double> size(0.1, std::max(config.level_size, 0.2));
+    if (walk) {
+        book.bid_ticks = std::max<int64_t>(book.bid_ticks + move(rng), static_cast<int64_t>(config.book_depth) + 1);
+    }
+
+    book.bids.resize(config.book_depth);
+    book.asks.resize(config.book_depth);
+    for (size_t i = 0; i < config.book_depth; ++i) {
+        book.bids[i] = Level{static_cast<double>(book.bid_ticks - static_cast<int64_t>(i)) * config.tick_size,
+                             std::round(size(rng) * 10.0) / 10.0};
+        book.asks[i] = Level{static_cast<double>(book.bid_ticks + 1 + static_cast<int64_t>(i)) * config.tick_size,
+                             std::round(size(rng) * 10.0) / 10.0};
+    }
+    ++book.change_id;
+    ++book_updates;
+}
+
+std::string MockExchange::Impl::bookData(const Book& book, size_t depth) const {
+    // Hand-built: the publisher must stay cheap at 100k updates per second
+    std::string data;
+    data.reserve(64 + depth * 48);
+    data += "{\"timestamp\":";
+    data += std::to_string(nowMs());
+    data += ",\"instrument_name\":\"";
+    data += book.instrument;
+    data += "\",\"change_id\":";
+    data += std::to_string(book.change_id);
+    for (int side = 0; side < 2; ++side) {
+        const std::vector<Level>& levels = side == 0 ? book.bids : book.asks;
+        data += side == 0 ? ",\"bids\":[" : ",\"asks\":[";
+        size_t count = std::min(depth, levels.size());
+        for (size_t i = 0; i < count; ++i) {
+            data += i ? ",[" : "[";
+            appendNumber(data, levels[i].price);
+            data += ',';
+            appendNumber(data, levels[i].size);
+            data += ']';
+        }
+        data += ']';
+    }
+    data += '}';
+    return data;
+}
+
+void MockExchange::Impl::publishBook(const Book& book) {
+    std::string data;
+    for (auto& session : sessions) {
+        for (const auto& channel : session->channels) {
+            if (channel.compare(0, 5, "book.") != 0 || !covers(channel, "book.", book.instrument)) continue;
+            if (session->congested()) {
+                ++messages_dropped;
+                continue;
+            }
+
+            if (data.empty()) {
+                data = bookData(book, config.book_depth);
+            }
+            auto frame = std::make_shared<std::string>();
+            frame->reserve(data.size() + channel.size() + 80);
+            *frame += "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"";
+            *frame += channel;
+            *frame += "\",\"data\":";
+            *frame += data;
+            *frame += "}}";
+            session->send(std::move(frame), true);
+        }
+    }
+}
+
+void MockExchange::Impl::matchResting(Book& book) {
+    if (book.bids.empty() || book.asks.empty()) return;
+    double best_bid = book.bids.front().price;
+    double best_ask = book.asks.front().price;
+
+    for (auto it = orders.begin(); it != orders.end();) {
+        MockOrder& order = it->second;
+        bool crossed = order.instrument == book.instrument &&
+                       (order.is_buy ? order.price >= best_ask : order.price <= best_bid);
+        if (!crossed) {
+            ++it;
+            continue;
+        }
+
+        json trades = json::array({fill(order, order.amount - order.filled, order.price)});
+        notifyOrder(order, trades);
+        it = orders.erase(it);
+    }
+}
+
+MockExchange::Impl::Book* MockExchange::Impl::findBook(const std::string& instrument) {
+    auto it = book_index.find(instrument);
+    return it == book_index.end() ? nullptr : &books[it->second];
+}
+
+bool MockExchange::Impl::covers(const std::string& channel, const std::string& prefix, const std::string& instrument) const {
+    if (channel.compare(0, prefix.size(), prefix) != 0) return false;
+
+    // The segment after the prefix names the instrument; anything else ("any",
+    // a kind or currency) is a filter the mock does not model and matches all
+    size_t end = channel.find('.', prefix.size());
+    std::string segment = channel.substr(prefix.size(), end == std::string::npos ? std::string::npos : end - prefix.size());
+    return segment == instrument || book_index.count(segment) == 0;
+}
+
+bool MockExchange::Impl::owns(const MockOrder& order, const SessionPtr& session) const {
+    return order.owner.lock() == session;
+}
+
+void MockExchange::Impl::send(Session& session, const std::string& frame) {
+    session.send(std::make_shared<const std::string>(frame), false);
+}
+
+void MockExchange::Impl::sendNotification(Session& session, const std::string& channel, const json& data) {
+    json message = {
+        {"jsonrpc", "2.0"},
+        {"method", "subscription"},
+        {"params", {{"channel", channel}, {"data", data}}}
+    };
+    send(session, message.dump());
+}
+
+void MockExchange::Impl::onMessage(const SessionPtr& session, const std::string& message) {
+    ++requests;
+
+    json request = json::parse(message, nullptr, false);
+    if (request.is_discarded() || !request.is_object()) {
+        json error = {{"jsonrpc", "2.0"}, {"id", nullptr},
+                      {"error", {{"code", kParseError}, {"message", "Parse error"}}}};
+        send(*session, error.dump());
+        return;
+    }
+
+    json id = request.value("id", json());
+    std::string method = request.value("method", "");
+    static const json kNoParams = json::object();
+    const json& params = request.contains("params") && request["params"].is_object() ? request["params"] : kNoParams;
+
+    json result;
+    int error_code = 0;
+    std::string error_message;
+
+    try {
+        if (method.compare(0, 8, "private/") == 0 && !session->authenticated) {
+            error_code = kUnauthorized;
+            error_message = "unauthorized";
+        } else if (method == "public/auth") {
+            result = handleAuth(*session, params);
+        } else if (method == "public/subscribe" || method == "private/subscribe") {
+            result = handleSubscribe(*session, params, method == "private/subscribe");
+        } else if (method == "public/unsubscribe" || method == "private/unsubscribe") {
+            result = handleUnsubscribe(*session, params);
+        } else if (method == "public/get_order_book") {
+            result = handleOrderBook(params);
+        } else if (method == "public/get_time") {
+            result = nowMs();
+        } else if (method == "public/test") {
+            result = {{"version", "mock"}};
+        } else if (method == "private/buy" || method == "private/sell") {
+            result = handlePlace(session, params, method == "private/buy");
+        } else if (method == "private/edit") {
+            result = handleEdit(session, params);
+        } else if (method == "private/cancel") {
+            result = handleCancel(session, params);
+        } else if (method == "private/cancel_by_label") {
+            result = handleCancelWhere(session, "label", params.at("label").get<std::string>());
+        } else if (method == "private/cancel_all_by_instrument") {
+            result = handleCancelWhere(session, "instrument_name", params.at("instrument_name").get<std::string>());
+        } else {
+            error_code = kMethodNotFound;
+            error_message = "Method not found";
+        }
+    } catch (const std::invalid_argument& e) {
+        error_code = kOrderNotFound;
+        error_message = e.what();
+    } catch (const std::exception&) {
+        error_code = kInvalidParams;
+        error_message = "Invalid params";
+    }
+
+    json response = {{"jsonrpc", "2.0"}, {"id", id}};
+    if (error_code != 0) {
+        response["error"] = {{"code", error_code}, {"message", error_message}};
+    } else {
+        response["result"] = std::move(result);
+    }
+    send(*session, response.dump());
+}
+
+json MockExchange::Impl::handleAuth(Session& session, const json& params) {
+    if (params.value("grant_type", "") != "client_credentials" || !params.contains("client_id")) {
+        throw std::runtime_error("invalid credentials");
+    }
+
+    // Any credentials are accepted
+    session.authenticated = true;
+    return {
+        {"access_token", "mock-access-" + std::to_string(connections.load())},
+        {"refresh_token", "mock-refresh-" + std::to_string(connections.load())},
+        {"expires_in", 31536000},
+        {"scope", "connection mainaccount"},
+        {"token_type", "bearer"}
+    };
+}
+
+json MockExchange::Impl::handleSubscribe(Session& session, const json& params, bool is_private) {
+    json subscribed = json::array();
+    for (const auto& item : params.at("channels")) {
+        std::string channel = item.get<std::string>();
+        if (!is_private && channel.compare(0, 5, "user.") == 0) continue;
+        if (std::find(session.channels.begin(), session.channels.end(), channel) == session.channels.end()) {
+            session.channels.push_back(channel);
+        }
+        subscribed.push_back(channel);
+    }
+    return subscribed;
+}
+
+json MockExchange::Impl::handleUnsubscribe(Session& session, const json& params) {
+    json removed = json::array();
+    for (const auto& item : params.at("channels")) {
+        std::string channel = item.get<std::string>();
+        auto it = std::find(session.channels.begin(), session.channels.end(), channel);
+        if (it != session.channels.end()) {
+            session.channels.erase(it);
+            removed.push_back(channel);
+        }
+    }
+    return removed;
+}
+
+json MockExchange::Impl::handleOrderBook(const json& params) {
+    Book* book = findBook(params.at("instrument_name").get<std::string>());
+    if (!book) throw std::runtime_error("unknown instrument");
+
+    size_t depth = params.value("depth", config.book_depth);
+    return json::parse(bookData(*book, depth));
+}
+
+json MockExchange::Impl::handlePlace(const SessionPtr& session, const json& params, bool is_buy) {
+    std::string instrument = params.at("instrument_name").get<std::string>();
+    Book* book = findBook(instrument);
+    double amount = params.at("amount").get<double>();
+    std::string type = params.value("type", "limit");
+    if (!book || amount <= 0.0 || (type != "limit" && type != "market")) {
+        throw std::runtime_error("invalid order");
+    }
+
+    MockOrder order;
+    order.order_id = "MOCK-" + std::to_string(++next_order_id);
+    order.label = params.value("label", "");
+    order.instrument = instrument;
+    order.type = type;
+    order.is_buy = is_buy;
+    order.amount = amount;
+    order.price = type == "market" ? 0.0 : params.at("price").get<double>();
+    order.created_ms = order.updated_ms = nowMs();
+    order.owner = session;
+    ++order_count;
+
+    // Marketable orders trade at the touch; market orders always fill completely
+    double best = is_buy ? book->asks.front().price : book->bids.front().price;
+    bool marketable = type == "market" || (is_buy ? order.price >= best : order.price <= best);
+    json trades = json::array();
+    if (marketable) {
+        double fill_amount = type == "market" ? amount : amount * std::min(std::max(config.fill_ratio, 0.0), 1.0);
+        if (fill_amount > 0.0) {
+            trades.push_back(fill(order, fill_amount, best));
+        }
+    }
+
+    json result = {{"order", orderJson(order)}, {"trades", trades}};
+    notifyOrder(order, trades);
+    if (order.state == "open") {
+        orders[order.order_id] = std::move(order);
+    }
+    return result;
+}
+
+json MockExchange::Impl::handleEdit(const SessionPtr& session, const json& params) {
+    auto it = orders.find(params.at("order_id").get<std::string>());
+    if (it == orders.end() || !owns(it->second, session)) {
+        throw std::invalid_argument("order_not_found");
+    }
+
+    MockOrder& order = it->second;
+    double amount = params.at("amount").get<double>();
+    if (amount <= order.filled) throw std::runtime_error("invalid amount");
+    order.amount = amount;
+    order.price = params.value("price", order.price);
+    order.updated_ms = nowMs();
+
+    // An edit that crosses the book trades like a new order
+    Book* book = findBook(order.instrument);
+    double best = order.is_buy ? book->asks.front().price : book->bids.front().price;
+    json trades = json::array();
+    if (order.is_buy ? order.price >= best : order.price <= best) {
+        trades.push_back(fill(order, order.amount - order.filled, best));
+    }
+
+    json result = {{"order", orderJson(order)}, {"trades", trades}};
+    notifyOrder(order, trades);
+    if (order.state != "open") {
+        orders.erase(it);
+    }
+    return result;
+}
+
+json MockExchange::Impl::handleCancel(const SessionPtr& session, const json& params) {
+    auto it = orders.find(params.at("order_id").get<std::string>());
+    if (it == orders.end() || !owns(it->second, session)) {
+        throw std::invalid_argument("order_not_found");
+    }
+
+    MockOrder order = std::move(it->second);
+    orders.erase(it);
+    order.state = "cancelled";
+    order.updated_ms = nowMs();
+    notifyOrder(order, json::array());
+    return orderJson(order);
+}
+
+json MockExchange::Impl::handleCancelWhere(const SessionPtr& session, const std::string& key, const std::string& value) {
+    int cancelled = 0;
+    for (auto it = orders.begin(); it != orders.end();) {
+        MockOrder& order = it->second;
+        const std::string& field = key == "label" ? order.label : order.instrument;
+        if (field != value || !owns(order, session)) {
+            ++it;
+            continue;
+        }
+
+        order.state = "cancelled";
+        order.updated_ms = nowMs();
+        notifyOrder(order, json::array());
+        it = orders.erase(it);
+        ++cancelled;
+    }
+    return cancelled;
+}
+
+json MockExchange::Impl::fill(MockOrder& order, double amount, double price) {
+    order.filled += amount;
+    order.updated_ms = nowMs();
+    if (order.filled >= order.amount) {
+        order.state = "filled";
+    }
+    ++fills;
+
+    return {
+        {"trade_id", "MOCK-T" + std::to_string(++next_trade_id)},
+        {"trade_seq", next_trade_id},
+        {"order_id", order.order_id},
+        {"label", order.label},
+        {"instrument_name", order.instrument},
+        {"direction", order.is_buy ? "buy" : "sell"},
+        {"price", price},
+        {"amount", amount},
+        {"fee", 0.0},
+        {"timestamp", order.updated_ms}
+    };
+}
+
+json MockExchange::Impl::orderJson(const MockOrder& order) const {
+    return {
+        {"order_id", order.order_id},
+        {"label", order.label},
+        {"instrument_name", order.instrument},
+        {"direction", order.is_buy ? "buy" : "sell"},
+        {"order_type", order.type},
+        {"order_state", order.state},
+        {"price", order.price},
+        {"amount", order.amount},
+        {"filled_amount", order.filled},
+        {"creation_timestamp", order.created_ms},
+        {"last_update_timestamp", order.updated_ms}
+    };
+}
+
+void MockExchange::Impl::notifyOrder(const MockOrder& order, const json& trades) {
+    // Private events go to the owner; public trades to every subscriber
+    if (SessionPtr owner = order.owner.lock()) {
+        json order_data = orderJson(order);
+        for (const auto& channel : owner->channels) {
+            if (covers(channel, "user.orders.", order.instrument)) {
+                sendNotification(*owner, channel, order_data);
+            } else if (!trades.empty() && covers(channel, "user.trades.", order.instrument)) {
+                sendNotification(*owner, channel, trades);
+            }
+        }
+    }
+
+    if (trades.empty()) return;
+    json public_trades = json::array();
+    for (const auto& trade : trades) {
+        public_trades.push_back({
+            {"trade_id", trade["trade_id"]},
+            {"trade_seq", trade["trade_seq"]},
+            {"instrument_name", trade["instrument_name"]},
+            {"direction", trade["direction"]},
+            {"price", trade["price"]},
+            {"amount", trade["amount"]},
+            {"timestamp", trade["timestamp"]}
+        });
+    }
+    for (auto& session : sessions) {
+        for (const auto& channel : session->channels) {
+            if (covers(channel, "trades.", order.instrument)) {
+                sendNotification(*session, channel, public_trades);
+            }
+        }
+    }
+}
+
+// MockExchange
+MockExchange::MockExchange(MockExchangeConfig config)
+    : config_(std::move(config)) {
+}
+
+MockExchange::~MockExchange() {
+    stop();
+}
+
+bool MockExchange::start() {
+    if (running_) return true;
+
+    auto impl = std::make_shared<Impl>(config_);
+    std::string error;
+    if (!impl->listen(config_, error)) {
+        std::cerr << "Mock exchange cannot listen on " << config_.address << ":" << config_.port
+                  << ": " << error << std::endl;
+        return false;
+    }
+    port_ = impl->acceptor.local_endpoint().port();
+    impl_ = impl;
+
+    impl->last_tick = std::chrono::steady_clock::now();
+    impl->accept();
+    impl->scheduleTick();
+
+    running_ = true;
+    thread_ = std::thread([impl]() {
+        try {
+            impl->ioc.run();
+        } catch (const std::exception& e) {
+            std::cerr << "Mock exchange error: " << e.what() << std::endl;
+        }
+    });
+    return true;
+}
+
+void MockExchange::stop() {
+    if (!running_) return;
+    running_ = false;
+
+    auto impl = impl_;
+    net::post(impl->ioc, [impl]() {
+        impl->shutdown();
+        impl->ioc.stop();
+    });
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+MockExchange::Stats MockExchange::stats() const {
+    Stats result;
+    if (!impl_) return result;
+    result.connections = impl_->connections;
+    result.requests = impl_->requests;
+    result.messages_sent = impl_->messages_sent;
+    result.messages_dropped = impl_->messages_dropped;
+    result.book_updates = impl_->book_updates;
+    result.orders = impl_->order_count;
+    result.fills = impl_->fills;
+    return result;
+}
\ No newline at end of file
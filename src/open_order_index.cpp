@@ -0,0 +1,70 @@
+#include "open_order_index.h"
+
+#include <algorithm>
+
+void OpenOrderIndex::add(OrderHandle handle, const std::string& instrument, Order::Side side) {
+    uint32_t slot = OrderTable::slotOf(handle);
+    if (slot >= links_.size()) {
+        links_.resize(std::max<size_t>(slot + 1, links_.size() * 2));
+    }
+    
+    // Re-adding moves the order to its new list
+    if (links_[slot].list) {
+        remove(links_[slot].handle);
+    }
+    
+    List& list = lists_[instrument][sideIndex(side)];
+    Link& link = links_[slot];
+    link.handle = handle;
+    link.prev = list.tail;
+    link.next = kNone;
+    link.list = &list;
+    
+    if (list.tail != kNone) {
+        links_[list.tail].next = slot;
+    } else {
+        list.head = slot;
+    }
+    list.tail = slot;
+    ++list.size;
+    ++size_;
+}
+
+bool OpenOrderIndex::remove(OrderHandle handle) {
+    if (!contains(handle)) return false;
+    
+    uint32_t slot = OrderTable::slotOf(handle);
+    Link& link = links_[slot];
+    List& list = *link.list;
+    
+    if (link.prev != kNone) {
+        links_[link.prev].next = link.next;
+    } else {
+        list.head = link.next;
+    }
+    if (link.next != kNone) {
+        links_[link.next].prev = link.prev;
+    } else {
+        list.tail = link.prev;
+    }
+    --list.size;
+    --size_;
+    
+    link = Link();
+    return true;
+}
+
+bool OpenOrderIndex::contains(OrderHandle handle) const {
+    uint32_t slot = OrderTable::slotOf(handle);
+    return slot < links_.size() && links_[slot].list && links_[slot].handle == handle;
+}
+
+size_t OpenOrderIndex::count(const std::string& instrument) const {
+    auto it = lists_.find(instrument);
+    return it != lists_.end() ? it->second[0].size + it->second[1].size : 0;
+}
+
+size_t OpenOrderIndex::count(const std::string& instrument, Order::Side side) const {
+    auto it = lists_.find(instrument);
+    return it != lists_.end() ? it->second[sideIndex(side)].size : 0;
+}
\ No newline at end of file
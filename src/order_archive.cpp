@@ -0,0 +1,261 @@
+#include "order_archive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+
+namespace {
+
+// Record layout: uint32 payload length, then the payload fields in the order
+// below, little-endian as written by the host. Strings are uint16 length + bytes.
+constexpr size_t kMaxPayload = 1 << 20;
+
+template<typename T>
+void putScalar(std::string& buffer, T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& buffer, const std::string& value) {
+    uint16_t length = static_cast<uint16_t>(std::min<size_t>(value.size(), UINT16_MAX));
+    putScalar(buffer, length);
+    buffer.append(value.data(), length);
+}
+
+template<typename T>
+bool getScalar(const char*& cursor, const char* end, T& value) {
+    if (static_cast<size_t>(end - cursor) < sizeof(value)) return false;
+    std::memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    return true;
+}
+
+bool getString(const char*& cursor, const char* end, std::string& value) {
+    uint16_t length;
+    if (!getScalar(cursor, end, length) || static_cast<size_t>(end - cursor) < length) return false;
+    value.assign(cursor, length);
+    cursor += length;
+    return true;
+}
+
+std::string encode(const Order& order) {
+    std::string payload;
+    putScalar<int64_t>(payload, order.creation_timestamp);
+    putScalar<int64_t>(payload, order.last_update_timestamp);
+    putScalar<double>(payload, order.price);
+    putScalar<double>(payload, order.amount);
+    putScalar<double>(payload, order.filled_amount);
+    putScalar<uint8_t>(payload, static_cast<uint8_t>(order.side));
+    putScalar<uint8_t>(payload, static_cast<uint8_t>(order.type));
+    putScalar<uint8_t>(payload, static_cast<uint8_t>(order.status));
+    putString(payload, order.order_id);
+    putString(payload, order.label);
+    putString(payload, order.instrument);
+    putString(payload, order.error_message);
+    
+    std::string record;
+    record.reserve(sizeof(uint32_t) + payload.size());
+    putScalar<uint32_t>(record, static_cast<uint32_t>(payload.size()));
+    record += payload;
+    return record;
+}
+
+bool decode(const std::string& payload, Order& order) {
+    const char* cursor = payload.data();
+    const char* end = cursor + payload.size();
+    uint8_t side, type, status;
+    if (!getScalar(cursor, end, order.creation_timestamp) ||
+        !getScalar(cursor, end, order.last_update_timestamp) ||
+        !getScalar(cursor, end, order.price) ||
+        !getScalar(cursor, end, order.amount) ||
+        !getScalar(cursor, end, order.filled_amount) ||
+        !getScalar(cursor, end, side) ||
+        !getScalar(cursor, end, type) ||
+        !getScalar(cursor, end, status) ||
+        !getString(cursor, end, order.order_id) ||
+        !getString(cursor, end, order.label) ||
+        !getString(cursor, end, order.instrument) ||
+        !getString(cursor, end, order.error_message)) {
+        return false;
+    }
+    order.side = static_cast<Order::Side>(side);
+    order.type = static_cast<Order::Type>(type);
+    order.status = static_cast<Order::Status>(status);
+    return true;
+}
+
+// Read one record at the stream position; false at end of file or on a torn record
+bool readRecord(std::ifstream& in, Order& order, uint64_t& size) {
+    uint32_t length;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > kMaxPayload) {
+        return false;
+    }
+    std::string payload(length, '\0');
+    if (!in.read(&payload[0], length) || !decode(payload, order)) {
+        return false;
+    }
+    size = sizeof(length) + length;
+    return true;
+}
+
+// Two filter bits per order id or label
+std::pair<size_t, size_t> filterBits(const std::string& key, size_t bits) {
+    size_t hash = std::hash<std::string>()(key);
+    return {hash % bits, (hash >> 32) % bits};
+}
+
+} // namespace
+
+OrderArchive::OrderArchive(const std::string& path, size_t block_size)
+    : path_(path),
+      block_size_(std::max<size_t>(block_size, 1)) {
+    rebuildIndex();
+    out_.open(path_, std::ios::binary | std::ios::app);
+    if (!out_) {
+        std::cerr << "Failed to open order archive: " << path_ << std::endl;
+    }
+}
+
+bool OrderArchive::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return out_.is_open() && out_.good();
+}
+
+void OrderArchive::rebuildIndex() {
+    std::ifstream in(path_, std::ios::binary);
+    if (!in) return;
+    
+    Order order;
+    uint64_t size;
+    while (readRecord(in, order, size)) {
+        indexRecord(end_offset_, order);
+        end_offset_ += size;
+    }
+    in.close();
+    
+    // Drop a torn trailing record so new appends start on a record boundary
+    std::error_code ec;
+    uint64_t file_size = std::filesystem::file_size(path_, ec);
+    if (!ec && file_size > end_offset_) {
+        std::cerr << "Truncating torn record at end of order archive: " << path_ << std::endl;
+        std::filesystem::resize_file(path_, end_offset_, ec);
+    }
+}
+
+void OrderArchive::indexRecord(uint64_t offset, const Order& order) {
+    if (count_ % block_size_ == 0) {
+        blocks_.push_back(Block{offset, max_timestamp_, {}});
+    }
+    
+    Block& block = blocks_.back();
+    max_timestamp_ = std::max(max_timestamp_, order.last_update_timestamp);
+    block.max_timestamp = max_timestamp_;
+    for (const std::string* key : {&order.order_id, &order.label}) {
+        if (key->empty()) continue;
+        auto bits = filterBits(*key, kFilterBits);
+        block.keys.set(bits.first);
+        block.keys.set(bits.second);
+    }
+    ++count_;
+}
+
+void OrderArchive::append(const Order& order) {
+    std::string record = encode(order);
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!out_) return;
+    
+    out_.write(record.data(), record.size());
+    indexRecord(end_offset_, order);
+    end_offset_ += record.size();
+}
+
+size_t OrderArchive::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+std::vector<Order> OrderArchive::readLocked(size_t first, size_t count) const {
+    std::vector<Order> result;
+    if (first >= count_ || count == 0) return result;
+    count = std::min(count, count_ - first);
+    
+    // Appends are buffered; make them visible to the reader
+    out_.flush();
+    
+    std::ifstream in(path_, std::ios::binary);
+    if (!in) return result;
+    
+    // Seek to the containing block, then skip forward within it
+    in.seekg(static_cast<std::streamoff>(blocks_[first / block_size_].offset));
+    Order order;
+    uint64_t size;
+    for (size_t skip = first % block_size_; skip > 0; --skip) {
+        if (!readRecord(in, order, size)) return result;
+    }
+    
+    result.reserve(count);
+    while (result.size() < count && readRecord(in, order, size)) {
+        result.push_back(order);
+    }
+    return result;
+}
+
+std::vector<Order> OrderArchive::read(size_t first, size_t limit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return readLocked(first, limit);
+}
+
+std::vector<Order> OrderArchive::readNewest(size_t skip, size_t limit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (skip >= count_) return {};
+    
+    size_t end = count_ - skip;
+    size_t first = end > limit ? end - limit : 0;
+    std::vector<Order> result = readLocked(first, end - first);
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+std::vector<Order> OrderArchive::readSince(int64_t since, size_t limit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // Block maxima are a running maximum, so the first candidate block is a binary search away
+    auto block = std::lower_bound(blocks_.begin(), blocks_.end(), since,
+        [](const Block& b, int64_t timestamp) { return b.max_timestamp < timestamp; });
+    
+    std::vector<Order> result;
+    size_t first = static_cast<size_t>(block - blocks_.begin()) * block_size_;
+    while (first < count_ && result.size() < limit) {
+        for (Order& order : readLocked(first, block_size_)) {
+            if (order.last_update_timestamp >= since && result.size() < limit) {
+                result.push_back(std::move(order));
+            }
+        }
+        first += block_size_;
+    }
+    return result;
+}
+
+bool OrderArchive::find(const std::string& order_ref, Order& order) const {
+    if (order_ref.empty()) return false;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto bits = filterBits(order_ref, kFilterBits);
+    
+    // Newest block first so the latest record for the id or label wins
+    for (size_t i = blocks_.size(); i > 0; --i) {
+        const Block& block = blocks_[i - 1];
+        if (!block.keys.test(bits.first) || !block.keys.test(bits.second)) continue;
+        
+        std::vector<Order> records = readLocked((i - 1) * block_size_, block_size_);
+        for (auto it = records.rbegin(); it != records.rend(); ++it) {
+            if (it->order_id == order_ref || it->label == order_ref) {
+                order = std::move(*it);
+                return true;
+            }
+        }
+    }
+    return false;
+}
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include "order_manager.h"
 
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
 #include <chrono>
+#include <cassert>
 #include <iostream>
 #include <algorithm>
 
@@ -12,8 +16,276 @@
 
 using json = nlohmann::json;
 
-OrderManager::OrderManager(std::shared_ptr<ApiClient> api_client)
-    : api_client_(api_client) {
+namespace {
+
+// Set while a request pool task runs; blocking bulk calls from there would wait
+// on the thread they occupy
+thread_local bool on_request_thread = false;
+
+// Working orders, including those still awaiting their ack
+bool isOpenStatus(Order::Status status) {
+    return status == Order::Status::PENDING || status == Order::Status::OPEN ||
+           status == Order::Status::PARTIALLY_FILLED;
+}
+
+bool isTerminalStatus(Order::Status status) {
+    return status == Order::Status::FILLED || status == Order::Status::CANCELLED ||
+           status == Order::Status::REJECTED;
+}
+
+// Map a Deribit order_state onto our status, keeping the current one for states we don't track
+Order::Status parseOrderState(const std::string& state, Order::Status current) {
+    if (state == "open") return Order::Status::OPEN;
+    if (state == "filled") return Order::Status::FILLED;
+    if (state == "cancelled") return Order::Status::CANCELLED;
+    if (state == "rejected") return Order::Status::REJECTED;
+    return current;
+}
+
+} // namespace
+
+OrderManager::OrderManager(std::shared_ptr<ApiClient> api_client,
+                           size_t history_capacity,
+                           size_t request_threads)
+    : api_client_(api_client),
+      history_capacity_(history_capacity),
+      label_prefix_("dt" + std::to_string(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::system_clock::now().time_since_epoch()).count()) + "-"),
+      positions_(std::make_shared<PositionEngine>()),
+      request_pool_(std::make_unique<boost::asio::thread_pool>(std::max<size_t>(request_threads, 1))) {
+}
+
+OrderManager::~OrderManager() {
+    // Let in-flight requests finish before the order state goes away
+    request_pool_->join();
+    writeEvicted();
+}
+
+std::string OrderManager::nextLabel() {
+    return label_prefix_ + std::to_string(++label_counter_);
+}
+
+OrderHandle OrderManager::findOrder(const std::string& order_ref) const {
+    OrderHandle handle = orders_.findById(order_ref);
+    return handle != OrderTable::kInvalidHandle ? handle : orders_.findByLabel(order_ref);
+}
+
+void OrderManager::onOrderAck(OrderHandle handle, const std::string& response) {
+    json data = json::parse(response, nullptr, false);
+    
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    Order* order = orders_.get(handle);
+    if (!order) return;
+    order->last_update_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+    
+    if (data.is_object() && data.contains("error")) {
+        if (isTerminalStatus(order->status)) return;
+        const json& error = data["error"];
+        order->error_message = error.is_object() ? error.value("message", "rejected") : error.dump();
+        updateStatus(handle, *order, Order::Status::REJECTED);
+        return;
+    }
+    
+    // Bind the exchange id from private/buy|sell's result.order
+    if (data.is_object() && data.contains("result") && data["result"].is_object() &&
+        data["result"].contains("order") && data["result"]["order"].is_object()) {
+        const json& ack = data["result"]["order"];
+        if (ack.contains("order_id") && ack["order_id"].is_string()) {
+            orders_.bindId(handle, ack["order_id"].get<std::string>());
+        }
+        order->filled_amount = std::max(order->filled_amount, ack.value("filled_amount", order->filled_amount));
+        Order::Status status = parseOrderState(ack.value("order_state", ""), Order::Status::OPEN);
+        updateStatus(handle, *order, status);
+        return;
+    }
+    
+    // Acks without an order echo (the stubbed REST path) leave the label as the order's id
+    if (order->order_id.empty()) {
+        orders_.bindId(handle, order->label);
+    }
+    updateStatus(handle, *order, order->status == Order::Status::PENDING ? Order::Status::OPEN : order->status);
+}
+
+OrderHandle OrderManager::trackNewOrder(Order& order) {
+    order.label = nextLabel();
+    order.status = Order::Status::PENDING;
+    order.creation_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+    order.last_update_timestamp = order.creation_timestamp;
+    
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    RiskResult risk = RiskResult::ACCEPTED;
+    InstrumentId instrument_id = OrderTable::kNoInstrument;
+    if (risk_) {
+        // Lock-free once the instrument is known; cached on the entry for later edits
+        instrument_id = risk_->instrumentId(order.instrument);
+        
+        RiskOrder request;
+        request.instrument = instrument_id;
+        request.side = order.side;
+        request.type = order.type;
+        request.price = order.price;
+        request.amount = order.amount;
+        request.open_orders = open_orders_.count(order.instrument);
+        risk = risk_->check(request);
+    }
+    
+    OrderHandle handle = orders_.insert(order, instrument_id);
+    if (risk != RiskResult::ACCEPTED) {
+        // Kept for queries like an exchange reject, but never sent
+        Order* stored = orders_.get(handle);
+        stored->error_message = std::string("Risk check failed: ") + RiskEngine::describe(risk);
+        updateStatus(handle, *stored, Order::Status::REJECTED);
+        order = *stored;
+        return handle;
+    }
+    open_orders_.add(handle, order.instrument, order.side);
+    order_states_.publish(handle, order);
+    return handle;
+}
+
+OrderAck OrderManager::makeAck(const std::string& order_ref, OrderHandle handle, bool success) const {
+    OrderAck ack;
+    ack.order_ref = order_ref;
+    ack.success = success;
+    
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    if (const Order* order = orders_.get(handle)) {
+        ack.order = *order;
+    }
+    return ack;
+}
+
+OrderAck OrderManager::sendPlace(OrderHandle handle, const Order& order) {
+    if (order.status == Order::Status::REJECTED) {
+        writeEvicted();
+        return makeAck(order.label, handle, false);
+    }
+    
+    // Call the API client to place the order
+    std::string api_response = api_client_->placeOrder(
+        order.instrument, 
+        order.side == Order::Side::BUY, 
+        order.price, 
+        order.amount, 
+        order.type == Order::Type::LIMIT ? "limit" : "market",
+        order.label
+    );
+    
+    onOrderAck(handle, api_response);
+    writeEvicted();
+    
+    OrderAck ack = makeAck(order.label, handle, true);
+    ack.success = ack.order.status != Order::Status::REJECTED;
+    return ack;
+}
+
+OrderAck OrderManager::sendCancel(const std::string& order_ref) {
+    // Orders still awaiting their ack are cancelled by label
+    std::string exchange_id = order_ref;
+    std::string label;
+    {
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        if (const Order* order = orders_.get(findOrder(order_ref))) {
+            exchange_id = order->order_id;
+            label = order->label;
+        }
+    }
+    
+    // Call the API client to cancel the order
+    bool success = exchange_id.empty() ? api_client_->cancelOrderByLabel(label)
+                                       : api_client_->cancelOrder(exchange_id);
+    
+    OrderHandle handle = OrderTable::kInvalidHandle;
+    if (success) {
+        // Update the order status
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        handle = findOrder(order_ref);
+        if (Order* order = orders_.get(handle)) {
+            order->last_update_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+            updateStatus(handle, *order, Order::Status::CANCELLED);
+        }
+    }
+    writeEvicted();
+    
+    return makeAck(order_ref, handle, success);
+}
+
+OrderAck OrderManager::sendModify(const std::string& order_ref, double new_price, double new_amount) {
+    // Edits need the exchange id, so an order still awaiting its ack can't be modified yet
+    std::string exchange_id = order_ref;
+    RiskResult risk = RiskResult::ACCEPTED;
+    {
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        OrderHandle handle = findOrder(order_ref);
+        if (const Order* order = orders_.get(handle)) {
+            exchange_id = order->order_id;
+            
+            // An edit replaces the order in place, so the open order count doesn't apply
+            if (risk_ && !exchange_id.empty()) {
+                RiskOrder request;
+                request.instrument = orders_.instrumentIdOf(handle);
+                if (request.instrument == OrderTable::kNoInstrument) {
+                    // Placed before the risk engine was attached
+                    request.instrument = risk_->instrumentId(order->instrument);
+                }
+                request.side = order->side;
+                request.type = order->type;
+                request.price = new_price;
+                request.amount = new_amount;
+                risk = risk_->check(request);
+            }
+        }
+    }
+    if (exchange_id.empty() || risk != RiskResult::ACCEPTED) {
+        return makeAck(order_ref, OrderTable::kInvalidHandle, false);
+    }
+    
+    // Call the API client to modify the order
+    bool success = api_client_->modifyOrder(exchange_id, new_price, new_amount);
+    
+    OrderHandle handle = OrderTable::kInvalidHandle;
+    if (success) {
+        // Update the order
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        handle = findOrder(order_ref);
+        if (Order* order = orders_.get(handle)) {
+            order->price = new_price;
+            order->amount = new_amount;
+            order->last_update_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+            order_states_.publish(handle, *order);
+        }
+    }
+    
+    return makeAck(order_ref, handle, success);
+}
+
+std::future<OrderAck> OrderManager::submit(std::function<OrderAck()> request, AckCallback on_ack) {
+    auto promise = std::make_shared<std::promise<OrderAck>>();
+    std::future<OrderAck> future = promise->get_future();
+    
+    boost::asio::post(*request_pool_, [request = std::move(request), on_ack = std::move(on_ack), promise]() {
+        on_request_thread = true;
+        OrderAck ack;
+        try {
+            ack = request();
+        } catch (const std::exception& e) {
+            std::cerr << "Error sending order request: " << e.what() << std::endl;
+            ack.order.error_message = e.what();
+        }
+        
+        // A throwing callback must not strand the future or unwind the pool thread
+        if (on_ack) {
+            try {
+                on_ack(ack);
+            } catch (const std::exception& e) {
+                std::cerr << "Error in order ack callback: " << e.what() << std::endl;
+            }
+        }
+        promise->set_value(std::move(ack));
+    });
+    
+    return future;
 }
 
 std::string OrderManager::placeOrder(const std::string& instrument, 
@@ -21,83 +293,202 @@ std::string OrderManager::placeOrder(const std::string& instrument,
                                     double price, 
                                     double amount, 
                                     Order::Type type) {
-    // Call the API client to place the order
-    std::string api_response = api_client_->placeOrder(
-        instrument, 
-        side == Order::Side::BUY, 
-        price, 
-        amount, 
-        type == Order::Type::LIMIT ? "limit" : "market"
-    );
-    
-    // Parse the response (in a real implementation)
-    // For now, mock the response
-    std::string order_id = "order_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    Order order;
+    order.instrument = instrument;
+    order.side = side;
+    order.type = type;
+    order.price = price;
+    order.amount = amount;
     
-    // Create a new order
+    OrderHandle handle = trackNewOrder(order);
+    return sendPlace(handle, order).order_ref;
+}
+
+bool OrderManager::cancelOrder(const std::string& order_id) {
+    return sendCancel(order_id).success;
+}
+
+bool OrderManager::modifyOrder(const std::string& order_id, 
+                             double new_price,
+                             double new_amount) {
+    return sendModify(order_id, new_price, new_amount).success;
+}
+
+OrderTicket OrderManager::placeOrderAsync(const std::string& instrument,
+                                          Order::Side side,
+                                          double price,
+                                          double amount,
+                                          Order::Type type,
+                                          AckCallback on_ack) {
     Order order;
-    order.order_id = order_id;
     order.instrument = instrument;
     order.side = side;
     order.type = type;
     order.price = price;
     order.amount = amount;
-    order.status = Order::Status::OPEN;
-    order.creation_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
-    order.last_update_timestamp = order.creation_timestamp;
     
-    // Add the order to our map
+    OrderHandle handle = trackNewOrder(order);
+    
+    OrderTicket ticket;
+    ticket.label = order.label;
+    ticket.handle = handle;
+    ticket.ack = submit([this, handle, order]() {
+        return sendPlace(handle, order);
+    }, std::move(on_ack));
+    return ticket;
+}
+
+std::future<OrderAck> OrderManager::cancelOrderAsync(const std::string& order_id, AckCallback on_ack) {
+    return submit([this, order_id]() {
+        return sendCancel(order_id);
+    }, std::move(on_ack));
+}
+
+std::future<OrderAck> OrderManager::modifyOrderAsync(const std::string& order_id,
+                                                     double new_price,
+                                                     double new_amount,
+                                                     AckCallback on_ack) {
+    return submit([this, order_id, new_price, new_amount]() {
+        return sendModify(order_id, new_price, new_amount);
+    }, std::move(on_ack));
+}
+
+size_t OrderManager::cancelAll(const std::string& instrument) {
+    // Only orders known before the request are covered by it
+    std::vector<OrderHandle> handles;
     {
         std::lock_guard<std::mutex> lock(orders_mutex_);
-        orders_[order_id] = order;
+        open_orders_.forEach(instrument, [&handles](OrderHandle handle) {
+            handles.push_back(handle);
+        });
     }
     
-    return order_id;
-}
-
-bool OrderManager::cancelOrder(const std::string& order_id) {
-    // Call the API client to cancel the order
-    bool success = api_client_->cancelOrder(order_id);
+    if (!api_client_->cancelAllByInstrument(instrument)) {
+        return 0;
+    }
     
-    if (success) {
-        // Update the order status
+    int64_t now = std::chrono::system_clock::now().time_since_epoch().count();
+    size_t cancelled = 0;
+    {
         std::lock_guard<std::mutex> lock(orders_mutex_);
-        if (orders_.find(order_id) != orders_.end()) {
-            orders_[order_id].status = Order::Status::CANCELLED;
-            orders_[order_id].last_update_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+        for (OrderHandle handle : handles) {
+            Order* order = orders_.get(handle);
+            if (order && open_orders_.contains(handle)) {
+                order->last_update_timestamp = now;
+                updateStatus(handle, *order, Order::Status::CANCELLED);
+                ++cancelled;
+            }
         }
     }
+    writeEvicted();
+    return cancelled;
+}
+
+size_t OrderManager::cancelAll(const std::string& instrument, Order::Side side) {
+    assert(!on_request_thread && "cancelAll(instrument, side) would wait on its own request thread");
+    return cancelAllAsync(instrument, side).get();
+}
+
+std::future<size_t> OrderManager::cancelAllAsync(const std::string& instrument, Order::Side side) {
+    struct Batch {
+        std::promise<size_t> done;
+        std::atomic<size_t> remaining;
+        std::atomic<size_t> cancelled{0};
+    };
+    
+    std::vector<Order> orders = getOpenOrders(instrument, side);
+    auto batch = std::make_shared<Batch>();
+    std::future<size_t> future = batch->done.get_future();
+    if (orders.empty()) {
+        batch->done.set_value(0);
+        return future;
+    }
     
-    return success;
+    // The last ack to arrive resolves the batch, so no thread waits on it
+    batch->remaining = orders.size();
+    for (const Order& order : orders) {
+        cancelOrderAsync(order.label.empty() ? order.order_id : order.label, [batch](const OrderAck& ack) {
+            if (ack.success) ++batch->cancelled;
+            if (--batch->remaining == 0) batch->done.set_value(batch->cancelled.load());
+        });
+    }
+    return future;
 }
 
-bool OrderManager::modifyOrder(const std::string& order_id, 
-                             double new_price,
-                             double new_amount) {
-    // Call the API client to modify the order
-    bool success = api_client_->modifyOrder(order_id, new_price, new_amount);
+MassQuoteResult OrderManager::replaceQuotes(const std::string& instrument, const std::vector<QuoteLevel>& ladder) {
+    assert(!on_request_thread && "replaceQuotes would wait on its own request thread");
+    MassQuoteResult result;
+    std::vector<Order> live = getOpenOrders(instrument);
+    std::vector<std::future<OrderAck>> acks;
     
-    if (success) {
-        // Update the order
-        std::lock_guard<std::mutex> lock(orders_mutex_);
-        if (orders_.find(order_id) != orders_.end()) {
-            orders_[order_id].price = new_price;
-            orders_[order_id].amount = new_amount;
-            orders_[order_id].last_update_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+    for (Order::Side side : {Order::Side::BUY, Order::Side::SELL}) {
+        std::vector<QuoteLevel> levels;
+        for (const QuoteLevel& level : ladder) {
+            if (level.side == side) levels.push_back(level);
+        }
+        std::vector<const Order*> orders;
+        for (const Order& order : live) {
+            if (order.side == side) orders.push_back(&order);
+        }
+        
+        // Orders already quoting a wanted level are left alone
+        std::vector<QuoteLevel> unmatched;
+        for (const QuoteLevel& level : levels) {
+            auto same = std::find_if(orders.begin(), orders.end(), [&level](const Order* order) {
+                return order->price == level.price && order->amount == level.amount;
+            });
+            if (same != orders.end()) {
+                orders.erase(same);
+                ++result.kept;
+            } else {
+                unmatched.push_back(level);
+            }
+        }
+        
+        // Pair the rest best price first; orders without an exchange id can't be edited
+        bool bids = side == Order::Side::BUY;
+        auto better = [bids](double a, double b) { return bids ? a > b : a < b; };
+        std::sort(unmatched.begin(), unmatched.end(), [&better](const QuoteLevel& a, const QuoteLevel& b) {
+            return better(a.price, b.price);
+        });
+        std::sort(orders.begin(), orders.end(), [&better](const Order* a, const Order* b) {
+            return better(a->price, b->price);
+        });
+        
+        size_t next_level = 0;
+        for (const Order* order : orders) {
+            std::string ref = order->label.empty() ? order->order_id : order->label;
+            if (next_level < unmatched.size() && !order->order_id.empty()) {
+                const QuoteLevel& level = unmatched[next_level++];
+                acks.push_back(modifyOrderAsync(ref, level.price, level.amount));
+                ++result.modified;
+            } else {
+                acks.push_back(cancelOrderAsync(ref));
+                ++result.cancelled;
+            }
+        }
+        for (; next_level < unmatched.size(); ++next_level) {
+            const QuoteLevel& level = unmatched[next_level];
+            acks.push_back(placeOrderAsync(instrument, side, level.price, level.amount).ack);
+            ++result.placed;
         }
     }
     
-    return success;
+    for (auto& ack : acks) {
+        if (!ack.get().success) ++result.failed;
+    }
+    return result;
 }
 
 std::vector<Order> OrderManager::getAllOrders() const {
     std::vector<Order> result;
     
     std::lock_guard<std::mutex> lock(orders_mutex_);
-    result.reserve(orders_.size());
-    for (const auto& pair : orders_) {
-        result.push_back(pair.second);
-    }
+    result.reserve(orders_.size() + evicted_.size());
+    orders_.forEach([&result](OrderHandle, const Order& order) {
+        result.push_back(order);
+    });
+    result.insert(result.end(), evicted_.begin(), evicted_.end());
     
     // Sort by creation time (newest first)
     std::sort(result.begin(), result.end(), [](const Order& a, const Order& b) {
@@ -107,16 +498,47 @@ std::vector<Order> OrderManager::getAllOrders() const {
     return result;
 }
 
+std::vector<Order> OrderManager::getAllOrders(size_t offset, size_t limit) const {
+    std::vector<Order> result = getAllOrders();
+    std::shared_ptr<OrderArchive> archive;
+    {
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        archive = archive_;
+    }
+    
+    size_t in_memory = result.size();
+    if (offset >= in_memory) {
+        result.clear();
+    } else {
+        result.erase(result.begin(), result.begin() + offset);
+        if (result.size() > limit) result.resize(limit);
+    }
+    
+    // Continue into the archive for the rest of the page
+    if (archive && result.size() < limit) {
+        size_t skip = offset > in_memory ? offset - in_memory : 0;
+        for (Order& order : archive->readNewest(skip, limit - result.size())) {
+            result.push_back(std::move(order));
+        }
+    }
+    
+    return result;
+}
+
+void OrderManager::collectOpen(std::vector<Order>& result, OrderHandle handle) const {
+    if (const Order* order = orders_.get(handle)) {
+        result.push_back(*order);
+    }
+}
+
 std::vector<Order> OrderManager::getOpenOrders() const {
     std::vector<Order> result;
     
     std::lock_guard<std::mutex> lock(orders_mutex_);
-    for (const auto& pair : orders_) {
-        if (pair.second.status == Order::Status::OPEN || 
-            pair.second.status == Order::Status::PARTIALLY_FILLED) {
-            result.push_back(pair.second);
-        }
-    }
+    result.reserve(open_orders_.size());
+    open_orders_.forEach([this, &result](OrderHandle handle) {
+        collectOpen(result, handle);
+    });
     
     // Sort by creation time (newest first)
     std::sort(result.begin(), result.end(), [](const Order& a, const Order& b) {
@@ -126,10 +548,65 @@ std::vector<Order> OrderManager::getOpenOrders() const {
     return result;
 }
 
-Order OrderManager::getOrder(const std::string& order_id) const {
+std::vector<Order> OrderManager::getOpenOrders(const std::string& instrument) const {
+    std::vector<Order> result;
+    
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    result.reserve(open_orders_.count(instrument));
+    open_orders_.forEach(instrument, [this, &result](OrderHandle handle) {
+        collectOpen(result, handle);
+    });
+    
+    // Each side is already newest first; merge the two
+    std::stable_sort(result.begin(), result.end(), [](const Order& a, const Order& b) {
+        return a.creation_timestamp > b.creation_timestamp;
+    });
+    
+    return result;
+}
+
+std::vector<Order> OrderManager::getOpenOrders(const std::string& instrument, Order::Side side) const {
+    std::vector<Order> result;
+    
     std::lock_guard<std::mutex> lock(orders_mutex_);
-    if (orders_.find(order_id) != orders_.end()) {
-        return orders_.at(order_id);
+    result.reserve(open_orders_.count(instrument, side));
+    open_orders_.forEach(instrument, side, [this, &result](OrderHandle handle) {
+        collectOpen(result, handle);
+    });
+    
+    return result;
+}
+
+size_t OrderManager::openOrderCount(const std::string& instrument) const {
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    return open_orders_.count(instrument);
+}
+
+OrderHandle OrderManager::findHandle(const std::string& order_ref) const {
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    return findOrder(order_ref);
+}
+
+bool OrderManager::getOrderState(OrderHandle handle, OrderState& state) const {
+    return order_states_.read(handle, state);
+}
+
+Order OrderManager::getOrder(const std::string& order_id) const {
+    std::shared_ptr<OrderArchive> archive;
+    {
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        if (const Order* order = orders_.get(findOrder(order_id))) {
+            return *order;
+        }
+        for (const Order& order : evicted_) {
+            if (order.order_id == order_id || order.label == order_id) return order;
+        }
+        archive = archive_;
+    }
+    
+    Order archived;
+    if (archive && archive->find(order_id, archived)) {
+        return archived;
     }
     
     // Return an empty order with REJECTED status if not found
@@ -141,46 +618,137 @@ Order OrderManager::getOrder(const std::string& order_id) const {
 }
 
 std::map<std::string, double> OrderManager::getCurrentPositions() const {
-    std::lock_guard<std::mutex> lock(positions_mutex_);
-    return positions_;
+    return positions_->netPositions();
 }
 
 void OrderManager::onOrderUpdate(const std::string& order_data) {
     try {
         // Parse the order update JSON
-        json data = json::parse(order_data);
-        
-        // Extract order information
-        std::string order_id = data["order_id"].get<std::string>();
-        std::string status = data["state"].get<std::string>();
-        double filled_amount = data["filled_amount"].get<double>();
-        
-        // Update our order record
+        onOrderUpdate(json::parse(order_data));
+    } catch (const std::exception& e) {
+        std::cerr << "Error processing order update: " << e.what() << std::endl;
+    }
+}
+
+void OrderManager::onOrderUpdate(const json& data) {
+    // Aggregated channels deliver a batch
+    if (data.is_array()) {
+        for (const auto& order : data) {
+            onOrderUpdate(order);
+        }
+        return;
+    }
+    
+    // Extract order information
+    std::string order_id = data.at("order_id").get<std::string>();
+    std::string status = data.contains("order_state") ? data["order_state"].get<std::string>()
+                                                      : data.at("state").get<std::string>();
+    double filled_amount = data.at("filled_amount").get<double>();
+    
+    // Update our order record, binding the exchange id to orders we only know by label
+    {
         std::lock_guard<std::mutex> lock(orders_mutex_);
-        if (orders_.find(order_id) != orders_.end()) {
-            Order& order = orders_[order_id];
-            order.filled_amount = filled_amount;
+        OrderHandle handle = orders_.findById(order_id);
+        if (handle == OrderTable::kInvalidHandle && data.contains("label")) {
+            handle = orders_.findByLabel(data["label"].get<std::string>());
+            orders_.bindId(handle, order_id);
+        }
+        if (Order* found = orders_.get(handle)) {
+            Order& order = *found;
+            // Updates can arrive out of order; the fill only grows
+            order.filled_amount = std::max(order.filled_amount, filled_amount);
             order.last_update_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
             
             // Update status
-            if (status == "open") {
-                order.status = Order::Status::OPEN;
-            } else if (status == "filled") {
-                order.status = Order::Status::FILLED;
-            } else if (status == "cancelled") {
-                order.status = Order::Status::CANCELLED;
-            } else if (status == "rejected") {
-                order.status = Order::Status::REJECTED;
-                if (data.contains("error")) {
+            Order::Status new_status = parseOrderState(status, order.status);
+            if (status == "rejected") {
+                if (data.contains("error") && !isTerminalStatus(order.status)) {
                     order.error_message = data["error"].get<std::string>();
                 }
-            } else if (filled_amount > 0 && filled_amount < order.amount) {
-                order.status = Order::Status::PARTIALLY_FILLED;
+            } else if (!isTerminalStatus(new_status) && order.filled_amount > 0 && order.filled_amount < order.amount) {
+                new_status = Order::Status::PARTIALLY_FILLED;
             }
+            updateStatus(handle, order, new_status);
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Error processing order update: " << e.what() << std::endl;
     }
+    writeEvicted();
+}
+
+void OrderManager::onTradeUpdate(const json& data) {
+    if (data.is_array()) {
+        for (const auto& trade : data) {
+            onTradeUpdate(trade);
+        }
+        return;
+    }
+    
+    Trade trade;
+    trade.trade_id = data.value("trade_id", "");
+    trade.order_id = data.value("order_id", "");
+    trade.label = data.value("label", "");
+    trade.instrument = data.at("instrument_name").get<std::string>();
+    trade.side = data.at("direction").get<std::string>() == "buy" ? Order::Side::BUY : Order::Side::SELL;
+    trade.price = data.at("price").get<double>();
+    trade.amount = data.at("amount").get<double>();
+    trade.fee = data.value("fee", 0.0);
+    trade.timestamp = data.value("timestamp", int64_t(0));
+    
+    positions_->applyFill(trade);
+    
+    if (trade_callback_) {
+        trade_callback_(trade);
+    }
+}
+
+void OrderManager::onPortfolioUpdate(const json& data) {
+    Portfolio portfolio;
+    portfolio.currency = data.at("currency").get<std::string>();
+    portfolio.equity = data.value("equity", 0.0);
+    portfolio.balance = data.value("balance", 0.0);
+    portfolio.available_funds = data.value("available_funds", 0.0);
+    portfolio.margin_balance = data.value("margin_balance", 0.0);
+    portfolio.initial_margin = data.value("initial_margin", 0.0);
+    portfolio.maintenance_margin = data.value("maintenance_margin", 0.0);
+    portfolio.total_pl = data.value("total_pl", 0.0);
+    
+    std::lock_guard<std::mutex> lock(portfolio_mutex_);
+    portfolios_[portfolio.currency] = portfolio;
+}
+
+Portfolio OrderManager::getPortfolio(const std::string& currency) const {
+    std::lock_guard<std::mutex> lock(portfolio_mutex_);
+    auto it = portfolios_.find(currency);
+    if (it != portfolios_.end()) {
+        return it->second;
+    }
+    
+    Portfolio empty;
+    empty.currency = currency;
+    return empty;
+}
+
+void OrderManager::registerRoutes(MessageRouter& router) {
+    router.addRoute("user.orders.", [this](const std::string&, const json& data) {
+        onOrderUpdate(data);
+    });
+    router.addRoute("user.trades.", [this](const std::string&, const json& data) {
+        onTradeUpdate(data);
+    });
+    router.addRoute("user.portfolio.", [this](const std::string&, const json& data) {
+        onPortfolioUpdate(data);
+    });
+}
+
+void OrderManager::subscribePrivateChannels() {
+    api_client_->subscribeToChannels({
+        "user.orders.any.any.raw",
+        "user.trades.any.any.raw",
+        "user.portfolio.any"
+    }, true);
+}
+
+void OrderManager::setTradeCallback(TradeCallback callback) {
+    trade_callback_ = std::move(callback);
 }
 
 void OrderManager::onPositionUpdate(const std::string& position_data) {
@@ -188,18 +756,100 @@ void OrderManager::onPositionUpdate(const std::string& position_data) {
         // Parse the position update JSON
         json data = json::parse(position_data);
         
-        // Extract position information
+        // Reconcile the fill-driven positions with the exchange snapshot;
+        // instruments missing from it are flat
         if (data.is_array()) {
-            std::lock_guard<std::mutex> lock(positions_mutex_);
-            positions_.clear();
+            std::map<std::string, double> stale = positions_->netPositions();
             
             for (const auto& position : data) {
                 std::string instrument = position["instrument_name"].get<std::string>();
                 double size = position["size"].get<double>();
-                positions_[instrument] = size;
+                double average_price = position.value("average_price", positions_->position(instrument).average_price);
+                positions_->setPosition(instrument, size, average_price);
+                stale.erase(instrument);
+            }
+            
+            for (const auto& pair : stale) {
+                positions_->setPosition(pair.first, 0.0, 0.0);
             }
         }
     } catch (const std::exception& e) {
         std::cerr << "Error processing position update: " << e.what() << std::endl;
     }
+}
+
+void OrderManager::setArchiveHandler(ArchiveHandler handler) {
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    archive_handler_ = std::move(handler);
+}
+
+void OrderManager::setArchive(std::shared_ptr<OrderArchive> archive) {
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    archive_ = std::move(archive);
+}
+
+void OrderManager::setRiskEngine(std::shared_ptr<RiskEngine> risk) {
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    risk_ = std::move(risk);
+}
+
+void OrderManager::updateStatus(OrderHandle handle, Order& order, Order::Status status) {
+    // Terminal statuses are final: a late ack or stale update can't reopen the order
+    if (isTerminalStatus(order.status)) {
+        order_states_.publish(handle, order);
+        return;
+    }
+    order.status = status;
+    order_states_.publish(handle, order);
+    
+    if (isOpenStatus(status)) {
+        if (!open_orders_.contains(handle)) {
+            open_orders_.add(handle, order.instrument, order.side);
+        }
+        return;
+    }
+    
+    open_orders_.remove(handle);
+    if (!isTerminalStatus(status)) return;
+    
+    // Terminal orders stay queryable until they age out of the history ring
+    history_.push_back(handle);
+    while (history_.size() > history_capacity_) {
+        OrderHandle oldest = history_.front();
+        history_.pop_front();
+        
+        const Order* evicted = orders_.get(oldest);
+        if (!evicted) continue;
+        
+        if (archive_ || archive_handler_) {
+            evicted_.push_back(*evicted);
+            evicted_pending_.store(evicted_.size(), std::memory_order_release);
+        }
+        orders_.erase(oldest);
+    }
+}
+
+void OrderManager::writeEvicted() {
+    if (evicted_pending_.load(std::memory_order_acquire) == 0) return;
+    
+    std::lock_guard<std::mutex> writer(archive_write_mutex_);
+    std::vector<Order> batch;
+    std::shared_ptr<OrderArchive> archive;
+    ArchiveHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        batch.assign(evicted_.begin(), evicted_.end());
+        archive = archive_;
+        handler = archive_handler_;
+    }
+    
+    for (const Order& order : batch) {
+        if (archive) archive->append(order);
+        if (handler) handler(order);
+    }
+    
+    // Dropped from the queue only once written, so lookups never miss them
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    evicted_.erase(evicted_.begin(), evicted_.begin() + batch.size());
+    evicted_pending_.store(evicted_.size(), std::memory_order_release);
 }
\ No newline at end of file
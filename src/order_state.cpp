@@ -0,0 +1,52 @@
+#include "order_state.h"
+
+#include <iostream>
+
+OrderStateTable::OrderStateTable()
+    : chunks_(new std::atomic<Slot*>[kMaxChunks]) {
+    for (size_t i = 0; i < kMaxChunks; ++i) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+OrderStateTable::~OrderStateTable() {
+    for (size_t i = 0; i < kMaxChunks; ++i) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+void OrderStateTable::publish(OrderHandle handle, const Order& order) {
+    uint32_t slot = OrderTable::slotOf(handle);
+    size_t index = slot >> kChunkShift;
+    if (index >= kMaxChunks) {
+        std::cerr << "Order slot " << slot << " beyond order state capacity" << std::endl;
+        return;
+    }
+    
+    Slot* chunk = chunks_[index].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Slot[kChunkSize];
+        chunks_[index].store(chunk, std::memory_order_release);
+    }
+    
+    OrderState state;
+    state.handle = handle;
+    state.status = order.status;
+    state.price = order.price;
+    state.amount = order.amount;
+    state.filled_amount = order.filled_amount;
+    state.last_update_timestamp = order.last_update_timestamp;
+    chunk[slot & (kChunkSize - 1)].store(state);
+}
+
+bool OrderStateTable::read(OrderHandle handle, OrderState& state) const {
+    uint32_t slot = OrderTable::slotOf(handle);
+    size_t index = slot >> kChunkShift;
+    if (index >= kMaxChunks) return false;
+    
+    const Slot* chunk = chunks_[index].load(std::memory_order_acquire);
+    if (!chunk) return false;
+    
+    state = chunk[slot & (kChunkSize - 1)].load();
+    return state.handle == handle && handle != OrderTable::kInvalidHandle;
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "order_table.h"
+
+#include <functional>
+
+uint32_t OrderTable::Index::find(const OrderTable& table, const std::string& key) const {
+    size_t hash = std::hash<std::string>()(key);
+    size_t mask = buckets_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Bucket& bucket = buckets_[i];
+        if (bucket.slot == kEmpty) return kEmpty;
+        if (bucket.slot != kTombstone && bucket.hash == hash &&
+            table.entryAt(bucket.slot).order.*key_ == key) {
+            return bucket.slot;
+        }
+    }
+}
+
+void OrderTable::Index::insert(const OrderTable& table, const std::string& key, uint32_t slot) {
+    // Keep the load factor (including tombstones) under 70%
+    if ((used_ + 1) * 10 > buckets_.size() * 7) {
+        grow();
+    }
+    
+    size_t hash = std::hash<std::string>()(key);
+    size_t mask = buckets_.size() - 1;
+    Bucket* reusable = nullptr;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Bucket& bucket = buckets_[i];
+        if (bucket.slot == kEmpty) {
+            if (!reusable) {
+                reusable = &bucket;
+                ++used_;
+            }
+            break;
+        }
+        if (bucket.slot == kTombstone) {
+            if (!reusable) reusable = &bucket;
+        } else if (bucket.hash == hash && table.entryAt(bucket.slot).order.*key_ == key) {
+            // Key already indexed: point it at the new slot
+            bucket.slot = slot;
+            return;
+        }
+    }
+    reusable->hash = hash;
+    reusable->slot = slot;
+}
+
+void OrderTable::Index::erase(const std::string& key, uint32_t slot) {
+    size_t hash = std::hash<std::string>()(key);
+    size_t mask = buckets_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Bucket& bucket = buckets_[i];
+        if (bucket.slot == kEmpty) return;
+        if (bucket.slot == slot && bucket.hash == hash) {
+            bucket.slot = kTombstone;
+            return;
+        }
+    }
+}
+
+void OrderTable::Index::grow() {
+    std::vector<Bucket> old;
+    old.swap(buckets_);
+    
+    size_t live = 0;
+    for (const Bucket& bucket : old) {
+        if (bucket.slot != kEmpty && bucket.slot != kTombstone) ++live;
+    }
+    
+    // Rehash to at most 50% load, dropping tombstones
+    size_t size = old.size();
+    while ((live + 1) * 2 > size) {
+        size *= 2;
+    }
+    buckets_.assign(size, Bucket());
+    used_ = live;
+    
+    size_t mask = size - 1;
+    for (const Bucket& bucket : old) {
+        if (bucket.slot == kEmpty || bucket.slot == kTombstone) continue;
+        size_t i = bucket.hash & mask;
+        while (buckets_[i].slot != kEmpty) {
+            i = (i + 1) & mask;
+        }
+        buckets_[i] = bucket;
+    }
+}
+
+OrderTable::OrderTable()
+    : by_id_(&Order::order_id),
+      by_label_(&Order::label) {
+}
+
+OrderHandle OrderTable::insert(Order order, InstrumentId instrument_id) {
+    uint32_t slot;
+    if (!free_slots_.empty()) {
+        // Reuse LIFO so recently touched memory is handed out first
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        if ((slot_count_ & (kChunkSize - 1)) == 0) {
+            chunks_.push_back(std::make_unique<Entry[]>(kChunkSize));
+        }
+        slot = slot_count_++;
+    }
+    
+    Entry& entry = entryAt(slot);
+    entry.order = std::move(order);
+    entry.instrument_id = instrument_id;
+    entry.live = true;
+    ++size_;
+    
+    if (!entry.order.order_id.empty()) {
+        by_id_.insert(*this, entry.order.order_id, slot);
+    }
+    if (!entry.order.label.empty()) {
+        by_label_.insert(*this, entry.order.label, slot);
+    }
+    
+    return handleOf(slot);
+}
+
+bool OrderTable::erase(OrderHandle handle) {
+    if (!resolve(handle)) return false;
+    
+    uint32_t slot = slotOf(handle);
+    Entry& entry = entryAt(slot);
+    if (!entry.order.order_id.empty()) {
+        by_id_.erase(entry.order.order_id, slot);
+    }
+    if (!entry.order.label.empty()) {
+        by_label_.erase(entry.order.label, slot);
+    }
+    
+    entry.order = Order();
+    entry.instrument_id = kNoInstrument;
+    entry.live = false;
+    
+    // Bump the generation, skipping 0 so no live handle equals kInvalidHandle
+    if (++entry.generation == 0) {
+        entry.generation = 1;
+    }
+    
+    free_slots_.push_back(slot);
+    --size_;
+    return true;
+}
+
+const OrderTable::Entry* OrderTable::resolve(OrderHandle handle) const {
+    uint32_t slot = slotOf(handle);
+    if (slot >= slot_count_) return nullptr;
+    
+    const Entry& entry = entryAt(slot);
+    if (!entry.live || entry.generation != generationOf(handle)) return nullptr;
+    return &entry;
+}
+
+Order* OrderTable::get(OrderHandle handle) {
+    const Entry* entry = resolve(handle);
+    return entry ? const_cast<Order*>(&entry->order) : nullptr;
+}
+
+const Order* OrderTable::get(OrderHandle handle) const {
+    const Entry* entry = resolve(handle);
+    return entry ? &entry->order : nullptr;
+}
+
+InstrumentId OrderTable::instrumentIdOf(OrderHandle handle) const {
+    const Entry* entry = resolve(handle);
+    return entry ? entry->instrument_id : kNoInstrument;
+}
+
+OrderHandle OrderTable::findById(const std::string& order_id) const {
+    uint32_t slot = by_id_.find(*this, order_id);
+    return slot < slot_count_ ? handleOf(slot) : kInvalidHandle;
+}
+
+OrderHandle OrderTable::findByLabel(const std::string& label) const {
+    uint32_t slot = by_label_.find(*this, label);
+    return slot < slot_count_ ? handleOf(slot) : kInvalidHandle;
+}
+
+bool OrderTable::bindId(OrderHandle handle, const std::string& order_id) {
+    if (!resolve(handle)) return false;
+    
+    uint32_t slot = slotOf(handle);
+    Order& order = entryAt(slot).order;
+    if (order.order_id == order_id) return true;
+    
+    if (!order.order_id.empty()) {
+        by_id_.erase(order.order_id, slot);
+    }
+    order.order_id = order_id;
+    if (!order.order_id.empty()) {
+        by_id_.insert(*this, order.order_id, slot);
+    }
+    return true;
+}
\ No newline at end of file
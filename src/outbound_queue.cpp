@@ -0,0 +1,80 @@
+#include "outbound_queue.h"
+
+#include <algorithm>
+#include <vector>
+
+void OutboundQueue::push(std::string frame, OutboundPriority priority, const std::string& order_key) {
+    size_t lane = static_cast<size_t>(priority);
+    
+    if (!order_key.empty()) {
+        KeyCounts& counts = pending_[order_key];
+        bool behind_lower = false;
+        for (size_t lower = lane + 1; lower < kLanes; ++lower) {
+            behind_lower |= counts[lower] > 0;
+        }
+        if (behind_lower) {
+            promote(order_key, lane);
+        }
+        ++counts[lane];
+    }
+    
+    lanes_[lane].push_back(Entry{std::move(frame), order_key, next_sequence_++});
+    ++size_;
+}
+
+void OutboundQueue::promote(const std::string& order_key, size_t lane) {
+    KeyCounts& counts = pending_[order_key];
+    std::vector<Entry> moved;
+    
+    for (size_t lower = lane + 1; lower < kLanes; ++lower) {
+        if (counts[lower] == 0) continue;
+        
+        std::deque<Entry>& queue = lanes_[lower];
+        auto keep = std::stable_partition(queue.begin(), queue.end(), [&order_key](const Entry& entry) {
+            return entry.order_key != order_key;
+        });
+        std::move(keep, queue.end(), std::back_inserter(moved));
+        queue.erase(keep, queue.end());
+        counts[lane] += counts[lower];
+        counts[lower] = 0;
+    }
+    
+    // Frames already in the lane for other orders stay ahead; these go to the back in submission order
+    std::sort(moved.begin(), moved.end(), [](const Entry& a, const Entry& b) {
+        return a.sequence < b.sequence;
+    });
+    for (Entry& entry : moved) {
+        lanes_[lane].push_back(std::move(entry));
+    }
+}
+
+bool OutboundQueue::pop(std::string& frame) {
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+        std::deque<Entry>& queue = lanes_[lane];
+        if (queue.empty()) continue;
+        
+        Entry& entry = queue.front();
+        if (!entry.order_key.empty()) {
+            auto it = pending_.find(entry.order_key);
+            if (it != pending_.end() && --it->second[lane] == 0) {
+                const KeyCounts& counts = it->second;
+                if (std::all_of(counts.begin(), counts.end(), [](uint32_t count) { return count == 0; })) {
+                    pending_.erase(it);
+                }
+            }
+        }
+        frame = std::move(entry.frame);
+        queue.pop_front();
+        --size_;
+        return true;
+    }
+    return false;
+}
+
+OutboundPriority OutboundQueue::priorityFor(const std::string& method) {
+    if (method.compare(0, 14, "private/cancel") == 0) return OutboundPriority::CANCEL;
+    if (method == "private/edit" || method == "private/edit_by_label") return OutboundPriority::MODIFY;
+    if (method == "private/buy" || method == "private/sell") return OutboundPriority::NEW_ORDER;
+    if (method.find("subscribe") != std::string::npos) return OutboundPriority::SUBSCRIPTION;
+    return OutboundPriority::QUERY;
+}
\ No newline at end of file
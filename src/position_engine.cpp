@@ -0,0 +1,208 @@
+#include "position_engine.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+namespace {
+
+// PnL of size contracts entered at entry and closed at exit
+double pnl(const PositionState& state, double size, double entry, double exit) {
+    if (state.contract == ContractKind::INVERSE) {
+        return entry > 0.0 && exit > 0.0 ? size * (1.0 / entry - 1.0 / exit) : 0.0;
+    }
+    return size * (exit - entry);
+}
+
+void markToMarket(PositionState& state) {
+    state.unrealized_pnl = state.mark_price > 0.0 && state.size != 0.0
+        ? pnl(state, state.size, state.average_price, state.mark_price)
+        : 0.0;
+}
+
+} // namespace
+
+PositionEngine::PositionEngine()
+    : slots_(new Slot[kMaxInstruments]),
+      names_(new std::string[kMaxInstruments]),
+      lookup_(new std::atomic<InstrumentId>[kLookupSize]) {
+    for (size_t i = 0; i < kLookupSize; ++i) {
+        lookup_[i].store(kInvalidInstrument, std::memory_order_relaxed);
+    }
+    working_.reserve(64);
+}
+
+InstrumentId PositionEngine::instrumentId(const std::string& instrument) {
+    InstrumentId id = findInstrument(instrument);
+    if (id != kInvalidInstrument) {
+        return id;
+    }
+    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    
+    // Another writer may have registered it since the lookup
+    id = findInstrument(instrument);
+    if (id != kInvalidInstrument) {
+        return id;
+    }
+    
+    uint32_t count = count_.load(std::memory_order_relaxed);
+    if (count >= kMaxInstruments) {
+        std::cerr << "Position engine full, ignoring instrument " << instrument << std::endl;
+        return kInvalidInstrument;
+    }
+    
+    id = count;
+    names_[id] = instrument;
+    working_.emplace_back();
+    working_.back().contract = defaultContractKind(instrument);
+    publish(id, working_.back());
+    
+    size_t mask = kLookupSize - 1;
+    size_t i = std::hash<std::string>()(instrument) & mask;
+    while (lookup_[i].load(std::memory_order_relaxed) != kInvalidInstrument) {
+        i = (i + 1) & mask;
+    }
+    lookup_[i].store(id, std::memory_order_release);
+    count_.store(count + 1, std::memory_order_release);
+    return id;
+}
+
+InstrumentId PositionEngine::findInstrument(const std::string& instrument) const {
+    size_t mask = kLookupSize - 1;
+    for (size_t i = std::hash<std::string>()(instrument) & mask;; i = (i + 1) & mask) {
+        InstrumentId id = lookup_[i].load(std::memory_order_acquire);
+        if (id == kInvalidInstrument) return kInvalidInstrument;
+        if (names_[id] == instrument) return id;
+    }
+}
+
+ContractKind PositionEngine::defaultContractKind(const std::string& instrument) {
+    bool stable_margined = instrument.find("_USDC") != std::string::npos ||
+                           instrument.find("_USDT") != std::string::npos;
+    return stable_margined ? ContractKind::LINEAR : ContractKind::INVERSE;
+}
+
+void PositionEngine::setContractKind(const std::string& instrument, ContractKind kind) {
+    InstrumentId id = instrumentId(instrument);
+    if (id == kInvalidInstrument) return;
+    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    PositionState& state = working_[id];
+    state.contract = kind;
+    markToMarket(state);
+    publish(id, state);
+}
+
+void PositionEngine::publish(InstrumentId id, const PositionState& state) {
+    slots_[id].state.store(state);
+    slots_[id].net.store(state.size, std::memory_order_release);
+}
+
+void PositionEngine::applyFill(const Trade& trade) {
+    InstrumentId id = instrumentId(trade.instrument);
+    if (id == kInvalidInstrument || trade.amount <= 0.0) return;
+    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    PositionState& state = working_[id];
+    double quantity = trade.side == Order::Side::BUY ? trade.amount : -trade.amount;
+    
+    if (state.size == 0.0 || (state.size > 0.0) == (quantity > 0.0)) {
+        // Opening or adding: size-weighted entry; harmonic for inverse contracts,
+        // where each contract is a fixed quote amount
+        double total = std::fabs(state.size) + std::fabs(quantity);
+        if (state.contract == ContractKind::INVERSE && state.size != 0.0) {
+            state.average_price = total / (std::fabs(state.size) / state.average_price + std::fabs(quantity) / trade.price);
+        } else {
+            state.average_price = (state.average_price * std::fabs(state.size) + trade.price * std::fabs(quantity)) / total;
+        }
+        state.size += quantity;
+    } else {
+        // Reducing: realize PnL on the closed part; a flip opens the remainder at the fill price
+        double closed = std::min(std::fabs(quantity), std::fabs(state.size));
+        double direction = state.size > 0.0 ? 1.0 : -1.0;
+        state.realized_pnl += pnl(state, closed * direction, state.average_price, trade.price);
+        
+        double remaining = state.size + quantity;
+        if (std::fabs(remaining) < 1e-12) {
+            state.size = 0.0;
+            state.average_price = 0.0;
+        } else {
+            if ((remaining > 0.0) != (state.size > 0.0)) {
+                state.average_price = trade.price;
+            }
+            state.size = remaining;
+        }
+    }
+    
+    state.fees += trade.fee;
+    state.last_update_timestamp = trade.timestamp ? trade.timestamp
+        : std::chrono::system_clock::now().time_since_epoch().count();
+    markToMarket(state);
+    publish(id, state);
+}
+
+void PositionEngine::updateMark(const std::string& instrument, double mark_price) {
+    InstrumentId id = instrumentId(instrument);
+    if (id == kInvalidInstrument || mark_price <= 0.0) return;
+    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    PositionState& state = working_[id];
+    state.mark_price = mark_price;
+    markToMarket(state);
+    publish(id, state);
+}
+
+void PositionEngine::setPosition(const std::string& instrument, double size, double average_price) {
+    InstrumentId id = instrumentId(instrument);
+    if (id == kInvalidInstrument) return;
+    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    PositionState& state = working_[id];
+    state.size = size;
+    state.average_price = size != 0.0 ? average_price : 0.0;
+    state.last_update_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+    markToMarket(state);
+    publish(id, state);
+}
+
+PositionState PositionEngine::position(InstrumentId id) const {
+    if (id >= count_.load(std::memory_order_acquire)) return PositionState();
+    return slots_[id].state.load();
+}
+
+PositionState PositionEngine::position(const std::string& instrument) const {
+    return position(findInstrument(instrument));
+}
+
+std::map<std::string, double> PositionEngine::netPositions() const {
+    std::map<std::string, double> result;
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    uint32_t count = count_.load(std::memory_order_relaxed);
+    for (InstrumentId id = 0; id < count; ++id) {
+        if (working_[id].size != 0.0) {
+            result[names_[id]] = working_[id].size;
+        }
+    }
+    return result;
+}
+
+double PositionEngine::totalRealizedPnl() const {
+    double total = 0.0;
+    uint32_t count = count_.load(std::memory_order_acquire);
+    for (InstrumentId id = 0; id < count; ++id) {
+        total += slots_[id].state.load().realized_pnl;
+    }
+    return total;
+}
+
+double PositionEngine::totalUnrealizedPnl() const {
+    double total = 0.0;
+    uint32_t count = count_.load(std::memory_order_acquire);
+    for (InstrumentId id = 0; id < count; ++id) {
+        total += slots_[id].state.load().unrealized_pnl;
+    }
+    return total;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "replay_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+ReplayEngine::ReplayEngine(std::vector<std::string> files)
+    : files_(std::move(files)) {
+}
+
+void ReplayEngine::setTarget(MarketDataClient& market_data) {
+    handler_ = [&market_data](const std::string& frame, int64_t) {
+        market_data.processMessage(frame);
+    };
+}
+
+void ReplayEngine::setTarget(std::shared_ptr<MessageRouter> router) {
+    handler_ = [router](const std::string& frame, int64_t) {
+        router->route(frame);
+    };
+}
+
+void ReplayEngine::setHandler(FrameHandler handler) {
+    handler_ = std::move(handler);
+}
+
+int64_t ReplayEngine::pace(int64_t start_ns, int64_t offset_ns) const {
+    int64_t due = start_ns + offset_ns;
+    int64_t now = steadyNs();
+    
+    // Sleep through long gaps, spin the last stretch for accuracy
+    while (now < due && !stopping_) {
+        int64_t remaining = due - now;
+        if (remaining > 200000) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - 100000));
+        }
+        now = steadyNs();
+    }
+    return now - due;
+}
+
+ReplayStats ReplayEngine::run(const ReplayOptions& options) {
+    ReplayStats stats;
+    stopping_ = false;
+    if (!handler_) {
+        std::cerr << "Replay has no target" << std::endl;
+        return stats;
+    }
+    
+    std::string frame;  // reused so replay doesn't allocate per frame
+    int64_t first_ns = 0;
+    int64_t last_ns = 0;
+    int64_t start_ns = steadyNs();
+    
+    for (const std::string& path : files_) {
+        JournalReader reader(path);
+        JournalRecord record;
+        while (!stopping_ && reader.next(record)) {
+            if (stats.frames == 0) {
+                first_ns = record.realtime_ns;
+            }
+            last_ns = record.realtime_ns;
+            
+            if (options.speed > 0.0) {
+                int64_t offset = static_cast<int64_t>((record.realtime_ns - first_ns) / options.speed);
+                stats.max_lag_ns = std::max(stats.max_lag_ns, pace(start_ns, offset));
+            }
+            
+            frame.assign(record.frame.data(), record.frame.size());
+            handler_(frame, record.realtime_ns);
+            
+            stats.bytes += frame.size();
+            if (++stats.frames == options.max_frames) {
+                stopping_ = true;
+            }
+        }
+        if (stopping_) break;
+    }
+    
+    stats.elapsed_ns = steadyNs() - start_ns;
+    stats.recorded_ns = last_ns - first_ns;
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "risk_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+RiskEngine::RiskEngine(std::shared_ptr<PositionEngine> positions)
+    : positions_(std::move(positions)),
+      rows_(new Row[PositionEngine::kMaxInstruments]),
+      limits_(PositionEngine::kMaxInstruments),
+      explicit_(PositionEngine::kMaxInstruments, false) {
+}
+
+void RiskEngine::storeLimits(InstrumentId id, const RiskLimits& limits) {
+    Row& row = rows_[id];
+    limits_[id] = limits;
+    row.max_order_size.store(limits.max_order_size, std::memory_order_relaxed);
+    row.max_notional.store(limits.max_notional, std::memory_order_relaxed);
+    row.max_position.store(limits.max_position, std::memory_order_relaxed);
+    row.max_open_orders.store(limits.max_open_orders, std::memory_order_relaxed);
+    refreshBand(id);
+}
+
+void RiskEngine::refreshBand(InstrumentId id) {
+    Row& row = rows_[id];
+    double mid = row.mid.load(std::memory_order_relaxed);
+    double band = limits_[id].price_band;
+    
+    // Without a mid or a band every price passes
+    if (mid <= 0.0 || band <= 0.0) {
+        row.band_low.store(0.0, std::memory_order_relaxed);
+        row.band_high.store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+        return;
+    }
+    row.band_low.store(mid * (1.0 - band), std::memory_order_relaxed);
+    row.band_high.store(mid * (1.0 + band), std::memory_order_relaxed);
+}
+
+void RiskEngine::setDefaultLimits(const RiskLimits& limits) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    default_limits_ = limits;
+    for (InstrumentId id = 0; id < PositionEngine::kMaxInstruments; ++id) {
+        if (!explicit_[id]) {
+            storeLimits(id, limits);
+        }
+    }
+}
+
+void RiskEngine::setLimits(const std::string& instrument, const RiskLimits& limits) {
+    InstrumentId id = instrumentId(instrument);
+    if (id == PositionEngine::kInvalidInstrument) return;
+    
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    explicit_[id] = true;
+    storeLimits(id, limits);
+}
+
+RiskLimits RiskEngine::limits(const std::string& instrument) const {
+    InstrumentId id = positions_->findInstrument(instrument);
+    
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return id < PositionEngine::kMaxInstruments ? limits_[id] : default_limits_;
+}
+
+void RiskEngine::setThrottle(uint32_t max_messages, int64_t window_ns) {
+    if (max_messages == 0 || window_ns <= 0) {
+        throttle_interval_.store(0, std::memory_order_relaxed);
+        return;
+    }
+    int64_t interval = std::max<int64_t>(window_ns / max_messages, 1);
+    throttle_tolerance_.store(window_ns - interval, std::memory_order_relaxed);
+    throttle_tat_.store(0, std::memory_order_relaxed);
+    throttle_interval_.store(interval, std::memory_order_relaxed);
+}
+
+void RiskEngine::updateMid(const std::string& instrument, double mid) {
+    InstrumentId id = instrumentId(instrument);
+    if (id == PositionEngine::kInvalidInstrument) return;
+    
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    rows_[id].mid.store(mid, std::memory_order_relaxed);
+    refreshBand(id);
+}
+
+RiskResult RiskEngine::reject(RiskResult reason) {
+    rejected_[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+    return reason;
+}
+
+RiskResult RiskEngine::check(const RiskOrder& order, int64_t now_ns) {
+    if (order.instrument >= PositionEngine::kMaxInstruments) {
+        return reject(RiskResult::UNKNOWN_INSTRUMENT);
+    }
+    const Row& row = rows_[order.instrument];
+    bool limit = order.type == Order::Type::LIMIT;
+    
+    if (order.amount > row.max_order_size.load(std::memory_order_relaxed)) {
+        return reject(RiskResult::ORDER_SIZE);
+    }
+    
+    // Market orders are valued at the mid; without one a notional limit can't be enforced
+    double max_notional = row.max_notional.load(std::memory_order_relaxed);
+    double price = order.price;
+    if (!limit) {
+        price = row.mid.load(std::memory_order_relaxed);
+        if (price <= 0.0 && max_notional < std::numeric_limits<double>::infinity()) {
+            return reject(RiskResult::NO_MID);
+        }
+    }
+    if (price * order.amount > max_notional) {
+        return reject(RiskResult::NOTIONAL);
+    }
+    
+    if (limit && (order.price < row.band_low.load(std::memory_order_relaxed) ||
+                  order.price > row.band_high.load(std::memory_order_relaxed))) {
+        return reject(RiskResult::PRICE_BAND);
+    }
+    
+    if (order.open_orders >= row.max_open_orders.load(std::memory_order_relaxed)) {
+        return reject(RiskResult::OPEN_ORDERS);
+    }
+    
+    // Orders that shrink the position are always allowed
+    double net = positions_->netPosition(order.instrument);
+    double projected = std::fabs(net + (order.side == Order::Side::BUY ? order.amount : -order.amount));
+    if (projected > row.max_position.load(std::memory_order_relaxed) && projected > std::fabs(net)) {
+        return reject(RiskResult::POSITION);
+    }
+    
+    // Last, so only orders that pass everything else spend a credit
+    int64_t interval = throttle_interval_.load(std::memory_order_relaxed);
+    if (interval > 0) {
+        int64_t tolerance = throttle_tolerance_.load(std::memory_order_relaxed);
+        int64_t tat = throttle_tat_.load(std::memory_order_relaxed);
+        int64_t next;
+        do {
+            int64_t start = std::max(tat, now_ns);
+            if (start - now_ns > tolerance) {
+                return reject(RiskResult::THROTTLED);
+            }
+            next = start + interval;
+        } while (!throttle_tat_.compare_exchange_weak(tat, next, std::memory_order_relaxed));
+    }
+    
+    return RiskResult::ACCEPTED;
+}
+
+RiskResult RiskEngine::check(const RiskOrder& order) {
+    return check(order, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t RiskEngine::rejectedCount(RiskResult reason) const {
+    return rejected_[static_cast<size_t>(reason)].load(std::memory_order_relaxed);
+}
+
+const char* RiskEngine::describe(RiskResult result) {
+    switch (result) {
+        case RiskResult::ACCEPTED: return "accepted";
+        case RiskResult::ORDER_SIZE: return "order size limit";
+        case RiskResult::NOTIONAL: return "notional limit";
+        case RiskResult::PRICE_BAND: return "price outside band";
+        case RiskResult::OPEN_ORDERS: return "open order limit";
+        case RiskResult::POSITION: return "position limit";
+        case RiskResult::THROTTLED: return "message rate limit";
+        case RiskResult::NO_MID: return "no mid price to value market order";
+        case RiskResult::UNKNOWN_INSTRUMENT: return "unknown instrument";
+    }
+    return "unknown";
+}
\ No newline at end of file
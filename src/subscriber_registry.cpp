@@ -0,0 +1,122 @@
+#include "subscriber_registry.h"
+
+#include <algorithm>
+#include <functional>
+
+SubscriberBitset::SubscriberBitset(size_t worker_count, size_t slots_per_worker)
+    : worker_count_(std::max<size_t>(worker_count, 1)),
+      words_per_worker_(std::max<size_t>(slots_per_worker / 64, 1)),
+      words_(new std::atomic<uint64_t>[worker_count_ * words_per_worker_]),
+      worker_counts_(new std::atomic<uint32_t>[worker_count_]) {
+    for (size_t i = 0; i < worker_count_ * words_per_worker_; ++i) {
+        words_[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < worker_count_; ++i) {
+        worker_counts_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool SubscriberBitset::set(uint32_t slot) {
+    uint64_t mask = uint64_t(1) << (slot % 64);
+    if (words_[slot / 64].fetch_or(mask, std::memory_order_acq_rel) & mask) {
+        return false;
+    }
+    
+    worker_counts_[slot / 64 / words_per_worker_].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool SubscriberBitset::reset(uint32_t slot) {
+    uint64_t mask = uint64_t(1) << (slot % 64);
+    if (!(words_[slot / 64].fetch_and(~mask, std::memory_order_acq_rel) & mask)) {
+        return false;
+    }
+    
+    worker_counts_[slot / 64 / words_per_worker_].fetch_sub(1, std::memory_order_relaxed);
+    count_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool SubscriberBitset::test(uint32_t slot) const {
+    return (word(slot / 64) >> (slot % 64)) & 1;
+}
+
+SubscriberRegistry::SubscriberRegistry(size_t worker_count, size_t slots_per_worker, size_t shard_count)
+    : worker_count_(std::max<size_t>(worker_count, 1)),
+      slots_per_worker_(slots_per_worker) {
+    shard_count = std::max<size_t>(shard_count, 1);
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        auto shard = std::make_unique<Shard>();
+        shard->map = std::make_shared<const Map>();
+        shards_.push_back(std::move(shard));
+    }
+}
+
+void SubscriberRegistry::add(uint32_t slot, const std::vector<std::string>& instruments) {
+    for (const auto& instrument : instruments) {
+        // Bits change under the shard lock so an entry can't be dropped between
+        // lookup and set; broadcast readers still never lock
+        Shard& shard = *shards_[shardIndex(instrument)];
+        std::lock_guard<std::mutex> lock(shard.write_mutex);
+        findOrCreate(shard, instrument)->set(slot);
+    }
+}
+
+void SubscriberRegistry::remove(uint32_t slot, const std::vector<std::string>& instruments) {
+    for (const auto& instrument : instruments) {
+        Shard& shard = *shards_[shardIndex(instrument)];
+        std::lock_guard<std::mutex> lock(shard.write_mutex);
+        
+        std::shared_ptr<const Map> current = std::atomic_load(&shard.map);
+        auto it = current->find(instrument);
+        if (it == current->end() || !it->second->reset(slot) || !it->second->empty()) {
+            continue;
+        }
+        
+        // Last subscriber left: publish a copy without the entry so the map only
+        // holds instruments someone is subscribed to
+        auto next = std::make_shared<Map>(*current);
+        next->erase(instrument);
+        std::atomic_store(&shard.map, std::shared_ptr<const Map>(std::move(next)));
+    }
+}
+
+SubscriberRegistry::SubscriberSetPtr SubscriberRegistry::subscribers(const std::string& instrument) const {
+    return find(instrument);
+}
+
+size_t SubscriberRegistry::instrumentCount() const {
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        count += std::atomic_load(&shard->map)->size();
+    }
+    return count;
+}
+
+size_t SubscriberRegistry::shardIndex(const std::string& instrument) const {
+    return std::hash<std::string>()(instrument) % shards_.size();
+}
+
+std::shared_ptr<SubscriberBitset> SubscriberRegistry::find(const std::string& instrument) const {
+    std::shared_ptr<const Map> map = std::atomic_load(&shards_[shardIndex(instrument)]->map);
+    auto it = map->find(instrument);
+    return it != map->end() ? it->second : nullptr;
+}
+
+std::shared_ptr<SubscriberBitset> SubscriberRegistry::findOrCreate(Shard& shard, const std::string& instrument) {
+    // First subscriber for this instrument: copy the shard map and publish the new entry
+    std::shared_ptr<const Map> current = std::atomic_load(&shard.map);
+    auto it = current->find(instrument);
+    if (it != current->end()) {
+        return it->second;
+    }
+    
+    auto subscribers = std::make_shared<SubscriberBitset>(worker_count_, slots_per_worker_);
+    auto next = std::make_shared<Map>(*current);
+    next->emplace(instrument, subscribers);
+    std::atomic_store(&shard.map, std::shared_ptr<const Map>(std::move(next)));
+    
+    return subscribers;
+}
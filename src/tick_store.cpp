@@ -0,0 +1,463 @@
+#include "tick_store.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// Include JSON library
+#define NLOHMANN_JSON_VERSION_MAJOR 3
+#define NLOHMANN_JSON_VERSION_MINOR 11
+#define NLOHMANN_JSON_VERSION_PATCH 2
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr uint32_t kChunkMagic = 0x31434b54;  // "TKC1"
+constexpr int64_t kHourNs = 3600LL * 1000000000LL;
+
+#pragma pack(push, 1)
+struct ChunkHeader {
+    uint32_t magic;
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t levels;
+    uint32_t rows;
+    uint32_t columns;
+    int64_t first_ts;
+    int64_t last_ts;
+    double price_scale;
+    double size_scale;
+    uint32_t payload_bytes;
+};
+#pragma pack(pop)
+
+const char* extensionFor(TickKind kind) {
+    switch (kind) {
+        case TickKind::QUOTES: return ".quotes";
+        case TickKind::BOOKS: return ".books";
+        case TickKind::TRADES: return ".trades";
+    }
+    return ".ticks";
+}
+
+int64_t hourOf(int64_t timestamp_ns) {
+    return timestamp_ns >= 0 ? timestamp_ns / kHourNs : (timestamp_ns - kHourNs + 1) / kHourNs;
+}
+
+std::string hourName(int64_t hour) {
+    time_t seconds = static_cast<time_t>(hour * 3600);
+    std::tm tm{};
+    gmtime_r(&seconds, &tm);
+    char name[32];
+    std::strftime(name, sizeof(name), "%Y%m%d-%H", &tm);
+    return name;
+}
+
+// Hour number from a YYYYMMDD-HH file stem, or -1
+int64_t parseHour(const std::string& stem) {
+    std::tm tm{};
+    if (std::sscanf(stem.c_str(), "%4d%2d%2d-%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour) != 4) {
+        return -1;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    return static_cast<int64_t>(timegm(&tm)) / 3600;
+}
+
+// Delta + zigzag + LEB128 varint
+void encodeColumn(const std::vector<int64_t>& values, std::string& out) {
+    int64_t previous = 0;
+    for (int64_t value : values) {
+        uint64_t delta = static_cast<uint64_t>(value) - static_cast<uint64_t>(previous);
+        int64_t signed_delta = static_cast<int64_t>(delta);
+        uint64_t zigzag = (static_cast<uint64_t>(signed_delta) << 1) ^ static_cast<uint64_t>(signed_delta >> 63);
+        while (zigzag >= 0x80) {
+            out.push_back(static_cast<char>((zigzag & 0x7f) | 0x80));
+            zigzag >>= 7;
+        }
+        out.push_back(static_cast<char>(zigzag));
+        previous = value;
+    }
+}
+
+bool decodeColumn(const char* data, size_t size, size_t rows, std::vector<int64_t>& values) {
+    values.resize(rows);
+    size_t pos = 0;
+    int64_t previous = 0;
+    for (size_t row = 0; row < rows; ++row) {
+        uint64_t zigzag = 0;
+        int shift = 0;
+        while (true) {
+            if (pos >= size || shift > 63) return false;
+            uint8_t byte = static_cast<uint8_t>(data[pos++]);
+            zigzag |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) break;
+            shift += 7;
+        }
+        int64_t delta = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        previous = static_cast<int64_t>(static_cast<uint64_t>(previous) + static_cast<uint64_t>(delta));
+        values[row] = previous;
+    }
+    return pos == size;
+}
+
+} // namespace
+
+TickStoreWriter::TickStoreWriter(const std::string& root, const TickStoreOptions& options)
+    : root_(root), options_(options) {
+    options_.chunk_rows = std::max<size_t>(options_.chunk_rows, 1);
+}
+
+TickStoreWriter::~TickStoreWriter() {
+    flush();
+}
+
+int64_t TickStoreWriter::price(double value) const {
+    return std::llround(value * options_.price_scale);
+}
+
+int64_t TickStoreWriter::size(double value) const {
+    return std::llround(value * options_.size_scale);
+}
+
+TickStoreWriter::Series& TickStoreWriter::series(const std::string& instrument, TickKind kind,
+                                                 int64_t timestamp_ns, size_t columns) {
+    Series& series = series_[std::make_pair(instrument, kind)];
+    if (series.columns.empty()) {
+        series.instrument = instrument;
+        series.kind = kind;
+        series.columns.resize(columns);
+        for (auto& column : series.columns) {
+            column.reserve(options_.chunk_rows);
+        }
+    }
+    
+    // Chunks never span an hour file
+    int64_t hour = hourOf(timestamp_ns);
+    if (series.rows > 0 && hour != series.hour) {
+        writeChunk(series);
+    }
+    series.hour = hour;
+    return series;
+}
+
+void TickStoreWriter::endRow(Series& series, int64_t timestamp_ns) {
+    if (series.rows == 0) {
+        series.first_ts = timestamp_ns;
+    }
+    series.last_ts = std::max(series.last_ts, timestamp_ns);
+    if (++series.rows >= options_.chunk_rows) {
+        writeChunk(series);
+    }
+}
+
+void TickStoreWriter::addQuote(const std::string& instrument, const QuoteTick& quote) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& s = series(instrument, TickKind::QUOTES, quote.timestamp_ns, 5);
+    s.columns[0].push_back(quote.timestamp_ns);
+    s.columns[1].push_back(price(quote.bid_price));
+    s.columns[2].push_back(size(quote.bid_size));
+    s.columns[3].push_back(price(quote.ask_price));
+    s.columns[4].push_back(size(quote.ask_size));
+    endRow(s, quote.timestamp_ns);
+}
+
+void TickStoreWriter::addBook(const std::string& instrument, const BookTick& book) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t levels = options_.book_levels;
+    Series& s = series(instrument, TickKind::BOOKS, book.timestamp_ns, 1 + 4 * levels);
+    s.columns[0].push_back(book.timestamp_ns);
+    for (size_t level = 0; level < levels; ++level) {
+        const Orderbook::Level empty{0.0, 0.0};
+        const Orderbook::Level& bid = level < book.bids.size() ? book.bids[level] : empty;
+        const Orderbook::Level& ask = level < book.asks.size() ? book.asks[level] : empty;
+        s.columns[1 + 4 * level].push_back(price(bid.price));
+        s.columns[2 + 4 * level].push_back(size(bid.size));
+        s.columns[3 + 4 * level].push_back(price(ask.price));
+        s.columns[4 + 4 * level].push_back(size(ask.size));
+    }
+    endRow(s, book.timestamp_ns);
+}
+
+void TickStoreWriter::addTrade(const std::string& instrument, const TradeTick& trade) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& s = series(instrument, TickKind::TRADES, trade.timestamp_ns, 4);
+    s.columns[0].push_back(trade.timestamp_ns);
+    s.columns[1].push_back(price(trade.price));
+    s.columns[2].push_back(size(trade.amount));
+    s.columns[3].push_back(trade.side == Order::Side::BUY ? 0 : 1);
+    endRow(s, trade.timestamp_ns);
+}
+
+void TickStoreWriter::onOrderbook(const Orderbook& orderbook) {
+    if (!orderbook.bids.empty() && !orderbook.asks.empty()) {
+        QuoteTick quote;
+        quote.timestamp_ns = orderbook.timestamp;
+        quote.bid_price = orderbook.bids[0].price;
+        quote.bid_size = orderbook.bids[0].size;
+        quote.ask_price = orderbook.asks[0].price;
+        quote.ask_size = orderbook.asks[0].size;
+        addQuote(orderbook.instrument, quote);
+    }
+    
+    BookTick book;
+    book.timestamp_ns = orderbook.timestamp;
+    book.bids = orderbook.bids;
+    book.asks = orderbook.asks;
+    addBook(orderbook.instrument, book);
+}
+
+void TickStoreWriter::onTrades(const json& data) {
+    if (!data.is_array()) return;
+    
+    for (const json& item : data) {
+        if (!item.is_object() || !item.contains("instrument_name")) continue;
+        
+        TradeTick trade;
+        trade.timestamp_ns = item.value("timestamp", int64_t(0)) * 1000000;
+        trade.price = item.value("price", 0.0);
+        trade.amount = item.value("amount", 0.0);
+        trade.side = item.value("direction", "buy") == "sell" ? Order::Side::SELL : Order::Side::BUY;
+        addTrade(item["instrument_name"].get<std::string>(), trade);
+    }
+}
+
+void TickStoreWriter::registerRoutes(MessageRouter& router) {
+    router.addRoute("trades.", [this](const std::string&, const json& data) {
+        onTrades(data);
+    });
+}
+
+void TickStoreWriter::writeChunk(Series& series) {
+    if (series.rows == 0) return;
+    
+    std::string payload;
+    for (const auto& column : series.columns) {
+        std::string encoded;
+        encodeColumn(column, encoded);
+        uint32_t length = static_cast<uint32_t>(encoded.size());
+        payload.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        payload += encoded;
+    }
+    
+    ChunkHeader header{};
+    header.magic = kChunkMagic;
+    header.kind = static_cast<uint8_t>(series.kind);
+    header.levels = static_cast<uint16_t>(series.kind == TickKind::BOOKS ? options_.book_levels : 1);
+    header.rows = static_cast<uint32_t>(series.rows);
+    header.columns = static_cast<uint32_t>(series.columns.size());
+    header.first_ts = series.first_ts;
+    header.last_ts = series.last_ts;
+    header.price_scale = options_.price_scale;
+    header.size_scale = options_.size_scale;
+    header.payload_bytes = static_cast<uint32_t>(payload.size());
+    
+    std::filesystem::path directory = std::filesystem::path(root_) / series.instrument;
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    std::filesystem::path path = directory / (hourName(series.hour) + extensionFor(series.kind));
+    
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    if (!file) {
+        std::cerr << "Error opening tick file " << path << std::endl;
+    } else {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        rows_written_ += series.rows;
+    }
+    
+    for (auto& column : series.columns) {
+        column.clear();
+    }
+    series.rows = 0;
+    series.last_ts = 0;
+}
+
+void TickStoreWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : series_) {
+        writeChunk(entry.second);
+    }
+}
+
+size_t TickStoreWriter::rowsWritten() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rows_written_;
+}
+
+TickStoreReader::TickStoreReader(const std::string& root) : root_(root) {
+}
+
+std::vector<std::string> TickStoreReader::instruments() const {
+    std::vector<std::string> result;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(root_, ec)) {
+        if (entry.is_directory()) {
+            result.push_back(entry.path().filename().string());
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<TickStoreReader::Chunk> TickStoreReader::readChunks(const std::string& instrument, TickKind kind,
+                                                                int64_t from_ns, int64_t to_ns) const {
+    // Hour files overlapping the range, oldest first
+    std::vector<std::string> files;
+    int64_t first_hour = hourOf(from_ns);
+    int64_t last_hour = hourOf(to_ns - 1);
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(root_) / instrument, ec)) {
+        if (entry.path().extension() != extensionFor(kind)) continue;
+        int64_t hour = parseHour(entry.path().stem().string());
+        if (hour >= first_hour && hour <= last_hour) {
+            files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    
+    std::vector<Chunk> chunks;
+    for (const std::string& path : files) {
+        std::ifstream file(path, std::ios::binary);
+        ChunkHeader header;
+        std::string payload;
+        while (file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            if (header.magic != kChunkMagic) {
+                std::cerr << "Corrupt tick chunk in " << path << std::endl;
+                break;
+            }
+            
+            // Skip chunks outside the range without decoding them
+            if (header.last_ts < from_ns || header.first_ts >= to_ns) {
+                file.seekg(header.payload_bytes, std::ios::cur);
+                continue;
+            }
+            
+            payload.resize(header.payload_bytes);
+            if (!file.read(&payload[0], header.payload_bytes)) {
+                std::cerr << "Truncated tick chunk in " << path << std::endl;
+                break;
+            }
+            
+            Chunk chunk;
+            chunk.rows = header.rows;
+            chunk.levels = header.levels;
+            chunk.price_scale = header.price_scale;
+            chunk.size_scale = header.size_scale;
+            chunk.columns.resize(header.columns);
+            
+            size_t pos = 0;
+            bool valid = true;
+            for (auto& column : chunk.columns) {
+                uint32_t length = 0;
+                if (pos + sizeof(length) > payload.size()) { valid = false; break; }
+                std::memcpy(&length, payload.data() + pos, sizeof(length));
+                pos += sizeof(length);
+                if (pos + length > payload.size() ||
+                    !decodeColumn(payload.data() + pos, length, chunk.rows, column)) {
+                    valid = false;
+                    break;
+                }
+                pos += length;
+            }
+            if (!valid) {
+                std::cerr << "Corrupt tick chunk in " << path << std::endl;
+                break;
+            }
+            chunks.push_back(std::move(chunk));
+        }
+    }
+    return chunks;
+}
+
+std::vector<QuoteTick> TickStoreReader::quotes(const std::string& instrument, int64_t from_ns, int64_t to_ns) const {
+    std::vector<QuoteTick> result;
+    for (const Chunk& chunk : readChunks(instrument, TickKind::QUOTES, from_ns, to_ns)) {
+        if (chunk.columns.size() < 5) continue;
+        for (size_t row = 0; row < chunk.rows; ++row) {
+            int64_t ts = chunk.columns[0][row];
+            if (ts < from_ns || ts >= to_ns) continue;
+            QuoteTick quote;
+            quote.timestamp_ns = ts;
+            quote.bid_price = chunk.columns[1][row] / chunk.price_scale;
+            quote.bid_size = chunk.columns[2][row] / chunk.size_scale;
+            quote.ask_price = chunk.columns[3][row] / chunk.price_scale;
+            quote.ask_size = chunk.columns[4][row] / chunk.size_scale;
+            result.push_back(quote);
+        }
+    }
+    return result;
+}
+
+std::vector<BookTick> TickStoreReader::books(const std::string& instrument, int64_t from_ns, int64_t to_ns) const {
+    std::vector<BookTick> result;
+    for (const Chunk& chunk : readChunks(instrument, TickKind::BOOKS, from_ns, to_ns)) {
+        if (chunk.columns.size() < 1 + 4 * chunk.levels) continue;
+        for (size_t row = 0; row < chunk.rows; ++row) {
+            int64_t ts = chunk.columns[0][row];
+            if (ts < from_ns || ts >= to_ns) continue;
+            BookTick book;
+            book.timestamp_ns = ts;
+            for (size_t level = 0; level < chunk.levels; ++level) {
+                // Empty levels were padded with zeros
+                if (chunk.columns[2 + 4 * level][row] != 0) {
+                    book.bids.push_back({chunk.columns[1 + 4 * level][row] / chunk.price_scale,
+                                         chunk.columns[2 + 4 * level][row] / chunk.size_scale});
+                }
+                if (chunk.columns[4 + 4 * level][row] != 0) {
+                    book.asks.push_back({chunk.columns[3 + 4 * level][row] / chunk.price_scale,
+                                         chunk.columns[4 + 4 * level][row] / chunk.size_scale});
+                }
+            }
+            result.push_back(std::move(book));
+        }
+    }
+    return result;
+}
+
+std::vector<TradeTick> TickStoreReader::trades(const std::string& instrument, int64_t from_ns, int64_t to_ns) const {
+    std::vector<TradeTick> result;
+    for (const Chunk& chunk : readChunks(instrument, TickKind::TRADES, from_ns, to_ns)) {
+        if (chunk.columns.size() < 4) continue;
+        for (size_t row = 0; row < chunk.rows; ++row) {
+            int64_t ts = chunk.columns[0][row];
+            if (ts < from_ns || ts >= to_ns) continue;
+            TradeTick trade;
+            trade.timestamp_ns = ts;
+            trade.price = chunk.columns[1][row] / chunk.price_scale;
+            trade.amount = chunk.columns[2][row] / chunk.size_scale;
+            trade.side = chunk.columns[3][row] == 0 ? Order::Side::BUY : Order::Side::SELL;
+            result.push_back(trade);
+        }
+    }
+    return result;
+}
+
+std::vector<QuoteTick> TickStoreReader::sampleQuotes(const std::string& instrument, int64_t from_ns, int64_t to_ns,
+                                                     int64_t interval_ns) const {
+    std::vector<QuoteTick> samples;
+    if (interval_ns <= 0 || to_ns <= from_ns) return samples;
+    
+    // Look back an hour for the quote in force at from_ns
+    std::vector<QuoteTick> ticks = quotes(instrument, from_ns - kHourNs, to_ns);
+    size_t next = 0;
+    const QuoteTick* current = nullptr;
+    for (int64_t t = from_ns; t < to_ns; t += interval_ns) {
+        while (next < ticks.size() && ticks[next].timestamp_ns <= t) {
+            current = &ticks[next++];
+        }
+        if (current) {
+            QuoteTick sample = *current;
+            sample.timestamp_ns = t;
+            samples.push_back(sample);
+        }
+    }
+    return samples;
+}
\ No newline at end of file
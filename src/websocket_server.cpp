@@ -1,13 +1,18 @@
 #include "websocket_server.h"
+#include "subscriber_registry.h"
+#include "connection_table.h"
+#include "cpu_affinity.h"
 
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
 #include <boost/asio/dispatch.hpp>
-#include <boost/asio/strand.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/executor_work_guard.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
 #include <algorithm>
 #include <cstdlib>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -15,50 +20,53 @@
 #include <thread>
 #include <vector>
 #include <mutex>
-#include <random>
+
+// Include JSON library
+#define NLOHMANN_JSON_VERSION_MAJOR 3
+#define NLOHMANN_JSON_VERSION_MINOR 11
+#define NLOHMANN_JSON_VERSION_PATCH 2
+#include <nlohmann/json.hpp>
 
 namespace beast = boost::beast;
 namespace websocket = beast::websocket;
 namespace net = boost::asio;
 using tcp = boost::asio::ip::tcp;
+using json = nlohmann::json;
 
 // Concrete implementation of a WebSocket connection
+//
+// Each connection lives on a single-threaded io_context, so its handlers are
+// serialized without a strand and broadcasts dispatched from that thread run inline.
 class WebSocketConnectionImpl : public WebSocketConnection, public std::enable_shared_from_this<WebSocketConnectionImpl> {
 public:
-    // Constructor for upgrading an HTTP connection to WebSocket
-    WebSocketConnectionImpl(tcp::socket&& socket, MessageHandler message_handler, CloseHandler close_handler)
+    // Constructor for upgrading an HTTP connection to WebSocket. A slow client
+    // with max_queued outbound frames pending is disconnected.
+    WebSocketConnectionImpl(tcp::socket&& socket, size_t worker, size_t max_queued,
+                            MessageHandler message_handler, CloseHandler close_handler)
         : ws_(std::move(socket)),
           message_handler_(message_handler),
           close_handler_(close_handler),
-          id_(generateRandomId()) {
+          worker_(worker),
+          max_queued_(max_queued) {
     }
 
-    // Start the connection
+    // Start the connection on its own I/O thread
     void start() {
-        // Set suggested timeout settings for the websocket
-        ws_.set_option(
-            websocket::stream_base::timeout::suggested(
-                beast::role_type::server));
-
-        // Set a decorator to change the Server of the handshake
-        ws_.set_option(websocket::stream_base::decorator(
-            [](websocket::response_type& res) {
-                res.set(beast::http::field::server,
-                    std::string(BOOST_BEAST_VERSION_STRING) +
-                    " deribit-trader-websocket-server");
-            }));
-
-        // Accept the websocket handshake
-        ws_.async_accept(
+        net::dispatch(
+            ws_.get_executor(),
             beast::bind_front_handler(
-                &WebSocketConnectionImpl::on_accept,
+                &WebSocketConnectionImpl::on_start,
                 shared_from_this()));
     }
 
     // Send a message to the client
     void send(const std::string& message) override {
-        // Post our work to the strand
-        net::post(
+        sendShared(std::make_shared<const std::string>(message));
+    }
+    
+    // Queue a shared buffer; inline when already on this connection's thread
+    void sendShared(const SharedMessage& message) override {
+        net::dispatch(
             ws_.get_executor(),
             beast::bind_front_handler(
                 &WebSocketConnectionImpl::on_send,
@@ -68,7 +76,7 @@ public:
 
     // Close the connection
     void close() override {
-        // Post our work to the strand
+        // Post our work to the connection's thread
         net::post(
             ws_.get_executor(),
             beast::bind_front_handler(
@@ -76,9 +84,8 @@ public:
                 shared_from_this()));
     }
 
-    // Get the connection ID
-    std::string getId() const override {
-        return id_;
+    size_t getWorker() const override {
+        return worker_;
     }
 
 private:
@@ -86,14 +93,51 @@ private:
     beast::flat_buffer buffer_;
     MessageHandler message_handler_;
     CloseHandler close_handler_;
-    std::string id_;
+    size_t worker_;
+    size_t max_queued_;
+    
+    // Frames waiting to be written; the front one is in flight
+    std::deque<SharedMessage> write_queue_;
+    bool accepted_ = false;
+    bool closing_ = false;
+
+    void on_start() {
+        // Set suggested timeout settings for the websocket
+        ws_.set_option(
+            websocket::stream_base::timeout::suggested(
+                beast::role_type::server));
+
+        // Set a decorator to change the Server of the handshake
+        ws_.set_option(websocket::stream_base::decorator(
+            [](websocket::response_type& res) {
+                res.set(beast::http::field::server,
+                    std::string(BOOST_BEAST_VERSION_STRING) +
+                    " deribit-trader-websocket-server");
+            }));
+
+        // Accept the websocket handshake
+        ws_.async_accept(
+            beast::bind_front_handler(
+                &WebSocketConnectionImpl::on_accept,
+                shared_from_this()));
+    }
 
     void on_accept(beast::error_code ec) {
         if (ec) {
             std::cerr << "WebSocket accept error: " << ec.message() << std::endl;
+            if (close_handler_) {
+                close_handler_(shared_from_this());
+            }
             return;
         }
 
+        accepted_ = true;
+
+        // Flush anything queued during the handshake (e.g. the welcome message)
+        if (!write_queue_.empty() && !closing_) {
+            write();
+        }
+
         // Start reading messages
         read();
     }
@@ -120,6 +164,9 @@ private:
 
         if (ec) {
             std::cerr << "WebSocket read error: " << ec.message() << std::endl;
+            if (close_handler_) {
+                close_handler_(shared_from_this());
+            }
             return;
         }
 
@@ -136,10 +183,28 @@ private:
         read();
     }
 
-    void on_send(std::string message) {
-        // Send the message
+    void on_send(SharedMessage message) {
+        if (closing_) return;
+        
+        // Disconnect clients that cannot keep up rather than buffering without bound
+        if (write_queue_.size() >= max_queued_) {
+            std::cerr << "WebSocket client " << ConnectionTable::slotOf(getId()) << " too slow, disconnecting" << std::endl;
+            on_close();
+            return;
+        }
+        
+        write_queue_.push_back(std::move(message));
+        
+        // A write is already in flight (on_write picks this one up), or the
+        // handshake is still running (on_accept flushes the queue)
+        if (write_queue_.size() > 1 || !accepted_) return;
+        
+        write();
+    }
+    
+    void write() {
         ws_.async_write(
-            net::buffer(message),
+            net::buffer(*write_queue_.front()),
             beast::bind_front_handler(
                 &WebSocketConnectionImpl::on_write,
                 shared_from_this()));
@@ -150,11 +215,27 @@ private:
 
         if (ec) {
             std::cerr << "WebSocket write error: " << ec.message() << std::endl;
+            write_queue_.clear();
             return;
         }
+        
+        write_queue_.pop_front();
+        if (!write_queue_.empty() && !closing_) {
+            write();
+        }
     }
 
     void on_close() {
+        if (closing_) return;
+        closing_ = true;
+        
+        // Drop pending frames, keeping the one still in flight
+        if (accepted_ && !write_queue_.empty()) {
+            write_queue_.erase(std::next(write_queue_.begin()), write_queue_.end());
+        } else {
+            write_queue_.clear();
+        }
+        
         // Close the WebSocket connection
         ws_.async_close(
             websocket::close_code::normal,
@@ -174,31 +255,32 @@ private:
             close_handler_(shared_from_this());
         }
     }
-
-    // Generate a random connection ID
-    static std::string generateRandomId() {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        static std::uniform_int_distribution<> dis(0, 15);
-        static const char* hex = "0123456789abcdef";
-
-        std::string id;
-        for (int i = 0; i < 16; ++i) {
-            id += hex[dis(gen)];
-        }
-        return id;
-    }
 };
 
+#ifdef SO_REUSEPORT
+using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
 // WebSocket server implementation
+//
+// Accepted sockets are created directly on a target worker's io_context. With
+// SO_REUSEPORT each worker owns a listener and targets itself; otherwise a single
+// listener hands sockets to the workers round-robin.
 class WebSocketListener : public std::enable_shared_from_this<WebSocketListener> {
 public:
-    WebSocketListener(net::io_context& ioc, tcp::endpoint endpoint,
+    struct Target {
+        net::io_context* ioc;
+        size_t worker;
+    };
+    
+    WebSocketListener(net::io_context& ioc, tcp::endpoint endpoint, bool reuse_port_enabled,
+                    std::vector<Target> targets, size_t max_queued,
                     std::function<void(WebSocketConnection::Pointer)> on_accept,
                     std::function<void(WebSocketConnection::Pointer, const std::string&)> on_message,
                     std::function<void(WebSocketConnection::Pointer)> on_close)
-        : ioc_(ioc),
-          acceptor_(ioc),
+        : acceptor_(ioc),
+          targets_(std::move(targets)),
+          max_queued_(max_queued),
           on_accept_(on_accept),
           on_message_(on_message),
           on_close_(on_close) {
@@ -219,6 +301,19 @@ public:
             return;
         }
         
+#ifdef SO_REUSEPORT
+        // Let every worker bind its own listening socket to the same port
+        if (reuse_port_enabled) {
+            acceptor_.set_option(reuse_port(true), ec);
+            if (ec) {
+                std::cerr << "Error setting reuse port: " << ec.message() << std::endl;
+                return;
+            }
+        }
+#else
+        boost::ignore_unused(reuse_port_enabled);
+#endif
+        
         // Bind to the server address
         acceptor_.bind(endpoint, ec);
         if (ec) {
@@ -249,48 +344,90 @@ public:
     }
 
 private:
-    net::io_context& ioc_;
     tcp::acceptor acceptor_;
+    std::vector<Target> targets_;
+    size_t next_target_ = 0;
+    size_t max_queued_;
     std::function<void(WebSocketConnection::Pointer)> on_accept_;
     std::function<void(WebSocketConnection::Pointer, const std::string&)> on_message_;
     std::function<void(WebSocketConnection::Pointer)> on_close_;
     
     void accept() {
-        // The new connection gets its own strand
+        if (!acceptor_.is_open()) return;
+        
+        // The new connection is pinned to the next worker for its lifetime
+        const Target& target = targets_[next_target_];
         acceptor_.async_accept(
-            net::make_strand(ioc_),
+            *target.ioc,
             beast::bind_front_handler(
                 &WebSocketListener::on_accept,
-                shared_from_this()));
+                shared_from_this(),
+                target.worker));
     }
     
-    void on_accept(beast::error_code ec, tcp::socket socket) {
+    void on_accept(size_t worker, beast::error_code ec, tcp::socket socket) {
+        if (ec == net::error::operation_aborted) {
+            return;
+        }
+        
         if (ec) {
             std::cerr << "Error accepting connection: " << ec.message() << std::endl;
         } else {
+            next_target_ = (next_target_ + 1) % targets_.size();
+            
             // Create the WebSocket connection
             auto connection = std::make_shared<WebSocketConnectionImpl>(
                 std::move(socket),
+                worker,
+                max_queued_,
                 on_message_,
                 on_close_);
             
-            // Start the connection
-            connection->start();
-            
-            // Notify the server
+            // Notify the server before any frame can arrive
             if (on_accept_) {
                 on_accept_(connection);
             }
+
+            // Start the connection on its own thread
+            connection->start();
         }
-        
+
         // Accept another connection
         accept();
     }
 };
 
+// Per-thread I/O state
+struct WebSocketServer::IoWorker {
+    // Concurrency hint 1: exactly one thread runs this context
+    net::io_context ioc{1};
+    std::shared_ptr<WebSocketListener> listener;
+    std::thread thread;
+};
+
 // WebSocketServer implementation
-WebSocketServer::WebSocketServer(int port)
+WebSocketServer::WebSocketServer(int port, size_t io_threads, size_t max_connections)
     : port_(port), running_(false) {
+    // Workers live as long as the server so broadcasts never race with start/stop
+    io_threads = std::max<size_t>(io_threads, 1);
+    for (size_t i = 0; i < io_threads; ++i) {
+        workers_.push_back(std::make_unique<IoWorker>());
+    }
+    
+    // Each worker gets an equal, contiguous share of the connection slots, rounded
+    // up to whole 64-bit words so subscriber bitsets split cleanly per worker
+    size_t slots_per_worker = std::max<size_t>((max_connections + io_threads - 1) / io_threads, 1);
+    slots_per_worker = (slots_per_worker + 63) / 64 * 64;
+    connections_ = std::make_unique<ConnectionTable>(io_threads, slots_per_worker);
+    slot_subscriptions_.resize(connections_->capacity());
+    subscribers_ = std::make_unique<SubscriberRegistry>(io_threads, slots_per_worker);
+    
+    // Register client commands
+    command_handlers_["subscribe"] = &WebSocketServer::handleSubscribe;
+    command_handlers_["unsubscribe"] = &WebSocketServer::handleUnsubscribe;
+    command_handlers_["snapshot"] = &WebSocketServer::handleSnapshot;
+    command_handlers_["ping"] = &WebSocketServer::handlePing;
+    command_handlers_["list"] = &WebSocketServer::handleList;
 }
 
 WebSocketServer::~WebSocketServer() {
@@ -300,31 +437,59 @@ WebSocketServer::~WebSocketServer() {
 void WebSocketServer::start() {
     if (running_) return;
     
-    running_ = true;
+    auto on_accept = [this](WebSocketConnection::Pointer connection) { this->onAccept(connection); };
+    auto on_message = [this](WebSocketConnection::Pointer connection, const std::string& message) { this->onMessage(connection, message); };
+    auto on_close = [this](WebSocketConnection::Pointer connection) { this->onClose(connection); };
     
-    // Create the IO context
-    io_context_ = std::make_unique<net::io_context>();
+    tcp::endpoint endpoint(tcp::v4(), port_);
     
-    // Create the listener
-    auto listener = std::make_shared<WebSocketListener>(
-        *io_context_,
-        tcp::endpoint(tcp::v4(), port_),
-        [this](WebSocketConnection::Pointer connection) { this->onAccept(connection); },
-        [this](WebSocketConnection::Pointer connection, const std::string& message) { this->onMessage(connection, message); },
-        [this](WebSocketConnection::Pointer connection) { this->onClose(connection); }
-    );
+#ifdef SO_REUSEPORT
+    // One listening socket per worker; the kernel balances accepts between them
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        IoWorker& worker = *workers_[i];
+        worker.ioc.restart();
+        worker.listener = std::make_shared<WebSocketListener>(
+            worker.ioc, endpoint, workers_.size() > 1,
+            std::vector<WebSocketListener::Target>{{&worker.ioc, i}}, max_queued_messages_,
+            on_accept, on_message, on_close);
+    }
+#else
+    // One listening socket on the first worker, distributing round-robin
+    std::vector<WebSocketListener::Target> targets;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->ioc.restart();
+        targets.push_back({&workers_[i]->ioc, i});
+    }
+    workers_.front()->listener = std::make_shared<WebSocketListener>(
+        workers_.front()->ioc, endpoint, false, targets, max_queued_messages_,
+        on_accept, on_message, on_close);
+#endif
     
-    // Start the listener
-    listener->run();
+    running_ = true;
     
-    // Run the IO context in a separate thread
-    server_thread_ = std::thread([this]() {
-        try {
-            io_context_->run();
-        } catch (const std::exception& e) {
-            std::cerr << "WebSocket server error: " << e.what() << std::endl;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        IoWorker& worker = *workers_[i];
+        
+        // Start the listener
+        if (worker.listener) {
+            worker.listener->run();
+        }
+        
+        // Run each IO context on its own thread; keep it alive while idle
+        worker.thread = std::thread([&worker]() {
+            auto guard = net::make_work_guard(worker.ioc);
+            try {
+                worker.ioc.run();
+            } catch (const std::exception& e) {
+                std::cerr << "WebSocket server error: " << e.what() << std::endl;
+            }
+        });
+        
+        // Workers beyond the CPU list reuse it round-robin
+        if (!cpus_.empty()) {
+            pinThreadToCpu(worker.thread, cpus_[i % cpus_.size()]);
         }
-    });
+    }
 }
 
 void WebSocketServer::stop() {
@@ -332,27 +497,28 @@ void WebSocketServer::stop() {
     
     running_ = false;
     
-    // Close all connections
-    std::vector<WebSocketConnection::Pointer> connections;
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex_);
-        for (const auto& pair : clients_) {
-            connections.push_back(pair.second);
+    // Stop accepting on every worker
+    for (auto& worker : workers_) {
+        if (worker->listener) {
+            auto listener = worker->listener;
+            net::post(worker->ioc, [listener]() { listener->stop(); });
         }
     }
     
-    for (auto& connection : connections) {
+    // Close all connections
+    for (auto& connection : connections_->all()) {
         connection->close();
     }
     
-    // Stop the IO context
-    if (io_context_) {
-        io_context_->stop();
+    // Stop the IO contexts and wait for the threads to finish
+    for (auto& worker : workers_) {
+        worker->ioc.stop();
     }
-    
-    // Wait for the server thread to finish
-    if (server_thread_.joinable()) {
-        server_thread_.join();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+        worker->listener.reset();
     }
 }
 
@@ -360,161 +526,160 @@ bool WebSocketServer::isRunning() const {
     return running_;
 }
 
-void WebSocketServer::broadcastOrderbook(const std::string& instrument, const std::string& orderbook_json) {
-    broadcastToSubscribers(instrument, orderbook_json);
+void WebSocketServer::setMaxQueuedMessages(size_t max_queued) {
+    max_queued_messages_ = std::max<size_t>(max_queued, 1);
 }
 
-void WebSocketServer::broadcastToSubscribers(const std::string& instrument, const std::string& message) {
-    std::vector<std::string> client_ids;
-    {
-        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
-        if (instrument_subscribers_.find(instrument) != instrument_subscribers_.end()) {
-            client_ids = std::vector<std::string>(
-                instrument_subscribers_[instrument].begin(),
-                instrument_subscribers_[instrument].end()
-            );
-        }
-    }
+void WebSocketServer::setCpuAffinity(const std::vector<int>& cpus) {
+    cpus_ = cpus;
+}
+
+size_t WebSocketServer::ioThreadCount() const {
+    return workers_.size();
+}
+
+bool WebSocketServer::addConnection(const WebSocketConnection::Pointer& connection) {
+    return connections_->acquire(connection->getWorker(), connection) != ConnectionTable::kInvalidId;
+}
+
+void WebSocketServer::removeConnection(const WebSocketConnection::Pointer& connection) {
+    // Remove all subscriptions while the slot still belongs to this connection
+    removeAllSubscriptions(connection);
+    connections_->release(connection->getId());
+}
+
+size_t WebSocketServer::connectionCount() const {
+    return connections_->size();
+}
+
+void WebSocketServer::broadcastOrderbook(const std::string& instrument, const std::string& orderbook_json) {
+    auto message = std::make_shared<const std::string>(orderbook_json);
     
-    std::vector<WebSocketConnection::Pointer> clients;
+    // Cache the latest book for snapshot requests
+    bool is_new = false;
     {
-        std::lock_guard<std::mutex> lock(clients_mutex_);
-        for (const auto& client_id : client_ids) {
-            if (clients_.find(client_id) != clients_.end()) {
-                clients.push_back(clients_[client_id]);
-            }
+        std::lock_guard<std::mutex> lock(snapshots_mutex_);
+        auto it = snapshots_.find(instrument);
+        if (it == snapshots_.end()) {
+            snapshots_.emplace(instrument, message);
+            is_new = true;
+        } else {
+            it->second = message;
         }
     }
     
-    for (auto& client : clients) {
-        client->send(message);
+    // Attach wildcard subscribers to instruments seen for the first time
+    if (is_new) {
+        onNewInstrument(instrument);
     }
+    
+    broadcastShared(instrument, message);
 }
 
-void WebSocketServer::broadcastToAll(const std::string& message) {
-    std::vector<WebSocketConnection::Pointer> clients;
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex_);
-        for (const auto& pair : clients_) {
-            clients.push_back(pair.second);
+void WebSocketServer::broadcastToSubscribers(const std::string& instrument, const std::string& message) {
+    broadcastShared(instrument, std::make_shared<const std::string>(message));
+}
+
+void WebSocketServer::broadcastShared(const std::string& instrument, const WebSocketConnection::SharedMessage& message) {
+    // One atomic load finds the instrument's bitset; no locks or per-id lookups
+    SubscriberRegistry::SubscriberSetPtr subscribers = subscribers_->subscribers(instrument);
+    if (!subscribers || subscribers->empty()) return;
+    
+    ConnectionTable* connections = connections_.get();
+    
+    for (size_t worker = 0; worker < subscribers->workerCount(); ++worker) {
+        if (subscribers->count(worker) == 0) continue;
+        
+        // Without running I/O threads, deliver on the caller's thread
+        if (!running_) {
+            subscribers->forEach(worker, [connections, &message](uint32_t slot) {
+                if (auto client = connections->at(slot)) {
+                    client->sendShared(message);
+                }
+            });
+            continue;
         }
+        
+        // One task per I/O thread walks that thread's slot range; sends run inline there
+        net::post(workers_[worker]->ioc, [connections, subscribers, worker, message]() {
+            subscribers->forEach(worker, [connections, &message](uint32_t slot) {
+                if (auto client = connections->at(slot)) {
+                    client->sendShared(message);
+                }
+            });
+        });
     }
+}
+
+void WebSocketServer::broadcastToAll(const std::string& message) {
+    auto shared = std::make_shared<const std::string>(message);
     
-    for (auto& client : clients) {
-        client->send(message);
+    for (auto& client : connections_->all()) {
+        client->sendShared(shared);
     }
 }
 
 void WebSocketServer::addSubscription(const WebSocketConnection::Pointer& client, const std::string& instrument) {
-    std::string client_id = client->getId();
-    
-    {
-        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
-        
-        // Add to client_subscriptions
-        client_subscriptions_[client_id].insert(instrument);
-        
-        // Add to instrument_subscribers
-        instrument_subscribers_[instrument].insert(client_id);
-    }
+    subscribeInstruments(client, {instrument});
     
     // Send a confirmation message
     client->send("{\"type\":\"subscription\",\"instrument\":\"" + instrument + "\",\"status\":\"subscribed\"}");
 }
 
 void WebSocketServer::removeSubscription(const WebSocketConnection::Pointer& client, const std::string& instrument) {
-    std::string client_id = client->getId();
-    
-    {
-        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
-        
-        // Remove from client_subscriptions
-        if (client_subscriptions_.find(client_id) != client_subscriptions_.end()) {
-            client_subscriptions_[client_id].erase(instrument);
-        }
-        
-        // Remove from instrument_subscribers
-        if (instrument_subscribers_.find(instrument) != instrument_subscribers_.end()) {
-            instrument_subscribers_[instrument].erase(client_id);
-            
-            // If no more subscribers, remove the instrument entry
-            if (instrument_subscribers_[instrument].empty()) {
-                instrument_subscribers_.erase(instrument);
-            }
-        }
-    }
+    unsubscribeInstruments(client, {instrument});
     
     // Send a confirmation message
     client->send("{\"type\":\"subscription\",\"instrument\":\"" + instrument + "\",\"status\":\"unsubscribed\"}");
 }
 
 void WebSocketServer::removeAllSubscriptions(const WebSocketConnection::Pointer& client) {
-    std::string client_id = client->getId();
+    if (!isRegistered(client)) return;
     
-    std::set<std::string> instruments;
-    {
-        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
-        
-        // Get all instruments this client is subscribed to
-        if (client_subscriptions_.find(client_id) != client_subscriptions_.end()) {
-            instruments = client_subscriptions_[client_id];
-        }
-        
-        // Remove from client_subscriptions
-        client_subscriptions_.erase(client_id);
-        
-        // Remove from all instrument_subscribers
-        for (const auto& instrument : instruments) {
-            if (instrument_subscribers_.find(instrument) != instrument_subscribers_.end()) {
-                instrument_subscribers_[instrument].erase(client_id);
-                
-                // If no more subscribers, remove the instrument entry
-                if (instrument_subscribers_[instrument].empty()) {
-                    instrument_subscribers_.erase(instrument);
-                }
-            }
-        }
+    ConnectionId id = client->getId();
+    uint32_t slot = ConnectionTable::slotOf(id);
+    
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    
+    // Get all instruments this client is subscribed to
+    std::set<std::string>& instruments = slot_subscriptions_[slot];
+    if (!instruments.empty()) {
+        subscribers_->remove(slot, std::vector<std::string>(instruments.begin(), instruments.end()));
+        instruments.clear();
     }
+    
+    // Drop wildcard patterns
+    client_patterns_.erase(id);
 }
 
 std::set<std::string> WebSocketServer::getSubscriptions(const WebSocketConnection::Pointer& client) const {
-    std::string client_id = client->getId();
+    if (!isRegistered(client)) return {};
     
     std::lock_guard<std::mutex> lock(subscriptions_mutex_);
-    if (client_subscriptions_.find(client_id) != client_subscriptions_.end()) {
-        return client_subscriptions_.at(client_id);
-    }
-    
-    return {};
+    return slot_subscriptions_[ConnectionTable::slotOf(client->getId())];
 }
 
 void WebSocketServer::onAccept(WebSocketConnection::Pointer connection) {
-    // Add the client to our map
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    clients_[connection->getId()] = connection;
+    // Give the client a slot; refuse it when the table is full
+    if (!addConnection(connection)) {
+        std::cerr << "WebSocket connection limit reached, rejecting client" << std::endl;
+        connection->close();
+        return;
+    }
     
     // Send a welcome message
     connection->send("{\"type\":\"welcome\",\"message\":\"Welcome to Deribit Trader WebSocket Server\"}");
 }
 
 void WebSocketServer::onMessage(WebSocketConnection::Pointer connection, const std::string& message) {
-    // Handle the message (parse JSON, etc.)
-    // This is a simple implementation that just echoes the message back
+    // Ignore frames from clients that were refused a slot
+    if (!isRegistered(connection)) return;
     
-    // For a real implementation, you would parse the JSON and handle commands
-    // like subscribe/unsubscribe, etc.
     handleMessage(connection, message);
 }
 
 void WebSocketServer::onClose(WebSocketConnection::Pointer connection) {
-    std::string client_id = connection->getId();
-    
-    // Remove all subscriptions
-    removeAllSubscriptions(connection);
-    
-    // Remove the client from our map
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    clients_.erase(client_id);
+    removeConnection(connection);
 }
 
 void WebSocketServer::startAccept() {
@@ -522,39 +687,294 @@ void WebSocketServer::startAccept() {
 }
 
 void WebSocketServer::handleMessage(WebSocketConnection::Pointer connection, const std::string& message) {
+    // Parse once; malformed frames get a structured error instead of being guessed at
+    json request = json::parse(message, nullptr, false);
+    if (request.is_discarded()) {
+        sendError(connection, json(), "invalid_json", "Message is not valid JSON");
+        return;
+    }
+    
+    if (!request.is_object() || !request.contains("type") || !request["type"].is_string()) {
+        sendError(connection, request, "invalid_request", "Missing string field 'type'");
+        return;
+    }
+    
+    // Dispatch through the command table
+    auto it = command_handlers_.find(request["type"].get<std::string>());
+    if (it == command_handlers_.end()) {
+        sendError(connection, request, "unknown_command", "Unknown command");
+        return;
+    }
+    
     try {
-        // Parse the message as JSON
-        // For brevity, we're using a simple string comparison approach
-        // In a real implementation, you would use a JSON parser
+        (this->*(it->second))(connection, request);
+    } catch (const std::exception& e) {
+        sendError(connection, request, "internal_error", e.what());
+    }
+}
+
+// Collect instruments from either "instrument" (string) or "instruments" (array of strings)
+static bool collectInstruments(const json& request, std::vector<std::string>& literals, std::vector<std::string>& patterns) {
+    std::vector<std::string> names;
+    if (request.contains("instrument")) {
+        if (!request["instrument"].is_string()) return false;
+        names.push_back(request["instrument"].get<std::string>());
+    }
+    if (request.contains("instruments")) {
+        if (!request["instruments"].is_array()) return false;
+        for (const auto& name : request["instruments"]) {
+            if (!name.is_string()) return false;
+            names.push_back(name.get<std::string>());
+        }
+    }
+    
+    for (auto& name : names) {
+        if (name.empty()) return false;
+        if (name.find('*') != std::string::npos) {
+            patterns.push_back(std::move(name));
+        } else {
+            literals.push_back(std::move(name));
+        }
+    }
+    return !literals.empty() || !patterns.empty();
+}
+
+// Build a reply of the given type, echoing the request id if present
+static json makeReply(const json& request, const char* type) {
+    json reply;
+    reply["type"] = type;
+    if (request.is_object() && request.contains("id")) {
+        reply["id"] = request["id"];
+    }
+    return reply;
+}
+
+void WebSocketServer::handleSubscribe(const WebSocketConnection::Pointer& connection, const json& request) {
+    std::vector<std::string> literals;
+    std::vector<std::string> patterns;
+    if (!collectInstruments(request, literals, patterns)) {
+        sendError(connection, request, "invalid_params", "Expected 'instrument' string or 'instruments' array");
+        return;
+    }
+    
+    // Remember patterns so instruments that appear later are picked up too
+    if (!patterns.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+            client_patterns_[connection->getId()].insert(patterns.begin(), patterns.end());
+        }
         
-        if (message.find("\"type\":\"subscribe\"") != std::string::npos) {
-            // Extract the instrument
-            size_t pos = message.find("\"instrument\":");
-            if (pos != std::string::npos) {
-                pos += 13; // Length of "instrument":
-                size_t end = message.find("\"", pos + 1);
-                if (end != std::string::npos) {
-                    std::string instrument = message.substr(pos + 1, end - pos - 1);
-                    addSubscription(connection, instrument);
+        for (const auto& instrument : knownInstruments()) {
+            for (const auto& pattern : patterns) {
+                if (matchesPattern(pattern, instrument)) {
+                    literals.push_back(instrument);
+                    break;
                 }
             }
-        } else if (message.find("\"type\":\"unsubscribe\"") != std::string::npos) {
-            // Extract the instrument
-            size_t pos = message.find("\"instrument\":");
-            if (pos != std::string::npos) {
-                pos += 13; // Length of "instrument":
-                size_t end = message.find("\"", pos + 1);
-                if (end != std::string::npos) {
-                    std::string instrument = message.substr(pos + 1, end - pos - 1);
-                    removeSubscription(connection, instrument);
+        }
+    }
+    
+    std::vector<std::string> subscribed = subscribeInstruments(connection, literals);
+    
+    json reply = makeReply(request, "subscription");
+    reply["status"] = "subscribed";
+    if (request.contains("instrument") && patterns.empty() && literals.size() == 1) {
+        reply["instrument"] = literals.front();
+    } else {
+        reply["instruments"] = subscribed;
+        reply["patterns"] = patterns;
+    }
+    connection->send(reply.dump());
+}
+
+void WebSocketServer::handleUnsubscribe(const WebSocketConnection::Pointer& connection, const json& request) {
+    std::vector<std::string> literals;
+    std::vector<std::string> patterns;
+    if (!collectInstruments(request, literals, patterns)) {
+        sendError(connection, request, "invalid_params", "Expected 'instrument' string or 'instruments' array");
+        return;
+    }
+    
+    // Drop the patterns and everything they currently match
+    if (!patterns.empty()) {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        auto patterns_it = client_patterns_.find(connection->getId());
+        if (patterns_it != client_patterns_.end()) {
+            for (const auto& pattern : patterns) {
+                patterns_it->second.erase(pattern);
+            }
+            if (patterns_it->second.empty()) {
+                client_patterns_.erase(patterns_it);
+            }
+        }
+        
+        for (const auto& instrument : slot_subscriptions_[ConnectionTable::slotOf(connection->getId())]) {
+            for (const auto& pattern : patterns) {
+                if (matchesPattern(pattern, instrument)) {
+                    literals.push_back(instrument);
+                    break;
                 }
             }
+        }
+    }
+    
+    std::vector<std::string> unsubscribed = unsubscribeInstruments(connection, literals);
+    
+    json reply = makeReply(request, "subscription");
+    reply["status"] = "unsubscribed";
+    if (request.contains("instrument") && patterns.empty() && literals.size() == 1) {
+        reply["instrument"] = literals.front();
+    } else {
+        reply["instruments"] = unsubscribed;
+        reply["patterns"] = patterns;
+    }
+    connection->send(reply.dump());
+}
+
+void WebSocketServer::handleSnapshot(const WebSocketConnection::Pointer& connection, const json& request) {
+    if (!request.contains("instrument") || !request["instrument"].is_string()) {
+        sendError(connection, request, "invalid_params", "Expected 'instrument' string");
+        return;
+    }
+    
+    std::string instrument = request["instrument"].get<std::string>();
+    WebSocketConnection::SharedMessage snapshot;
+    {
+        std::lock_guard<std::mutex> lock(snapshots_mutex_);
+        auto it = snapshots_.find(instrument);
+        if (it != snapshots_.end()) {
+            snapshot = it->second;
+        }
+    }
+    
+    if (!snapshot) {
+        sendError(connection, request, "no_data", "No orderbook available for " + instrument);
+        return;
+    }
+    
+    // The cached book is already serialized; send the shared buffer as-is
+    connection->sendShared(snapshot);
+}
+
+void WebSocketServer::handlePing(const WebSocketConnection::Pointer& connection, const json& request) {
+    json reply = makeReply(request, "pong");
+    if (request.contains("timestamp")) {
+        reply["timestamp"] = request["timestamp"];
+    }
+    connection->send(reply.dump());
+}
+
+void WebSocketServer::handleList(const WebSocketConnection::Pointer& connection, const json& request) {
+    json reply = makeReply(request, "list");
+    reply["subscriptions"] = json::array();
+    reply["patterns"] = json::array();
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        reply["subscriptions"] = slot_subscriptions_[ConnectionTable::slotOf(connection->getId())];
+        auto patterns_it = client_patterns_.find(connection->getId());
+        if (patterns_it != client_patterns_.end()) {
+            reply["patterns"] = patterns_it->second;
+        }
+    }
+    reply["instruments"] = knownInstruments();
+    
+    connection->send(reply.dump());
+}
+
+std::vector<std::string> WebSocketServer::subscribeInstruments(const WebSocketConnection::Pointer& client, const std::vector<std::string>& instruments) {
+    std::vector<std::string> subscribed;
+    if (!isRegistered(client)) return subscribed;
+    subscribed.reserve(instruments.size());
+    
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    std::set<std::string>& client_set = slot_subscriptions_[ConnectionTable::slotOf(client->getId())];
+    for (const auto& instrument : instruments) {
+        if (client_set.insert(instrument).second) {
+            subscribed.push_back(instrument);
+        }
+    }
+    
+    subscribers_->add(ConnectionTable::slotOf(client->getId()), subscribed);
+    
+    return subscribed;
+}
+
+std::vector<std::string> WebSocketServer::unsubscribeInstruments(const WebSocketConnection::Pointer& client, const std::vector<std::string>& instruments) {
+    std::vector<std::string> unsubscribed;
+    if (!isRegistered(client)) return unsubscribed;
+    
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    std::set<std::string>& client_set = slot_subscriptions_[ConnectionTable::slotOf(client->getId())];
+    for (const auto& instrument : instruments) {
+        if (client_set.erase(instrument) > 0) {
+            unsubscribed.push_back(instrument);
+        }
+    }
+    
+    subscribers_->remove(ConnectionTable::slotOf(client->getId()), unsubscribed);
+    
+    return unsubscribed;
+}
+
+std::vector<std::string> WebSocketServer::knownInstruments() const {
+    std::vector<std::string> instruments;
+    
+    std::lock_guard<std::mutex> lock(snapshots_mutex_);
+    instruments.reserve(snapshots_.size());
+    for (const auto& pair : snapshots_) {
+        instruments.push_back(pair.first);
+    }
+    return instruments;
+}
+
+void WebSocketServer::onNewInstrument(const std::string& instrument) {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    for (const auto& pair : client_patterns_) {
+        for (const auto& pattern : pair.second) {
+            if (!matchesPattern(pattern, instrument)) continue;
+            
+            // Patterns are dropped before a slot is released, so the id is still live
+            WebSocketConnection::Pointer client = connections_->get(pair.first);
+            if (client && slot_subscriptions_[ConnectionTable::slotOf(pair.first)].insert(instrument).second) {
+                subscribers_->add(ConnectionTable::slotOf(pair.first), {instrument});
+            }
+            break;
+        }
+    }
+}
+
+bool WebSocketServer::isRegistered(const WebSocketConnection::Pointer& client) const {
+    return connections_->get(client->getId()) == client;
+}
+
+bool WebSocketServer::matchesPattern(const std::string& pattern, const std::string& instrument) {
+    // Iterative glob match where '*' matches any run of characters
+    size_t p = 0, s = 0;
+    size_t star = std::string::npos, mark = 0;
+    while (s < instrument.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            mark = s;
+        } else if (p < pattern.size() && pattern[p] == instrument[s]) {
+            ++p;
+            ++s;
+        } else if (star != std::string::npos) {
+            p = star + 1;
+            s = ++mark;
         } else {
-            // Echo the message back
-            connection->send("{\"type\":\"error\",\"message\":\"Unknown command\"}");
+            return false;
         }
-    } catch (const std::exception& e) {
-        // Send an error message
-        connection->send("{\"type\":\"error\",\"message\":\"" + std::string(e.what()) + "\"}");
     }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+void WebSocketServer::sendError(const WebSocketConnection::Pointer& connection, const json& request,
+                                const std::string& code, const std::string& message) {
+    json reply = makeReply(request, "error");
+    reply["code"] = code;
+    reply["message"] = message;
+    connection->send(reply.dump());
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <string>
 #include <chrono>
 #include <thread>
+#include <vector>
 
 // Define Catch version before including it
 #define CATCH_VERSION_MAJOR 2
@@ -13,8 +14,8 @@
 TEST_CASE("ApiClient basic functionality", "[api_client]") {
     // Create API client with test credentials
     ApiClient::Auth auth;
-    auth.client_id = "m_B5zE25";
-    auth.client_secret = "qwHcammuk8D-MEK4idg8urGt_ZAkfk4r_MuIzT9v1LE";
+    auth.client_id = "test-client";
+    auth.client_secret = "test-secret";
     ApiClient api_client(auth);
     
     SECTION("Place order") {
@@ -39,11 +40,157 @@ TEST_CASE("ApiClient basic functionality", "[api_client]") {
         REQUIRE(!response.empty());
     }
     
+    SECTION("Book channel") {
+        REQUIRE(api_client.bookChannel("BTC-PERPETUAL") == "book.BTC-PERPETUAL.none.10.100ms");
+        api_client.setBookChannel(20, "raw");
+        REQUIRE(api_client.bookChannel("BTC-PERPETUAL") == "book.BTC-PERPETUAL.none.20.raw");
+    }
+    
     SECTION("Get positions") {
         std::string response = api_client.getCurrentPositions();
         REQUIRE(!response.empty());
     }
 }
 
+TEST_CASE("CreditTracker token bucket", "[api_client]") {
+    CreditTracker::Limits limits;
+    limits.max_credits = 2000;
+    limits.refill_per_second = 1000;
+    limits.max_queue_ns = 3000000000;
+    CreditTracker credits(limits);
+    int64_t now = 1000000000;
+    
+    SECTION("Bursts up to the pool, then refills at the configured rate") {
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(credits.tryAcquire(500, now));
+        }
+        REQUIRE_FALSE(credits.tryAcquire(500, now));
+        REQUIRE(credits.waitTime(500, now) == 500000000);
+        
+        REQUIRE_FALSE(credits.tryAcquire(500, now + 400000000));
+        REQUIRE(credits.tryAcquire(500, now + 500000000));
+        
+        // Refill stops at the pool size
+        REQUIRE(credits.available(now + 10000000000) == 2000);
+    }
+    
+    SECTION("Reservations queue in order at the refill rate") {
+        REQUIRE(credits.reserve(2000, now) == 0);
+        REQUIRE(credits.reserve(500, now) == 500000000);
+        REQUIRE(credits.reserve(500, now) == 1000000000);
+        REQUIRE(credits.available(now) == -1000);
+        
+        // Beyond the queue limit the request is refused and nothing is taken
+        REQUIRE(credits.reserve(2500, now) == -1);
+        REQUIRE(credits.available(now) == -1000);
+    }
+}
+
+TEST_CASE("ApiClient rate limiting", "[api_client]") {
+    ApiClient::Auth auth;
+    ApiClient api_client(auth);
+    
+    REQUIRE(ApiClient::poolFor("/api/v2/private/buy") == ApiClient::CreditPool::MATCHING_ENGINE);
+    REQUIRE(ApiClient::poolFor("/api/v2/private/cancel_by_label") == ApiClient::CreditPool::MATCHING_ENGINE);
+    REQUIRE(ApiClient::poolFor("/api/v2/public/get_order_book") == ApiClient::CreditPool::NON_MATCHING);
+    REQUIRE(ApiClient::poolFor("private/edit") == ApiClient::CreditPool::MATCHING_ENGINE);
+    REQUIRE(ApiClient::poolFor("public/subscribe") == ApiClient::CreditPool::NON_MATCHING);
+    
+    CreditTracker::Limits limits;
+    limits.max_credits = 3 * ApiClient::kRequestCost;
+    limits.refill_per_second = 100 * ApiClient::kRequestCost;
+    api_client.setCreditLimits(ApiClient::CreditPool::MATCHING_ENGINE, limits);
+    
+    SECTION("Off by default") {
+        for (int i = 0; i < 10; ++i) {
+            REQUIRE(api_client.cancelOrder("mock_order_id"));
+        }
+    }
+    
+    SECTION("Reject mode fails requests locally once the pool is empty") {
+        api_client.setRateLimitMode(ApiClient::RateLimitMode::REJECT);
+        for (int i = 0; i < 3; ++i) {
+            REQUIRE(api_client.cancelOrder("mock_order_id"));
+        }
+        REQUIRE_FALSE(api_client.cancelOrder("mock_order_id"));
+        std::string response = api_client.placeOrder("BTC-PERPETUAL", true, 50000.0, 0.1);
+        REQUIRE(response.find("too_many_requests") != std::string::npos);
+        
+        // The non-matching pool is separate
+        REQUIRE(api_client.getOrderbook("BTC-PERPETUAL", 10).find("error") == std::string::npos);
+    }
+    
+    SECTION("Queue mode sends every request at the refill rate") {
+        api_client.setRateLimitMode(ApiClient::RateLimitMode::QUEUE);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 8; ++i) {
+            REQUIRE(api_client.cancelOrder("mock_order_id"));
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        
+        // 3 from the burst, then 5 at 10 ms each
+        REQUIRE(elapsed >= std::chrono::milliseconds(45));
+    }
+}
+
+TEST_CASE("OutboundQueue priority lanes", "[api_client]") {
+    OutboundQueue queue;
+    auto drain = [&queue]() {
+        std::vector<std::string> frames;
+        std::string frame;
+        while (queue.pop(frame)) {
+            frames.push_back(frame);
+        }
+        return frames;
+    };
+    
+    SECTION("Lanes drain highest priority first, FIFO within a lane") {
+        queue.push("query", OutboundPriority::QUERY);
+        queue.push("sub1", OutboundPriority::SUBSCRIPTION);
+        queue.push("new1", OutboundPriority::NEW_ORDER, "a");
+        queue.push("sub2", OutboundPriority::SUBSCRIPTION);
+        queue.push("new2", OutboundPriority::NEW_ORDER, "b");
+        queue.push("edit", OutboundPriority::MODIFY, "c");
+        queue.push("cancel", OutboundPriority::CANCEL, "d");
+        REQUIRE(queue.size() == 7);
+        REQUIRE(queue.size(OutboundPriority::SUBSCRIPTION) == 2);
+        
+        std::vector<std::string> expected = {"cancel", "edit", "new1", "new2", "sub1", "sub2", "query"};
+        REQUIRE(drain() == expected);
+        REQUIRE(queue.empty());
+    }
+    
+    SECTION("A cancel never overtakes its own order") {
+        queue.push("new-other", OutboundPriority::NEW_ORDER, "x");
+        queue.push("new-a", OutboundPriority::NEW_ORDER, "a");
+        queue.push("edit-a", OutboundPriority::MODIFY, "a");
+        queue.push("cancel-b", OutboundPriority::CANCEL, "b");
+        queue.push("cancel-a", OutboundPriority::CANCEL, "a");
+        
+        // new-a and edit-a ride up into the cancel lane, ahead of cancel-a
+        std::vector<std::string> expected = {"cancel-b", "new-a", "edit-a", "cancel-a", "new-other"};
+        REQUIRE(drain() == expected);
+    }
+    
+    SECTION("Frames for the same order in the same lane stay FIFO") {
+        queue.push("edit-a1", OutboundPriority::MODIFY, "a");
+        queue.push("edit-a2", OutboundPriority::MODIFY, "a");
+        queue.push("cancel-a", OutboundPriority::CANCEL, "a");
+        queue.push("edit-a3", OutboundPriority::MODIFY, "a");
+        
+        std::vector<std::string> expected = {"edit-a1", "edit-a2", "cancel-a", "edit-a3"};
+        REQUIRE(drain() == expected);
+    }
+    
+    SECTION("Methods map to lanes") {
+        REQUIRE(OutboundQueue::priorityFor("private/cancel") == OutboundPriority::CANCEL);
+        REQUIRE(OutboundQueue::priorityFor("private/cancel_all_by_instrument") == OutboundPriority::CANCEL);
+        REQUIRE(OutboundQueue::priorityFor("private/edit") == OutboundPriority::MODIFY);
+        REQUIRE(OutboundQueue::priorityFor("private/sell") == OutboundPriority::NEW_ORDER);
+        REQUIRE(OutboundQueue::priorityFor("public/subscribe") == OutboundPriority::SUBSCRIPTION);
+        REQUIRE(OutboundQueue::priorityFor("public/get_order_book") == OutboundPriority::QUERY);
+    }
+}
+
 // Note: WebSocket tests require a running server and are more complex,
 // so we're not including them in this basic test suite
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string>
+
+// Define Catch version before including it
+#define CATCH_VERSION_MAJOR 2
+#define CATCH_VERSION_MINOR 13
+#define CATCH_VERSION_PATCH 9
+#include <catch2/catch.hpp>
+
+#include "config.h"
+
+namespace {
+
+// Environment backed by a map instead of the process environment
+Config::Environment fakeEnvironment(const std::map<std::string, std::string>& variables) {
+    return [variables](const char* name) -> const char* {
+        auto it = variables.find(name);
+        return it == variables.end() ? nullptr : it->second.c_str();
+    };
+}
+
+}
+
+TEST_CASE("Config defaults", "[config]") {
+    Config config;
+    std::string error;
+    REQUIRE(Config::load("", config, error, fakeEnvironment({})));
+    
+    REQUIRE(config.endpoint.host == "test.deribit.com");
+    REQUIRE(config.endpoint.port == "443");
+    REQUIRE(config.endpoint.path == "/ws/api/v2");
+    REQUIRE(config.endpoint.tls);
+    REQUIRE(config.auth.client_id.empty());
+    REQUIRE(config.rate_limit == ApiClient::RateLimitMode::QUEUE);
+    REQUIRE(config.instruments == std::vector<std::string>{"BTC-PERPETUAL", "ETH-PERPETUAL"});
+    REQUIRE(config.server_port == 8080);
+    REQUIRE(config.server_cpus.empty());
+    REQUIRE(config.risk_limits.max_order_size == 100000.0);
+    REQUIRE(config.risk_limits.max_notional == std::numeric_limits<double>::infinity());
+    REQUIRE(config.risk_limits.price_band == 0.05);
+    REQUIRE(config.risk_max_messages == 20);
+}
+
+TEST_CASE("Config file and environment layers", "[config]") {
+    const char* path = "config_test.json";
+    {
+        std::ofstream file(path);
+        file << R"({
+            "exchange": {"host": "127.0.0.1", "port": 9000, "tls": false, "client_id": "from-file", "rate_limit": "reject"},
+            "market_data": {"instruments": ["BTC-PERPETUAL"], "book_interval": "raw", "journal_file_size": "64M"},
+            "server": {"threads": 4, "cpus": [2, 3], "max_queued_messages": 1024},
+            "risk": {"max_order_size": 5000, "max_notional": 2e6, "price_band": 0.02, "max_open_orders": 10}
+        })";
+    }
+    
+    SECTION("File overrides defaults") {
+        Config config;
+        std::string error;
+        REQUIRE(Config::load(path, config, error, fakeEnvironment({})));
+        REQUIRE(config.endpoint.host == "127.0.0.1");
+        REQUIRE(config.endpoint.port == "9000");
+        REQUIRE_FALSE(config.endpoint.tls);
+        REQUIRE(config.endpoint.path == "/ws/api/v2");
+        REQUIRE(config.auth.client_id == "from-file");
+        REQUIRE(config.rate_limit == ApiClient::RateLimitMode::REJECT);
+        REQUIRE(config.instruments == std::vector<std::string>{"BTC-PERPETUAL"});
+        REQUIRE(config.book_interval == "raw");
+        REQUIRE(config.journal_file_size == 64u << 20);
+        REQUIRE(config.server_threads == 4);
+        REQUIRE(config.server_cpus == std::vector<int>{2, 3});
+        REQUIRE(config.max_queued_messages == 1024);
+        REQUIRE(config.risk_limits.max_order_size == 5000.0);
+        REQUIRE(config.risk_limits.max_notional == 2e6);
+        REQUIRE(config.risk_limits.price_band == 0.02);
+        REQUIRE(config.risk_limits.max_open_orders == 10);
+        REQUIRE(config.risk_limits.max_position == 1000000.0);
+    }
+    
+    SECTION("Environment overrides the file") {
+        Config config;
+        std::string error;
+        REQUIRE(Config::load(path, config, error, fakeEnvironment({
+            {"DERIBIT_CLIENT_ID", "from-env"},
+            {"DERIBIT_CLIENT_SECRET", "secret"},
+            {"DERIBIT_TLS", "on"},
+            {"DERIBIT_INSTRUMENTS", "ETH-PERPETUAL, SOL-PERPETUAL"},
+            {"DERIBIT_SERVER_CPUS", "0,4-6"},
+            {"DERIBIT_RISK_MAX_ORDER_SIZE", "off"},
+            {"DERIBIT_RISK_MAX_MESSAGES", "0"}
+        })));
+        REQUIRE(config.auth.client_id == "from-env");
+        REQUIRE(config.auth.client_secret == "secret");
+        REQUIRE(config.endpoint.tls);
+        REQUIRE(config.endpoint.host == "127.0.0.1");
+        REQUIRE(config.instruments == std::vector<std::string>{"ETH-PERPETUAL", "SOL-PERPETUAL"});
+        REQUIRE(config.server_cpus == std::vector<int>{0, 4, 5, 6});
+        REQUIRE(config.risk_limits.max_order_size == std::numeric_limits<double>::infinity());
+        REQUIRE(config.risk_limits.price_band == 0.02);
+        REQUIRE(config.risk_max_messages == 0);
+    }
+    
+    std::remove(path);
+}
+
+TEST_CASE("Config rejects bad input", "[config]") {
+    Config config;
+    std::string error;
+    
+    SECTION("Unknown key") {
+        REQUIRE_FALSE(config.applyJson(R"({"server": {"prot": 8080}})", error));
+        REQUIRE(error == "unknown setting server.prot");
+    }
+    
+    SECTION("Malformed values") {
+        REQUIRE_FALSE(config.set("server.port", "80a", error));
+        REQUIRE_FALSE(config.set("exchange.port", "70000", error));
+        REQUIRE_FALSE(config.set("exchange.tls", "maybe", error));
+        REQUIRE_FALSE(config.set("market_data.book_interval", "5ms", error));
+        REQUIRE_FALSE(config.set("server.cpus", "3-1", error));
+        REQUIRE_FALSE(config.set("risk.max_order_size", "-1", error));
+        REQUIRE_FALSE(config.set("risk.price_band", "five", error));
+        REQUIRE(config.server_port == 8080);
+    }
+    
+    SECTION("Bad environment variable names its source") {
+        REQUIRE_FALSE(Config::load("", config, error, fakeEnvironment({{"DERIBIT_SERVER_THREADS", "0"}})));
+        REQUIRE(error.find("DERIBIT_SERVER_THREADS") != std::string::npos);
+    }
+    
+    SECTION("Missing file") {
+        REQUIRE_FALSE(Config::load("does-not-exist.json", config, error, fakeEnvironment({})));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <chrono>
+
+// Define Catch version before including it
+#define CATCH_VERSION_MAJOR 2
+#define CATCH_VERSION_MINOR 13
+#define CATCH_VERSION_PATCH 9
+#include <catch2/catch.hpp>
+
+#include "frame_journal.h"
+#include "replay_engine.h"
+#include "market_data.h"
+#include "order_manager.h"
+#include "api_client.h"
+
+namespace {
+
+// Records copied out, since a JournalRecord points into the reader's mapping
+struct Frame {
+    int64_t realtime_ns;
+    uint64_t tsc;
+    std::string frame;
+};
+
+std::vector<Frame> readAll(const std::string& path) {
+    std::vector<Frame> frames;
+    JournalReader reader(path);
+    JournalRecord record;
+    while (reader.next(record)) {
+        frames.push_back(Frame{record.realtime_ns, record.tsc, std::string(record.frame)});
+    }
+    return frames;
+}
+
+} // namespace
+
+TEST_CASE("FrameJournal recording and rotation", "[frame_journal]") {
+    std::string directory = (std::filesystem::temp_directory_path() / "deribit_frame_journal_test").string();
+    std::filesystem::remove_all(directory);
+    
+    SECTION("Frames round-trip with their stamps") {
+        {
+            FrameJournal journal(directory, "md", 1 << 20);
+            REQUIRE(journal.isOpen());
+            REQUIRE(journal.append("first", 5, 1000, 42));
+            REQUIRE(journal.append(std::string(R"({"method":"subscription"})")));
+            REQUIRE(journal.append(std::string(13, 'x')));
+            REQUIRE(journal.framesWritten() == 3);
+            
+            // Records are visible while the journal is still open
+            JournalReader live(journal.currentPath());
+            JournalRecord record;
+            REQUIRE(live.next(record));
+            REQUIRE(record.frame == "first");
+        }
+        
+        std::vector<std::string> files = FrameJournal::listFiles(directory, "md");
+        REQUIRE(files.size() == 1);
+        
+        std::vector<Frame> records = readAll(files[0]);
+        REQUIRE(records.size() == 3);
+        REQUIRE(records[0].frame == "first");
+        REQUIRE(records[0].realtime_ns == 1000);
+        REQUIRE(records[0].tsc == 42);
+        REQUIRE(records[1].frame == R"({"method":"subscription"})");
+        REQUIRE(records[1].realtime_ns > 1000);
+        REQUIRE(records[2].frame == std::string(13, 'x'));
+        
+        // Closed files are trimmed to the data written
+        REQUIRE(std::filesystem::file_size(files[0]) < 4096);
+    }
+    
+    SECTION("Full files rotate to the next sequence number") {
+        std::string frame(1000, 'a');
+        size_t written = 0;
+        {
+            FrameJournal journal(directory, "md", 16384);
+            for (int i = 0; i < 100; ++i) {
+                frame[0] = static_cast<char>('A' + i % 26);
+                if (journal.append(frame)) {
+                    ++written;
+                } else {
+                    // The next file is prepared in the background; give it a moment
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                }
+            }
+            REQUIRE(journal.rotations() > 0);
+            REQUIRE(journal.framesWritten() == written);
+            REQUIRE(journal.framesWritten() + journal.framesDropped() == 100);
+        }
+        
+        std::vector<std::string> files = FrameJournal::listFiles(directory, "md");
+        REQUIRE(files.size() > 1);
+        
+        size_t total = 0;
+        for (const std::string& file : files) {
+            for (const Frame& record : readAll(file)) {
+                REQUIRE(record.frame.size() == 1000);
+                ++total;
+            }
+        }
+        REQUIRE(total == written);
+        
+        // A new journal continues the numbering
+        FrameJournal next(directory, "md", 16384);
+        REQUIRE(next.currentPath() > files.back());
+    }
+    
+    SECTION("Files that are not numbered journals are ignored") {
+        std::filesystem::create_directories(directory);
+        std::ofstream(directory + "/md-old.journal") << "stray";
+        std::ofstream(directory + "/md-000007.journal.bak") << "stray";
+        {
+            FrameJournal journal(directory, "md", 4096);
+            REQUIRE(journal.isOpen());
+        }
+        
+        std::vector<std::string> files = FrameJournal::listFiles(directory, "md");
+        REQUIRE(files.size() == 1);
+        REQUIRE(std::filesystem::path(files[0]).filename() == "md-000000.journal");
+    }
+    
+    SECTION("Frames larger than a file are dropped") {
+        FrameJournal journal(directory, "md", 4096);
+        REQUIRE_FALSE(journal.append(std::string(8192, 'z')));
+        REQUIRE(journal.framesDropped() == 1);
+    }
+    
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("FrameJournal keeps tokens off disk", "[frame_journal]") {
+    // Auth requests and token replies are dropped
+    REQUIRE(FrameJournal::carriesToken(
+        R"({"jsonrpc": "2.0", "id": 9929, "method" : "public/auth", "params": {"grant_type": "client_credentials"}})"));
+    REQUIRE(FrameJournal::carriesToken(
+        R"({"jsonrpc":"2.0","id":1,"result":{"access_token":"secret","refresh_token":"secret","expires_in":900}})"));
+    REQUIRE(FrameJournal::carriesToken(R"({"jsonrpc":"2.0","id":7,"result":{"refresh_token":"secret"}})"));
+    
+    // Market data, private channels and other replies are recorded
+    REQUIRE_FALSE(FrameJournal::carriesToken(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.none.10.100ms","data":{}}})"));
+    REQUIRE_FALSE(FrameJournal::carriesToken(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"user.orders.BTC-PERPETUAL.raw","data":{"label":"my_access_token_order"}}})"));
+    REQUIRE_FALSE(FrameJournal::carriesToken(R"({"jsonrpc":"2.0","id":2,"result":["book.BTC-PERPETUAL.none.10.100ms"]})"));
+    REQUIRE_FALSE(FrameJournal::carriesToken("not json"));
+}
+
+TEST_CASE("ReplayEngine replays recorded frames", "[frame_journal]") {
+    std::string directory = (std::filesystem::temp_directory_path() / "deribit_replay_test").string();
+    std::filesystem::remove_all(directory);
+    
+    auto notification = [](const std::string& channel, const std::string& data) {
+        return R"({"jsonrpc": "2.0", "method": "subscription", "params": {"channel": ")" + channel +
+               R"(", "data": )" + data + "}}";
+    };
+    
+    // Three book updates 20 ms apart and a fill
+    const int64_t base_ns = 1700000000000000000;
+    {
+        FrameJournal journal(directory, "md", 1 << 20);
+        for (int i = 0; i < 3; ++i) {
+            std::string book = notification("book.BTC-PERPETUAL.none.10.100ms",
+                R"({"bids": [[)" + std::to_string(50000 + i) + R"(, 1.0]], "asks": [[50010.0, 2.0]]})");
+            journal.append(book.data(), book.size(), base_ns + i * 20000000, i);
+        }
+        std::string fill = notification("user.trades.any.any.raw",
+            R"([{"trade_id": "t1", "order_id": "1", "instrument_name": "BTC-PERPETUAL",
+                 "direction": "sell", "price": 50001.0, "amount": 0.3}])");
+        journal.append(fill.data(), fill.size(), base_ns + 60000000, 3);
+    }
+    std::vector<std::string> files = FrameJournal::listFiles(directory, "md");
+    
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    
+    SECTION("As fast as possible through the router") {
+        MarketDataClient market_data(api_client);
+        OrderManager order_manager(api_client);
+        auto router = std::make_shared<MessageRouter>();
+        market_data.registerRoutes(*router);
+        order_manager.registerRoutes(*router);
+        
+        std::vector<double> best_bids;
+        market_data.setOrderbookCallback([&best_bids](const Orderbook& orderbook) {
+            best_bids.push_back(orderbook.bids[0].price);
+        });
+        
+        ReplayEngine replay(files);
+        replay.setTarget(router);
+        ReplayStats stats = replay.run();
+        
+        REQUIRE(stats.frames == 4);
+        REQUIRE(stats.recorded_ns == 60000000);
+        REQUIRE(stats.elapsed_ns < stats.recorded_ns);
+        REQUIRE(best_bids == std::vector<double>{50000.0, 50001.0, 50002.0});
+        REQUIRE(order_manager.getCurrentPositions().at("BTC-PERPETUAL") == -0.3);
+        
+        // The same journal replays identically
+        best_bids.clear();
+        replay.run();
+        REQUIRE(best_bids == std::vector<double>{50000.0, 50001.0, 50002.0});
+    }
+    
+    SECTION("Into processMessage with a frame limit") {
+        MarketDataClient market_data(api_client);
+        ReplayEngine replay(files);
+        replay.setTarget(market_data);
+        
+        ReplayOptions options;
+        options.max_frames = 2;
+        REQUIRE(replay.run(options).frames == 2);
+        REQUIRE(market_data.getOrderbook("BTC-PERPETUAL").bids[0].price == 50001.0);
+    }
+    
+    SECTION("Paced at recorded and scaled speed") {
+        std::vector<int64_t> stamps;
+        ReplayEngine replay(files);
+        replay.setHandler([&stamps](const std::string&, int64_t realtime_ns) {
+            stamps.push_back(realtime_ns);
+        });
+        
+        ReplayOptions options;
+        options.speed = 1.0;
+        ReplayStats stats = replay.run(options);
+        REQUIRE(stats.frames == 4);
+        REQUIRE(stats.elapsed_ns >= 60000000);
+        REQUIRE(stamps.front() == base_ns);
+        
+        options.speed = 3.0;
+        stats = replay.run(options);
+        REQUIRE(stats.elapsed_ns >= 20000000);
+        REQUIRE(stats.elapsed_ns < 60000000);
+    }
+    
+    std::filesystem::remove_all(directory);
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Define Catch version before including it
+#define CATCH_VERSION_MAJOR 2
+#define CATCH_VERSION_MINOR 13
+#define CATCH_VERSION_PATCH 9
+#include <catch2/catch.hpp>
+
+#include "latency_histogram.h"
+
+TEST_CASE("LatencyHistogram percentiles", "[latency_histogram]") {
+    LatencyHistogram histogram;
+    
+    SECTION("Small values are exact") {
+        for (int64_t v = 1; v <= 1000; ++v) {
+            histogram.record(v);
+        }
+        REQUIRE(histogram.count() == 1000);
+        REQUIRE(histogram.min() == 1);
+        REQUIRE(histogram.max() == 1000);
+        REQUIRE(histogram.mean() == Approx(500.5));
+        REQUIRE(histogram.valueAtPercentile(50) == 500);
+        REQUIRE(histogram.valueAtPercentile(99) == 990);
+        REQUIRE(histogram.valueAtPercentile(99.9) == 999);
+        REQUIRE(histogram.valueAtPercentile(100) == 1000);
+    }
+    
+    SECTION("Large values keep three significant digits") {
+        std::mt19937_64 rng(1);
+        std::lognormal_distribution<double> distribution(10.0, 2.0);
+        std::vector<int64_t> values;
+        for (int i = 0; i < 200000; ++i) {
+            values.push_back(static_cast<int64_t>(distribution(rng)));
+            histogram.record(values.back());
+        }
+        std::sort(values.begin(), values.end());
+        
+        for (double percentile : {50.0, 90.0, 99.0, 99.9, 99.99}) {
+            size_t rank = static_cast<size_t>(percentile / 100.0 * values.size() + 0.5) - 1;
+            double exact = static_cast<double>(values[rank]);
+            REQUIRE(histogram.valueAtPercentile(percentile) >= exact);
+            REQUIRE(histogram.valueAtPercentile(percentile) <= exact * 1.001 + 1);
+        }
+        REQUIRE(histogram.max() == values.back());
+    }
+    
+    SECTION("Out of range values are clamped") {
+        LatencyHistogram bounded(1000000);
+        bounded.record(-5);
+        bounded.record(5000000);
+        REQUIRE(bounded.min() == 0);
+        REQUIRE(bounded.max() == 1000000);
+        REQUIRE(bounded.count() == 2);
+    }
+    
+    SECTION("Summary and CSV") {
+        histogram.record(100, 99);
+        histogram.record(2000000);
+        REQUIRE(histogram.summary() == "p50/p90/p99/p99.9/p99.99/max: 100 / 100 / 100 / 2000000 / 2000000 / 2000000 ns");
+        REQUIRE(histogram.summary("us", 1000).find("2000.0 us") != std::string::npos);
+        REQUIRE(histogram.toCsv().find("percentile,value_ns,count\n99.000000,100,99\n") == 0);
+    }
+}
+
+TEST_CASE("LatencyHistogram merge and correction", "[latency_histogram]") {
+    SECTION("Merging matches recording into one histogram") {
+        LatencyHistogram a;
+        LatencyHistogram b;
+        LatencyHistogram both;
+        for (int64_t v = 0; v < 100000; v += 7) {
+            (v % 2 ? a : b).record(v * 13);
+            both.record(v * 13);
+        }
+        REQUIRE(a.merge(b));
+        REQUIRE(a.count() == both.count());
+        REQUIRE(a.min() == both.min());
+        REQUIRE(a.max() == both.max());
+        for (double percentile : {50.0, 99.0, 99.99}) {
+            REQUIRE(a.valueAtPercentile(percentile) == both.valueAtPercentile(percentile));
+        }
+        
+        LatencyHistogram other_layout(1000, 8);
+        REQUIRE_FALSE(a.merge(other_layout));
+        REQUIRE(a.count() == both.count());
+    }
+    
+    SECTION("Coordinated omission correction backfills stalled sends") {
+        LatencyHistogram corrected;
+        
+        // Paced at 100 ns: one 1000 ns stall hid nine sends that would have waited 900..100 ns
+        for (int i = 0; i < 90; ++i) {
+            corrected.recordCorrected(10, 100);
+        }
+        corrected.recordCorrected(1000, 100);
+        REQUIRE(corrected.count() == 100);
+        REQUIRE(corrected.valueAtPercentile(90) == 10);
+        REQUIRE(corrected.valueAtPercentile(95) == 500);
+        REQUIRE(corrected.max() == 1000);
+        
+        // Without an interval nothing is added
+        LatencyHistogram plain;
+        plain.recordCorrected(1000, 0);
+        REQUIRE(plain.count() == 1);
+    }
+    
+    SECTION("Reset empties the histogram") {
+        LatencyHistogram histogram;
+        histogram.record(42);
+        histogram.reset();
+        REQUIRE(histogram.count() == 0);
+        REQUIRE(histogram.max() == 0);
+        REQUIRE(histogram.valueAtPercentile(50) == 0);
+    }
+}
\ No newline at end of file
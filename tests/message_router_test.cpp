@@ -0,0 +1,90 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+// Define Catch version before including it
+#define CATCH_VERSION_MAJOR 2
+#define CATCH_VERSION_MINOR 13
+#define CATCH_VERSION_PATCH 9
+#include <catch2/catch.hpp>
+
+#include "message_router.h"
+#include "market_data.h"
+#include "order_manager.h"
+#include "api_client.h"
+
+TEST_CASE("MessageRouter channel dispatch", "[message_router]") {
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    OrderManager order_manager(api_client);
+    MarketDataClient market_data(api_client);
+    
+    MessageRouter router;
+    market_data.registerRoutes(router);
+    order_manager.registerRoutes(router);
+    
+    auto notification = [](const std::string& channel, const std::string& data) {
+        return R"({"jsonrpc": "2.0", "method": "subscription", "params": {"channel": ")" + channel +
+               R"(", "data": )" + data + "}}";
+    };
+    
+    SECTION("Book updates reach MarketDataClient") {
+        std::vector<std::string> updated;
+        market_data.setOrderbookCallback([&updated](const Orderbook& orderbook) {
+            updated.push_back(orderbook.instrument);
+        });
+        
+        router.route(notification("book.BTC-PERPETUAL.none.10.100ms",
+                                  R"({"bids": [[50000.0, 1.5]], "asks": [[50010.0, 2.0]]})"));
+        
+        REQUIRE(updated == std::vector<std::string>{"BTC-PERPETUAL"});
+        Orderbook orderbook = market_data.getOrderbook("BTC-PERPETUAL");
+        REQUIRE(orderbook.bids.size() == 1);
+        REQUIRE(orderbook.asks[0].price == 50010.0);
+    }
+    
+    SECTION("Private channels reach OrderManager") {
+        std::string label = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.2);
+        
+        router.route(notification("user.orders.any.any.raw",
+                                  R"({"order_id": "28410", "label": ")" + label +
+                                  R"(", "order_state": "filled", "filled_amount": 0.2})"));
+        REQUIRE(order_manager.getOrder("28410").status == Order::Status::FILLED);
+        
+        std::vector<Trade> trades;
+        order_manager.setTradeCallback([&trades](const Trade& trade) {
+            trades.push_back(trade);
+        });
+        router.route(notification("user.trades.any.any.raw",
+                                  R"([{"trade_id": "t1", "order_id": "28410", "instrument_name": "BTC-PERPETUAL",
+                                       "direction": "buy", "price": 50000.0, "amount": 0.2, "fee": 0.0001}])"));
+        REQUIRE(trades.size() == 1);
+        REQUIRE(trades[0].side == Order::Side::BUY);
+        REQUIRE(trades[0].amount == 0.2);
+        REQUIRE(order_manager.getCurrentPositions().at("BTC-PERPETUAL") == 0.2);
+        
+        router.route(notification("user.portfolio.btc",
+                                  R"({"currency": "BTC", "equity": 1.25, "balance": 1.2, "total_pl": 0.05})"));
+        REQUIRE(order_manager.getPortfolio("BTC").equity == 1.25);
+        REQUIRE(router.routedCount() == 3);
+    }
+    
+    SECTION("Unknown channels and malformed frames are counted, not dispatched") {
+        router.route(notification("ticker.BTC-PERPETUAL.raw", "{}"));
+        router.route("not json");
+        router.route(R"({"jsonrpc": "2.0", "id": 1, "result": []})");
+        REQUIRE(router.routedCount() == 0);
+        REQUIRE(router.unroutedCount() == 3);
+    }
+    
+    SECTION("Longest prefix wins") {
+        std::string hit;
+        router.addRoute("user.", [&hit](const std::string&, const nlohmann::json&) { hit = "user."; });
+        router.addRoute("user.changes.", [&hit](const std::string&, const nlohmann::json&) { hit = "user.changes."; });
+        
+        router.route(notification("user.changes.BTC-PERPETUAL.raw", "{}"));
+        REQUIRE(hit == "user.changes.");
+        router.route(notification("user.access_log", "{}"));
+        REQUIRE(hit == "user.");
+    }
+}
\ No newline at end of file
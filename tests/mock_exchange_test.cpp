@@ -0,0 +1,289 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Define Catch version before including it
+#define CATCH_VERSION_MAJOR 2
+#define CATCH_VERSION_MINOR 13
+#define CATCH_VERSION_PATCH 9
+#include <catch2/catch.hpp>
+
+#include "mock_exchange.h"
+#include "api_client.h"
+#include "market_data.h"
+#include "message_router.h"
+#include "order_manager.h"
+
+#define NLOHMANN_JSON_VERSION_MAJOR 3
+#define NLOHMANN_JSON_VERSION_MINOR 11
+#define NLOHMANN_JSON_VERSION_PATCH 2
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+bool waitFor(const std::function<bool()>& condition, int timeout_ms = 5000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (condition()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return condition();
+}
+
+std::shared_ptr<ApiClient> mockClient(const MockExchange& exchange) {
+    ApiClient::Auth auth;
+    auth.client_id = "mock";
+    auth.client_secret = "mock";
+    auto client = std::make_shared<ApiClient>(auth);
+    
+    ApiClient::Endpoint endpoint;
+    endpoint.host = "127.0.0.1";
+    endpoint.port = std::to_string(exchange.port());
+    endpoint.tls = false;
+    client->setEndpoint(endpoint);
+    return client;
+}
+
+// Parsed frames received on a raw connection
+class FrameLog {
+public:
+    void add(const std::string& frame) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frames_.push_back(json::parse(frame));
+    }
+    
+    // First frame matching the predicate, or null
+    json find(const std::function<bool(const json&)>& match) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& frame : frames_) {
+            if (match(frame)) return frame;
+        }
+        return json();
+    }
+    
+private:
+    mutable std::mutex mutex_;
+    std::vector<json> frames_;
+};
+
+bool isResponse(const json& frame, uint64_t id) {
+    return frame.contains("id") && frame["id"] == id;
+}
+
+bool isNotification(const json& frame, const std::string& channel_prefix) {
+    return frame.value("method", "") == "subscription" &&
+           frame["params"]["channel"].get<std::string>().compare(0, channel_prefix.size(), channel_prefix) == 0;
+}
+
+}
+
+TEST_CASE("MockExchange streams books to MarketDataClient", "[mock_exchange]") {
+    MockExchangeConfig config;
+    config.instruments = {"BTC-PERPETUAL", "ETH-PERPETUAL"};
+    config.book_updates_per_second = 500;
+    MockExchange exchange(config);
+    REQUIRE(exchange.start());
+    REQUIRE(exchange.port() != 0);
+    
+    auto client = mockClient(exchange);
+    auto router = std::make_shared<MessageRouter>();
+    MarketDataClient market_data(client);
+    market_data.setRouter(router);
+    
+    std::atomic<int> updates{0};
+    market_data.setOrderbookCallback([&updates](const Orderbook& book) {
+        if (book.instrument == "BTC-PERPETUAL" && !book.bids.empty() && !book.asks.empty() &&
+            book.bids[0].price < book.asks[0].price) {
+            ++updates;
+        }
+    });
+    market_data.subscribe("BTC-PERPETUAL");
+    market_data.start();
+    
+    REQUIRE(waitFor([&updates]() { return updates >= 20; }));
+    
+    Orderbook book = market_data.getOrderbook("BTC-PERPETUAL");
+    REQUIRE(book.bids.size() == config.book_depth);
+    REQUIRE(book.asks.size() == config.book_depth);
+    REQUIRE(market_data.getOrderbook("ETH-PERPETUAL").bids.empty());
+    
+    market_data.stop();
+    client->closeWebSocket();
+    MockExchange::Stats stats = exchange.stats();
+    REQUIRE(stats.connections == 1);
+    REQUIRE(stats.book_updates >= 20);
+}
+
+TEST_CASE("MockExchange matches orders", "[mock_exchange]") {
+    MockExchangeConfig config;
+    config.book_updates_per_second = 0;  // a still book keeps prices predictable
+    config.initial_price = 100.0;
+    config.tick_size = 1.0;
+    MockExchange exchange(config);
+    REQUIRE(exchange.start());
+    
+    auto client = mockClient(exchange);
+    FrameLog log;
+    client->connectWebSocket([&log](const std::string& frame) { log.add(frame); });
+    client->subscribeToChannels({"user.orders.any.any.raw", "user.trades.any.any.raw"}, true);
+    client->subscribeToChannels({"trades.BTC-PERPETUAL.raw"}, false);
+    
+    // Authenticated before the subscriptions were answered
+    REQUIRE(waitFor([&log]() { return !log.find([](const json& f) { return isResponse(f, 4235); }).is_null(); }));
+    REQUIRE_FALSE(log.find([](const json& f) { return isResponse(f, 9929) && f.contains("result"); }).is_null());
+    
+    SECTION("Marketable order fills at the touch") {
+        client->sendWebSocketRequest("private/buy",
+            R"({"instrument_name": "BTC-PERPETUAL", "amount": 10, "type": "limit", "price": 105, "label": "fill-me"})");
+        
+        REQUIRE(waitFor([&log]() { return !log.find([](const json& f) { return isNotification(f, "trades."); }).is_null(); }));
+        json response = log.find([](const json& f) { return f.contains("result") && f["result"].contains("order"); });
+        REQUIRE(response["result"]["order"]["order_state"] == "filled");
+        REQUIRE(response["result"]["trades"].size() == 1);
+        REQUIRE(response["result"]["trades"][0]["price"] == 101.0);
+        
+        json trade = log.find([](const json& f) { return isNotification(f, "user.trades."); });
+        REQUIRE(trade["params"]["data"][0]["label"] == "fill-me");
+        json order = log.find([](const json& f) { return isNotification(f, "user.orders."); });
+        REQUIRE(order["params"]["data"]["filled_amount"] == 10.0);
+    }
+    
+    SECTION("Resting order can be edited and cancelled") {
+        client->sendWebSocketRequest("private/sell",
+            R"({"instrument_name": "BTC-PERPETUAL", "amount": 5, "type": "limit", "price": 120, "label": "rest"})");
+        REQUIRE(waitFor([&log]() { return !log.find([](const json& f) { return f.contains("result") && f["result"].contains("order"); }).is_null(); }));
+        json placed = log.find([](const json& f) { return f.contains("result") && f["result"].contains("order"); });
+        REQUIRE(placed["result"]["order"]["order_state"] == "open");
+        std::string order_id = placed["result"]["order"]["order_id"];
+        
+        client->sendWebSocketRequest("private/edit",
+            R"({"order_id": ")" + order_id + R"(", "amount": 7, "price": 110})", order_id);
+        client->sendWebSocketRequest("private/cancel", R"({"order_id": ")" + order_id + R"("})", order_id);
+        client->sendWebSocketRequest("private/cancel", R"({"order_id": ")" + order_id + R"("})", order_id);
+        
+        REQUIRE(waitFor([&log]() { return !log.find([](const json& f) { return f.contains("error"); }).is_null(); }));
+        json edited = log.find([](const json& f) { return f.contains("result") && f["result"].contains("order") &&
+                                                          f["result"]["order"]["amount"] == 7.0; });
+        REQUIRE(edited["result"]["order"]["price"] == 110.0);
+        json cancelled = log.find([](const json& f) { return f.contains("result") && f["result"].is_object() &&
+                                                             f["result"].value("order_state", "") == "cancelled"; });
+        REQUIRE_FALSE(cancelled.is_null());
+        
+        // A second cancel finds nothing
+        json error = log.find([](const json& f) { return f.contains("error"); });
+        REQUIRE(error["error"]["code"] == 10004);
+        REQUIRE(log.find([](const json& f) { return isNotification(f, "trades."); }).is_null());
+    }
+    
+    SECTION("WebSocket requests draw on the credit pools") {
+        CreditTracker::Limits limits;
+        limits.max_credits = 2 * ApiClient::kRequestCost;
+        limits.refill_per_second = 1;
+        client->setCreditLimits(ApiClient::CreditPool::MATCHING_ENGINE, limits);
+        client->setRateLimitMode(ApiClient::RateLimitMode::REJECT);
+        uint64_t orders = exchange.stats().orders;
+        
+        const std::string order = R"({"instrument_name": "BTC-PERPETUAL", "amount": 1, "type": "limit", "price": 90})";
+        REQUIRE(client->sendWebSocketRequest("private/buy", order));
+        REQUIRE(client->sendWebSocketRequest("private/buy", order));
+        REQUIRE_FALSE(client->sendWebSocketRequest("private/buy", order));
+        REQUIRE_FALSE(client->sendWebSocketRequest("private/cancel", R"({"order_id": "none"})"));
+        
+        // The non-matching pool is separate
+        REQUIRE(client->sendWebSocketRequest("private/get_everything", "{}"));
+        REQUIRE(waitFor([&log]() { return !log.find([](const json& f) { return f.contains("error"); }).is_null(); }));
+        REQUIRE(waitFor([&]() { return exchange.stats().orders == orders + 2; }));
+    }
+    
+    SECTION("Unknown methods are rejected") {
+        client->sendWebSocketRequest("private/get_everything", "{}");
+        REQUIRE(waitFor([&log]() { return !log.find([](const json& f) { return f.contains("error"); }).is_null(); }));
+        REQUIRE(log.find([](const json& f) { return f.contains("error"); })["error"]["code"] == -32601);
+    }
+    
+    client->closeWebSocket();
+    REQUIRE(exchange.stats().connections == 1);
+}
+
+TEST_CASE("Order entry runs as JSON-RPC over the session", "[mock_exchange]") {
+    MockExchangeConfig config;
+    config.book_updates_per_second = 0;
+    config.initial_price = 100.0;
+    config.tick_size = 1.0;
+    MockExchange exchange(config);
+    REQUIRE(exchange.start());
+    
+    auto client = mockClient(exchange);
+    FrameLog log;
+    client->connectWebSocket([&log](const std::string& frame) { log.add(frame); });
+    
+    SECTION("ApiClient calls return the response with their id") {
+        std::string placed = client->placeOrder("BTC-PERPETUAL", false, 120.0, 5.0, "limit", "rest");
+        json response = json::parse(placed);
+        REQUIRE(response["result"]["order"]["order_state"] == "open");
+        REQUIRE(response["result"]["order"]["label"] == "rest");
+        std::string order_id = response["result"]["order"]["order_id"];
+        
+        REQUIRE(client->modifyOrder(order_id, 110.0, 7.0));
+        REQUIRE(client->cancelOrder(order_id));
+        REQUIRE_FALSE(client->cancelOrder(order_id));
+        
+        json filled = json::parse(client->placeOrder("BTC-PERPETUAL", true, 0.0, 10.0, "market"));
+        REQUIRE(filled["result"]["order"]["order_state"] == "filled");
+        
+        client->placeOrder("BTC-PERPETUAL", false, 130.0, 1.0, "limit", "by-label");
+        REQUIRE(client->cancelOrderByLabel("by-label"));
+        client->placeOrder("BTC-PERPETUAL", false, 140.0, 1.0);
+        REQUIRE(client->cancelAllByInstrument("BTC-PERPETUAL"));
+        
+        // Matched responses are not passed on to the message handler
+        REQUIRE(log.find([](const json& f) { return f.contains("result") && f["result"].is_object() &&
+                                                    f["result"].contains("order"); }).is_null());
+    }
+    
+    SECTION("OrderManager binds exchange ids from the responses") {
+        OrderManager order_manager(client, 100, 2);
+        std::string label = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::SELL, 120.0, 5.0);
+        Order order = order_manager.getOrder(label);
+        REQUIRE(order.status == Order::Status::OPEN);
+        REQUIRE(order.label == label);
+        REQUIRE_FALSE(order.order_id.empty());
+        REQUIRE(order.order_id != label);
+        
+        REQUIRE(order_manager.modifyOrder(label, 115.0, 5.0));
+        REQUIRE(order_manager.cancelOrder(label));
+        REQUIRE(order_manager.getOrder(label).status == Order::Status::CANCELLED);
+        REQUIRE_FALSE(order_manager.cancelOrder("no-such-order"));
+        
+        OrderTicket ticket = order_manager.placeOrderAsync("BTC-PERPETUAL", Order::Side::BUY, 105.0, 2.0);
+        OrderAck ack = ticket.ack.get();
+        REQUIRE(ack.success);
+        REQUIRE(ack.order.status == Order::Status::FILLED);
+    }
+    
+    SECTION("Without a session calls take the stubbed path") {
+        REQUIRE_FALSE(client->cancelOrder("warm-up"));  // answered by the exchange
+        uint64_t requests = exchange.stats().requests;
+        client->closeWebSocket();
+        REQUIRE(client->cancelOrder("after-close"));
+        REQUIRE(exchange.stats().requests == requests);
+    }
+    
+    SECTION("Losing the connection fails calls without waiting for the timeout") {
+        REQUIRE_FALSE(client->cancelOrder("warm-up"));
+        exchange.stop();
+        
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE_FALSE(client->cancelOrder("gone"));
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    }
+    
+    client->closeWebSocket();
+}
\ No newline at end of file
@@ -1,5 +1,11 @@
 #include <memory>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <string>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
 
 // Define Catch version before including it
 #define CATCH_VERSION_MAJOR 2
@@ -8,13 +14,17 @@
 #include <catch2/catch.hpp>
 
 #include "order_manager.h"
+#include "order_table.h"
+#include "order_archive.h"
+#include "seqlock.h"
+#include "position_engine.h"
 #include "api_client.h"
 
 TEST_CASE("OrderManager basic functionality", "[order_manager]") {
     // Create API client with test credentials
     ApiClient::Auth auth;
-    auth.client_id = "m_B5zE25";
-    auth.client_secret = "qwHcammuk8D-MEK4idg8urGt_ZAkfk4r_MuIzT9v1LE";
+    auth.client_id = "test-client";
+    auth.client_secret = "test-secret";
     auto api_client = std::make_shared<ApiClient>(auth);
     
     // Create order manager
@@ -122,5 +132,697 @@ TEST_CASE("OrderManager basic functionality", "[order_manager]") {
         REQUIRE(positions.size() == 2);
         REQUIRE(positions.at("BTC-PERPETUAL") == 0.5);
         REQUIRE(positions.at("ETH-PERPETUAL") == -1.0);
+        
+        // A later snapshot flattens instruments it no longer lists
+        order_manager.onPositionUpdate(R"([{"instrument_name": "BTC-PERPETUAL", "size": 0.7, "average_price": 100.0}])");
+        positions = order_manager.getCurrentPositions();
+        REQUIRE(positions.size() == 1);
+        REQUIRE(positions.at("BTC-PERPETUAL") == 0.7);
+        REQUIRE(order_manager.positionEngine()->position("BTC-PERPETUAL").average_price == 100.0);
     }
+}
+
+TEST_CASE("OrderManager client labels", "[order_manager]") {
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    OrderManager order_manager(api_client);
+    
+    std::string label = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1);
+    std::string other = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1);
+    REQUIRE(!label.empty());
+    REQUIRE(label != other);
+    REQUIRE(order_manager.getOrder(label).label == label);
+    
+    SECTION("Exchange id is bound from a user.orders update carrying the label") {
+        order_manager.onOrderUpdate(R"({"order_id": "ETH-4021", "label": ")" + label +
+                                    R"(", "order_state": "open", "filled_amount": 0.05})");
+        
+        Order order = order_manager.getOrder("ETH-4021");
+        REQUIRE(order.label == label);
+        REQUIRE(order.order_id == "ETH-4021");
+        REQUIRE(order.status == Order::Status::PARTIALLY_FILLED);
+        
+        // Still addressable by label
+        REQUIRE(order_manager.getOrder(label).order_id == "ETH-4021");
+        REQUIRE(order_manager.cancelOrder(label));
+        REQUIRE(order_manager.getOrder("ETH-4021").status == Order::Status::CANCELLED);
+    }
+    
+    SECTION("Updates for unknown orders are ignored") {
+        order_manager.onOrderUpdate(R"({"order_id": "ETH-1", "label": "someone-else", "order_state": "filled", "filled_amount": 1.0})");
+        REQUIRE(order_manager.getOrder("ETH-1").status == Order::Status::REJECTED);
+        REQUIRE(order_manager.getOpenOrders().size() == 2);
+    }
+}
+
+TEST_CASE("OrderManager async API", "[order_manager]") {
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    OrderManager order_manager(api_client, 10000, 4);
+    
+    SECTION("Order is tracked as pending until acked") {
+        api_client->setMockLatency(20000);
+        
+        std::atomic<int> callbacks{0};
+        OrderTicket ticket = order_manager.placeOrderAsync("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1,
+            Order::Type::LIMIT, [&callbacks](const OrderAck&) { ++callbacks; });
+        REQUIRE(!ticket.label.empty());
+        REQUIRE(order_manager.getOrder(ticket.label).status == Order::Status::PENDING);
+        
+        OrderAck ack = ticket.ack.get();
+        REQUIRE(ack.success);
+        REQUIRE(ack.order_ref == ticket.label);
+        REQUIRE(ack.order.status == Order::Status::OPEN);
+        REQUIRE(callbacks == 1);
+    }
+    
+    SECTION("A throwing callback still resolves the ticket") {
+        OrderTicket ticket = order_manager.placeOrderAsync("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1,
+            Order::Type::LIMIT, [](const OrderAck&) { throw std::runtime_error("callback failed"); });
+        
+        OrderAck ack = ticket.ack.get();
+        REQUIRE(ack.success);
+        REQUIRE(ack.order.status == Order::Status::OPEN);
+        
+        // The pool thread survived and keeps serving requests
+        REQUIRE(order_manager.cancelOrderAsync(ticket.label).get().success);
+    }
+    
+    SECTION("A burst of orders is in flight at once") {
+        std::vector<OrderTicket> tickets;
+        for (int i = 0; i < 20; ++i) {
+            tickets.push_back(order_manager.placeOrderAsync("BTC-PERPETUAL", Order::Side::SELL, 50000.0 + i, 0.1));
+        }
+        for (auto& ticket : tickets) {
+            REQUIRE(ticket.ack.get().success);
+        }
+        REQUIRE(order_manager.getOpenOrders("BTC-PERPETUAL", Order::Side::SELL).size() == 20);
+        
+        auto modified = order_manager.modifyOrderAsync(tickets[0].label, 51000.0, 0.2);
+        auto cancelled = order_manager.cancelOrderAsync(tickets[1].label);
+        REQUIRE(modified.get().order.price == 51000.0);
+        REQUIRE(cancelled.get().order.status == Order::Status::CANCELLED);
+        REQUIRE(order_manager.getOpenOrders().size() == 19);
+    }
+}
+
+TEST_CASE("OrderManager bulk operations", "[order_manager]") {
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    OrderManager order_manager(api_client, 10000, 4);
+    
+    auto prices = [&order_manager](Order::Side side) {
+        std::vector<double> result;
+        for (const Order& order : order_manager.getOpenOrders("BTC-PERPETUAL", side)) {
+            result.push_back(order.price);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    
+    SECTION("Cancel all by instrument and by side") {
+        order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1);
+        order_manager.placeOrder("BTC-PERPETUAL", Order::Side::SELL, 50010.0, 0.1);
+        order_manager.placeOrder("BTC-PERPETUAL", Order::Side::SELL, 50020.0, 0.1);
+        order_manager.placeOrder("ETH-PERPETUAL", Order::Side::BUY, 3000.0, 1.0);
+        
+        REQUIRE(order_manager.cancelAll("BTC-PERPETUAL", Order::Side::SELL) == 2);
+        REQUIRE(order_manager.openOrderCount("BTC-PERPETUAL") == 1);
+        
+        REQUIRE(order_manager.cancelAll("BTC-PERPETUAL") == 1);
+        REQUIRE(order_manager.openOrderCount("BTC-PERPETUAL") == 0);
+        REQUIRE(order_manager.openOrderCount("ETH-PERPETUAL") == 1);
+    }
+    
+    SECTION("Cancel a side from an ack callback") {
+        // One request thread: waiting on it from its own callback would never return
+        OrderManager single(api_client, 10000, 1);
+        for (int i = 0; i < 3; ++i) {
+            single.placeOrder("BTC-PERPETUAL", Order::Side::SELL, 50010.0 + i, 0.1);
+        }
+        REQUIRE(single.cancelAllAsync("BTC-PERPETUAL", Order::Side::BUY).get() == 0);
+        
+        std::promise<std::future<size_t>> inner;
+        single.placeOrderAsync("BTC-PERPETUAL", Order::Side::BUY, 49990.0, 0.1, Order::Type::LIMIT,
+            [&single, &inner](const OrderAck&) {
+                inner.set_value(single.cancelAllAsync("BTC-PERPETUAL", Order::Side::SELL));
+            });
+        REQUIRE(inner.get_future().get().get() == 3);
+        REQUIRE(single.getOpenOrders("BTC-PERPETUAL", Order::Side::SELL).empty());
+        REQUIRE(single.openOrderCount("BTC-PERPETUAL") == 1);
+    }
+    
+    SECTION("Mass replace sends only the difference") {
+        MassQuoteResult first = order_manager.replaceQuotes("BTC-PERPETUAL", {
+            {Order::Side::BUY, 49990.0, 0.1}, {Order::Side::BUY, 49980.0, 0.1},
+            {Order::Side::SELL, 50010.0, 0.1}, {Order::Side::SELL, 50020.0, 0.1},
+        });
+        REQUIRE(first.placed == 4);
+        REQUIRE(first.failed == 0);
+        
+        // Bids shift down one level and shrink to one; asks unchanged plus a new level
+        MassQuoteResult second = order_manager.replaceQuotes("BTC-PERPETUAL", {
+            {Order::Side::BUY, 49970.0, 0.1},
+            {Order::Side::SELL, 50010.0, 0.1}, {Order::Side::SELL, 50020.0, 0.1},
+            {Order::Side::SELL, 50030.0, 0.2},
+        });
+        REQUIRE(second.kept == 2);
+        REQUIRE(second.modified == 1);
+        REQUIRE(second.cancelled == 1);
+        REQUIRE(second.placed == 1);
+        REQUIRE(second.failed == 0);
+        
+        REQUIRE(prices(Order::Side::BUY) == std::vector<double>{49970.0});
+        REQUIRE(prices(Order::Side::SELL) == std::vector<double>{50010.0, 50020.0, 50030.0});
+        
+        // Replacing with the same ladder is a no-op
+        MassQuoteResult third = order_manager.replaceQuotes("BTC-PERPETUAL", {
+            {Order::Side::BUY, 49970.0, 0.1},
+            {Order::Side::SELL, 50010.0, 0.1}, {Order::Side::SELL, 50020.0, 0.1},
+            {Order::Side::SELL, 50030.0, 0.2},
+        });
+        REQUIRE(third.kept == 4);
+        REQUIRE(third.modified + third.cancelled + third.placed == 0);
+    }
+}
+
+TEST_CASE("OrderManager lock-free order state", "[order_manager]") {
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    OrderManager order_manager(api_client, 1);
+    
+    SECTION("State follows each change") {
+        std::string label = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.4);
+        OrderHandle handle = order_manager.findHandle(label);
+        
+        OrderState state;
+        REQUIRE(order_manager.getOrderState(handle, state));
+        REQUIRE(state.status == Order::Status::OPEN);
+        REQUIRE(state.price == 50000.0);
+        
+        order_manager.onOrderUpdate(R"({"order_id": ")" + label + R"(", "order_state": "open", "filled_amount": 0.1})");
+        REQUIRE(order_manager.getOrderState(handle, state));
+        REQUIRE(state.status == Order::Status::PARTIALLY_FILLED);
+        REQUIRE(state.filled_amount == 0.1);
+        
+        REQUIRE(order_manager.modifyOrder(label, 50100.0, 0.5));
+        REQUIRE(order_manager.getOrderState(handle, state));
+        REQUIRE(state.price == 50100.0);
+        REQUIRE(state.amount == 0.5);
+        
+        REQUIRE(order_manager.cancelOrder(label));
+        REQUIRE(order_manager.getOrderState(handle, state));
+        REQUIRE(state.status == Order::Status::CANCELLED);
+    }
+    
+    SECTION("Stale handles stop resolving once the slot is reused") {
+        std::string first = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1);
+        OrderHandle handle = order_manager.findHandle(first);
+        REQUIRE(order_manager.cancelOrder(first));
+        
+        // Evicts the first order from the one-entry history ring, freeing its slot
+        std::string second = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1);
+        REQUIRE(order_manager.cancelOrder(second));
+        std::string third = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1);
+        
+        OrderState state;
+        REQUIRE(OrderTable::slotOf(order_manager.findHandle(third)) == OrderTable::slotOf(handle));
+        REQUIRE_FALSE(order_manager.getOrderState(handle, state));
+    }
+    
+    SECTION("Readers see consistent snapshots while the writer updates") {
+        struct Pair { int64_t first; int64_t second; };
+        SeqLock<Pair> lock;
+        std::atomic<bool> done{false};
+        std::thread writer([&lock, &done]() {
+            for (int64_t i = 1; i <= 200000; ++i) {
+                lock.store(Pair{i, -i});
+            }
+            done = true;
+        });
+        
+        bool consistent = true;
+        while (!done) {
+            auto value = lock.load();
+            consistent = consistent && value.first == -value.second;
+        }
+        writer.join();
+        REQUIRE(consistent);
+        REQUIRE(lock.load().first == 200000);
+    }
+}
+
+TEST_CASE("OrderManager open-order index and history", "[order_manager]") {
+    ApiClient::Auth auth;
+    auth.client_id = "test-client";
+    auth.client_secret = "test-secret";
+    auto api_client = std::make_shared<ApiClient>(auth);
+    
+    // Keep at most two terminal orders in memory
+    OrderManager order_manager(api_client, 2);
+    std::vector<std::string> archived;
+    order_manager.setArchiveHandler([&archived](const Order& order) {
+        archived.push_back(order.order_id);
+    });
+    
+    auto fill = [&order_manager](const std::string& order_id) {
+        order_manager.onOrderUpdate(R"({"order_id": ")" + order_id + R"(", "state": "filled", "filled_amount": 0.1})");
+    };
+    
+    std::string bid1 = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1);
+    std::string bid2 = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 49990.0, 0.1);
+    std::string ask1 = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::SELL, 50010.0, 0.1);
+    std::string eth = order_manager.placeOrder("ETH-PERPETUAL", Order::Side::SELL, 3000.0, 1.0);
+    
+    SECTION("Queries by instrument and side") {
+        auto bids = order_manager.getOpenOrders("BTC-PERPETUAL", Order::Side::BUY);
+        REQUIRE(bids.size() == 2);
+        REQUIRE(bids[0].order_id == bid2);  // newest first
+        REQUIRE(bids[1].order_id == bid1);
+        
+        REQUIRE(order_manager.getOpenOrders("BTC-PERPETUAL").size() == 3);
+        REQUIRE(order_manager.getOpenOrders("ETH-PERPETUAL", Order::Side::BUY).empty());
+        REQUIRE(order_manager.getOpenOrders("SOL-PERPETUAL").empty());
+        REQUIRE(order_manager.openOrderCount("BTC-PERPETUAL") == 3);
+    }
+    
+    SECTION("Terminal orders leave the open index") {
+        REQUIRE(order_manager.cancelOrder(bid1));
+        fill(ask1);
+        
+        auto btc = order_manager.getOpenOrders("BTC-PERPETUAL");
+        REQUIRE(btc.size() == 1);
+        REQUIRE(btc[0].order_id == bid2);
+        REQUIRE(order_manager.getOpenOrders().size() == 2);
+        
+        // Still queryable from the history ring
+        REQUIRE(order_manager.getOrder(bid1).status == Order::Status::CANCELLED);
+        REQUIRE(order_manager.getOrder(ask1).status == Order::Status::FILLED);
+        REQUIRE(archived.empty());
+    }
+    
+    SECTION("History ring evicts the oldest terminal order") {
+        REQUIRE(order_manager.cancelOrder(bid1));
+        fill(ask1);
+        fill(eth);
+        
+        REQUIRE(archived == std::vector<std::string>{bid1});
+        REQUIRE(order_manager.getOrder(bid1).status == Order::Status::REJECTED);
+        REQUIRE(order_manager.getAllOrders().size() == 3);
+        REQUIRE(order_manager.getOpenOrders().size() == 1);
+    }
+    
+    SECTION("Terminal orders stay terminal") {
+        auto update = [&order_manager](const std::string& order_id, const std::string& state, double filled) {
+            order_manager.onOrderUpdate(R"({"order_id": ")" + order_id + R"(", "order_state": ")" + state +
+                                        R"(", "filled_amount": )" + std::to_string(filled) + "}");
+        };
+        
+        // A stale open update after the cancel neither reopens the order nor lowers its fill
+        update(bid1, "open", 0.05);
+        REQUIRE(order_manager.cancelOrder(bid1));
+        update(bid1, "open", 0.0);
+        Order cancelled = order_manager.getOrder(bid1);
+        REQUIRE(cancelled.status == Order::Status::CANCELLED);
+        REQUIRE(cancelled.filled_amount == 0.05);
+        REQUIRE(order_manager.getOpenOrders("BTC-PERPETUAL", Order::Side::BUY).size() == 1);
+        
+        fill(ask1);
+        update(ask1, "open", 0.0);
+        update(ask1, "cancelled", 0.0);
+        REQUIRE(order_manager.getOrder(ask1).status == Order::Status::FILLED);
+        REQUIRE(order_manager.getOrder(ask1).filled_amount == 0.1);
+        
+        // Each terminal order enters the history ring once
+        fill(eth);
+        REQUIRE(archived == std::vector<std::string>{bid1});
+        REQUIRE(order_manager.getAllOrders().size() == 3);
+    }
+    
+    SECTION("Eviction hands orders over outside the order lock") {
+        // The handler may call back into the manager
+        size_t open_at_eviction = 0;
+        order_manager.setArchiveHandler([&](const Order& order) {
+            archived.push_back(order.order_id);
+            open_at_eviction = order_manager.getOpenOrders().size();
+        });
+        
+        REQUIRE(order_manager.cancelOrder(bid1));
+        fill(ask1);
+        fill(eth);
+        
+        REQUIRE(archived == std::vector<std::string>{bid1});
+        REQUIRE(open_at_eviction == 1);
+    }
+}
+
+TEST_CASE("PositionEngine fills and PnL", "[order_manager]") {
+    PositionEngine engine;
+    
+    SECTION("Instrument ids are dense and stable") {
+        std::vector<InstrumentId> ids;
+        for (int i = 0; i < 1000; ++i) {
+            ids.push_back(engine.instrumentId("INST-" + std::to_string(i)));
+        }
+        for (int i = 0; i < 1000; ++i) {
+            REQUIRE(ids[i] == static_cast<InstrumentId>(i));
+            REQUIRE(engine.findInstrument("INST-" + std::to_string(i)) == ids[i]);
+            REQUIRE(engine.instrumentId("INST-" + std::to_string(i)) == ids[i]);
+        }
+        REQUIRE(engine.findInstrument("UNKNOWN") == PositionEngine::kInvalidInstrument);
+    }
+    
+    // Linear: amounts in BTC, PnL in USDC
+    auto fill = [&engine](Order::Side side, double price, double amount,
+                          const std::string& instrument = "BTC_USDC-PERPETUAL") {
+        Trade trade;
+        trade.instrument = instrument;
+        trade.side = side;
+        trade.price = price;
+        trade.amount = amount;
+        trade.timestamp = 1;
+        engine.applyFill(trade);
+    };
+    
+    SECTION("Adding to a position averages the entry") {
+        fill(Order::Side::BUY, 100.0, 1.0);
+        fill(Order::Side::BUY, 110.0, 3.0);
+        
+        PositionState state = engine.position("BTC_USDC-PERPETUAL");
+        REQUIRE(state.size == 4.0);
+        REQUIRE(state.average_price == Approx(107.5));
+        REQUIRE(state.realized_pnl == 0.0);
+        
+        InstrumentId id = engine.findInstrument("BTC_USDC-PERPETUAL");
+        REQUIRE(engine.netPosition(id) == 4.0);
+    }
+    
+    SECTION("Reducing realizes PnL and keeps the entry") {
+        fill(Order::Side::BUY, 100.0, 2.0);
+        fill(Order::Side::SELL, 120.0, 0.5);
+        
+        PositionState state = engine.position("BTC_USDC-PERPETUAL");
+        REQUIRE(state.size == 1.5);
+        REQUIRE(state.average_price == 100.0);
+        REQUIRE(state.realized_pnl == Approx(10.0));
+    }
+    
+    SECTION("Flipping opens the remainder at the fill price") {
+        fill(Order::Side::SELL, 100.0, 1.0);
+        fill(Order::Side::BUY, 90.0, 3.0);
+        
+        PositionState state = engine.position("BTC_USDC-PERPETUAL");
+        REQUIRE(state.size == 2.0);
+        REQUIRE(state.average_price == 90.0);
+        REQUIRE(state.realized_pnl == Approx(10.0));
+        
+        fill(Order::Side::SELL, 95.0, 2.0);
+        state = engine.position("BTC_USDC-PERPETUAL");
+        REQUIRE(state.size == 0.0);
+        REQUIRE(state.average_price == 0.0);
+        REQUIRE(state.realized_pnl == Approx(20.0));
+        REQUIRE(engine.netPositions().empty());
+    }
+    
+    SECTION("Unrealized PnL follows the mark") {
+        fill(Order::Side::SELL, 100.0, 2.0);
+        engine.updateMark("BTC_USDC-PERPETUAL", 97.0);
+        
+        PositionState state = engine.position("BTC_USDC-PERPETUAL");
+        REQUIRE(state.unrealized_pnl == Approx(6.0));
+        REQUIRE(engine.totalUnrealizedPnl() == Approx(6.0));
+        
+        engine.updateMark("BTC_USDC-PERPETUAL", 101.0);
+        REQUIRE(engine.position("BTC_USDC-PERPETUAL").unrealized_pnl == Approx(-2.0));
+    }
+    
+    SECTION("Contract kind follows the instrument name") {
+        REQUIRE(PositionEngine::defaultContractKind("BTC-PERPETUAL") == ContractKind::INVERSE);
+        REQUIRE(PositionEngine::defaultContractKind("ETH-27DEC24") == ContractKind::INVERSE);
+        REQUIRE(PositionEngine::defaultContractKind("BTC_USDC-PERPETUAL") == ContractKind::LINEAR);
+        REQUIRE(PositionEngine::defaultContractKind("ETH_USDT-PERPETUAL") == ContractKind::LINEAR);
+        
+        engine.instrumentId("BTC-PERPETUAL");
+        REQUIRE(engine.position("BTC-PERPETUAL").contract == ContractKind::INVERSE);
+    }
+    
+    SECTION("Inverse fills average harmonically and realize PnL in coin") {
+        // Amounts in USD contracts
+        fill(Order::Side::BUY, 50000.0, 10000.0, "BTC-PERPETUAL");
+        fill(Order::Side::BUY, 40000.0, 10000.0, "BTC-PERPETUAL");
+        
+        PositionState state = engine.position("BTC-PERPETUAL");
+        REQUIRE(state.size == 20000.0);
+        REQUIRE(state.average_price == Approx(20000.0 / 0.45));
+        
+        fill(Order::Side::SELL, 50000.0, 10000.0, "BTC-PERPETUAL");
+        state = engine.position("BTC-PERPETUAL");
+        REQUIRE(state.size == 10000.0);
+        REQUIRE(state.average_price == Approx(20000.0 / 0.45));
+        REQUIRE(state.realized_pnl == Approx(0.025));
+        
+        engine.updateMark("BTC-PERPETUAL", 40000.0);
+        REQUIRE(engine.position("BTC-PERPETUAL").unrealized_pnl == Approx(-0.025));
+        
+        // A short gains coin as the price falls
+        fill(Order::Side::SELL, 40000.0, 30000.0, "BTC-PERPETUAL");
+        state = engine.position("BTC-PERPETUAL");
+        REQUIRE(state.size == -20000.0);
+        REQUIRE(state.average_price == 40000.0);
+        engine.updateMark("BTC-PERPETUAL", 32000.0);
+        REQUIRE(engine.position("BTC-PERPETUAL").unrealized_pnl == Approx(0.125));
+    }
+    
+    SECTION("Contract kind can be overridden") {
+        fill(Order::Side::BUY, 100.0, 2.0, "CUSTOM-PERPETUAL");
+        engine.updateMark("CUSTOM-PERPETUAL", 110.0);
+        REQUIRE(engine.position("CUSTOM-PERPETUAL").unrealized_pnl == Approx(2.0 * (1.0 / 100.0 - 1.0 / 110.0)));
+        
+        engine.setContractKind("CUSTOM-PERPETUAL", ContractKind::LINEAR);
+        PositionState state = engine.position("CUSTOM-PERPETUAL");
+        REQUIRE(state.contract == ContractKind::LINEAR);
+        REQUIRE(state.unrealized_pnl == Approx(20.0));
+    }
+    
+    SECTION("Unknown instruments read as flat") {
+        REQUIRE(engine.findInstrument("ETH-PERPETUAL") == PositionEngine::kInvalidInstrument);
+        REQUIRE(engine.netPosition(PositionEngine::kInvalidInstrument) == 0.0);
+        REQUIRE(engine.position("ETH-PERPETUAL").size == 0.0);
+    }
+}
+
+TEST_CASE("OrderTable handles and indexes", "[order_manager]") {
+    OrderTable table;
+    
+    auto makeOrder = [](const std::string& order_id, const std::string& label) {
+        Order order;
+        order.order_id = order_id;
+        order.label = label;
+        order.instrument = "BTC-PERPETUAL";
+        return order;
+    };
+    
+    SECTION("Lookup by id and label") {
+        OrderHandle a = table.insert(makeOrder("1001", "quote-a"));
+        OrderHandle b = table.insert(makeOrder("1002", ""));
+        
+        REQUIRE(table.size() == 2);
+        REQUIRE(table.findById("1001") == a);
+        REQUIRE(table.findById("1002") == b);
+        REQUIRE(table.findByLabel("quote-a") == a);
+        REQUIRE(table.findById("1003") == OrderTable::kInvalidHandle);
+        REQUIRE(table.findByLabel("") == OrderTable::kInvalidHandle);
+        REQUIRE(table.get(b)->order_id == "1002");
+    }
+    
+    SECTION("Instrument id kept with the entry") {
+        OrderHandle a = table.insert(makeOrder("1001", "quote-a"), 7);
+        OrderHandle b = table.insert(makeOrder("1002", ""));
+        
+        REQUIRE(table.instrumentIdOf(a) == 7);
+        REQUIRE(table.instrumentIdOf(b) == OrderTable::kNoInstrument);
+        
+        table.erase(a);
+        REQUIRE(table.instrumentIdOf(a) == OrderTable::kNoInstrument);
+    }
+    
+    SECTION("Erased handles go stale when the slot is reused") {
+        OrderHandle a = table.insert(makeOrder("1001", "quote-a"));
+        REQUIRE(table.erase(a));
+        REQUIRE_FALSE(table.erase(a));
+        REQUIRE(table.get(a) == nullptr);
+        REQUIRE(table.findById("1001") == OrderTable::kInvalidHandle);
+        REQUIRE(table.findByLabel("quote-a") == OrderTable::kInvalidHandle);
+        
+        OrderHandle b = table.insert(makeOrder("1002", ""));
+        REQUIRE(OrderTable::slotOf(b) == OrderTable::slotOf(a));
+        REQUIRE(b != a);
+        REQUIRE(table.get(a) == nullptr);
+    }
+    
+    SECTION("Binding an exchange id after insert") {
+        OrderHandle a = table.insert(makeOrder("", "quote-a"));
+        REQUIRE(table.bindId(a, "2001"));
+        REQUIRE(table.findById("2001") == a);
+        REQUIRE(table.bindId(a, "2002"));
+        REQUIRE(table.findById("2001") == OrderTable::kInvalidHandle);
+        REQUIRE(table.findById("2002") == a);
+    }
+    
+    SECTION("Indexes survive growth and churn") {
+        std::vector<OrderHandle> handles;
+        for (int i = 0; i < 5000; ++i) {
+            handles.push_back(table.insert(makeOrder(std::to_string(i), "l" + std::to_string(i))));
+        }
+        for (int i = 0; i < 5000; i += 2) {
+            REQUIRE(table.erase(handles[i]));
+        }
+        REQUIRE(table.size() == 2500);
+        
+        Order* kept = table.get(handles[4999]);
+        for (int i = 5000; i < 7500; ++i) {
+            table.insert(makeOrder(std::to_string(i), ""));
+        }
+        REQUIRE(table.get(handles[4999]) == kept);
+        
+        for (int i = 0; i < 7500; ++i) {
+            bool live = i >= 5000 || i % 2 == 1;
+            OrderHandle handle = table.findById(std::to_string(i));
+            REQUIRE((handle != OrderTable::kInvalidHandle) == live);
+            if (live) {
+                REQUIRE(table.get(handle)->order_id == std::to_string(i));
+            }
+        }
+    }
+}
+
+TEST_CASE("OrderArchive on-disk history", "[order_manager]") {
+    std::string path = (std::filesystem::temp_directory_path() / "deribit_order_archive_test.log").string();
+    std::filesystem::remove(path);
+    
+    auto makeOrder = [](int i) {
+        Order order;
+        order.order_id = "order_" + std::to_string(i);
+        order.label = i % 2 ? "quote" : "";
+        order.instrument = "BTC-PERPETUAL";
+        order.side = Order::Side::SELL;
+        order.type = Order::Type::LIMIT;
+        order.price = 50000.0 + i;
+        order.amount = 0.1;
+        order.filled_amount = 0.1;
+        order.status = Order::Status::FILLED;
+        order.creation_timestamp = 1000 + i;
+        order.last_update_timestamp = 2000 + i;
+        return order;
+    };
+    
+    SECTION("Append, page and find") {
+        OrderArchive archive(path, 16);
+        REQUIRE(archive.isOpen());
+        for (int i = 0; i < 100; ++i) {
+            archive.append(makeOrder(i));
+        }
+        REQUIRE(archive.size() == 100);
+        
+        auto page = archive.read(30, 5);
+        REQUIRE(page.size() == 5);
+        REQUIRE(page[0].order_id == "order_30");
+        REQUIRE(page[4].price == 50034.0);
+        REQUIRE(page[1].label == "quote");
+        REQUIRE(page[0].status == Order::Status::FILLED);
+        
+        auto newest = archive.readNewest(0, 3);
+        REQUIRE(newest.size() == 3);
+        REQUIRE(newest[0].order_id == "order_99");
+        REQUIRE(newest[2].order_id == "order_97");
+        REQUIRE(archive.readNewest(98, 10).size() == 2);
+        
+        auto since = archive.readSince(2090, 100);
+        REQUIRE(since.size() == 10);
+        REQUIRE(since[0].order_id == "order_90");
+        
+        Order found;
+        REQUIRE(archive.find("order_42", found));
+        REQUIRE(found.creation_timestamp == 1042);
+        REQUIRE_FALSE(archive.find("order_100", found));
+        REQUIRE_FALSE(archive.find("", found));
+        
+        // Labels are indexed too; the newest record carrying one wins
+        REQUIRE(archive.find("quote", found));
+        REQUIRE(found.order_id == "order_99");
+    }
+    
+    SECTION("Index is rebuilt on reopen and a torn record is dropped") {
+        {
+            OrderArchive archive(path, 16);
+            for (int i = 0; i < 40; ++i) {
+                archive.append(makeOrder(i));
+            }
+        }
+        {
+            std::ofstream torn(path, std::ios::binary | std::ios::app);
+            torn.write("\x40\x00\x00\x00partial", 11);
+        }
+        
+        OrderArchive archive(path, 16);
+        REQUIRE(archive.size() == 40);
+        archive.append(makeOrder(40));
+        REQUIRE(archive.size() == 41);
+        REQUIRE(archive.readNewest(0, 1)[0].order_id == "order_40");
+        
+        Order found;
+        REQUIRE(archive.find("order_7", found));
+    }
+    
+    SECTION("OrderManager pages through memory and archive") {
+        ApiClient::Auth auth;
+        auto api_client = std::make_shared<ApiClient>(auth);
+        OrderManager order_manager(api_client, 1);
+        order_manager.setArchive(std::make_shared<OrderArchive>(path, 16));
+        
+        std::vector<std::string> ids;
+        for (int i = 0; i < 4; ++i) {
+            ids.push_back(order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1));
+            REQUIRE(order_manager.cancelOrder(ids.back()));
+        }
+        std::string open = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 49000.0, 0.1);
+        
+        // One terminal order stays in memory, three went to disk
+        REQUIRE(order_manager.getAllOrders().size() == 2);
+        auto page = order_manager.getAllOrders(0, 10);
+        REQUIRE(page.size() == 5);
+        REQUIRE(page[0].order_id == open);
+        REQUIRE(page[1].order_id == ids[3]);
+        REQUIRE(page[2].order_id == ids[2]);
+        REQUIRE(page[4].order_id == ids[0]);
+        
+        auto tail = order_manager.getAllOrders(3, 10);
+        REQUIRE(tail.size() == 2);
+        REQUIRE(tail[0].order_id == ids[1]);
+        
+        REQUIRE(order_manager.getOrder(ids[0]).status == Order::Status::CANCELLED);
+    }
+    
+    SECTION("OrderManager finds evicted orders by label") {
+        ApiClient::Auth auth;
+        auto api_client = std::make_shared<ApiClient>(auth);
+        OrderManager order_manager(api_client, 1);
+        order_manager.setArchive(std::make_shared<OrderArchive>(path, 16));
+        
+        // The exchange assigns ids distinct from the client labels
+        std::vector<std::string> labels;
+        for (int i = 0; i < 3; ++i) {
+            labels.push_back(order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 0.1));
+            order_manager.onOrderUpdate(R"({"order_id": "EX-)" + std::to_string(i) + R"(", "label": ")" +
+                                        labels.back() + R"(", "order_state": "cancelled", "filled_amount": 0.0})");
+        }
+        
+        Order evicted = order_manager.getOrder(labels[0]);
+        REQUIRE(evicted.status == Order::Status::CANCELLED);
+        REQUIRE(evicted.order_id == "EX-0");
+        REQUIRE(evicted.label == labels[0]);
+        REQUIRE(order_manager.getOrder("EX-1").label == labels[1]);
+    }
+    
+    std::filesystem::remove(path);
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include <memory>
+#include <string>
+
+// Define Catch version before including it
+#define CATCH_VERSION_MAJOR 2
+#define CATCH_VERSION_MINOR 13
+#define CATCH_VERSION_PATCH 9
+#include <catch2/catch.hpp>
+
+#include "risk_engine.h"
+#include "position_engine.h"
+#include "order_manager.h"
+#include "api_client.h"
+
+namespace {
+
+RiskOrder makeOrder(InstrumentId id, Order::Side side, double price, double amount) {
+    RiskOrder order;
+    order.instrument = id;
+    order.side = side;
+    order.price = price;
+    order.amount = amount;
+    return order;
+}
+
+} // namespace
+
+TEST_CASE("RiskEngine pre-trade rules", "[risk_engine]") {
+    auto positions = std::make_shared<PositionEngine>();
+    RiskEngine risk(positions);
+    InstrumentId btc = risk.instrumentId("BTC-PERPETUAL");
+    
+    SECTION("No limits accept everything") {
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 50000.0, 1000.0)) == RiskResult::ACCEPTED);
+    }
+    
+    SECTION("Unknown instrument") {
+        RiskOrder order = makeOrder(PositionEngine::kInvalidInstrument, Order::Side::BUY, 1.0, 1.0);
+        REQUIRE(risk.check(order) == RiskResult::UNKNOWN_INSTRUMENT);
+    }
+    
+    SECTION("Max order size") {
+        RiskLimits limits;
+        limits.max_order_size = 5.0;
+        risk.setLimits("BTC-PERPETUAL", limits);
+        
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 50000.0, 5.0)) == RiskResult::ACCEPTED);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::SELL, 50000.0, 5.5)) == RiskResult::ORDER_SIZE);
+        REQUIRE(risk.rejectedCount(RiskResult::ORDER_SIZE) == 1);
+    }
+    
+    SECTION("Max notional, with market orders valued at the mid") {
+        RiskLimits limits;
+        limits.max_notional = 100000.0;
+        risk.setLimits("BTC-PERPETUAL", limits);
+        
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 50000.0, 2.0)) == RiskResult::ACCEPTED);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 50000.0, 2.1)) == RiskResult::NOTIONAL);
+        
+        // Before any mid a market order can't be valued, so it is refused
+        RiskOrder market = makeOrder(btc, Order::Side::BUY, 0.0, 2.0);
+        market.type = Order::Type::MARKET;
+        REQUIRE(risk.check(market) == RiskResult::NO_MID);
+        REQUIRE(risk.rejectedCount(RiskResult::NO_MID) == 1);
+        
+        risk.updateMid("BTC-PERPETUAL", 60000.0);
+        REQUIRE(risk.check(market) == RiskResult::NOTIONAL);
+        market.amount = 1.0;
+        REQUIRE(risk.check(market) == RiskResult::ACCEPTED);
+    }
+    
+    SECTION("Price band around the live mid") {
+        RiskLimits limits;
+        limits.price_band = 0.01;
+        risk.setLimits("BTC-PERPETUAL", limits);
+        
+        // No mid yet: the band can't be applied
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 10.0, 1.0)) == RiskResult::ACCEPTED);
+        
+        risk.updateMid("BTC-PERPETUAL", 50000.0);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 49600.0, 1.0)) == RiskResult::ACCEPTED);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 49400.0, 1.0)) == RiskResult::PRICE_BAND);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::SELL, 50600.0, 1.0)) == RiskResult::PRICE_BAND);
+        
+        // The band follows the mid
+        risk.updateMid("BTC-PERPETUAL", 49500.0);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 49400.0, 1.0)) == RiskResult::ACCEPTED);
+        
+        RiskOrder market = makeOrder(btc, Order::Side::BUY, 0.0, 1.0);
+        market.type = Order::Type::MARKET;
+        REQUIRE(risk.check(market) == RiskResult::ACCEPTED);
+    }
+    
+    SECTION("Max open orders per instrument") {
+        RiskLimits limits;
+        limits.max_open_orders = 2;
+        risk.setLimits("BTC-PERPETUAL", limits);
+        
+        RiskOrder order = makeOrder(btc, Order::Side::BUY, 50000.0, 1.0);
+        order.open_orders = 1;
+        REQUIRE(risk.check(order) == RiskResult::ACCEPTED);
+        order.open_orders = 2;
+        REQUIRE(risk.check(order) == RiskResult::OPEN_ORDERS);
+    }
+    
+    SECTION("Position limit allows reducing orders") {
+        RiskLimits limits;
+        limits.max_position = 3.0;
+        risk.setLimits("BTC-PERPETUAL", limits);
+        positions->setPosition("BTC-PERPETUAL", 2.5, 50000.0);
+        
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 50000.0, 0.5)) == RiskResult::ACCEPTED);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 50000.0, 1.0)) == RiskResult::POSITION);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::SELL, 50000.0, 5.5)) == RiskResult::ACCEPTED);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::SELL, 50000.0, 6.0)) == RiskResult::POSITION);
+        
+        // Already over the limit: only orders that shrink the position pass
+        positions->setPosition("BTC-PERPETUAL", 4.0, 50000.0);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::SELL, 50000.0, 0.5)) == RiskResult::ACCEPTED);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 50000.0, 0.1)) == RiskResult::POSITION);
+    }
+    
+    SECTION("Message-rate throttle") {
+        risk.setThrottle(10, 1000000);  // 10 per millisecond
+        RiskOrder order = makeOrder(btc, Order::Side::BUY, 50000.0, 1.0);
+        int64_t now = 5000000;
+        
+        for (int i = 0; i < 10; ++i) {
+            REQUIRE(risk.check(order, now) == RiskResult::ACCEPTED);
+        }
+        REQUIRE(risk.check(order, now) == RiskResult::THROTTLED);
+        
+        // Credit returns at the configured rate
+        REQUIRE(risk.check(order, now + 100000) == RiskResult::ACCEPTED);
+        REQUIRE(risk.check(order, now + 100000) == RiskResult::THROTTLED);
+        
+        // Orders failing another rule don't spend credit
+        RiskLimits limits;
+        limits.max_order_size = 0.5;
+        risk.setLimits("BTC-PERPETUAL", limits);
+        REQUIRE(risk.check(order, now + 200000) == RiskResult::ORDER_SIZE);
+        order.amount = 0.1;
+        REQUIRE(risk.check(order, now + 200000) == RiskResult::ACCEPTED);
+    }
+    
+    SECTION("Default limits apply to instruments without their own") {
+        RiskLimits defaults;
+        defaults.max_order_size = 1.0;
+        risk.setDefaultLimits(defaults);
+        
+        RiskLimits btc_limits;
+        btc_limits.max_order_size = 10.0;
+        risk.setLimits("BTC-PERPETUAL", btc_limits);
+        
+        InstrumentId eth = risk.instrumentId("ETH-PERPETUAL");
+        REQUIRE(risk.check(makeOrder(eth, Order::Side::BUY, 3000.0, 2.0)) == RiskResult::ORDER_SIZE);
+        REQUIRE(risk.check(makeOrder(btc, Order::Side::BUY, 50000.0, 2.0)) == RiskResult::ACCEPTED);
+        REQUIRE(risk.limits("ETH-PERPETUAL").max_order_size == 1.0);
+        REQUIRE(risk.limits("BTC-PERPETUAL").max_order_size == 10.0);
+    }
+}
+
+TEST_CASE("OrderManager pre-trade risk gate", "[risk_engine]") {
+    ApiClient::Auth auth;
+    auto api_client = std::make_shared<ApiClient>(auth);
+    OrderManager order_manager(api_client);
+    auto risk = std::make_shared<RiskEngine>(order_manager.positionEngine());
+    
+    RiskLimits limits;
+    limits.max_order_size = 2.0;
+    limits.max_open_orders = 1;
+    risk->setDefaultLimits(limits);
+    order_manager.setRiskEngine(risk);
+    
+    SECTION("Failed placements are recorded but not sent") {
+        std::string label = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 3.0);
+        Order order = order_manager.getOrder(label);
+        REQUIRE(order.status == Order::Status::REJECTED);
+        REQUIRE(order.error_message == "Risk check failed: order size limit");
+        REQUIRE(order_manager.getOpenOrders().empty());
+        
+        OrderTicket ticket = order_manager.placeOrderAsync("BTC-PERPETUAL", Order::Side::SELL, 50000.0, 5.0);
+        OrderAck ack = ticket.ack.get();
+        REQUIRE_FALSE(ack.success);
+        REQUIRE(ack.order.status == Order::Status::REJECTED);
+    }
+    
+    SECTION("Open orders count against the limit") {
+        std::string first = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 1.0);
+        REQUIRE(order_manager.getOrder(first).status == Order::Status::OPEN);
+        
+        std::string second = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 49999.0, 1.0);
+        REQUIRE(order_manager.getOrder(second).status == Order::Status::REJECTED);
+        
+        // Other instruments have their own count
+        std::string eth = order_manager.placeOrder("ETH-PERPETUAL", Order::Side::BUY, 3000.0, 1.0);
+        REQUIRE(order_manager.getOrder(eth).status == Order::Status::OPEN);
+        
+        REQUIRE(order_manager.cancelOrder(first));
+        std::string third = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 49998.0, 1.0);
+        REQUIRE(order_manager.getOrder(third).status == Order::Status::OPEN);
+    }
+    
+    SECTION("Edits are checked too") {
+        std::string label = order_manager.placeOrder("BTC-PERPETUAL", Order::Side::BUY, 50000.0, 1.0);
+        REQUIRE(order_manager.modifyOrder(label, 50001.0, 2.0));
+        REQUIRE_FALSE(order_manager.modifyOrder(label, 50001.0, 4.0));
+        REQUIRE(order_manager.getOrder(label).amount == 2.0);
+    }
+}
\ No newline at end of file
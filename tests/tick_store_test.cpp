@@ -0,0 +1,158 @@
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Define Catch version before including it
+#define CATCH_VERSION_MAJOR 2
+#define CATCH_VERSION_MINOR 13
+#define CATCH_VERSION_PATCH 9
+#include <catch2/catch.hpp>
+
+#include "tick_store.h"
+#include "message_router.h"
+#include "market_data.h"
+#include "order_manager.h"
+
+TEST_CASE("TickStore columnar round trip", "[tick_store]") {
+    std::string root = (std::filesystem::temp_directory_path() / "deribit_tick_store_test").string();
+    std::filesystem::remove_all(root);
+    
+    // 2024-01-01 00:59:00 UTC, so the series crosses into the next hour
+    const int64_t start_ns = 1704070740LL * 1000000000LL;
+    const int64_t step_ns = 100000000;  // 100 ms
+    
+    TickStoreOptions options;
+    options.chunk_rows = 256;
+    options.book_levels = 3;
+    
+    SECTION("Quotes are chunked by hour and read back exactly") {
+        {
+            TickStoreWriter writer(root, options);
+            for (int i = 0; i < 1200; ++i) {
+                QuoteTick quote;
+                quote.timestamp_ns = start_ns + i * step_ns;
+                quote.bid_price = 42000.0 + (i % 7) * 0.5;
+                quote.bid_size = 1000.0 + i;
+                quote.ask_price = quote.bid_price + 0.5;
+                quote.ask_size = 250.25;
+                writer.addQuote("BTC-PERPETUAL", quote);
+            }
+            writer.flush();
+            REQUIRE(writer.rowsWritten() == 1200);
+        }
+        
+        REQUIRE(std::filesystem::exists(root + "/BTC-PERPETUAL/20240101-00.quotes"));
+        REQUIRE(std::filesystem::exists(root + "/BTC-PERPETUAL/20240101-01.quotes"));
+        
+        // Delta + varint keeps the columns far below the raw 40 bytes per row
+        size_t bytes = std::filesystem::file_size(root + "/BTC-PERPETUAL/20240101-00.quotes") +
+                       std::filesystem::file_size(root + "/BTC-PERPETUAL/20240101-01.quotes");
+        REQUIRE(bytes < 1200 * 16);
+        
+        TickStoreReader reader(root);
+        REQUIRE(reader.instruments() == std::vector<std::string>{"BTC-PERPETUAL"});
+        
+        std::vector<QuoteTick> all = reader.quotes("BTC-PERPETUAL", start_ns, start_ns + 1200 * step_ns);
+        REQUIRE(all.size() == 1200);
+        REQUIRE(all[0].timestamp_ns == start_ns);
+        REQUIRE(all[0].bid_price == 42000.0);
+        REQUIRE(all[13].bid_price == 42003.0);
+        REQUIRE(all[13].ask_price == 42003.5);
+        REQUIRE(all[1199].bid_size == 2199.0);
+        REQUIRE(all[1199].ask_size == 250.25);
+        
+        // A range inside the second hour only
+        int64_t hour_ns = 1704070800LL * 1000000000LL;
+        std::vector<QuoteTick> later = reader.quotes("BTC-PERPETUAL", hour_ns, hour_ns + 10 * step_ns);
+        REQUIRE(later.size() == 10);
+        REQUIRE(later[0].timestamp_ns == hour_ns);
+        
+        // As-of sampling at 1 s
+        std::vector<QuoteTick> samples = reader.sampleQuotes("BTC-PERPETUAL", start_ns + 50, start_ns + 5000000000LL,
+                                                             1000000000LL);
+        REQUIRE(samples.size() == 5);
+        REQUIRE(samples[1].timestamp_ns == start_ns + 1000000050);
+        REQUIRE(samples[1].bid_size == 1010.0);
+        
+        REQUIRE(reader.quotes("ETH-PERPETUAL", start_ns, start_ns + step_ns).empty());
+    }
+    
+    SECTION("Book snapshots and trades") {
+        {
+            TickStoreWriter writer(root, options);
+            
+            Orderbook orderbook;
+            orderbook.instrument = "ETH-PERPETUAL";
+            orderbook.timestamp = start_ns;
+            orderbook.bids = {{2300.05, 10.0}, {2300.0, 5.0}};
+            orderbook.asks = {{2300.1, 3.0}, {2300.15, 7.5}, {2300.2, 1.0}, {2300.25, 9.0}};
+            writer.onOrderbook(orderbook);
+            
+            MessageRouter router;
+            writer.registerRoutes(router);
+            router.route(R"({"jsonrpc": "2.0", "method": "subscription", "params": {
+                "channel": "trades.ETH-PERPETUAL.100ms",
+                "data": [{"instrument_name": "ETH-PERPETUAL", "price": 2300.1, "amount": 2.0,
+                          "direction": "buy", "timestamp": 1704070740001},
+                         {"instrument_name": "ETH-PERPETUAL", "price": 2300.05, "amount": 1.0,
+                          "direction": "sell", "timestamp": 1704070740002}]}})");
+        }
+        
+        TickStoreReader reader(root);
+        std::vector<BookTick> books = reader.books("ETH-PERPETUAL", start_ns, start_ns + step_ns);
+        REQUIRE(books.size() == 1);
+        REQUIRE(books[0].bids.size() == 2);
+        REQUIRE(books[0].asks.size() == 3);  // truncated to book_levels
+        REQUIRE(books[0].bids[0].price == Approx(2300.05));
+        REQUIRE(books[0].asks[2].size == 1.0);
+        
+        std::vector<QuoteTick> quotes = reader.quotes("ETH-PERPETUAL", start_ns, start_ns + step_ns);
+        REQUIRE(quotes.size() == 1);
+        REQUIRE(quotes[0].ask_price == Approx(2300.1));
+        
+        std::vector<TradeTick> trades = reader.trades("ETH-PERPETUAL", start_ns, start_ns + step_ns);
+        REQUIRE(trades.size() == 2);
+        REQUIRE(trades[0].timestamp_ns == start_ns + 1000000);
+        REQUIRE(trades[0].side == Order::Side::BUY);
+        REQUIRE(trades[1].side == Order::Side::SELL);
+        REQUIRE(trades[1].price == Approx(2300.05));
+    }
+    
+    SECTION("Public trades share the router with market data and orders") {
+        // Wired as in live mode: one router for book.*, trades.* and user.*
+        auto api_client = std::make_shared<ApiClient>(ApiClient::Auth{});
+        auto router = std::make_shared<MessageRouter>();
+        MarketDataClient market_data(api_client);
+        market_data.setRouter(router);
+        OrderManager order_manager(api_client);
+        order_manager.registerRoutes(*router);
+        {
+            TickStoreWriter writer(root, options);
+            writer.registerRoutes(*router);
+            
+            router->route(R"({"jsonrpc": "2.0", "method": "subscription", "params": {
+                "channel": "trades.BTC-PERPETUAL.100ms",
+                "data": [{"instrument_name": "BTC-PERPETUAL", "price": 42000.5, "amount": 30.0,
+                          "direction": "sell", "timestamp": 1704070740005}]}})");
+            
+            // Own fills go to the order manager, not the public tape
+            router->route(R"({"jsonrpc": "2.0", "method": "subscription", "params": {
+                "channel": "user.trades.any.any.raw",
+                "data": [{"instrument_name": "BTC-PERPETUAL", "price": 42001.0, "amount": 10.0,
+                          "direction": "buy", "timestamp": 1704070740006}]}})");
+        }
+        
+        TickStoreReader reader(root);
+        std::vector<TradeTick> trades = reader.trades("BTC-PERPETUAL", start_ns, start_ns + step_ns);
+        REQUIRE(trades.size() == 1);
+        REQUIRE(trades[0].timestamp_ns == start_ns + 5000000);
+        REQUIRE(trades[0].price == Approx(42000.5));
+        REQUIRE(trades[0].amount == 30.0);
+        REQUIRE(trades[0].side == Order::Side::SELL);
+        REQUIRE(order_manager.positionEngine()->position("BTC-PERPETUAL").size == 10.0);
+        REQUIRE(router->unroutedCount() == 0);
+    }
+    
+    std::filesystem::remove_all(root);
+}
\ No newline at end of file
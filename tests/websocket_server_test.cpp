@@ -0,0 +1,181 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+// Define Catch version before including it
+#define CATCH_VERSION_MAJOR 2
+#define CATCH_VERSION_MINOR 13
+#define CATCH_VERSION_PATCH 9
+#include <catch2/catch.hpp>
+
+#include "websocket_server.h"
+#include "subscriber_registry.h"
+#include "connection_table.h"
+
+namespace {
+
+// Connection that records what it was sent
+class MockConnection : public WebSocketConnection {
+public:
+    explicit MockConnection(size_t worker = 0) : worker_(worker) {}
+    
+    void send(const std::string& message) override { sent.push_back(message); }
+    void close() override {}
+    size_t getWorker() const override { return worker_; }
+    
+    std::vector<std::string> sent;
+    
+private:
+    size_t worker_;
+};
+
+}
+
+TEST_CASE("WebSocketServer wildcard patterns", "[websocket_server]") {
+    SECTION("Exact match") {
+        REQUIRE(WebSocketServer::matchesPattern("BTC-PERPETUAL", "BTC-PERPETUAL"));
+        REQUIRE_FALSE(WebSocketServer::matchesPattern("BTC-PERPETUAL", "ETH-PERPETUAL"));
+    }
+    
+    SECTION("Prefix wildcard") {
+        REQUIRE(WebSocketServer::matchesPattern("BTC-*", "BTC-PERPETUAL"));
+        REQUIRE(WebSocketServer::matchesPattern("BTC-*", "BTC-27DEC24-60000-C"));
+        REQUIRE_FALSE(WebSocketServer::matchesPattern("BTC-*", "ETH-PERPETUAL"));
+    }
+    
+    SECTION("Wildcards anywhere") {
+        REQUIRE(WebSocketServer::matchesPattern("*-PERPETUAL", "ETH-PERPETUAL"));
+        REQUIRE(WebSocketServer::matchesPattern("BTC-*-C", "BTC-27DEC24-60000-C"));
+        REQUIRE_FALSE(WebSocketServer::matchesPattern("BTC-*-C", "BTC-27DEC24-60000-P"));
+        REQUIRE(WebSocketServer::matchesPattern("*", "ANY"));
+    }
+}
+
+
+TEST_CASE("SubscriberRegistry slot bitsets", "[websocket_server]") {
+    SubscriberRegistry registry(2, 128, 4);
+    
+    SECTION("Add and remove subscribers") {
+        registry.add(3, {"BTC-PERPETUAL", "ETH-PERPETUAL"});
+        registry.add(130, {"BTC-PERPETUAL"});
+        registry.add(130, {"BTC-PERPETUAL"});
+        
+        auto btc = registry.subscribers("BTC-PERPETUAL");
+        REQUIRE(btc->count() == 2);
+        REQUIRE(btc->count(0) == 1);
+        REQUIRE(btc->count(1) == 1);
+        REQUIRE(registry.subscribers("ETH-PERPETUAL")->count() == 1);
+        REQUIRE(registry.subscribers("SOL-PERPETUAL") == nullptr);
+        REQUIRE(registry.instrumentCount() == 2);
+        
+        registry.remove(3, {"BTC-PERPETUAL", "ETH-PERPETUAL"});
+        REQUIRE(btc->count() == 1);
+        REQUIRE(registry.subscribers("ETH-PERPETUAL") == nullptr);
+        REQUIRE(registry.instrumentCount() == 1);
+    }
+    
+    SECTION("Entries are dropped with their last subscriber") {
+        for (int i = 0; i < 100; ++i) {
+            registry.add(5, {"JUNK-" + std::to_string(i)});
+        }
+        REQUIRE(registry.instrumentCount() == 100);
+        
+        for (int i = 0; i < 100; ++i) {
+            registry.remove(5, {"JUNK-" + std::to_string(i)});
+        }
+        REQUIRE(registry.instrumentCount() == 0);
+        REQUIRE(registry.subscribers("JUNK-0") == nullptr);
+        
+        // Re-subscribing creates a fresh entry
+        registry.add(7, {"JUNK-0"});
+        REQUIRE(registry.subscribers("JUNK-0")->test(7));
+        REQUIRE_FALSE(registry.subscribers("JUNK-0")->test(5));
+    }
+    
+    SECTION("Iteration visits each worker's slots in order") {
+        registry.add(0, {"BTC-PERPETUAL"});
+        registry.add(63, {"BTC-PERPETUAL"});
+        registry.add(64, {"BTC-PERPETUAL"});
+        registry.add(255, {"BTC-PERPETUAL"});
+        
+        auto btc = registry.subscribers("BTC-PERPETUAL");
+        std::vector<uint32_t> worker0, worker1, all;
+        btc->forEach(0, [&worker0](uint32_t slot) { worker0.push_back(slot); });
+        btc->forEach(1, [&worker1](uint32_t slot) { worker1.push_back(slot); });
+        btc->forEach([&all](uint32_t slot) { all.push_back(slot); });
+        
+        REQUIRE(worker0 == std::vector<uint32_t>{0, 63, 64});
+        REQUIRE(worker1 == std::vector<uint32_t>{255});
+        REQUIRE(all == std::vector<uint32_t>{0, 63, 64, 255});
+    }
+}
+
+TEST_CASE("ConnectionTable slot allocation", "[websocket_server]") {
+    ConnectionTable table(2, 2);
+    auto a = std::make_shared<MockConnection>();
+    auto b = std::make_shared<MockConnection>();
+    auto c = std::make_shared<MockConnection>();
+    
+    SECTION("Slots come from the worker's range") {
+        ConnectionId id_a = table.acquire(0, a);
+        ConnectionId id_b = table.acquire(1, b);
+        
+        REQUIRE(id_a == a->getId());
+        REQUIRE(ConnectionTable::slotOf(id_a) == 0);
+        REQUIRE(ConnectionTable::slotOf(id_b) == 2);
+        REQUIRE(table.workerOf(ConnectionTable::slotOf(id_b)) == 1);
+        REQUIRE(table.get(id_a) == a);
+        REQUIRE(table.size() == 2);
+    }
+    
+    SECTION("Released slots are recycled with a new generation") {
+        ConnectionId id_a = table.acquire(0, a);
+        table.release(id_a);
+        REQUIRE(table.get(id_a) == nullptr);
+        
+        ConnectionId id_c = table.acquire(0, c);
+        REQUIRE(ConnectionTable::slotOf(id_c) == ConnectionTable::slotOf(id_a));
+        REQUIRE(id_c != id_a);
+        
+        // A stale id neither resolves nor releases the new owner
+        table.release(id_a);
+        REQUIRE(table.get(id_a) == nullptr);
+        REQUIRE(table.get(id_c) == c);
+    }
+    
+    SECTION("Full worker range is refused") {
+        REQUIRE(table.acquire(0, a) != ConnectionTable::kInvalidId);
+        REQUIRE(table.acquire(0, b) != ConnectionTable::kInvalidId);
+        REQUIRE(table.acquire(0, c) == ConnectionTable::kInvalidId);
+    }
+}
+
+TEST_CASE("WebSocketServer subscriptions", "[websocket_server]") {
+    WebSocketServer server(0, 2, 8);
+    auto a = std::make_shared<MockConnection>(0);
+    auto b = std::make_shared<MockConnection>(1);
+    REQUIRE(server.addConnection(a));
+    REQUIRE(server.addConnection(b));
+    
+    SECTION("Broadcast reaches only subscribers") {
+        server.addSubscription(a, "BTC-PERPETUAL");
+        server.addSubscription(b, "ETH-PERPETUAL");
+        a->sent.clear();
+        b->sent.clear();
+        
+        server.broadcastToSubscribers("BTC-PERPETUAL", "btc");
+        REQUIRE(a->sent == std::vector<std::string>{"btc"});
+        REQUIRE(b->sent.empty());
+    }
+    
+    SECTION("Removing a connection drops its subscriptions") {
+        server.addSubscription(a, "BTC-PERPETUAL");
+        server.removeConnection(a);
+        a->sent.clear();
+        
+        server.broadcastToSubscribers("BTC-PERPETUAL", "btc");
+        REQUIRE(a->sent.empty());
+        REQUIRE(server.getSubscriptions(a).empty());
+        REQUIRE(server.connectionCount() == 1);
+    }
+}